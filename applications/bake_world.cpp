@@ -0,0 +1,70 @@
+// Headless world baker. Enable this file instead of main.cpp in
+// CMakeLists.txt and run it once. The game uploads the baked chunk meshes
+// from Config::World::BAKED_WORLD_FILE instead of generating them only when
+// Config::Rendering::HEIGHTMAP_TERRAIN is false; by default it draws the
+// terrain from height tiles and never opens the baked world.
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <noise/noise.h>
+#include <noise/tilecache.h>
+
+#include <general/Config.h>
+#include <general/JobSystem.h>
+#include <terrain/BakedWorld.h>
+#include <terrain/Chunk.h>
+#include <terrain/Heightfield.h>
+#include <terrain/Waterfall.h>
+
+using namespace noise;
+
+int main() {
+    const int worldSize = Config::World::SIZE;
+    auto start = std::chrono::steady_clock::now();
+
+    // Every hardware thread meshes chunks
+    JobSystem& jobs = JobSystem::getInstance();
+    JobCounter chunkJobs;
+
+    utils::NoiseMapTileCache tileCache(Config::Terrain::TILE_CACHE_DIR);
+    Heightfield heightfield;
+    heightfield.setTileCache(&tileCache);
+    heightfield.setSlopeMaps(true);
+    heightfield.build(2, 2, worldSize, worldSize);
+
+    std::vector<std::unique_ptr<Chunk>> chunks(worldSize * worldSize);
+    std::vector<std::vector<float>> meshes(worldSize * worldSize);
+    std::unique_ptr<Waterfall> waterfall;
+    for (int i = 0; i < worldSize; i++) {
+        for (int j = 0; j < worldSize; j++) {
+            std::vector<float>* mesh = &meshes[i * worldSize + j];
+            if (i == Config::World::WATERFALL_CHUNK_X && j == Config::World::WATERFALL_CHUNK_Z) {
+                // Same blocky terrain the game builds for the waterfall chunk
+                waterfall = std::make_unique<Waterfall>();
+                Waterfall* chunk = waterfall.get();
+                jobs.run(chunkJobs, [chunk, mesh, i, j] {
+                    chunk->create(Waterfall::CHUNK_SIZE * (i + 2), Waterfall::CHUNK_SIZE * (j + 2));
+                    *mesh = chunk->render();
+                });
+            } else {
+                Chunk* chunk = (chunks[i * worldSize + j] = std::make_unique<Chunk>()).get();
+                HeightfieldView view = heightfield.getChunkView(i + 2, j + 2);
+                jobs.run(chunkJobs, [chunk, mesh, view] {
+                    chunk->createSmoothLandscape(view);
+                    *mesh = chunk->renderSmooth();
+                });
+            }
+        }
+    }
+    jobs.wait(chunkJobs);
+
+    bool written = BakedWorld::bake(Config::World::BAKED_WORLD_FILE, worldSize, heightfield.getSourceHash(), meshes);
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "[BAKE] " << worldSize << "x" << worldSize << " chunks on " << jobs.getThreadCount()
+              << " threads in " << elapsed.count() << " ms" << std::endl;
+    return written ? 0 : 1;
+}
@@ -9,6 +9,7 @@
 #include <learnopengl/shader_m.h>
 
 #include <iostream>
+#include <chrono>
 
 #include <noise/noise.h>
 #include <noise/noiseutils.h>
@@ -19,7 +20,13 @@
 #include <general/VolumetricFog.h>
 #include <general/Rain.h>
 #include <general/Config.h>
+#include <general/SimulationThread.h>
+#include <general/JobSystem.h>
+#include <general/HeightmapTerrain.h>
+#include <terrain/BakedWorld.h>
 #include <terrain/Chunk.h>
+#include <terrain/Heightfield.h>
+#include <terrain/RegionStore.h>
 #include <terrain/Waterfall.h>
 #include <general/app_util.hpp>
 #include <general/water_plane.hpp>
@@ -28,7 +35,8 @@ using namespace noise;
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow *window);void renderWorld(VertexArrayWrapper &worldVAO, Shader& worldShader, Renderer& renderer, glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection, glm::vec4& plane);
+void processInput(GLFWwindow *window);void renderWorld(VertexArrayWrapper &worldVAO, Shader& worldShader, Renderer& renderer, glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection, glm::vec4& plane, const std::vector<int>& visibleChunks);
+void renderSmoothTerrain(VertexArrayWrapper &smoothVAO, Shader& smoothShader, Renderer& renderer, glm::mat4 &view, glm::mat4 &projection, glm::vec4& plane, const std::vector<int>& visibleChunks);
 
 // Use Config for all settings
 const int WORLD_SIZE = Config::World::SIZE;
@@ -66,12 +74,17 @@ int main()
     
     
     Shader worldShader(Config::Shaders::WORLD_SHADER);
+    Shader terrainShader(Config::Shaders::TERRAIN_SHADER);
+    Shader smoothShader(Config::Shaders::SMOOTH_SHADER);
     
     // Init Renderer
     Renderer renderer;
     
     // Create World Vertex Array
     VertexArrayWrapper worldVAO(Vertex_Normal_RGB_Optimized);
+
+    // Smooth chunk meshes carry packed normals, see Chunk::renderSmooth()
+    VertexArrayWrapper smoothVAO(Vertex_Smooth_Octahedral);
     
     // Create Volumetric Fog system
     VolumetricFog fog;
@@ -83,27 +96,117 @@ int main()
     std::vector<std::vector<std::unique_ptr<Chunk>>> chunks(WORLD_SIZE);
     std::unique_ptr<Waterfall> waterfall;  // Waterfall at chunk (7,7)
 
+    // Terrain generation and meshing run on the job system; GL uploads stay
+    // on this thread once every chunk has finished
+    JobSystem& jobs = JobSystem::getInstance();
+    JobCounter chunkJobs;
+    std::vector<std::vector<float>> chunkMeshes(WORLD_SIZE * WORLD_SIZE);
+
+    // One height map for the whole world; chunks read their part of it. It is
+    // kept on disk so that the next start maps it instead of generating it
+    utils::NoiseMapTileCache tileCache(Config::Terrain::TILE_CACHE_DIR);
+    Heightfield heightfield;
+    heightfield.setTileCache(&tileCache);
+
+    // Blocks of hand-built and edited chunks are saved in region files
+    RegionStore regions(Config::World::REGION_DIR);
+
+    // Chunk meshes baked by bake_world (or by an earlier start) are uploaded
+    // straight from the mapped file; only the waterfall's simulation is set up.
+    // Height tiles need no meshes at all, only the heightfield
+    BakedWorld bakedWorld;
+    const bool useHeightTiles = Config::Rendering::HEIGHTMAP_TERRAIN;
+    std::unique_ptr<HeightmapTerrain> terrain;
+    bool isBaked = !useHeightTiles &&
+                   bakedWorld.open(Config::World::BAKED_WORLD_FILE, WORLD_SIZE, heightfield.getSourceHash());
+    if (!isBaked) {
+        // Only meshed chunks read the slopes; height tiles shade from the samples
+        heightfield.setSlopeMaps(!useHeightTiles);
+        heightfield.build(2, 2, WORLD_SIZE, WORLD_SIZE);
+    }
+
     // Iterate through chunk grid
     for (int i = 0; i < WORLD_SIZE; i++) {
         for (int j = 0; j < WORLD_SIZE; j++) {
-            std::string key = "Chunk" + std::to_string(i) +","+ std::to_string(j);
-            
             // Create waterfall at configured position
             if (i == Config::World::WATERFALL_CHUNK_X && j == Config::World::WATERFALL_CHUNK_Z) {
                 std::cout << "Creating WATERFALL at chunk (" << i << ", " << j << ")" << std::endl;
                 waterfall = std::make_unique<Waterfall>();
-                waterfall->create(Waterfall::CHUNK_SIZE * (i + 2), Waterfall::CHUNK_SIZE * (j + 2));
-                worldVAO.createVBO(key, waterfall->render());  // Waterfall uses blocky render
+                Waterfall* pool = waterfall.get();
+                std::vector<float>* mesh = &chunkMeshes[i * WORLD_SIZE + j];
+                int chunkX = i + 2;
+                int chunkZ = j + 2;
+                // Saved blocks (edits included) win over the generated landscape,
+                // so its mesh is always rebuilt from them
+                jobs.run(chunkJobs, [&regions, pool, mesh, chunkX, chunkZ] {
+                    if (!regions.loadChunk(chunkX, chunkZ, pool->getTerrain())) {
+                        pool->create(Waterfall::CHUNK_SIZE * chunkX, Waterfall::CHUNK_SIZE * chunkZ);
+                        regions.markDirty(chunkX, chunkZ, pool->getTerrain());
+                    }
+                    *mesh = pool->render();  // Waterfall uses blocky render
+                });
                 chunks[i].push_back(nullptr);  // Placeholder to maintain array indices
+            } else if (isBaked || useHeightTiles) {
+                chunks[i].push_back(nullptr);  // Mesh comes from the baked world, or none is needed
             } else {
                 std::cout << "Creating SMOOTH TERRAIN at chunk (" << i << ", " << j << ")" << std::endl;
-                std::unique_ptr<Chunk> chunkPtr = std::make_unique<Chunk>();
-                chunks[i].push_back(std::move(chunkPtr));
-                chunks[i][j]->createSmoothLandscape(chunks[i][j]->CHUNK_SIZE * (i + 2), chunks[i][j]->CHUNK_SIZE * (j + 2));
-                worldVAO.createVBO(key, chunks[i][j]->renderSmooth());  // Regular terrain uses smooth render
+                chunks[i].push_back(std::make_unique<Chunk>());
+                Chunk* chunk = chunks[i][j].get();
+                std::vector<float>* mesh = &chunkMeshes[i * WORLD_SIZE + j];
+                HeightfieldView view = heightfield.getChunkView(i + 2, j + 2);
+                jobs.run(chunkJobs, [chunk, mesh, view] {
+                    chunk->createSmoothLandscape(view);
+                    *mesh = chunk->renderSmooth();  // Regular terrain uses smooth render
+                });
             }
         }
     }
+    jobs.wait(chunkJobs);
+
+    if (useHeightTiles) {
+        terrain = std::make_unique<HeightmapTerrain>(WORLD_SIZE);
+    }
+
+    for (int i = 0; i < WORLD_SIZE; i++) {
+        for (int j = 0; j < WORLD_SIZE; j++) {
+            std::string key = "Chunk" + std::to_string(i) +","+ std::to_string(j);
+            bool isWaterfall = i == Config::World::WATERFALL_CHUNK_X && j == Config::World::WATERFALL_CHUNK_Z;
+            if (useHeightTiles && !isWaterfall) {
+                terrain->uploadChunk(i, j, heightfield, i + 2, j + 2);
+            } else if (isBaked && !isWaterfall) {
+                size_t floatCount = 0;
+                const float* mesh = bakedWorld.getMesh(i, j, floatCount);
+                smoothVAO.createVBO(key, mesh, floatCount);
+            } else if (!isWaterfall) {
+                smoothVAO.createVBO(key, chunkMeshes[i * WORLD_SIZE + j]);
+            } else {
+                worldVAO.createVBO(key, chunkMeshes[i * WORLD_SIZE + j]);
+            }
+        }
+    }
+
+    // Finer normals than the height tiles' for lighting distant chunks
+    if (useHeightTiles) {
+        std::vector<uint8_t> normalPixels;
+        int normalWidth = 0;
+        int normalHeight = 0;
+        if (heightfield.renderNormalMap(Config::Terrain::NORMAL_MAP_DETAIL, utils::NORMAL_MAP_RG8, normalPixels,
+                                        normalWidth, normalHeight)) {
+            terrain->uploadNormalMap(normalPixels.data(), utils::NORMAL_MAP_RG8, normalWidth, normalHeight,
+                                     Config::Terrain::NORMAL_MAP_DETAIL);
+        }
+    }
+
+    // The GPU holds its own copies now; keep the generated meshes for next start
+    if (isBaked) {
+        bakedWorld.close();
+    } else if (!useHeightTiles) {
+        BakedWorld::bake(Config::World::BAKED_WORLD_FILE, WORLD_SIZE, heightfield.getSourceHash(), chunkMeshes);
+    }
+    chunkMeshes.clear();
+
+    // A freshly generated waterfall is written on a worker, not before the first frame
+    regions.flushAsync();
 
     std::cout << "iterated through chunks" << std::endl;
 
@@ -144,6 +247,12 @@ int main()
     */
     water_plane water(view,projection,camera.position,fog);
 
+    // Particle physics and visibility run on their own thread from here on;
+    // the render loop only reads the snapshots it publishes
+    SimulationThread simulation(waterfall.get(), rain, WORLD_SIZE);
+    simulation.start();
+    float timingLogTimer = 0.0f;
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
@@ -158,14 +267,6 @@ int main()
         // -----
         processInput(window);
 
-        // UPDATE FLUID PHYSICS - Update particles for waterfall
-        if (waterfall) {
-            waterfall->updateParticles(deltaTime);
-        }
-
-        // UPDATE RAIN PHYSICS
-        rain.updateParticles(deltaTime);
-
         // render
         // ------
         // Clear with fog color for seamless horizon blend
@@ -184,7 +285,12 @@ int main()
         float aspect = (float)Config::Rendering::WINDOW_WIDTH / Config::Rendering::WINDOW_HEIGHT;
         projection = glm::perspective(glm::radians(camera.zoom), aspect,
                                                 Config::Rendering::NEAR_PLANE, Config::Rendering::FAR_PLANE);
-                                                
+
+        // SIMULATION - kick off the next physics step, draw the newest finished one
+        simulation.submitFrame(deltaTime, projection * view);
+        const SimulationSnapshot& snapshot = simulation.latestSnapshot();
+        auto renderStart = std::chrono::steady_clock::now();
+
         // Generate World
         glDisable(GL_CLIP_DISTANCE0);
         worldShader.use();
@@ -193,11 +299,29 @@ int main()
         // Apply Volumetric Fog - atmospheric waterfall mist!
         fog.applyToShader(worldShader);
         glm::vec4 plane = glm::vec4(0, 0, 0, 0);
-        renderWorld(worldVAO, worldShader, renderer, model, view, projection, plane);
+        renderWorld(worldVAO, worldShader, renderer, model, view, projection, plane, snapshot.visibleChunks);
+
+        // All smooth terrain in one instanced draw, or one mesh per chunk
+        if (!terrain) {
+            fog.applyToShader(smoothShader);
+            renderSmoothTerrain(smoothVAO, smoothShader, renderer, view, projection, plane, snapshot.visibleChunks);
+            worldVAO.bind();
+        } else {
+            terrainShader.use();
+            fog.applyToShader(terrainShader);
+            terrainShader.setVec4("plane", plane);
+            terrainShader.setMat4("view", view);
+            terrainShader.setMat4("projection", projection);
+            terrainShader.setVec3("lightPos", lightPos);
+            terrainShader.setVec3("lightColor", lightColor);
+            terrainShader.setVec3("viewPos", camera.position);
+            terrain->draw(terrainShader, snapshot.visibleChunks);
+            worldVAO.bind();
+        }
 
         // RENDER FLUID PHYSICS PARTICLES
         if (waterfall) {
-            std::vector<float> particleVertices = waterfall->renderParticles();
+            const std::vector<float>& particleVertices = snapshot.waterfallParticles;
             if (!particleVertices.empty()) {
                 worldVAO.createVBO("Particles", particleVertices);  // Recreate VBO each frame
                 worldVAO.bindVBO("Particles");
@@ -210,9 +334,9 @@ int main()
         }
 
         // RENDER RAIN PARTICLES - Optimized: render each chunk's rain only once
-        for (int i = 0; i < WORLD_SIZE; ++i) {
+        for (int i = 0; i < WORLD_SIZE && !snapshot.chunkRain.empty(); ++i) {
             for (int j = 0; j < WORLD_SIZE; ++j) {
-                std::vector<float> rainVertices = rain.renderParticlesForChunk(i, j);
+                const std::vector<float>& rainVertices = snapshot.chunkRain[i * WORLD_SIZE + j];
                 if (!rainVertices.empty()) {
                     // Use unique VBO key per chunk to avoid recreating VBOs
                     std::string rainKey = "Rain_" + std::to_string(i) + "_" + std::to_string(j);
@@ -229,11 +353,26 @@ int main()
 
         water.render();
 
+        // Render thread time excludes the swap, which waits on the GPU
+        std::chrono::duration<float, std::milli> renderTime = std::chrono::steady_clock::now() - renderStart;
+        simulation.recordRenderTime(renderTime.count());
+
+        timingLogTimer += deltaTime;
+        if (timingLogTimer > 2.0f) {
+            ThreadTimings timings = simulation.takeTimings();
+            std::cout << "[TIMING] simulation " << timings.simulationMs << " ms/step (" << timings.steps
+                      << " steps, idle " << timings.idleMs << " ms), render " << timings.renderMs
+                      << " ms/frame (" << timings.frames << " frames)" << std::endl;
+            timingLogTimer = 0.0f;
+        }
+
         glfwSwapBuffers(window);
         glfwPollEvents();
 
     }
 
+    simulation.stop();
+
     // // optional: de-allocate all resources once they've outlived their purpose:
     // // ------------------------------------------------------------------------
     // glDeleteVertexArrays(1, &VAO);
@@ -245,7 +384,7 @@ int main()
     return 0;
 }
 
-void renderWorld(VertexArrayWrapper &worldVAO, Shader& worldShader, Renderer& renderer, glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection, glm::vec4& plane) {
+void renderWorld(VertexArrayWrapper &worldVAO, Shader& worldShader, Renderer& renderer, glm::mat4 &model, glm::mat4 &view, glm::mat4 &projection, glm::vec4& plane, const std::vector<int>& visibleChunks) {
     worldVAO.bind();
     worldShader.use();
     worldShader.setVec4("plane", plane);
@@ -255,20 +394,25 @@ void renderWorld(VertexArrayWrapper &worldVAO, Shader& worldShader, Renderer& re
     worldShader.setVec3("lightColor", lightColor);
     worldShader.setVec3("viewPos", camera.position);
 
-    for (int i = 0; i < WORLD_SIZE; ++i) {
-        for (int j = 0; j < WORLD_SIZE; ++j) {
-            std::string key = "Chunk" + std::to_string(i) +","+ std::to_string(j);
-            // Removed memory leak - chunk already created during initialization
-            worldVAO.bindVBO(key);
+    // Only chunks the simulation thread found inside the view frustum
+    for (int index : visibleChunks) {
+        int i = index / WORLD_SIZE;
+        int j = index % WORLD_SIZE;
+        bool isWaterfall = i == Config::World::WATERFALL_CHUNK_X && j == Config::World::WATERFALL_CHUNK_Z;
+        if (!isWaterfall) {
+            continue;  // Smooth terrain has its own shader, see renderSmoothTerrain()
+        }
+        std::string key = "Chunk" + std::to_string(i) +","+ std::to_string(j);
+        // Removed memory leak - chunk already created during initialization
+        worldVAO.bindVBO(key);
 
-            // Draw - translate THEN scale to avoid gaps between chunks
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(i * 20, 0.0f, -j * 20));
-            model = glm::scale(model, glm::vec3(20, 20, 20));
-            worldShader.setMat4("model", model);
+        // Draw - translate THEN scale to avoid gaps between chunks
+        model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(i * 20, 0.0f, -j * 20));
+        model = glm::scale(model, glm::vec3(20, 20, 20));
+        worldShader.setMat4("model", model);
 
-            renderer.draw(worldVAO, worldShader);
-        }
+        renderer.draw(worldVAO, worldShader);
     }
     /*
     // Draw WATER PLANE underneath terrain - dark blue water visible through gaps
@@ -286,6 +430,34 @@ void renderWorld(VertexArrayWrapper &worldVAO, Shader& worldShader, Renderer& re
     */
 }
 
+void renderSmoothTerrain(VertexArrayWrapper &smoothVAO, Shader& smoothShader, Renderer& renderer, glm::mat4 &view, glm::mat4 &projection, glm::vec4& plane, const std::vector<int>& visibleChunks) {
+    smoothVAO.bind();
+    smoothShader.use();
+    smoothShader.setVec4("plane", plane);
+    smoothShader.setMat4("view", view);
+    smoothShader.setMat4("projection", projection);
+    smoothShader.setVec3("lightPos", lightPos);
+    smoothShader.setVec3("lightColor", lightColor);
+    smoothShader.setVec3("viewPos", camera.position);
+
+    for (int index : visibleChunks) {
+        int i = index / WORLD_SIZE;
+        int j = index % WORLD_SIZE;
+        if (i == Config::World::WATERFALL_CHUNK_X && j == Config::World::WATERFALL_CHUNK_Z) {
+            continue;  // Blocky, drawn by renderWorld()
+        }
+        smoothVAO.bindVBO("Chunk" + std::to_string(i) + "," + std::to_string(j));
+
+        // Draw - translate THEN scale to avoid gaps between chunks
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(i * 20, 0.0f, -j * 20));
+        model = glm::scale(model, glm::vec3(20, 20, 20));
+        smoothShader.setMat4("model", model);
+
+        renderer.draw(smoothVAO, smoothShader);
+    }
+}
+
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 void processInput(GLFWwindow *window)
 {
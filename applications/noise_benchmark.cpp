@@ -0,0 +1,1681 @@
+// Headless benchmarks for terrain generation. Enable this file instead of
+// main.cpp in CMakeLists.txt and run it from a release build.
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <noise/batch.h>
+#include <noise/interp.h>
+#include <noise/noise.h>
+#include <noise/noisegen2d.h>
+#include <noise/noiseutils.h>
+#include <noise/tilecache.h>
+
+#include <general/Config.h>
+#include <general/JobSystem.h>
+#include <terrain/BakedWorld.h>
+#include <terrain/Chunk.h>
+#include <terrain/Heightfield.h>
+#include <terrain/RegionStore.h>
+
+using namespace noise;
+
+const int REPEATS = 3;
+
+/**
+ * @brief Run a function several times and return the fastest run
+ *
+ * @param function Work to measure
+ * @return double  Milliseconds of the fastest run
+ */
+double bestOf(const std::function<void()>& function) {
+    double best = 1.0e30;
+    for (int i = 0; i < REPEATS; i++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+/**
+ * @brief Build a large Perlin height map through NoiseMapBuilderPlane
+ */
+void buildPlaneMap(int size) {
+    module::Perlin perlin;
+    perlin.SetFrequency(0.01);
+
+    utils::NoiseMap heightMap;
+    utils::NoiseMapBuilderPlane builder;
+    builder.SetSourceModule(perlin);
+    builder.SetDestNoiseMap(heightMap);
+    builder.SetDestSize(size, size);
+    builder.SetBounds(0.0, size, 0.0, size);
+    builder.Build();
+}
+
+/**
+ * @brief Build a noise map of the given size with any noise map builder
+ *
+ * @param builder Builder with its bounds already set
+ * @param width   Width of the noise map in points
+ * @param height  Height of the noise map in points
+ */
+void buildMap(utils::NoiseMapBuilder& builder, int width, int height) {
+    utils::NoiseMap noiseMap;
+    builder.SetDestNoiseMap(noiseMap);
+    builder.SetDestSize(width, height);
+    builder.Build();
+}
+
+/**
+ * @brief Generate and mesh the default world the way main.cpp does
+ */
+void generateWorld() {
+    const int worldSize = Config::World::SIZE;
+    JobSystem& jobs = JobSystem::getInstance();
+    JobCounter chunkJobs;
+
+    Heightfield heightfield;
+    heightfield.setSlopeMaps(true);
+    heightfield.build(2, 2, worldSize, worldSize);
+
+    std::vector<std::unique_ptr<Chunk>> chunks(worldSize * worldSize);
+    std::vector<std::vector<float>> meshes(worldSize * worldSize);
+    for (int i = 0; i < worldSize; i++) {
+        for (int j = 0; j < worldSize; j++) {
+            Chunk* chunk = (chunks[i * worldSize + j] = std::make_unique<Chunk>()).get();
+            std::vector<float>* mesh = &meshes[i * worldSize + j];
+            HeightfieldView view = heightfield.getChunkView(i + 2, j + 2);
+            jobs.run(chunkJobs, [chunk, mesh, view] {
+                chunk->createSmoothLandscape(view);
+                *mesh = chunk->renderSmooth();
+            });
+        }
+    }
+    jobs.wait(chunkJobs);
+}
+
+/**
+ * @brief Job system scaling from one thread up to every hardware thread
+ */
+void benchmarkJobScaling() {
+    int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    JobSystem& jobs = JobSystem::getInstance();
+
+    std::cout << "== Job system scaling (" << maxThreads << " hardware threads)" << std::endl;
+    std::cout << std::setw(8) << "threads"
+              << std::setw(18) << "plane 2048^2 ms" << std::setw(10) << "speedup"
+              << std::setw(18) << "world 16x16 ms" << std::setw(10) << "speedup" << std::endl;
+
+    // Chunk generation logs every chunk, keep the table readable
+    std::ostringstream discard;
+    double planeBase = 0.0, worldBase = 0.0;
+    for (int threads = 1; threads <= maxThreads; threads++) {
+        jobs.setThreadCount(threads);
+
+        double planeMs = bestOf([] { buildPlaneMap(2048); });
+
+        std::streambuf* console = std::cout.rdbuf(discard.rdbuf());
+        double worldMs = bestOf(generateWorld);
+        std::cout.rdbuf(console);
+        discard.str("");
+
+        if (threads == 1) {
+            planeBase = planeMs;
+            worldBase = worldMs;
+        }
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(8) << threads
+                  << std::setw(18) << planeMs << std::setw(10) << planeBase / planeMs
+                  << std::setw(18) << worldMs << std::setw(10) << worldBase / worldMs << std::endl;
+    }
+
+    jobs.setThreadCount(maxThreads);
+}
+
+/**
+ * @brief Row-parallel noise map builder scaling on large maps
+ */
+void benchmarkBuilderScaling() {
+    int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    JobSystem& jobs = JobSystem::getInstance();
+
+    // Shared through a ThreadCache, the way terrain graphs reuse a source
+    module::Perlin perlin;
+    module::ThreadCache cachedPerlin;
+    cachedPerlin.SetSourceModule(0, perlin);
+
+    utils::NoiseMapBuilderPlane plane;
+    plane.SetSourceModule(cachedPerlin);
+    plane.SetBounds(0.0, 64.0, 0.0, 64.0);
+
+    utils::NoiseMapBuilderCylinder cylinder;
+    cylinder.SetSourceModule(cachedPerlin);
+    cylinder.SetBounds(-180.0, 180.0, -4.0, 4.0);
+
+    utils::NoiseMapBuilderSphere sphere;
+    sphere.SetSourceModule(cachedPerlin);
+    sphere.SetBounds(-90.0, 90.0, -180.0, 180.0);
+
+    std::cout << "== Noise map builder scaling" << std::endl;
+    std::cout << std::setw(8) << "threads"
+              << std::setw(18) << "plane 8192^2 ms" << std::setw(10) << "speedup"
+              << std::setw(18) << "cyl 4096x2048" << std::setw(10) << "speedup"
+              << std::setw(18) << "sphere 4096x2048" << std::setw(10) << "speedup" << std::endl;
+
+    double planeBase = 0.0, cylinderBase = 0.0, sphereBase = 0.0;
+    for (int threads = 1; threads <= maxThreads; threads++) {
+        jobs.setThreadCount(threads);
+
+        double planeMs = bestOf([&] { buildMap(plane, 8192, 8192); });
+        double cylinderMs = bestOf([&] { buildMap(cylinder, 4096, 2048); });
+        double sphereMs = bestOf([&] { buildMap(sphere, 4096, 2048); });
+
+        if (threads == 1) {
+            planeBase = planeMs;
+            cylinderBase = cylinderMs;
+            sphereBase = sphereMs;
+        }
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(8) << threads
+                  << std::setw(18) << planeMs << std::setw(10) << planeBase / planeMs
+                  << std::setw(18) << cylinderMs << std::setw(10) << cylinderBase / cylinderMs
+                  << std::setw(18) << sphereMs << std::setw(10) << sphereBase / sphereMs << std::endl;
+    }
+
+    jobs.setThreadCount(maxThreads);
+}
+
+// Callbacks seen per row by checkRowCallbacks()
+std::vector<int> callbackCounts;
+
+void countRowCallback(int row) {
+    callbackCounts[row]++;
+}
+
+/**
+ * @brief Check that a row-parallel build reports every row to its callback
+ * exactly once
+ *
+ * Each single-row build is one job, which finishes while the building thread
+ * polls for its row; a full build runs many jobs. The rows are just wide
+ * enough to build in parallel, and a constant keeps the jobs short, so the
+ * last job often finishes between the two checks of the polling loop.
+ */
+void checkRowCallbacks() {
+    const int width = 4096;
+    const int height = 512;
+    const int singleRowBuilds = 20000;
+    JobSystem& jobs = JobSystem::getInstance();
+    int maxThreads = jobs.getThreadCount();
+    int threads = std::max(4, maxThreads);
+    jobs.setThreadCount(threads);
+
+    module::Const constant;
+    utils::NoiseMap noiseMap;
+    utils::NoiseMapBuilderPlane builder;
+    builder.SetSourceModule(constant);
+    builder.SetDestNoiseMap(noiseMap);
+    builder.SetDestSize(width, height);
+    builder.SetBounds(0.0, width, 0.0, height);
+    builder.SetCallback(countRowCallback);
+
+    callbackCounts.assign(height, 0);
+    int wrongRows = 0;
+    for (int build = 0; build < singleRowBuilds; build++) {
+        int row = build % height;
+        builder.SetDestRowRange(row, row + 1);
+        builder.Build();
+        if (callbackCounts[row] != 1) {
+            wrongRows++;
+        }
+        callbackCounts[row] = 0;
+    }
+    builder.ClearDestRowRange();
+    builder.Build();
+    int wrongFullRows = (int)std::count_if(callbackCounts.begin(), callbackCounts.end(),
+                                           [](int count) { return count != 1; });
+    jobs.setThreadCount(maxThreads);
+
+    std::cout << "== Row callbacks (" << threads << " threads)" << std::endl;
+    std::cout << singleRowBuilds << " single-row builds: " << (wrongRows == 0 ? "OK" : "FAILED") << " ("
+              << wrongRows << " rows not reported once)" << std::endl;
+    std::cout << height << "-row build: " << (wrongFullRows == 0 ? "OK" : "FAILED") << " (" << wrongFullRows
+              << " rows not reported once)" << std::endl;
+}
+
+/**
+ * @brief Scalar GetValue() against the batch API, with and without AVX2
+ */
+void benchmarkBatchEvaluation() {
+    const int size = 512;
+    const int count = size * size;
+    std::vector<double> xs(count), ys(count), zs(count);
+    for (int i = 0; i < count; i++) {
+        xs[i] = (i % size) * 0.02;
+        ys[i] = 0.0;
+        zs[i] = (i / size) * 0.02;
+    }
+
+    module::Perlin perlin;
+    module::Billow billow;
+    module::RidgedMulti ridged;
+    module::Voronoi voronoi;
+    voronoi.EnableDistance(true);
+    struct Generator {
+        const char* name;
+        const module::Module* module;
+    } generators[] = {
+        {"Perlin", &perlin}, {"Billow", &billow}, {"RidgedMulti", &ridged}, {"Voronoi", &voronoi},
+    };
+
+    std::cout << "== Batch evaluation (" << count << " samples, AVX2 "
+              << (IsBatchSimdEnabled() ? "available" : "unavailable") << ")" << std::endl;
+    std::cout << std::setw(12) << "module" << std::setw(14) << "scalar ms"
+              << std::setw(14) << "batch ms" << std::setw(14) << "avx2 ms"
+              << std::setw(10) << "speedup" << std::setw(14) << "max error" << std::endl;
+
+    std::vector<double> reference(count), batch(count);
+    for (const Generator& generator : generators) {
+        const module::Module& source = *generator.module;
+        double scalarMs = bestOf([&] {
+            for (int i = 0; i < count; i++) {
+                reference[i] = source.GetValue(xs[i], ys[i], zs[i]);
+            }
+        });
+
+        EnableBatchSimd(false);
+        double batchMs = bestOf([&] { GetValues(source, &xs[0], &ys[0], &zs[0], &batch[0], count); });
+        EnableBatchSimd(true);
+        double simdMs = bestOf([&] { GetValues(source, &xs[0], &ys[0], &zs[0], &batch[0], count); });
+
+        double maxError = 0.0;
+        for (int i = 0; i < count; i++) {
+            maxError = std::max(maxError, std::fabs(batch[i] - reference[i]));
+        }
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(12) << generator.name << std::setw(14) << scalarMs
+                  << std::setw(14) << batchMs << std::setw(14) << simdMs
+                  << std::setw(10) << scalarMs / simdMs
+                  << std::setw(14) << std::scientific << maxError << std::endl;
+    }
+}
+
+/**
+ * @brief Compare a representative terrain graph evaluated per sample, through
+ * the batch evaluator and as a compiled program
+ *
+ * The graph follows the libnoise complex planet tutorial: ridged mountains and
+ * scaled billow plains selected by a low-frequency Perlin control, roughened
+ * by turbulence and terraced. A redundant ScaleBias chain and a constant sum
+ * show the folding done by the compiler.
+ */
+void benchmarkGraphCompiler() {
+    const int size = 512;
+    const int count = size * size;
+    std::vector<double> xs(count), ys(count), zs(count);
+    for (int i = 0; i < count; i++) {
+        xs[i] = (i % size) * 0.02;
+        ys[i] = 0.0;
+        zs[i] = (i / size) * 0.02;
+    }
+
+    module::RidgedMulti mountains;
+    module::Billow plainsBase;
+    plainsBase.SetFrequency(2.0);
+    module::ScaleBias plains;
+    plains.SetSourceModule(0, plainsBase);
+    plains.SetScale(0.125);
+    plains.SetBias(-0.75);
+    module::Perlin terrainType;
+    terrainType.SetFrequency(0.5);
+    terrainType.SetPersistence(0.25);
+    module::Select selected;
+    selected.SetSourceModule(0, plains);
+    selected.SetSourceModule(1, mountains);
+    selected.SetSourceModule(2, terrainType);
+    selected.SetBounds(0.0, 1000.0);
+    selected.SetEdgeFalloff(0.125);
+    module::Turbulence roughened;
+    roughened.SetSourceModule(0, selected);
+    roughened.SetFrequency(4.0);
+    roughened.SetPower(0.125);
+    module::Terrace terraced;
+    terraced.SetSourceModule(0, roughened);
+    terraced.AddControlPoint(-1.0);
+    terraced.AddControlPoint(-0.25);
+    terraced.AddControlPoint(0.25);
+    terraced.AddControlPoint(1.0);
+    module::ScaleBias scaled;
+    scaled.SetSourceModule(0, terraced);
+    scaled.SetScale(0.5);
+    module::ScaleBias shifted;
+    shifted.SetSourceModule(0, scaled);
+    shifted.SetBias(0.25);
+    module::Const seaLevel;
+    seaLevel.SetConstValue(-0.125);
+    module::Const offset;
+    offset.SetConstValue(0.0625);
+    module::Add seaLevelOffset;
+    seaLevelOffset.SetSourceModule(0, seaLevel);
+    seaLevelOffset.SetSourceModule(1, offset);
+    module::Add terrain;
+    terrain.SetSourceModule(0, shifted);
+    terrain.SetSourceModule(1, seaLevelOffset);
+
+    module::CompiledGraph compiled;
+    double compileMs = bestOf([&] { compiled.Compile(terrain); });
+
+    std::vector<double> reference(count), batch(count), result(count);
+    double scalarMs = bestOf([&] {
+        for (int i = 0; i < count; i++) {
+            reference[i] = terrain.GetValue(xs[i], ys[i], zs[i]);
+        }
+    });
+    double batchMs = bestOf([&] { GetValues(terrain, &xs[0], &ys[0], &zs[0], &batch[0], count); });
+    double compiledMs = bestOf([&] { compiled.GetValues(&xs[0], &ys[0], &zs[0], &result[0], count); });
+
+    double maxError = 0.0;
+    for (int i = 0; i < count; i++) {
+        maxError = std::max(maxError, std::fabs(result[i] - reference[i]));
+    }
+    std::cout << "== Graph compiler (" << count << " samples, " << compiled.GetInstructionCount()
+              << " instructions, " << compiled.GetRegisterCount() << " registers)" << std::endl;
+    std::cout << std::fixed << std::setprecision(2) << "  compile " << compileMs << " ms, scalar "
+              << scalarMs << " ms, batch " << batchMs << " ms, compiled " << compiledMs
+              << " ms, speedup " << scalarMs / compiledMs << "x, max error " << std::scientific
+              << maxError << std::endl;
+}
+
+/**
+ * @brief Compare Cache, ThreadCache and LruCache on a subgraph that is sampled
+ * at interleaved coordinates
+ *
+ * The shared RidgedMulti module is both Blend sources and, through Turbulence,
+ * the blend control. Blend asks for the first source, then the distorted
+ * control, then the second source, so a single-entry cache always misses.
+ */
+void benchmarkCacheModules() {
+    const int size = 512;
+    module::RidgedMulti base;
+    module::Cache cache;
+    module::ThreadCache threadCache;
+    module::LruCache lruCache;
+    struct CacheModule {
+        const char* name;
+        module::Module* module;
+    } caches[] = {
+        {"Cache", &cache}, {"ThreadCache", &threadCache}, {"LruCache", &lruCache},
+    };
+
+    std::cout << "== Cache modules (" << size * size << " samples)" << std::endl;
+    for (const CacheModule& entry : caches) {
+        entry.module->SetSourceModule(0, base);
+        module::Turbulence distorted;
+        distorted.SetSourceModule(0, *entry.module);
+        distorted.SetPower(0.125);
+        module::Blend blended;
+        blended.SetSourceModule(0, *entry.module);
+        blended.SetSourceModule(1, distorted);
+        blended.SetSourceModule(2, *entry.module);
+
+        lruCache.ResetCounters();
+        double sum = 0.0;
+        double ms = bestOf([&] {
+            sum = 0.0;
+            for (int z = 0; z < size; z++) {
+                for (int x = 0; x < size; x++) {
+                    sum += blended.GetValue(x * 0.02, 0.0, z * 0.02);
+                }
+            }
+        });
+        std::cout << std::fixed << std::setprecision(2) << std::setw(14) << entry.name << std::setw(10)
+                  << ms << " ms  checksum " << std::setprecision(6) << sum;
+        if (entry.module == &lruCache) {
+            double lookups = double(lruCache.GetHitCount() + lruCache.GetMissCount());
+            std::cout << "  hit rate " << std::setprecision(1) << 100.0 * lruCache.GetHitCount() / lookups
+                      << "%";
+        }
+        std::cout << std::endl;
+    }
+}
+
+/**
+ * @brief Compare the 3D and planar gradient noise paths on chunk height maps
+ *
+ * Chunk::createSmoothLandscape builds (CHUNK_SIZE + 1)^2 Perlin height maps on
+ * the y = 0 plane. The plane builder hands those blocks to the planar kernels,
+ * which evaluate four lattice corners per octave instead of eight.
+ */
+void benchmarkPlanarNoise() {
+    const int chunkCount = 256;
+    const int chunkSize = Chunk::CHUNK_SIZE;
+    const int side = chunkSize + 1;
+    module::Perlin perlin;
+
+    double reference = 0.0;
+    double scalar3dMs = bestOf([&] {
+        reference = 0.0;
+        for (int chunk = 0; chunk < chunkCount; chunk++) {
+            for (int z = 0; z < side; z++) {
+                for (int x = 0; x < side; x++) {
+                    reference += perlin.GetValue(chunk * chunkSize + x, 0.0, z);
+                }
+            }
+        }
+    });
+    double planar = 0.0;
+    double scalar2dMs = bestOf([&] {
+        planar = 0.0;
+        for (int chunk = 0; chunk < chunkCount; chunk++) {
+            for (int z = 0; z < side; z++) {
+                for (int x = 0; x < side; x++) {
+                    planar += GetValue2D(perlin, chunk * chunkSize + x, z);
+                }
+            }
+        }
+    });
+
+    utils::NoiseMap heightMap;
+    utils::NoiseMapBuilderPlane builder;
+    builder.SetSourceModule(perlin);
+    builder.SetDestNoiseMap(heightMap);
+    builder.SetDestSize(side, side);
+    double builderMs = bestOf([&] {
+        for (int chunk = 0; chunk < chunkCount; chunk++) {
+            double dx = chunk * chunkSize;
+            builder.SetBounds(dx, dx + chunkSize, 0.0, chunkSize);
+            builder.Build();
+        }
+    });
+
+    double samples = double(chunkCount) * side * side;
+    std::cout << "== Planar noise (" << chunkCount << " chunk height maps of " << side << "x" << side
+              << ")" << std::endl;
+    std::cout << std::fixed << std::setprecision(1) << "  Perlin::GetValue " << scalar3dMs * 1e6 / samples
+              << " ns/sample, GetValue2D " << scalar2dMs * 1e6 / samples << " ns/sample, plane builder "
+              << builderMs * 1e6 / samples << " ns/sample, results "
+              << (planar == reference ? "identical" : "DIFFER") << std::endl;
+}
+
+/**
+ * @brief Compare row-by-row batch evaluation with the grid kernel on 1024x1024
+ * Perlin grids of increasing extent
+ *
+ * Dense grids put many samples in every lattice cell, so the grid kernel skips
+ * most of the hashing; sparse grids show its overhead.
+ */
+void benchmarkGridEvaluation() {
+    const int size = 1024;
+    module::Perlin perlin;
+    std::vector<double> xs(size), ys(size, 0.0), zs(size), grid(size * size), rows(size * size);
+
+    std::cout << "== Grid evaluation (" << size << "x" << size << " Perlin)" << std::endl;
+    std::cout << std::setw(10) << "extent" << std::setw(12) << "rows ms" << std::setw(12) << "grid ms"
+              << std::setw(10) << "speedup" << std::setw(10) << "equal" << std::endl;
+    for (double extent : {4.0, 64.0, 1024.0}) {
+        std::vector<double> columns(size), rowCoords(size);
+        for (int i = 0; i < size; i++) {
+            columns[i] = extent * i / size;
+            rowCoords[i] = extent * i / size;
+        }
+        double rowsMs = bestOf([&] {
+            for (int z = 0; z < size; z++) {
+                std::fill(zs.begin(), zs.end(), rowCoords[z]);
+                GetValues(perlin, &columns[0], &ys[0], &zs[0], &rows[z * size], size);
+            }
+        });
+        double gridMs = bestOf([&] { GetGridValues(perlin, &columns[0], size, &rowCoords[0], size, &grid[0]); });
+        std::cout << std::fixed << std::setprecision(2) << std::setw(10) << extent << std::setw(12) << rowsMs
+                  << std::setw(12) << gridMs << std::setw(10) << rowsMs / gridMs << std::setw(10)
+                  << (grid == rows ? "yes" : "NO") << std::endl;
+    }
+}
+
+/**
+ * @brief Compare seamless plane maps built from a periodic lattice with the
+ * four-sample seamless blend
+ *
+ * An extent of 4 units tiles with the periodic lattice; 4.5 units is not a
+ * whole number of lattice cells, so the builder falls back to the blend.
+ */
+void benchmarkSeamlessMaps() {
+    const int size = 1024;
+    module::Perlin perlin;
+    utils::NoiseMap heightMap;
+    utils::NoiseMapBuilderPlane builder;
+    builder.SetSourceModule(perlin);
+    builder.SetDestNoiseMap(heightMap);
+    builder.SetDestSize(size, size);
+    builder.EnableSeamless();
+
+    std::cout << "== Seamless plane maps (" << size << "x" << size << " Perlin)" << std::endl;
+    for (double extent : {4.0, 4.5}) {
+        builder.SetBounds(0.0, extent, 0.0, extent);
+        double ms = bestOf([&] { builder.Build(); });
+        float seam = 0.0f;
+        for (int y = 0; y < size; y++) {
+            seam = std::max(seam, std::fabs(heightMap.GetValue(size - 1, y) - heightMap.GetValue(0, y)));
+        }
+        std::cout << std::fixed << std::setprecision(2) << "  extent " << extent << ": "
+                  << (IsPeriodSupported(perlin, extent, extent) ? "periodic" : "blend   ") << " " << ms
+                  << " ms, largest step across the x seam " << std::setprecision(4) << seam << std::endl;
+    }
+}
+
+/**
+ * @brief Compare the Voronoi module with FastVoronoi and the batch kernel on a
+ * plane grid and on scattered input values
+ */
+void benchmarkVoronoi() {
+    const int size = 512;
+    const int count = size * size;
+    std::vector<double> planeXs(count), planeYs(count, 0.0), planeZs(count);
+    std::vector<double> scatterXs(count), scatterYs(count), scatterZs(count);
+    unsigned int state = 12345;
+    auto random = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) / 16777216.0 * 20000.0 - 10000.0;
+    };
+    for (int i = 0; i < count; i++) {
+        planeXs[i] = (i % size) * (8.0 / size);
+        planeZs[i] = (i / size) * (8.0 / size);
+        scatterXs[i] = random();
+        scatterYs[i] = random();
+        scatterZs[i] = random();
+    }
+
+    module::Voronoi voronoi;
+    module::FastVoronoi fastVoronoi;
+    voronoi.EnableDistance(true);
+    fastVoronoi.EnableDistance(true);
+
+    std::cout << "== Voronoi (" << count << " samples)" << std::endl;
+    std::cout << std::setw(12) << "inputs" << std::setw(16) << "Voronoi ms" << std::setw(16) << "FastVoronoi ms"
+              << std::setw(14) << "batch ms" << std::setw(10) << "speedup" << std::setw(10) << "equal" << std::endl;
+    struct Inputs {
+        const char* name;
+        const std::vector<double>& xs;
+        const std::vector<double>& ys;
+        const std::vector<double>& zs;
+    } inputs[] = {
+        {"plane", planeXs, planeYs, planeZs},
+        {"scattered", scatterXs, scatterYs, scatterZs},
+    };
+    std::vector<double> reference(count), fast(count), batch(count);
+    for (const Inputs& input : inputs) {
+        double voronoiMs = bestOf([&] {
+            for (int i = 0; i < count; i++) {
+                reference[i] = voronoi.GetValue(input.xs[i], input.ys[i], input.zs[i]);
+            }
+        });
+        double fastMs = bestOf([&] {
+            for (int i = 0; i < count; i++) {
+                fast[i] = fastVoronoi.GetValue(input.xs[i], input.ys[i], input.zs[i]);
+            }
+        });
+        double batchMs = bestOf([&] { GetValues(voronoi, &input.xs[0], &input.ys[0], &input.zs[0], &batch[0], count); });
+        std::cout << std::fixed << std::setprecision(2) << std::setw(12) << input.name << std::setw(16) << voronoiMs
+                  << std::setw(16) << fastMs << std::setw(14) << batchMs << std::setw(10) << voronoiMs / batchMs
+                  << std::setw(10) << (fast == reference && batch == reference ? "yes" : "NO") << std::endl;
+    }
+}
+
+/**
+ * @brief Compare domain warping with per-sample GetValue() calls and with the
+ * batch evaluator on rows and on columns of a plane grid
+ *
+ * Rows share their y and z coordinates, so the distortion and displacement
+ * modules take the row kernel; columns take the generic batch kernels.
+ */
+void benchmarkDomainWarp() {
+    const int size = 512;
+    const int count = size * size;
+    // Off the y = 0 plane, where the displacement modules would take the planar kernels.
+    std::vector<double> rowXs(count), ys(count, 0.5), rowZs(count);
+    for (int i = 0; i < count; i++) {
+        rowXs[i] = (i % size) * (8.0 / size);
+        rowZs[i] = (i / size) * (8.0 / size);
+    }
+
+    module::Perlin perlin;
+    module::Turbulence turbulence;
+    turbulence.SetSourceModule(0, perlin);
+    turbulence.SetRoughness(3);
+    turbulence.SetPower(0.25);
+    module::Perlin xDisplace, yDisplace, zDisplace;
+    yDisplace.SetSeed(1);
+    zDisplace.SetSeed(2);
+    module::Displace displace;
+    displace.SetSourceModule(0, perlin);
+    displace.SetDisplaceModules(xDisplace, yDisplace, zDisplace);
+
+    std::cout << "== Domain warp (" << count << " samples)" << std::endl;
+    std::cout << std::setw(12) << "module" << std::setw(14) << "GetValue ms" << std::setw(14) << "columns ms"
+              << std::setw(12) << "rows ms" << std::setw(10) << "speedup" << std::setw(10) << "equal" << std::endl;
+    struct Warp {
+        const char* name;
+        const module::Module& module;
+    } warps[] = {
+        {"Turbulence", turbulence},
+        {"Displace", displace},
+    };
+    std::vector<double> reference(count), columns(count), rows(count);
+    for (const Warp& warp : warps) {
+        double valueMs = bestOf([&] {
+            for (int i = 0; i < count; i++) {
+                reference[i] = warp.module.GetValue(rowXs[i], ys[i], rowZs[i]);
+            }
+        });
+        // The same samples, transposed: x and z swap roles, so no block is a row.
+        // The two are timed in turns, so that a slow stretch of the machine
+        // does not only hit one of them
+        double columnsMs = 1.0e30, rowsMs = 1.0e30;
+        for (int round = 0; round < REPEATS; round++) {
+            columnsMs = std::min(columnsMs, bestOf([&] {
+                GetValues(warp.module, &rowZs[0], &ys[0], &rowXs[0], &columns[0], count);
+            }));
+            rowsMs = std::min(rowsMs, bestOf([&] { GetValues(warp.module, &rowXs[0], &ys[0], &rowZs[0], &rows[0], count); }));
+        }
+        bool equal = (rows == reference);
+        for (int i = 0; i < count && equal; i++) {
+            equal = (columns[i] == warp.module.GetValue(rowZs[i], ys[i], rowXs[i]));
+        }
+        std::cout << std::fixed << std::setprecision(2) << std::setw(12) << warp.name << std::setw(14) << valueMs
+                  << std::setw(14) << columnsMs << std::setw(12) << rowsMs << std::setw(10) << columnsMs / rowsMs
+                  << std::setw(10) << (equal ? "yes" : "NO") << std::endl;
+    }
+}
+
+/**
+ * @brief Compare the runtime octave loop with the fixed octave kernels for
+ * every octave count they cover
+ *
+ * Only blocks on the y = 0 plane have kernels; off the plane every block
+ * runs the runtime loop, so there is nothing to compare.
+ */
+void benchmarkOctaveSpecialization() {
+    const int size = 512;
+    const int count = size * size;
+    std::vector<double> xs(count), ys(count, 0.0), zs(count);
+    for (int i = 0; i < count; i++) {
+        xs[i] = (i % size) * (8.0 / size);
+        zs[i] = (i / size) * (8.0 / size);
+    }
+
+    std::cout << "== Fixed octave kernels (" << count << " planar Perlin samples)" << std::endl;
+    std::cout << std::setw(8) << "octaves" << std::setw(14) << "runtime ms" << std::setw(12) << "fixed ms"
+              << std::setw(10) << "speedup" << std::setw(10) << "equal" << std::endl;
+    std::vector<double> runtime(count), fixed(count);
+    for (int octaveCount = 1; octaveCount <= 8; octaveCount++) {
+        module::Perlin perlin;
+        perlin.SetOctaveCount(octaveCount);
+        EnableOctaveSpecialization(false);
+        double runtimeMs = bestOf([&] { GetValues(perlin, &xs[0], &ys[0], &zs[0], &runtime[0], count); });
+        EnableOctaveSpecialization(true);
+        double fixedMs = bestOf([&] { GetValues(perlin, &xs[0], &ys[0], &zs[0], &fixed[0], count); });
+        std::cout << std::fixed << std::setprecision(2) << std::setw(8) << octaveCount << std::setw(14) << runtimeMs
+                  << std::setw(12) << fixedMs << std::setw(10) << runtimeMs / fixedMs << std::setw(10)
+                  << (fixed == runtime ? "yes" : "NO") << std::endl;
+    }
+}
+
+/**
+ * @brief Compare per-point model sampling with the sphere and cylinder
+ * builders on 8192x4096 maps
+ *
+ * The models compute sines and cosines for every point and call GetValue();
+ * the builders take them from row and column tables and evaluate whole rows.
+ */
+void benchmarkCurvedMaps() {
+    const int width = 8192;
+    const int height = 4096;
+    module::Perlin perlin;
+    utils::NoiseMap noiseMap;
+
+    utils::NoiseMapBuilderSphere sphere;
+    sphere.SetSourceModule(perlin);
+    sphere.SetBounds(-90.0, 90.0, -180.0, 180.0);
+    model::Sphere sphereModel(perlin);
+
+    utils::NoiseMapBuilderCylinder cylinder;
+    cylinder.SetSourceModule(perlin);
+    cylinder.SetBounds(-180.0, 180.0, -4.0, 4.0);
+    model::Cylinder cylinderModel(perlin);
+
+    std::cout << "== Curved maps (" << width << "x" << height << " Perlin)" << std::endl;
+    std::cout << std::setw(10) << "map" << std::setw(12) << "model ms" << std::setw(14) << "builder ms"
+              << std::setw(10) << "speedup" << std::setw(10) << "equal" << std::endl;
+    struct CurvedMap {
+        const char* name;
+        utils::NoiseMapBuilder& builder;
+        std::function<double(double, double)> sample;
+        double lowerX, upperX, lowerY, upperY;
+    } maps[] = {
+        {"sphere", sphere, [&](double lon, double lat) { return sphereModel.GetValue(lat, lon); }, -180.0, 180.0, -90.0,
+         90.0},
+        {"cylinder", cylinder, [&](double angle, double y) { return cylinderModel.GetValue(angle, y); }, -180.0, 180.0,
+         -4.0, 4.0},
+    };
+    std::vector<float> reference((size_t)width * height);
+    for (const CurvedMap& map : maps) {
+        double xDelta = (map.upperX - map.lowerX) / width;
+        double yDelta = (map.upperY - map.lowerY) / height;
+        double modelMs = bestOf([&] {
+            double y = map.lowerY;
+            for (int row = 0; row < height; row++) {
+                double x = map.lowerX;
+                for (int column = 0; column < width; column++) {
+                    reference[(size_t)row * width + column] = (float)map.sample(x, y);
+                    x += xDelta;
+                }
+                y += yDelta;
+            }
+        });
+        map.builder.SetDestNoiseMap(noiseMap);
+        map.builder.SetDestSize(width, height);
+        double builderMs = bestOf([&] { map.builder.Build(); });
+        bool equal = true;
+        for (int row = 0; row < height && equal; row++) {
+            equal = std::equal(noiseMap.GetConstSlabPtr(row), noiseMap.GetConstSlabPtr(row) + width,
+                               &reference[(size_t)row * width]);
+        }
+        std::cout << std::fixed << std::setprecision(2) << std::setw(10) << map.name << std::setw(12) << modelMs
+                  << std::setw(14) << builderMs << std::setw(10) << modelMs / builderMs << std::setw(10)
+                  << (equal ? "yes" : "NO") << std::endl;
+    }
+}
+
+/**
+ * @brief Compare per-pixel gradient lookups with RendererImage on a
+ * 4096x4096 map
+ *
+ * GradientColor::GetColor() searches the gradient points for every pixel;
+ * the renderer takes colors from the gradient's color table and renders rows
+ * in parallel. The lit render is compared with the same lookups lit per
+ * pixel. The difference column is the largest channel difference to the
+ * reference, caused by the table's resolution.
+ */
+void benchmarkImageRendering() {
+    const int size = 4096;
+    module::Perlin perlin;
+    utils::NoiseMap noiseMap;
+    utils::NoiseMapBuilderPlane builder;
+    builder.SetSourceModule(perlin);
+    builder.SetDestNoiseMap(noiseMap);
+    builder.SetDestSize(size, size);
+    builder.SetBounds(0.0, 4.0, 0.0, 4.0);
+    builder.Build();
+
+    utils::Image image;
+    utils::RendererImage renderer;
+    renderer.BuildTerrainGradient();
+    renderer.SetSourceNoiseMap(noiseMap);
+    renderer.SetDestImage(image);
+
+    utils::GradientColor gradient;
+    gradient.AddGradientPoint(-1.00, utils::Color(0, 0, 128, 255));
+    gradient.AddGradientPoint(-0.20, utils::Color(32, 64, 128, 255));
+    gradient.AddGradientPoint(-0.04, utils::Color(64, 96, 192, 255));
+    gradient.AddGradientPoint(-0.02, utils::Color(192, 192, 128, 255));
+    gradient.AddGradientPoint(0.00, utils::Color(0, 192, 0, 255));
+    gradient.AddGradientPoint(0.25, utils::Color(192, 192, 0, 255));
+    gradient.AddGradientPoint(0.50, utils::Color(160, 96, 64, 255));
+    gradient.AddGradientPoint(0.75, utils::Color(128, 255, 255, 255));
+    gradient.AddGradientPoint(1.00, utils::Color(255, 255, 255, 255));
+    std::vector<utils::Color> reference((size_t)size * size);
+    double lookupMs = bestOf([&] {
+        for (int y = 0; y < size; y++) {
+            const float* pSource = noiseMap.GetConstSlabPtr(y);
+            for (int x = 0; x < size; x++) {
+                reference[(size_t)y * size + x] = gradient.GetColor(pSource[x]);
+            }
+        }
+    });
+
+    // The per-pixel lit render: GetColor() lookups lit with the renderer's
+    // default light (azimuth 45, elevation 45, contrast 1, brightness 1,
+    // white), from the four neighbours clamped to the map edges.
+    std::vector<utils::Color> litReference((size_t)size * size);
+    double litMs = bestOf([&] {
+        const double sin45 = std::sqrt(0.5);
+        const double io = std::sqrt(2.0) * sin45 / 2.0;
+        const double ixy = (1.0 - io) * std::sqrt(2.0) * sin45 * sin45;
+        for (int y = 0; y < size; y++) {
+            const float* pSource = noiseMap.GetConstSlabPtr(y);
+            const float* pDown = noiseMap.GetConstSlabPtr(std::max(y - 1, 0));
+            const float* pUp = noiseMap.GetConstSlabPtr(std::min(y + 1, size - 1));
+            for (int x = 0; x < size; x++) {
+                double left = pSource[std::max(x - 1, 0)];
+                double right = pSource[std::min(x + 1, size - 1)];
+                double intensity = std::max(ixy * (left - right) + ixy * (pDown[x] - pUp[x]) + io, 0.0);
+                const utils::Color& color = gradient.GetColor(pSource[x]);
+                auto channel = [&](int value) {
+                    double lit = std::min((value / 255.0) * intensity, 1.0);
+                    return (noise::uint8)(lit * 255.0);
+                };
+                litReference[(size_t)y * size + x] =
+                    utils::Color(channel(color.red), channel(color.green), channel(color.blue), 255);
+            }
+        }
+    });
+
+    std::cout << std::fixed << std::setprecision(2) << "== Image rendering (" << size << "x" << size
+              << " terrain gradient, " << lookupMs << " ms of GetColor() lookups, " << litMs
+              << " ms lit per pixel)" << std::endl;
+    std::cout << std::setw(8) << "light" << std::setw(12) << "render ms" << std::setw(10) << "speedup"
+              << std::setw(12) << "difference" << std::endl;
+    for (int light = 0; light < 2; light++) {
+        renderer.EnableLight(light == 1);
+        double renderMs = bestOf([&] { renderer.Render(); });
+        const std::vector<utils::Color>& expected = (light == 1) ? litReference : reference;
+        int difference = 0;
+        for (int y = 0; y < size; y++) {
+            const utils::Color* pDest = image.GetConstSlabPtr(y);
+            for (int x = 0; x < size; x++) {
+                const utils::Color& color = expected[(size_t)y * size + x];
+                difference = std::max({difference, std::abs(pDest[x].red - color.red),
+                                       std::abs(pDest[x].green - color.green),
+                                       std::abs(pDest[x].blue - color.blue)});
+            }
+        }
+        std::cout << std::fixed << std::setprecision(2) << std::setw(8) << (light == 1 ? "on" : "off")
+                  << std::setw(12) << renderMs << std::setw(10) << ((light == 1) ? litMs : lookupMs) / renderMs
+                  << std::setw(12) << difference << std::endl;
+    }
+}
+
+/**
+ * @brief Compare per-chunk height map pipelines with one shared Heightfield
+ *
+ * Before the shared heightfield every chunk owned a Perlin module, a noise
+ * map builder, a renderer, an image and a BMP writer, and built its own
+ * (CHUNK_SIZE + 1)^2 map whose last row and column repeat the neighbours'
+ * first ones. The byte counts only include what a chunk held for its height
+ * map, not its blocks. The slopes row also builds the slope maps that meshed
+ * chunks need.
+ */
+void benchmarkSharedHeightfield() {
+    const int worldSize = Config::World::SIZE;
+    const int side = Chunk::CHUNK_SIZE + 1;
+
+    // Discard the heightfield's log line
+    std::ostringstream discard;
+    std::streambuf* console = std::cout.rdbuf(discard.rdbuf());
+    double perChunkMs = bestOf([&] {
+        for (int i = 0; i < worldSize; i++) {
+            for (int j = 0; j < worldSize; j++) {
+                module::Perlin perlin;
+                perlin.SetFrequency(Config::Terrain::NOISE_FREQUENCY);
+                utils::NoiseMap heightMap;
+                utils::NoiseMapBuilderPlane builder;
+                builder.SetSourceModule(perlin);
+                builder.SetDestNoiseMap(heightMap);
+                builder.SetDestSize(side, side);
+                double dx = Chunk::CHUNK_SIZE * (i + 2);
+                double dy = Chunk::CHUNK_SIZE * (j + 2);
+                builder.SetBounds(dx, dx + Chunk::CHUNK_SIZE, dy, dy + Chunk::CHUNK_SIZE);
+                builder.Build();
+            }
+        }
+    });
+    Heightfield heightfield;
+    double sharedMs = bestOf([&] { heightfield.build(2, 2, worldSize, worldSize); });
+    heightfield.setSlopeMaps(true);
+    double slopesMs = bestOf([&] { heightfield.build(2, 2, worldSize, worldSize); });
+    std::cout.rdbuf(console);
+
+    size_t perChunkBytes = sizeof(module::Perlin) + sizeof(utils::NoiseMap) + sizeof(utils::NoiseMapBuilderPlane) +
+                           sizeof(utils::RendererImage) + sizeof(utils::Image) + sizeof(utils::WriterBMP) +
+                           side * side * (2 * sizeof(float) + sizeof(utils::Color)) +
+                           utils::GRADIENT_TABLE_SIZE * sizeof(utils::Color);
+    long perChunkSamples = (long)worldSize * worldSize * side * side;
+    long sharedSamples = (long)(worldSize * Chunk::CHUNK_SIZE + 1) * (worldSize * Chunk::CHUNK_SIZE + 1);
+    std::cout << "== Shared heightfield (" << worldSize << "x" << worldSize << " chunks)" << std::endl;
+    std::cout << std::setw(12) << "pipeline" << std::setw(12) << "build ms" << std::setw(12) << "samples"
+              << std::setw(16) << "bytes/chunk" << std::endl;
+    std::cout << std::fixed << std::setprecision(2) << std::setw(12) << "per chunk" << std::setw(12) << perChunkMs
+              << std::setw(12) << perChunkSamples << std::setw(16) << perChunkBytes << std::endl;
+    std::cout << std::setw(12) << "shared" << std::setw(12) << sharedMs << std::setw(12) << sharedSamples
+              << std::setw(16) << sizeof(HeightfieldView) << std::endl;
+    std::cout << std::setw(12) << "slopes" << std::setw(12) << slopesMs << std::setw(12) << sharedSamples
+              << std::setw(16) << sizeof(HeightfieldView) << std::endl;
+}
+
+/**
+ * @brief Startup time and block memory of the default world with smooth
+ * chunks voxelized eagerly and lazily
+ *
+ * Smooth chunks mesh straight from the heightfield; their blocks are only
+ * created when getBlocks() or render() asks for them. The eager column forces
+ * that right after createSmoothLandscape(), the way every chunk used to fill
+ * its 32^3 blocks.
+ */
+void benchmarkLazyVoxels() {
+    const int worldSize = Config::World::SIZE;
+    const int chunkSize = Chunk::CHUNK_SIZE;
+    const size_t blockBytes = chunkSize * sizeof(Block**) + chunkSize * chunkSize * sizeof(Block*) +
+                              (size_t)chunkSize * chunkSize * chunkSize * sizeof(Block);
+    JobSystem& jobs = JobSystem::getInstance();
+
+    std::cout << "== Lazy voxelization (" << worldSize << "x" << worldSize << " smooth chunks)" << std::endl;
+    std::cout << std::setw(8) << "blocks" << std::setw(12) << "startup ms" << std::setw(14) << "voxelized"
+              << std::setw(14) << "block MB" << std::endl;
+    std::ostringstream discard;
+    for (int eager = 1; eager >= 0; eager--) {
+        int voxelized = 0;
+        std::streambuf* console = std::cout.rdbuf(discard.rdbuf());
+        double startupMs = bestOf([&] {
+            Heightfield heightfield;
+            heightfield.setSlopeMaps(true);
+            heightfield.build(2, 2, worldSize, worldSize);
+            JobCounter chunkJobs;
+            std::vector<std::unique_ptr<Chunk>> chunks(worldSize * worldSize);
+            std::vector<std::vector<float>> meshes(worldSize * worldSize);
+            for (int i = 0; i < worldSize; i++) {
+                for (int j = 0; j < worldSize; j++) {
+                    Chunk* chunk = (chunks[i * worldSize + j] = std::make_unique<Chunk>()).get();
+                    std::vector<float>* mesh = &meshes[i * worldSize + j];
+                    HeightfieldView view = heightfield.getChunkView(i + 2, j + 2);
+                    jobs.run(chunkJobs, [chunk, mesh, view, eager] {
+                        chunk->createSmoothLandscape(view);
+                        if (eager) {
+                            chunk->getBlocks();
+                        }
+                        *mesh = chunk->renderSmooth();
+                    });
+                }
+            }
+            jobs.wait(chunkJobs);
+            voxelized = (int)std::count_if(chunks.begin(), chunks.end(),
+                                           [](const std::unique_ptr<Chunk>& chunk) { return chunk->hasBlocks(); });
+        });
+        std::cout.rdbuf(console);
+        discard.str("");
+        std::cout << std::fixed << std::setprecision(2) << std::setw(8) << (eager ? "eager" : "lazy")
+                  << std::setw(12) << startupMs << std::setw(14) << voxelized << std::setw(14)
+                  << voxelized * blockBytes / (1024.0 * 1024.0) << std::endl;
+    }
+}
+
+/**
+ * @brief Start the default world's heightfield from an empty and from a warm
+ * tile cache, and check that changed noise parameters invalidate the tile
+ *
+ * The cold run generates the samples and writes the tile; the warm runs map
+ * the tile without evaluating any noise. The cache directory is removed
+ * afterwards.
+ */
+void benchmarkTileCache() {
+    const int worldSize = Config::World::SIZE;
+    const std::string directory = "./noise_benchmark_tiles";
+    std::filesystem::remove_all(directory);
+
+    std::ostringstream discard;
+    std::streambuf* console = std::cout.rdbuf(discard.rdbuf());
+    double uncachedMs = bestOf([&] {
+        Heightfield heightfield;
+        heightfield.build(2, 2, worldSize, worldSize);
+    });
+    utils::NoiseMapTileCache cache(directory);
+    auto start = std::chrono::steady_clock::now();
+    {
+        Heightfield heightfield;
+        heightfield.setTileCache(&cache);
+        heightfield.build(2, 2, worldSize, worldSize);
+    }
+    std::chrono::duration<double, std::milli> coldMs = std::chrono::steady_clock::now() - start;
+    double sum = 0.0;
+    double warmMs = bestOf([&] {
+        Heightfield heightfield;
+        heightfield.setTileCache(&cache);
+        heightfield.build(2, 2, worldSize, worldSize);
+        // Touch every sample so the pages are actually read
+        for (int i = 0; i < worldSize; i++) {
+            for (int j = 0; j < worldSize; j++) {
+                HeightfieldView view = heightfield.getChunkView(i + 2, j + 2);
+                for (int row = 0; row <= Chunk::CHUNK_SIZE; row++) {
+                    for (int x = 0; x <= Chunk::CHUNK_SIZE; x++) {
+                        sum += view.getValue(x, row);
+                    }
+                }
+            }
+        }
+    });
+    std::cout.rdbuf(console);
+
+    // The same region generated with another frequency must not hit the tile
+    // written above
+    module::Perlin perlin;
+    perlin.SetFrequency(Config::Terrain::NOISE_FREQUENCY * 2.0);
+    utils::NoiseMapTileKey key;
+    utils::GetModuleGraphHash(perlin, key.graphHash);
+    key.seed = perlin.GetSeed();
+    key.width = worldSize * Chunk::CHUNK_SIZE + 1;
+    key.height = worldSize * Chunk::CHUNK_SIZE + 1;
+    key.lowerXBound = 2.0 * Chunk::CHUNK_SIZE;
+    key.upperXBound = key.lowerXBound + key.width;
+    key.lowerZBound = 2.0 * Chunk::CHUNK_SIZE;
+    key.upperZBound = key.lowerZBound + key.height;
+    key.channel = 0;
+    utils::NoiseMapTile tile;
+    bool staleHit = cache.Load(key, tile);
+    std::filesystem::remove_all(directory);
+
+    std::cout << "== Heightfield tile cache (" << worldSize << "x" << worldSize << " chunks)" << std::endl;
+    std::cout << std::setw(12) << "start" << std::setw(12) << "build ms" << std::endl;
+    std::cout << std::fixed << std::setprecision(2) << std::setw(12) << "no cache" << std::setw(12) << uncachedMs
+              << std::endl;
+    std::cout << std::setw(12) << "cold" << std::setw(12) << coldMs.count() << std::endl;
+    std::cout << std::setw(12) << "warm" << std::setw(12) << warmMs << std::endl;
+    std::cout << "hits " << cache.GetHitCount() << ", misses " << cache.GetMissCount() << ", stale "
+              << cache.GetStaleCount() << ", changed frequency " << (staleHit ? "HIT (wrong)" : "missed")
+              << " (checksum " << sum << ")" << std::endl;
+}
+
+/**
+ * @brief Time from nothing to every chunk's vertex buffer being ready for
+ * upload, generated and meshed versus mapped from a baked world
+ *
+ * The mapped column reads every float once, as the GL upload would.
+ */
+void benchmarkBakedWorld() {
+    const int worldSize = Config::World::SIZE;
+    const std::string filename = "./noise_benchmark_world.baked";
+    JobSystem& jobs = JobSystem::getInstance();
+
+    std::ostringstream discard;
+    std::streambuf* console = std::cout.rdbuf(discard.rdbuf());
+    std::vector<std::vector<float>> meshes;
+    unsigned long long sourceHash = 0;
+    double generatedMs = bestOf([&] {
+        Heightfield heightfield;
+        heightfield.setSlopeMaps(true);
+        heightfield.build(2, 2, worldSize, worldSize);
+        sourceHash = heightfield.getSourceHash();
+        JobCounter chunkJobs;
+        std::vector<std::unique_ptr<Chunk>> chunks(worldSize * worldSize);
+        meshes.assign(worldSize * worldSize, std::vector<float>());
+        for (int i = 0; i < worldSize; i++) {
+            for (int j = 0; j < worldSize; j++) {
+                Chunk* chunk = (chunks[i * worldSize + j] = std::make_unique<Chunk>()).get();
+                std::vector<float>* mesh = &meshes[i * worldSize + j];
+                HeightfieldView view = heightfield.getChunkView(i + 2, j + 2);
+                jobs.run(chunkJobs, [chunk, mesh, view] {
+                    chunk->createSmoothLandscape(view);
+                    *mesh = chunk->renderSmooth();
+                });
+            }
+        }
+        jobs.wait(chunkJobs);
+    });
+    BakedWorld::bake(filename, worldSize, sourceHash, meshes);
+    size_t floats = 0;
+    float checksum = 0.0f;
+    double mappedMs = bestOf([&] {
+        BakedWorld bakedWorld;
+        bakedWorld.open(filename, worldSize, sourceHash);
+        floats = 0;
+        for (int i = 0; i < worldSize; i++) {
+            for (int j = 0; j < worldSize; j++) {
+                size_t count = 0;
+                const float* mesh = bakedWorld.getMesh(i, j, count);
+                for (size_t k = 0; k < count; k++) {
+                    checksum += mesh[k];
+                }
+                floats += count;
+            }
+        }
+    });
+    std::cout.rdbuf(console);
+    std::remove(filename.c_str());
+
+    std::cout << "== Baked world (" << worldSize << "x" << worldSize << " chunks, "
+              << floats * sizeof(float) / 1024 << " KB of vertices)" << std::endl;
+    std::cout << std::setw(12) << "meshes" << std::setw(12) << "ready ms" << std::endl;
+    std::cout << std::fixed << std::setprecision(2) << std::setw(12) << "generated" << std::setw(12) << generatedMs
+              << std::endl;
+    std::cout << std::setw(12) << "mapped" << std::setw(12) << mappedMs << " (checksum " << checksum << ")"
+              << std::endl;
+}
+
+/**
+ * @brief Save the default world's blocks to region files and load them back
+ * on the job system
+ *
+ * The save column is what the frame pays (encoding the snapshots); the flush
+ * runs on a worker in the game and is timed separately here.
+ */
+void benchmarkRegionFiles() {
+    const int worldSize = Config::World::SIZE;
+    const std::string directory = "./noise_benchmark_regions";
+    std::filesystem::remove_all(directory);
+    JobSystem& jobs = JobSystem::getInstance();
+
+    std::ostringstream discard;
+    std::streambuf* console = std::cout.rdbuf(discard.rdbuf());
+    Heightfield heightfield;
+    heightfield.build(2, 2, worldSize, worldSize);
+    std::vector<std::unique_ptr<Chunk>> chunks(worldSize * worldSize);
+    for (int i = 0; i < worldSize; i++) {
+        for (int j = 0; j < worldSize; j++) {
+            chunks[i * worldSize + j] = std::make_unique<Chunk>();
+            chunks[i * worldSize + j]->createLandscape(heightfield.getChunkView(i + 2, j + 2));
+        }
+    }
+
+    double markMs = 0.0, flushMs = 0.0, loadMs = 0.0;
+    int loaded = 0;
+    {
+        RegionStore regions(directory);
+        markMs = bestOf([&] {
+            for (int i = 0; i < worldSize; i++) {
+                for (int j = 0; j < worldSize; j++) {
+                    regions.markDirty(i + 2, j + 2, *chunks[i * worldSize + j]);
+                }
+            }
+        });
+        auto start = std::chrono::steady_clock::now();
+        regions.flush();
+        flushMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    std::vector<std::unique_ptr<Chunk>> restored(worldSize * worldSize);
+    loadMs = bestOf([&] {
+        RegionStore regions(directory);
+        JobCounter loadJobs;
+        std::unique_ptr<bool[]> found(new bool[worldSize * worldSize]);
+        for (int c = 0; c < worldSize * worldSize; c++) {
+            restored[c] = std::make_unique<Chunk>();
+            regions.loadChunkAsync(c / worldSize + 2, c % worldSize + 2, restored[c].get(), &found[c], loadJobs);
+        }
+        jobs.wait(loadJobs);
+        loaded = (int)std::count(found.get(), found.get() + worldSize * worldSize, true);
+    });
+    std::cout.rdbuf(console);
+
+    uintmax_t fileBytes = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        fileBytes += entry.file_size();
+    }
+    std::filesystem::remove_all(directory);
+    size_t rawBytes = (size_t)worldSize * worldSize * Chunk::CHUNK_SIZE * Chunk::CHUNK_SIZE * Chunk::CHUNK_SIZE;
+
+    std::cout << "== Region files (" << worldSize << "x" << worldSize << " block chunks)" << std::endl;
+    std::cout << std::fixed << std::setprecision(2) << "mark dirty " << markMs << " ms, flush " << flushMs
+              << " ms, async load " << loadMs << " ms (" << loaded << " chunks)" << std::endl;
+    std::cout << "on disk " << fileBytes / 1024 << " KB, one byte per block " << rawBytes / 1024 << " KB" << std::endl;
+}
+
+/**
+ * @brief Compare exporting a lit BMP and a TER file in one piece with the
+ * strip-by-strip stream writers
+ *
+ * The whole-map export holds the noise map and the image; the stream writers
+ * hold two strips of each plus their write buffer. The byte counts leave out
+ * the borders of the noise maps and images.
+ */
+void benchmarkStreamingExport() {
+    const int size = 4096;
+    const int stripHeight = utils::DEFAULT_STRIP_HEIGHT;
+    module::Perlin perlin;
+    utils::NoiseMapBuilderPlane builder;
+    builder.SetSourceModule(perlin);
+    builder.SetDestSize(size, size);
+    builder.SetBounds(0.0, 4.0, 0.0, 4.0);
+    utils::RendererImage renderer;
+    renderer.BuildTerrainGradient();
+    renderer.EnableLight(true);
+
+    double wholeMs = bestOf([&] {
+        utils::NoiseMap noiseMap;
+        utils::Image image;
+        builder.SetDestNoiseMap(noiseMap);
+        builder.Build();
+        renderer.SetSourceNoiseMap(noiseMap);
+        renderer.SetDestImage(image);
+        renderer.Render();
+        utils::WriterBMP bmpWriter;
+        bmpWriter.SetSourceImage(image);
+        bmpWriter.SetDestFilename("noise_benchmark_whole.bmp");
+        bmpWriter.WriteDestFile();
+        utils::WriterTER terWriter;
+        terWriter.SetSourceNoiseMap(noiseMap);
+        terWriter.SetDestFilename("noise_benchmark_whole.ter");
+        terWriter.WriteDestFile();
+    });
+    // The stream writers build the noise map once per file
+    double stripMs = bestOf([&] {
+        utils::StreamWriterBMP bmpWriter;
+        bmpWriter.Open("noise_benchmark_strips.bmp", size, size);
+        bmpWriter.WriteStrips(builder, renderer, stripHeight);
+        bmpWriter.Close();
+    });
+    double terStripMs = bestOf([&] {
+        utils::StreamWriterTER terWriter;
+        terWriter.Open("noise_benchmark_strips.ter", size, size);
+        terWriter.WriteStrips(builder, stripHeight);
+        terWriter.Close();
+    });
+
+    auto sameFile = [](const std::string& a, const std::string& b) {
+        std::ifstream fileA(a, std::ios::binary), fileB(b, std::ios::binary);
+        return std::equal(std::istreambuf_iterator<char>(fileA), std::istreambuf_iterator<char>(),
+                          std::istreambuf_iterator<char>(fileB), std::istreambuf_iterator<char>());
+    };
+    bool identical = sameFile("noise_benchmark_whole.bmp", "noise_benchmark_strips.bmp") &&
+                     sameFile("noise_benchmark_whole.ter", "noise_benchmark_strips.ter");
+    for (const char* name : {"noise_benchmark_whole.bmp", "noise_benchmark_whole.ter", "noise_benchmark_strips.bmp",
+                             "noise_benchmark_strips.ter"}) {
+        std::filesystem::remove(name);
+    }
+
+    size_t pointBytes = sizeof(float) + sizeof(utils::Color);
+    size_t wholeBytes = (size_t)size * size * pointBytes;
+    size_t stripBytes = 2 * (size_t)size * (stripHeight + 2) * pointBytes + (1 << 20);
+    std::cout << "== Streaming export (" << size << "x" << size << " lit BMP and TER, " << stripHeight
+              << "-row strips)" << std::endl;
+    std::cout << std::fixed << std::setprecision(2) << "whole map " << wholeMs << " ms, " << wholeBytes / 1024
+              << " KB; strips " << stripMs << " + " << terStripMs << " ms, " << stripBytes / 1024 << " KB; files "
+              << (identical ? "identical" : "DIFFERENT") << std::endl;
+}
+
+/**
+ * @brief Compare float and 16-bit quantized storage of a large height map
+ *
+ * The quantized map is built strip by strip, so its peak also holds one
+ * strip of floats. The error is measured against the float values clamped
+ * to the quantized range, as chunks clamp their heights anyway.
+ */
+void benchmarkQuantizedNoiseMap() {
+    const int size = 4097;
+    const int stripRows = Config::Terrain::HEIGHTFIELD_STRIP_ROWS;
+    module::Perlin perlin;
+    perlin.SetFrequency(Config::Terrain::NOISE_FREQUENCY);
+    utils::NoiseMapBuilderPlane builder;
+    builder.SetSourceModule(perlin);
+    builder.SetDestSize(size, size);
+    builder.SetBounds(0.0, size, 0.0, size);
+
+    utils::NoiseMap floatMap;
+    double floatMs = bestOf([&] {
+        builder.SetDestNoiseMap(floatMap);
+        builder.Build();
+    });
+    utils::QuantizedNoiseMap quantizedMap;
+    double quantizedMs = bestOf([&] {
+        utils::NoiseMap strip;
+        builder.SetDestNoiseMap(strip);
+        quantizedMap.SetSize(size, size);
+        for (int firstRow = 0; firstRow < size; firstRow += stripRows) {
+            int lastRow = std::min(size, firstRow + stripRows);
+            builder.SetDestRowRange(firstRow, lastRow);
+            builder.Build();
+            quantizedMap.QuantizeRows(strip, 0, firstRow, lastRow - firstRow);
+        }
+        builder.ClearDestRowRange();
+    });
+
+    double maxError = 0.0;
+    for (int y = 0; y < size; y++) {
+        const float* pFloat = floatMap.GetConstSlabPtr(y);
+        for (int x = 0; x < size; x++) {
+            double expected = std::max(-1.0, std::min(1.0, (double)pFloat[x]));
+            maxError = std::max(maxError, std::abs(quantizedMap.GetValue(x, y) - expected));
+        }
+    }
+
+    // Read every sample the way a chunk does
+    double floatSum = 0.0, quantizedSum = 0.0;
+    double floatReadMs = bestOf([&] {
+        for (int y = 0; y < size; y++) {
+            const float* pRow = floatMap.GetConstSlabPtr(y);
+            for (int x = 0; x < size; x++) {
+                floatSum += pRow[x];
+            }
+        }
+    });
+    double quantizedReadMs = bestOf([&] {
+        float scale = quantizedMap.GetScale();
+        float bias = quantizedMap.GetBias();
+        for (int y = 0; y < size; y++) {
+            const uint16* pRow = quantizedMap.GetConstSlabPtr(y);
+            for (int x = 0; x < size; x++) {
+                quantizedSum += bias + (float)pRow[x] * scale;
+            }
+        }
+    });
+
+    utils::Image image;
+    utils::RendererImage renderer;
+    renderer.BuildTerrainGradient();
+    renderer.EnableLight(true);
+    renderer.SetDestImage(image);
+    renderer.SetSourceNoiseMap(floatMap);
+    double floatRenderMs = bestOf([&] { renderer.Render(); });
+    renderer.SetSourceNoiseMap(quantizedMap);
+    double quantizedRenderMs = bestOf([&] { renderer.Render(); });
+
+    size_t floatBytes = floatMap.GetMemUsed() * sizeof(float);
+    size_t quantizedBytes = quantizedMap.GetMemUsed() * sizeof(uint16);
+    size_t stripBytes = (size_t)size * stripRows * sizeof(float);
+    std::cout << "== Quantized noise map (" << size << "x" << size << ", " << stripRows << "-row strips)"
+              << std::endl;
+    std::cout << std::setw(12) << "storage" << std::setw(10) << "KB" << std::setw(12) << "build ms" << std::setw(12)
+              << "read ms" << std::setw(12) << "render ms" << std::endl;
+    std::cout << std::fixed << std::setprecision(2) << std::setw(12) << "float" << std::setw(10) << floatBytes / 1024
+              << std::setw(12) << floatMs << std::setw(12) << floatReadMs << std::setw(12) << floatRenderMs
+              << std::endl;
+    std::cout << std::setw(12) << "16-bit" << std::setw(10) << (quantizedBytes + stripBytes) / 1024 << std::setw(12)
+              << quantizedMs << std::setw(12) << quantizedReadMs << std::setw(12) << quantizedRenderMs << std::endl;
+    std::cout << std::setprecision(6) << "max error " << maxError << ", step " << quantizedMap.GetScale()
+              << " (checksums " << std::setprecision(1) << floatSum << ", " << quantizedSum << ")" << std::endl;
+}
+
+/**
+ * @brief Compare the serial normal map loop with the row-parallel renderer
+ *
+ * The serial loop is what RendererNormalMap::Render() used to do: one pixel
+ * at a time into an RGBA image. The renderer also writes the GPU formats
+ * directly, so no image has to be converted before the texture upload.
+ */
+void benchmarkNormalMaps() {
+    const int size = 4097;
+    const double bumpHeight = Config::World::CHUNK_SIZE / 2.0 * Config::Terrain::NORMAL_MAP_DETAIL;
+    module::Perlin perlin;
+    perlin.SetFrequency(Config::Terrain::NOISE_FREQUENCY / Config::Terrain::NORMAL_MAP_DETAIL);
+    utils::NoiseMap noiseMap;
+    utils::NoiseMapBuilderPlane builder;
+    builder.SetSourceModule(perlin);
+    builder.SetDestNoiseMap(noiseMap);
+    builder.SetDestSize(size, size);
+    builder.SetBounds(0.0, size, 0.0, size);
+    builder.Build();
+
+    std::vector<utils::Color> reference((size_t)size * size);
+    double serialMs = bestOf([&] {
+        for (int y = 0; y < size; y++) {
+            const float* pSource = noiseMap.GetConstSlabPtr(y);
+            const float* pUp = noiseMap.GetConstSlabPtr(std::min(y + 1, size - 1));
+            for (int x = 0; x < size; x++) {
+                double nc = pSource[x] * bumpHeight;
+                double nr = pSource[std::min(x + 1, size - 1)] * bumpHeight;
+                double nu = pUp[x] * bumpHeight;
+                double d = std::sqrt((nc - nu) * (nc - nu) + (nc - nr) * (nc - nr) + 1);
+                reference[(size_t)y * size + x] = utils::Color((uint8)std::floor(((nc - nr) / d + 1.0) * 127.5),
+                                                               (uint8)std::floor(((nc - nu) / d + 1.0) * 127.5),
+                                                               (uint8)std::floor((1.0 / d + 1.0) * 127.5), 0);
+            }
+        }
+    });
+
+    utils::RendererNormalMap renderer;
+    renderer.SetSourceNoiseMap(noiseMap);
+    renderer.SetBumpHeight(bumpHeight);
+    utils::Image image;
+    renderer.SetDestImage(image);
+    double imageMs = bestOf([&] { renderer.Render(); });
+    std::vector<uint8> rg8(renderer.GetDestBufferSize(utils::NORMAL_MAP_RG8));
+    renderer.SetDestBuffer(rg8.data(), utils::NORMAL_MAP_RG8);
+    double rg8Ms = bestOf([&] { renderer.Render(); });
+    std::vector<uint8> rgb10a2(renderer.GetDestBufferSize(utils::NORMAL_MAP_RGB10A2));
+    renderer.SetDestBuffer(rgb10a2.data(), utils::NORMAL_MAP_RGB10A2);
+    double rgb10a2Ms = bestOf([&] { renderer.Render(); });
+
+    // The image and RG8 channels must match the serial loop exactly
+    int imageDifference = 0;
+    int rg8Difference = 0;
+    for (int y = 0; y < size; y++) {
+        const utils::Color* pDest = image.GetConstSlabPtr(y);
+        for (int x = 0; x < size; x++) {
+            size_t i = (size_t)y * size + x;
+            const utils::Color& color = reference[i];
+            imageDifference = std::max({imageDifference, std::abs(pDest[x].red - color.red),
+                                        std::abs(pDest[x].green - color.green),
+                                        std::abs(pDest[x].blue - color.blue)});
+            rg8Difference = std::max({rg8Difference, std::abs(rg8[i * 2] - color.red),
+                                      std::abs(rg8[i * 2 + 1] - color.green)});
+        }
+    }
+
+    std::cout << "== Normal maps (" << size << "x" << size << ", " << JobSystem::getInstance().getThreadCount()
+              << " threads)" << std::endl;
+    std::cout << std::setw(10) << "dest" << std::setw(10) << "KB" << std::setw(12) << "render ms" << std::setw(10)
+              << "speedup" << std::setw(12) << "difference" << std::endl;
+    auto printRow = [&](const char* name, size_t bytes, double ms, const std::string& difference) {
+        std::cout << std::fixed << std::setprecision(2) << std::setw(10) << name << std::setw(10) << bytes / 1024
+                  << std::setw(12) << ms << std::setw(10) << serialMs / ms << std::setw(12) << difference
+                  << std::endl;
+    };
+    size_t imageBytes = (size_t)size * size * sizeof(utils::Color);
+    printRow("serial", imageBytes, serialMs, "-");
+    printRow("image", imageBytes, imageMs, std::to_string(imageDifference));
+    printRow("RG8", rg8.size(), rg8Ms, std::to_string(rg8Difference));
+    printRow("RGB10A2", rgb10a2.size(), rgb10a2Ms, "-");
+}
+
+/**
+ * @brief Four-dimensional gradient noise on the hypercube lattice
+ *
+ * libnoise has no four-dimensional generator. This is GradientCoherentNoise3D()
+ * with a fourth axis: every sample hashes the 16 corners of its hypercube,
+ * takes their gradient products and blends them with the quintic S-curve.
+ * Only the Simplex benchmark uses it.
+ */
+double latticeNoise4D(double x, double y, double z, double w, int seed) {
+    const unsigned int axisHash[4] = {1619, 31337, 6971, 1999};
+    double p[4] = {x, y, z, w};
+    long long cell[4];
+    double fade[4];
+    for (int a = 0; a < 4; a++) {
+        cell[a] = (long long)std::floor(p[a]);
+        p[a] -= (double)cell[a];
+        fade[a] = noise::SCurve5(p[a]);
+    }
+
+    // Gradients are the edges of the hypercube: one axis is zero, the other
+    // three are +1 or -1
+    double corners[16];
+    for (int c = 0; c < 16; c++) {
+        unsigned int hash = 1013u * (unsigned int)seed;
+        for (int a = 0; a < 4; a++) {
+            hash += axisHash[a] * (unsigned int)(cell[a] + ((c >> a) & 1));
+        }
+        hash ^= hash >> 8;
+        int zeroAxis = (hash >> 3) & 3;
+        double product = 0.0;
+        for (int a = 0, bit = 0; a < 4; a++) {
+            if (a != zeroAxis) {
+                double offset = p[a] - ((c >> a) & 1);
+                product += ((hash >> bit++) & 1) ? offset : -offset;
+            }
+        }
+        corners[c] = product;
+    }
+    for (int a = 0, count = 16; a < 4; a++, count /= 2) {
+        for (int c = 0; c < count / 2; c++) {
+            corners[c] = noise::LinearInterp(corners[c * 2], corners[c * 2 + 1], fade[a]);
+        }
+    }
+    return corners[0];
+}
+
+/**
+ * @brief Lattice gradient noise against Simplex, per sample and in builders
+ *
+ * 2D compares noise::GetValue2D() of Perlin (the planar kernel, 4 corners per
+ * octave) with Simplex::GetValue2D() (3), 3D Perlin::GetValue() (8) with
+ * Simplex::GetValue() (4), and 4D the hypercube noise above (16) with
+ * Simplex::GetValue4D() (5). All run six octaves. The 3D batch row runs the
+ * 3D samples through noise::GetValues(), the path of the builders, where
+ * Simplex has an AVX2 kernel. The comparison image puts
+ * Perlin, Billow and RidgedMulti above the fBm, billow and ridged Simplex
+ * types, rendered through RendererImage.
+ */
+void benchmarkSimplex() {
+    const int sampleCount = 1 << 20;
+    const int octaveCount = module::DEFAULT_PERLIN_OCTAVE_COUNT;
+    std::vector<double> coords((size_t)sampleCount * 4);
+    unsigned int state = 12345;
+    for (double& coord : coords) {
+        state = state * 1664525u + 1013904223u;
+        coord = (state >> 8) * (256.0 / 16777216.0) - 128.0;
+    }
+    const double* c = coords.data();
+
+    module::Perlin perlin;
+    module::Simplex simplex;
+    double sink = 0.0;
+    auto nsPerSample = [&](const std::function<double(int)>& sample) {
+        return bestOf([&] {
+            for (int i = 0; i < sampleCount; i++) {
+                sink += sample(i);
+            }
+        }) * 1.0e6 / sampleCount;
+    };
+    double lattice2D = nsPerSample([&](int i) { return GetValue2D(perlin, c[i * 4], c[i * 4 + 1]); });
+    double simplex2D = nsPerSample([&](int i) { return simplex.GetValue2D(c[i * 4], c[i * 4 + 1]); });
+    double lattice3D = nsPerSample([&](int i) { return perlin.GetValue(c[i * 4], c[i * 4 + 1], c[i * 4 + 2]); });
+    double simplex3D = nsPerSample([&](int i) { return simplex.GetValue(c[i * 4], c[i * 4 + 1], c[i * 4 + 2]); });
+    double lattice4D = nsPerSample([&](int i) {
+        double value = 0.0, amplitude = 1.0, scale = 1.0;
+        for (int octave = 0; octave < octaveCount; octave++) {
+            value += latticeNoise4D(c[i * 4] * scale, c[i * 4 + 1] * scale, c[i * 4 + 2] * scale,
+                                    c[i * 4 + 3] * scale, octave) * amplitude;
+            amplitude *= module::DEFAULT_PERLIN_PERSISTENCE;
+            scale *= module::DEFAULT_PERLIN_LACUNARITY;
+        }
+        return value;
+    });
+    double simplex4D =
+        nsPerSample([&](int i) { return simplex.GetValue4D(c[i * 4], c[i * 4 + 1], c[i * 4 + 2], c[i * 4 + 3]); });
+
+    // The same 3D samples through noise::GetValues(), which the builders use
+    std::vector<double> xs(sampleCount), ys(sampleCount), zs(sampleCount), batchValues(sampleCount);
+    for (int i = 0; i < sampleCount; i++) {
+        xs[i] = c[i * 4];
+        ys[i] = c[i * 4 + 1];
+        zs[i] = c[i * 4 + 2];
+    }
+    auto batchNsPerSample = [&](const module::Module& module) {
+        return bestOf([&] { GetValues(module, xs.data(), ys.data(), zs.data(), batchValues.data(), sampleCount); }) *
+               1.0e6 / sampleCount;
+    };
+    double latticeBatch = batchNsPerSample(perlin);
+    double simplexBatch = batchNsPerSample(simplex);
+    bool batchEqual = true;
+    for (int i = 0; i < sampleCount && batchEqual; i++) {
+        batchEqual = (batchValues[i] == simplex.GetValue(xs[i], ys[i], zs[i]));
+    }
+
+    std::cout << "== Simplex noise (" << sampleCount << " samples, " << octaveCount << " octaves)" << std::endl;
+    std::cout << std::setw(10) << "dims" << std::setw(10) << "corners" << std::setw(14) << "lattice ns"
+              << std::setw(14) << "simplex ns" << std::setw(10) << "speedup" << std::endl;
+    const char* names[4] = {"2D", "3D", "4D", "3D batch"};
+    const char* corners[4] = {"4 / 3", "8 / 4", "16 / 5", "8 / 4"};
+    double latticeNs[4] = {lattice2D, lattice3D, lattice4D, latticeBatch};
+    double simplexNs[4] = {simplex2D, simplex3D, simplex4D, simplexBatch};
+    for (int i = 0; i < 4; i++) {
+        std::cout << std::fixed << std::setprecision(1) << std::setw(10) << names[i] << std::setw(10) << corners[i]
+                  << std::setw(14) << latticeNs[i] << std::setw(14) << simplexNs[i] << std::setw(10)
+                  << std::setprecision(2) << latticeNs[i] / simplexNs[i] << std::endl;
+    }
+    std::cout << "batch Simplex equals GetValue(): " << (batchEqual ? "yes" : "NO") << std::endl;
+
+    // Every builder takes the module as it is
+    const int size = 512;
+    utils::NoiseMapBuilderPlane plane;
+    plane.SetBounds(0.0, 8.0, 0.0, 8.0);
+    utils::NoiseMapBuilderCylinder cylinder;
+    cylinder.SetBounds(-180.0, 180.0, -4.0, 4.0);
+    utils::NoiseMapBuilderSphere sphere;
+    sphere.SetBounds(-90.0, 90.0, -180.0, 180.0);
+    utils::NoiseMapBuilder* builders[3] = {&plane, &cylinder, &sphere};
+    std::cout << std::setw(10) << "builder" << std::setw(12) << "Perlin ms" << std::setw(12) << "Simplex ms"
+              << std::setw(10) << "speedup" << std::endl;
+    const char* builderNames[3] = {"plane", "cylinder", "sphere"};
+    for (int i = 0; i < 3; i++) {
+        builders[i]->SetSourceModule(perlin);
+        double perlinMs = bestOf([&] { buildMap(*builders[i], size, size); });
+        builders[i]->SetSourceModule(simplex);
+        double simplexMs = bestOf([&] { buildMap(*builders[i], size, size); });
+        std::cout << std::fixed << std::setprecision(2) << std::setw(10) << builderNames[i] << std::setw(12)
+                  << perlinMs << std::setw(12) << simplexMs << std::setw(10) << perlinMs / simplexMs << std::endl;
+    }
+
+    // Lattice modules on the top row, the matching Simplex types below
+    module::Billow billow;
+    module::RidgedMulti ridged;
+    module::Simplex simplexTypes[3];
+    simplexTypes[1].SetType(module::SIMPLEX_BILLOW);
+    simplexTypes[2].SetType(module::SIMPLEX_RIDGED);
+    const module::Module* tiles[6] = {&perlin, &billow, &ridged, &simplexTypes[0], &simplexTypes[1], &simplexTypes[2]};
+    const int tileSize = 256;
+    utils::Image comparison(tileSize * 3, tileSize * 2);
+    utils::NoiseMap noiseMap;
+    utils::Image tileImage;
+    utils::RendererImage renderer;
+    renderer.BuildTerrainGradient();
+    renderer.EnableLight(true);
+    renderer.SetSourceNoiseMap(noiseMap);
+    renderer.SetDestImage(tileImage);
+    plane.SetBounds(0.0, 4.0, 0.0, 4.0);
+    plane.SetDestNoiseMap(noiseMap);
+    plane.SetDestSize(tileSize, tileSize);
+    for (int i = 0; i < 6; i++) {
+        plane.SetSourceModule(*tiles[i]);
+        plane.Build();
+        renderer.Render();
+        for (int y = 0; y < tileSize; y++) {
+            for (int x = 0; x < tileSize; x++) {
+                comparison.SetValue((i % 3) * tileSize + x, (1 - i / 3) * tileSize + y, tileImage.GetValue(x, y));
+            }
+        }
+    }
+    utils::WriterBMP writer;
+    writer.SetSourceImage(comparison);
+    writer.SetDestFilename("noise_benchmark_simplex.bmp");
+    writer.WriteDestFile();
+    std::cout << "wrote noise_benchmark_simplex.bmp (checksum " << std::setprecision(1) << sink << ")" << std::endl;
+}
+
+int main() {
+    benchmarkJobScaling();
+    benchmarkBuilderScaling();
+    checkRowCallbacks();
+    benchmarkBatchEvaluation();
+    benchmarkGraphCompiler();
+    benchmarkCacheModules();
+    benchmarkPlanarNoise();
+    benchmarkGridEvaluation();
+    benchmarkSeamlessMaps();
+    benchmarkVoronoi();
+    benchmarkDomainWarp();
+    benchmarkOctaveSpecialization();
+    benchmarkCurvedMaps();
+    benchmarkImageRendering();
+    benchmarkSharedHeightfield();
+    benchmarkLazyVoxels();
+    benchmarkTileCache();
+    benchmarkBakedWorld();
+    benchmarkRegionFiles();
+    benchmarkStreamingExport();
+    benchmarkQuantizedNoiseMap();
+    benchmarkNormalMaps();
+    benchmarkSimplex();
+    return 0;
+}
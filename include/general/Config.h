@@ -20,6 +20,8 @@ namespace Config {
         constexpr int WATERFALL_CHUNK_X = 7;  // Waterfall position
         constexpr int WATERFALL_CHUNK_Z = 7;
         constexpr int WATER_PLANE_Y = 8;      // Y level for underground water plane
+        constexpr const char* BAKED_WORLD_FILE = "./cache/world.baked";  // Chunk meshes, used without HEIGHTMAP_TERRAIN
+        constexpr const char* REGION_DIR = "./saves/regions";            // Saved chunk blocks, see RegionStore
     }
 
     /**
@@ -76,6 +78,9 @@ namespace Config {
         constexpr float NEAR_PLANE = 0.1f;
         constexpr float FAR_PLANE = 1000.0f;
         constexpr float FOV = 45.0f;
+        // Draw smooth chunks from height tiles, see HeightmapTerrain. BakedWorld and
+        // Chunk::renderSmooth() only run when this is false.
+        constexpr bool HEIGHTMAP_TERRAIN = true;
     }
 
     /**
@@ -85,6 +90,8 @@ namespace Config {
         constexpr const char* WORLD_SHADER = "./shaders/WorldShader.GLSL";
         constexpr const char* LIGHT_SHADER = "./shaders/LightsShader.GLSL";
         constexpr const char* WATER_PLANE_SHADER = "./shaders/water.GLSL";
+        constexpr const char* TERRAIN_SHADER = "./shaders/TerrainShader.GLSL";
+        constexpr const char* SMOOTH_SHADER = "./shaders/SmoothShader.GLSL";
     }
 
     /**
@@ -115,5 +122,10 @@ namespace Config {
         constexpr float GRASS_THRESHOLD = 0.5f;     // Below 50% height = grass
         constexpr float STONE_THRESHOLD = 0.9f;     // Below 90% height = stone
         // Above 90% = snow
+        constexpr double NOISE_FREQUENCY = 0.01;    // Perlin frequency of the world heightfield
+        constexpr const char* TILE_CACHE_DIR = "./cache/heightfield";  // Generated height map tiles
+        constexpr int HEIGHTFIELD_STRIP_ROWS = 128;  // Rows built as floats at a time, then stored as 16 bits
+        constexpr float MAX_NOISE_SLOPE = 0.25f;      // Steepest stored noise gradient per block; the world noise stays below 0.11
+        constexpr int NORMAL_MAP_DETAIL = 4;         // Terrain normal map pixels per block, see HeightmapTerrain
     }
 }
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+
+#include <general/Config.h>
+#include <learnopengl/shader_m.h>
+#include <terrain/Heightfield.h>
+
+/**
+ * @brief Draws smooth terrain chunks straight from their height samples
+ *
+ * Instead of a mesh per chunk, every chunk's samples live in one layer of a
+ * 16-bit texture array, and a single (CHUNK_SIZE + 1)^2 grid is drawn
+ * instanced once per visible chunk. The vertex shader (TerrainShader.GLSL)
+ * reads the heights and takes the normals from the neighbouring samples, so
+ * heights keep the heightfield's precision and the whole terrain is one draw
+ * call. A chunk costs (CHUNK_SIZE + 3)^2 * 2 bytes (about 2.4 KB) of GPU
+ * memory instead of a 24 KB packed mesh.
+ *
+ * Layer i * worldSize + j holds chunk (i, j), the same index the simulation
+ * thread uses for visible chunks.
+ *
+ * Optionally a normal map with several pixels per block covers the whole
+ * world (see Heightfield::renderNormalMap()). The fragment shader then lights
+ * the terrain with its normals instead of the grid's, which gives distant
+ * chunks finer shading than their 33x33 vertices can.
+ */
+class HeightmapTerrain {
+  private:
+    static constexpr int GRID_SIZE = Config::World::CHUNK_SIZE + 1;  // Vertices per grid row
+    static constexpr int TILE_SIZE = Config::World::CHUNK_SIZE + 3;  // Samples per tile row, apron included
+
+    unsigned int vArray;           // Grid indices and the instance attribute
+    unsigned int indexBuffer;      // Triangles of the shared grid
+    unsigned int instanceBuffer;   // Chunk index of each drawn instance, rewritten every frame
+    unsigned int heightTiles;      // Texture array with one tile per chunk
+    unsigned int normalMap;        // Normals of the whole world, 0 if there are none
+    int worldSize;                 // Chunks along each side of the world
+    int indexCount;
+    float heightScale;             // Block height of a texel value of 1
+    float heightBias;              // Block height of a texel value of 0
+    int normalMapWidth;            // Normal map size, in pixels
+    int normalMapHeight;
+    int normalDetail;              // Normal map pixels per block
+    std::vector<bool> hasTile;     // Chunks that were uploaded, by chunk index
+    std::vector<int> instances;    // Reused for the instance buffer
+
+  public:
+    /**
+     * @brief Create the grid and room for worldSize^2 tiles
+     *
+     * @param worldSize Chunks along each side of the world
+     */
+    HeightmapTerrain(int worldSize);
+
+    /**
+     * @brief Release the GPU buffers and the texture array
+     *
+     */
+    ~HeightmapTerrain();
+
+    HeightmapTerrain(const HeightmapTerrain&) = delete;
+    HeightmapTerrain& operator=(const HeightmapTerrain&) = delete;
+
+    /**
+     * @brief Upload the samples of one chunk into its tile
+     *
+     * All chunks must come from the same heightfield build, which shares
+     * one quantization scale and bias.
+     *
+     * @param i           Chunk position in the world, along x
+     * @param j           Chunk position in the world, along z
+     * @param heightfield Built heightfield holding the chunk
+     * @param chunkX      Chunk index in the heightfield, as passed to build()
+     * @param chunkZ      Chunk index in the heightfield
+     * @return true       The chunk lies inside the heightfield
+     */
+    bool uploadChunk(int i, int j, const Heightfield& heightfield, int chunkX, int chunkZ);
+
+    /**
+     * @brief Upload a normal map of the whole world as a mipmapped texture
+     *
+     * Pixel (x, row) lies at x / detail blocks along x and row / detail
+     * blocks along the heightfield rows from the corner of chunk (0, 0), as
+     * Heightfield::renderNormalMap() renders a region whose first chunk is
+     * uploaded as chunk (0, 0). Replaces an earlier normal map.
+     *
+     * @param pixels Pixels in the given format, row by row without padding
+     * @param format NORMAL_MAP_RG8 or NORMAL_MAP_RGB10A2
+     * @param width  Pixels per row
+     * @param height Rows
+     * @param detail Pixels per block
+     * @return true  The GPU supports a texture of this size
+     */
+    bool uploadNormalMap(const uint8_t* pixels, utils::NormalMapFormat format, int width, int height, int detail);
+
+    /**
+     * @brief Draw every visible chunk that has a tile in one instanced call
+     *
+     * The caller sets the view, projection, clip plane, light and fog
+     * uniforms of the shader.
+     *
+     * @param shader        TerrainShader
+     * @param visibleChunks Chunk indices (i * worldSize + j) to draw
+     */
+    void draw(Shader& shader, const std::vector<int>& visibleChunks);
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Tracks a group of jobs until all of them (and their children) finish
+ *
+ * A job that is started with a counter may start more jobs on the same
+ * counter before it returns; the counter only reaches zero once the parent
+ * and every child it spawned have completed. The first exception thrown by
+ * any of those jobs is rethrown by JobSystem::wait().
+ */
+struct JobCounter {
+    std::atomic<int> pending{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+};
+
+/**
+ * @brief Work-stealing job system shared by the whole engine
+ *
+ * Every worker owns a deque: it pushes and pops its own jobs at the back
+ * (newest first, cache friendly for nested work) while idle workers steal
+ * from the front of other deques. Threads that are not workers submit into
+ * a shared queue. Waiting on a counter never blocks: the waiting thread
+ * keeps executing queued jobs until the counter drops to zero.
+ */
+class JobSystem {
+public:
+    using JobFunction = std::function<void()>;
+
+private:
+    struct Job {
+        JobFunction function;
+        JobCounter* counter;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    // queues[0] is shared by non-worker threads, queues[i] belongs to worker i
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<int> queuedJobs;
+    std::atomic<bool> stopping;
+    std::mutex sleepMutex;
+    std::condition_variable wakeup;
+
+    void startWorkers(int threadCount);
+    void stopWorkers();
+    void workerLoop(int queueIndex);
+    int currentQueueIndex() const;
+    bool popJob(int queueIndex, Job& job);
+    bool stealJob(int thiefIndex, Job& job);
+    void execute(Job& job);
+
+public:
+    /**
+     * @brief Construct a job system
+     *
+     * @param threadCount Threads that execute jobs, including the thread that
+     *                    waits (threadCount - 1 background workers are started)
+     */
+    explicit JobSystem(int threadCount);
+
+    /**
+     * @brief Finish outstanding work and join all workers
+     */
+    ~JobSystem();
+
+    /**
+     * @brief Engine-wide instance, sized to the hardware thread count
+     */
+    static JobSystem& getInstance();
+
+    /**
+     * @brief Restart with a different number of threads. Only call while no
+     *        jobs are queued or running (used by the scaling benchmarks).
+     *
+     * @param threadCount Threads that execute jobs, including the waiter
+     */
+    void setThreadCount(int threadCount);
+
+    /**
+     * @brief Threads that execute jobs, including the waiting thread
+     */
+    int getThreadCount() const { return (int)workers.size() + 1; }
+
+    /**
+     * @brief Queue a job on the calling thread's deque
+     *
+     * @param counter  Incremented now, decremented when the job finishes
+     * @param function Work to run on any thread
+     */
+    void run(JobCounter& counter, JobFunction function);
+
+    /**
+     * @brief Execute queued jobs until the counter reaches zero
+     *
+     * @param counter Counter passed to run()
+     */
+    void wait(JobCounter& counter);
+
+    /**
+     * @brief Execute one queued job on the calling thread, if there is one.
+     *        Lets a thread that polls for partial results keep helping.
+     *
+     * @return true  A job was executed
+     * @return false Every queue was empty
+     */
+    bool runPendingJob();
+
+    /**
+     * @brief Split [begin, end) into ranges of at most grainSize items, run
+     *        them as jobs and wait for all of them
+     *
+     * @param begin     First index
+     * @param end       One past the last index
+     * @param grainSize Largest range handed to a single job
+     * @param function  Called as function(rangeBegin, rangeEnd)
+     */
+    void parallelFor(int begin, int end, int grainSize, const std::function<void(int, int)>& function);
+
+    // Prevent copying
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class Rain;
+class Waterfall;
+
+/**
+ * @brief Lock-free hand-off of snapshots between exactly two threads
+ *
+ * Double buffering with a spare slot: the producer fills its back slot and
+ * publishes it by swapping it with the shared middle slot, the consumer
+ * picks up the middle slot only when something newer was published. Neither
+ * side blocks, and neither side ever touches the slot the other one owns.
+ */
+template <typename T>
+class SnapshotBuffer {
+private:
+    static const unsigned int INDEX_MASK = 0x3;  // Low bits: slot index
+    static const unsigned int FRESH_BIT = 0x4;   // Set when middle slot is new
+
+    T slots[3];
+    std::atomic<unsigned int> middle;  // Shared slot index | FRESH_BIT
+    unsigned int back;                 // Owned by the producer
+    unsigned int front;                // Owned by the consumer
+
+public:
+    SnapshotBuffer() : middle(1), back(0), front(2) {}
+
+    /**
+     * @brief Slot the producer may fill before calling publish()
+     */
+    T& writeSlot() { return slots[back]; }
+
+    /**
+     * @brief Make the write slot visible to the consumer
+     */
+    void publish() {
+        unsigned int previous = middle.exchange(back | FRESH_BIT, std::memory_order_acq_rel);
+        back = previous & INDEX_MASK;
+    }
+
+    /**
+     * @brief Swap in the newest published snapshot, if there is one
+     *
+     * @return true  A new snapshot is now in readSlot()
+     * @return false Nothing new was published since the last call
+     */
+    bool acquire() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH_BIT)) {
+            return false;
+        }
+        unsigned int previous = middle.exchange(front, std::memory_order_acq_rel);
+        front = previous & INDEX_MASK;
+        return true;
+    }
+
+    /**
+     * @brief Snapshot the consumer is currently reading
+     */
+    const T& readSlot() const { return slots[front]; }
+};
+
+/**
+ * @brief Per-frame input handed from the render thread to the simulation
+ */
+struct SimulationInput {
+    unsigned long frame = 0;       // Render frame that produced this input
+    glm::mat4 viewProjection{1.0f};  // Used to build the visible chunk list
+};
+
+/**
+ * @brief Everything the render thread needs from one simulation step
+ */
+struct SimulationSnapshot {
+    unsigned long frame = 0;                     // Input frame this step consumed
+    std::vector<float> waterfallParticles;       // Packed waterfall particle vertices
+    std::vector<std::vector<float>> chunkRain;   // Packed rain vertices, index i * worldSize + j
+    std::vector<int> visibleChunks;              // Chunk indices (i * worldSize + j) inside the view
+};
+
+/**
+ * @brief Averaged per-thread timings, used to verify the overlap
+ */
+struct ThreadTimings {
+    float simulationMs;   // Average simulation step (physics + vertex building)
+    float renderMs;       // Average render thread GL submission per frame
+    float idleMs;         // Average time the simulation thread waited for input
+    int steps;            // Simulation steps in the sample window
+    int frames;           // Render frames in the sample window
+};
+
+/**
+ * @brief Runs particle physics and chunk visibility on a dedicated thread
+ *
+ * The render thread submits one SimulationInput per frame and draws from the
+ * newest SimulationSnapshot, so step N + 1 is simulated while frame N is
+ * being submitted to the GPU. Both hand-offs go through SnapshotBuffer, no
+ * locks are taken on either side.
+ */
+class SimulationThread {
+private:
+    Waterfall* waterfall;   // May be null when the world has no waterfall
+    Rain& rain;
+    int worldSize;
+
+    SnapshotBuffer<SimulationInput> inputs;
+    SnapshotBuffer<SimulationSnapshot> snapshots;
+    unsigned long submittedFrames;  // Owned by the render thread
+
+    // Frame time submitted but not yet simulated. Inputs the simulation
+    // thread skips still add their time here, so no time is dropped.
+    std::atomic<long long> pendingDeltaNs;
+
+    std::thread worker;
+    std::atomic<bool> running;
+
+    // Timing accumulators, reset by takeTimings()
+    std::atomic<long long> simulationNs;
+    std::atomic<long long> idleNs;
+    std::atomic<int> stepCount;
+    std::atomic<long long> renderNs;
+    std::atomic<int> frameCount;
+
+    void run();
+    void step(const SimulationInput& input, float deltaTime, SimulationSnapshot& snapshot);
+    void collectVisibleChunks(const glm::mat4& viewProjection, std::vector<int>& visible) const;
+
+public:
+    /**
+     * @brief Construct the simulation thread (does not start it)
+     *
+     * @param waterfall Waterfall whose particles are simulated, may be null
+     * @param rain      Rain system to simulate
+     * @param worldSize Size of the world in chunks
+     */
+    SimulationThread(Waterfall* waterfall, Rain& rain, int worldSize);
+
+    /**
+     * @brief Stops the thread if it is still running
+     */
+    ~SimulationThread();
+
+    /**
+     * @brief Start simulating. Waterfall and rain must not be touched by
+     *        other threads until stop() returns.
+     */
+    void start();
+
+    /**
+     * @brief Stop and join the simulation thread
+     */
+    void stop();
+
+    /**
+     * @brief Hand the next frame's input to the simulation thread
+     *
+     * The delta time is accumulated: if the simulation thread is still busy
+     * and skips this input, the next step simulates its time as well.
+     *
+     * @param deltaTime      Seconds since the previous frame
+     * @param viewProjection Camera view-projection for visibility
+     */
+    void submitFrame(float deltaTime, const glm::mat4& viewProjection);
+
+    /**
+     * @brief Newest finished snapshot (render thread only)
+     *
+     * @return const SimulationSnapshot& Valid until the next call
+     */
+    const SimulationSnapshot& latestSnapshot();
+
+    /**
+     * @brief Record how long the render thread spent submitting a frame
+     *
+     * @param milliseconds Render thread time for one frame
+     */
+    void recordRenderTime(float milliseconds);
+
+    /**
+     * @brief Average timings since the previous call, then reset them
+     */
+    ThreadTimings takeTimings();
+
+    // Prevent copying
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+};
@@ -18,6 +18,7 @@ enum VertexType {
   Vertex_Normal_RGB,            // x, y, z, n1, n2, n3, r, g, b
   Vertex_Water,                 // x, z
   Vertex_Normal_RGB_Optimized,  // position | normal | color
+  Vertex_Smooth_Octahedral,     // position | color, octahedral normal
 };
 
 class VertexArrayWrapper {
@@ -72,7 +73,19 @@ class VertexArrayWrapper {
      * @param key      VBO ID
      * @param vertices The vertex data to store
      */
-    void createVBO(std::string key, std::vector<float> vertices);
+    void createVBO(std::string key, const std::vector<float>& vertices);
+
+    /**
+     * @brief Create a new Vertex Buffer Object from memory the caller owns
+     *
+     * The floats are uploaded straight from the pointer, so they can live in
+     * a memory-mapped file (see BakedWorld) without being copied first.
+     *
+     * @param key      VBO ID
+     * @param vertices First float of the vertex data
+     * @param count    Number of floats
+     */
+    void createVBO(const std::string& key, const float* vertices, size_t count);
 
     /**
      * @brief Edit the Vertex Buffer Object
@@ -80,7 +93,7 @@ class VertexArrayWrapper {
      * @param key      VBO ID
      * @param vertices The vertices to store
      */
-    void editVBO(std::string key, std::vector<float> vertices);
+    void editVBO(std::string key, const std::vector<float>& vertices);
 
     /**
      * @brief Bind VBO to VAO 
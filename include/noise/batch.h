@@ -0,0 +1,224 @@
+// batch.h
+//
+// Batch evaluation of noise module graphs.  Not part of the original libnoise
+// distribution; it is compiled with the game sources.
+//
+
+#ifndef NOISE_BATCH_H
+#define NOISE_BATCH_H
+
+#include "module/modulebase.h"
+
+namespace noise
+{
+
+  /// @addtogroup libnoise
+  /// @{
+
+  /// Number of input values a batch evaluation processes at a time.
+  ///
+  /// Larger requests are split into blocks of this size, so the temporary
+  /// buffers of a module graph stay in the L1 cache.
+  const int BATCH_BLOCK_SIZE = 256;
+
+  /// Generates the output values of a noise module for many input values.
+  ///
+  /// @param sourceModule The noise module at the root of the graph.
+  /// @param pX The @a x coordinates of the input values.
+  /// @param pY The @a y coordinates of the input values.
+  /// @param pZ The @a z coordinates of the input values.
+  /// @param pDest Receives one output value per input value.
+  /// @param count The number of input values.
+  ///
+  /// @throw noise::ExceptionNoModule A module in the graph is missing a
+  /// source module.
+  ///
+  /// This function walks the module graph once per block of input values
+  /// instead of once per input value.  The Perlin, Billow, RidgedMulti,
+  /// Simplex, Voronoi and Turbulence noise modules use AVX2 kernels when the
+  /// processor supports them (see EnableBatchSimd()); combiner, modifier,
+  /// selector and transformer modules run tight loops over whole blocks.
+  /// Modules that have no batch form, including modules defined by the
+  /// application, fall back to calling their GetValue() method.
+  ///
+  /// When every @a y coordinate a Perlin, Billow or RidgedMulti module
+  /// receives in a block is zero, as with the plane noise map builder, the
+  /// generator samples the two-dimensional lattice (see
+  /// GradientCoherentNoise2D()) at about half the cost.
+  ///
+  /// Voronoi and FastVoronoi modules compute the seed points of all unit
+  /// cubes around a block of nearby input values once, and search them
+  /// nearest first (see noise::module::FastVoronoi); their output values
+  /// are identical to the output of Voronoi::GetValue().
+  ///
+  /// When the input values of a block share their @a y and @a z
+  /// coordinates, as the rows of a plane noise map do, the distortion
+  /// modules of a Turbulence module and the Perlin, Billow and RidgedMulti
+  /// displacement modules of a Displace module hash the lattice cubes along
+  /// the row once per octave instead of once per input value; the warped
+  /// input values then feed the source module as one block.
+  ///
+  /// The output values match the output of GetValue() to within rounding
+  /// error.  GetValue() stays the reference implementation.
+  void GetValues (const module::Module& sourceModule, const double* pX,
+    const double* pY, const double* pZ, double* pDest, int count);
+
+  /// Generates the output values of a noise module on a grid of input
+  /// values on the @a y = 0 plane.
+  ///
+  /// @param sourceModule The noise module at the root of the graph.
+  /// @param pX The @a x coordinates of the grid columns.
+  /// @param width The number of columns.
+  /// @param pZ The @a z coordinates of the grid rows.
+  /// @param height The number of rows.
+  /// @param pDest Receives @a width times @a height output values, row by
+  /// row; the value at ( @a pX[c], 0, @a pZ[r] ) is stored at
+  /// @a pDest[r * @a width + c].
+  ///
+  /// @throw noise::ExceptionNoModule A module in the graph is missing a
+  /// source module.
+  ///
+  /// If the noise module is a Perlin, Billow or RidgedMulti noise module,
+  /// this function runs a grid kernel.  For each octave, it computes the
+  /// lattice cell and s-curve weight of every column once, and the
+  /// gradients at the corners of those cells only when a row enters a new
+  /// lattice row, so dense grids skip most of the hashing and gradient
+  /// lookups.  Other noise modules are evaluated row by row with
+  /// GetValues().
+  ///
+  /// The output values are the same as the output values of GetValues()
+  /// for the same input values.
+  void GetGridValues (const module::Module& sourceModule, const double* pX,
+    int width, const double* pZ, int height, double* pDest);
+
+  /// Generates the output values of a noise module with a periodic lattice
+  /// on a grid of input values on the @a y = 0 plane.
+  ///
+  /// @param sourceModule The noise module.
+  /// @param pX The @a x coordinates of the grid columns.
+  /// @param width The number of columns.
+  /// @param pZ The @a z coordinates of the grid rows.
+  /// @param height The number of rows.
+  /// @param periodX The period along the @a x axis, in units.
+  /// @param periodZ The period along the @a z axis, in units.
+  /// @param pDest Receives @a width times @a height output values, laid out
+  /// like the output values of GetGridValues().
+  ///
+  /// @pre IsPeriodSupported() returns @a true for the noise module and the
+  /// periods.
+  ///
+  /// @throw noise::ExceptionInvalidParam An invalid parameter was
+  /// specified; see the preconditions for more information.
+  ///
+  /// The output values repeat themselves every @a periodX units along the
+  /// @a x axis and every @a periodZ units along the @a z axis, so a grid
+  /// that covers one period in each direction tiles without seams.  The
+  /// output values are the values GetPeriodicValue2D() returns, computed
+  /// with the grid kernel of GetGridValues().
+  void GetPeriodicGridValues (const module::Module& sourceModule,
+    const double* pX, int width, const double* pZ, int height,
+    double periodX, double periodZ, double* pDest);
+
+  /// Determines if a noise module can generate a lattice that repeats
+  /// itself with the given periods.
+  ///
+  /// @param sourceModule The noise module.
+  /// @param periodX The period along the @a x axis, in units.
+  /// @param periodZ The period along the @a z axis, in units.
+  ///
+  /// @returns
+  /// - @a true if the noise module is a Perlin, Billow or RidgedMulti noise
+  ///   module and every octave spans a whole number of lattice cells over
+  ///   each period.
+  /// - @a false if not.
+  ///
+  /// The period of an octave, in lattice cells, is the period times the
+  /// frequency of the module times the lacunarity raised to the octave
+  /// number.  With the default lacunarity of 2.0, any period that covers a
+  /// whole number of cells of the first octave qualifies; with the
+  /// default frequency of 1.0, that is any whole number of units.  The
+  /// lattice cells of an octave may not exceed 2^30 per period.
+  bool IsPeriodSupported (const module::Module& sourceModule,
+    double periodX, double periodZ);
+
+  /// Generates the output values of a noise module and their gradients on a
+  /// grid of input values on the @a y = 0 plane.
+  ///
+  /// @param sourceModule The noise module.
+  /// @param pX The @a x coordinates of the grid columns.
+  /// @param width The number of columns.
+  /// @param pZ The @a z coordinates of the grid rows.
+  /// @param height The number of rows.
+  /// @param pDest Receives @a width times @a height output values, laid out
+  /// like the output values of GetGridValues().
+  /// @param pDestDX Receives the derivative of each output value along the
+  /// @a x axis, per unit, laid out the same way.
+  /// @param pDestDZ Receives the derivative of each output value along the
+  /// @a z axis, per unit, laid out the same way.
+  ///
+  /// @pre IsGradientSupported() returns @a true for the noise module.
+  ///
+  /// @throw noise::ExceptionInvalidParam An invalid parameter was
+  /// specified; see the preconditions for more information.
+  ///
+  /// The output values are the values GetGridValues() generates, with the
+  /// same grid kernel; the gradients are those of GetValueDeriv2D(),
+  /// computed in the same pass.
+  void GetGridGradients (const module::Module& sourceModule,
+    const double* pX, int width, const double* pZ, int height, double* pDest,
+    double* pDestDX, double* pDestDZ);
+
+  /// Determines if a noise module can generate analytic gradients.
+  ///
+  /// @param sourceModule The noise module.
+  ///
+  /// @returns
+  /// - @a true if the noise module is a Perlin, Billow or RidgedMulti noise
+  ///   module (see GetValueDeriv2D()).
+  /// - @a false if not.
+  bool IsGradientSupported (const module::Module& sourceModule);
+
+  /// Enables or disables the AVX2 kernels used by GetValues().
+  ///
+  /// @param enable Specifies whether to use the AVX2 kernels.
+  ///
+  /// The kernels are enabled by default.  They are never used on processors
+  /// without AVX2 support, regardless of this setting.  Disabling them is
+  /// useful for accuracy tests and benchmarks.
+  void EnableBatchSimd (bool enable = true);
+
+  /// Determines if GetValues() uses the AVX2 kernels.
+  ///
+  /// @returns
+  /// - @a true if the kernels are enabled and the processor supports AVX2.
+  /// - @a false if not.
+  bool IsBatchSimdEnabled ();
+
+  /// Enables or disables the fixed octave kernels used by GetValues() and
+  /// GetValue2D().
+  ///
+  /// @param enable Specifies whether to use the fixed octave kernels.
+  ///
+  /// For Perlin, Billow and RidgedMulti noise modules with the default
+  /// lacunarity of 2.0 and one to eight octaves, the batch evaluator picks,
+  /// for input values on the @a y = 0 plane, an octave loop that was
+  /// instantiated for the fractal type, octave count and noise quality of
+  /// the module.  Its loop is unrolled, its
+  /// octave scales are compile-time constants and it skips MakeInt32Range()
+  /// for input values that stay within its range; the output values are
+  /// identical.  The kernels are enabled by default.  Disabling them is
+  /// useful for benchmarks.
+  void EnableOctaveSpecialization (bool enable = true);
+
+  /// Determines if GetValues() uses the fixed octave kernels.
+  ///
+  /// @returns
+  /// - @a true if the kernels are enabled.
+  /// - @a false if not.
+  bool IsOctaveSpecializationEnabled ();
+
+  // @}
+
+}
+
+#endif
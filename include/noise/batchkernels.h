@@ -0,0 +1,89 @@
+// batchkernels.h
+//
+// Array kernels shared by the batch evaluator and the module graph compiler.
+// Not part of the original libnoise distribution; it is compiled with the
+// game sources.
+//
+
+#ifndef NOISE_BATCHKERNELS_H
+#define NOISE_BATCHKERNELS_H
+
+#include "module/module.h"
+
+namespace noise
+{
+
+  /// Array forms of the per-sample operations of the combiner, modifier and
+  /// selector noise modules.
+  ///
+  /// Each kernel applies the operation of the matching noise module to
+  /// @a count values.  The destination array may be the same array as any
+  /// of the source arrays.
+  namespace kernels
+  {
+
+    /// @a pDest = @a pSource * @a scale + @a bias (ScaleBias, ScalePoint,
+    /// TranslatePoint.)
+    void ScaleBias (const double* pSource, double scale, double bias,
+      double* pDest, int count);
+
+    /// Absolute value (Abs.)
+    void Abs (const double* pSource, double* pDest, int count);
+
+    /// Negation (Invert.)
+    void Invert (const double* pSource, double* pDest, int count);
+
+    /// Clamping to [ @a lowerBound, @a upperBound ] (Clamp.)
+    void Clamp (const double* pSource, double lowerBound, double upperBound,
+      double* pDest, int count);
+
+    /// Exponential curve (Exponent.)
+    void Exponent (const double* pSource, double exponent, double* pDest,
+      int count);
+
+    /// Terrace-forming curve of a Terrace noise module.
+    ///
+    /// @pre The Terrace noise module has at least two control points.
+    void Terrace (const module::Terrace& terrace, const double* pSource,
+      double* pDest, int count);
+
+    /// Cubic curve of a Curve noise module.
+    ///
+    /// @pre The Curve noise module has at least four control points.
+    void Curve (const module::Curve& curve, const double* pSource,
+      double* pDest, int count);
+
+    /// Sum of two arrays (Add.)
+    void Add (const double* pSource0, const double* pSource1, double* pDest,
+      int count);
+
+    /// Product of two arrays (Multiply.)
+    void Multiply (const double* pSource0, const double* pSource1,
+      double* pDest, int count);
+
+    /// Larger value of two arrays (Max.)
+    void Max (const double* pSource0, const double* pSource1, double* pDest,
+      int count);
+
+    /// Smaller value of two arrays (Min.)
+    void Min (const double* pSource0, const double* pSource1, double* pDest,
+      int count);
+
+    /// @a pSource0 raised to the power of @a pSource1 (Power.)
+    void Power (const double* pSource0, const double* pSource1,
+      double* pDest, int count);
+
+    /// Weighted blend of two arrays by a control array (Blend.)
+    void Blend (const double* pSource0, const double* pSource1,
+      const double* pControl, double* pDest, int count);
+
+    /// Selection between two arrays by a control array (Select.)
+    void Select (const double* pSource0, const double* pSource1,
+      const double* pControl, double lowerBound, double upperBound,
+      double edgeFalloff, double* pDest, int count);
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,211 @@
+// compiledgraph.h
+//
+// Noise module that evaluates a module graph flattened into a linear
+// program.  Not part of the original libnoise distribution; it is compiled
+// with the game sources.
+//
+
+#ifndef NOISE_MODULE_COMPILEDGRAPH_H
+#define NOISE_MODULE_COMPILEDGRAPH_H
+
+#include <memory>
+#include <vector>
+
+#include "modulebase.h"
+
+namespace noise
+{
+
+  namespace module
+  {
+
+    /// @addtogroup libnoise
+    /// @{
+
+    /// @addtogroup modules
+    /// @{
+
+    /// @addtogroup miscmodules
+    /// @{
+
+    /// Noise module that evaluates a compiled copy of a noise module graph.
+    ///
+    /// The Compile() method walks a module graph once and flattens it into
+    /// a linear program of array instructions over blocks of input values
+    /// (see noise::GetValues().)  Evaluating the program costs no virtual
+    /// calls, source module lookups or exception checks per sample.  While
+    /// compiling, this noise module:
+    /// - folds constant subgraphs (Const modules and any module whose
+    ///   inputs are all constant) into constants;
+    /// - merges chains of ScaleBias, Invert, ScalePoint and TranslatePoint
+    ///   modules, and additions or multiplications by constants, into a
+    ///   single scale-and-bias instruction;
+    /// - resolves Select modules whose control value is constant;
+    /// - evaluates a module that appears several times in the graph with
+    ///   the same input values only once, which makes Cache, ThreadCache and
+    ///   LruCache modules unnecessary;
+    /// - expands Turbulence and Displace modules into their generators and
+    ///   coordinate instructions.
+    ///
+    /// The generator modules (Perlin, Billow, RidgedMulti, Voronoi,
+    /// FastVoronoi) run the batch kernels of noise::GetValues().  Modules the compiler does not
+    /// know, including modules defined by the application, are evaluated
+    /// through their own GetValue() method.
+    ///
+    /// The output values match the output of the original graph to within
+    /// rounding error; merged scale-and-bias chains round differently from
+    /// the step-by-step evaluation.
+    ///
+    /// The compiled program copies the parameters of the modules in the
+    /// graph.  If the application changes the graph afterwards, it must
+    /// call Compile() again.  The program does refer to the generator
+    /// modules, so the graph must exist throughout the lifetime of this
+    /// object.
+    ///
+    /// Compiled graphs keep no per-sample state, so several threads may
+    /// evaluate the same compiled graph at the same time.
+    ///
+    /// This noise module does not require any source modules.
+    class CompiledGraph: public Module
+    {
+
+      public:
+
+        /// Constructor.
+        ///
+        /// Call Compile() before evaluating this noise module.
+        CompiledGraph ();
+
+        /// Destructor.
+        ~CompiledGraph ();
+
+        /// Compiles a module graph.
+        ///
+        /// @param sourceModule The noise module at the root of the graph.
+        ///
+        /// @throw noise::ExceptionNoModule A module in the graph is missing
+        /// a source module.
+        void Compile (const Module& sourceModule);
+
+        /// Returns the number of instructions in the compiled program.
+        ///
+        /// @returns The number of instructions, or zero if the whole graph
+        /// folded into a constant.
+        int GetInstructionCount () const
+        {
+          return (int)m_program.size ();
+        }
+
+        /// Returns the number of value registers the compiled program uses,
+        /// including the three input coordinate registers.
+        int GetRegisterCount () const
+        {
+          return m_registerCount;
+        }
+
+        virtual int GetSourceModuleCount () const
+        {
+          return 0;
+        }
+
+        /// Generates an output value given the coordinates of the specified
+        /// input value.
+        ///
+        /// @throw noise::ExceptionNoModule Compile() was not called.
+        virtual double GetValue (double x, double y, double z) const;
+
+        /// Generates the output values for many input values.
+        ///
+        /// @param pX The @a x coordinates of the input values.
+        /// @param pY The @a y coordinates of the input values.
+        /// @param pZ The @a z coordinates of the input values.
+        /// @param pDest Receives one output value per input value.
+        /// @param count The number of input values.
+        ///
+        /// @throw noise::ExceptionNoModule Compile() was not called.
+        void GetValues (const double* pX, const double* pY, const double* pZ,
+          double* pDest, int count) const;
+
+        /// Operation performed by an instruction.
+        enum OpCode
+        {
+          OP_CONST,       ///< Fill with params[0].
+          OP_GENERATE,    ///< Evaluate pModule at (src[0], src[1], src[2]).
+          OP_SCALE_BIAS,  ///< src[0] * params[0] + params[1].
+          OP_ABS,         ///< Abs of src[0].
+          OP_CLAMP,       ///< Clamp src[0] to [params[0], params[1]].
+          OP_EXPONENT,    ///< Exponent of src[0] by params[0].
+          OP_CURVE,       ///< Curve pModule applied to src[0].
+          OP_TERRACE,     ///< Terrace pModule applied to src[0].
+          OP_ADD,         ///< src[0] + src[1].
+          OP_MULTIPLY,    ///< src[0] * src[1].
+          OP_MAX,         ///< Larger of src[0] and src[1].
+          OP_MIN,         ///< Smaller of src[0] and src[1].
+          OP_POWER,       ///< src[0] raised to the power of src[1].
+          OP_BLEND,       ///< Blend of src[0] and src[1] by src[2].
+          OP_SELECT       ///< Select between src[0] and src[1] by src[2],
+                          ///< bounds params[0] and params[1], falloff
+                          ///< params[2].
+        };
+
+        /// One instruction of the compiled program.
+        struct Instruction
+        {
+          /// The operation.
+          OpCode opCode;
+
+          /// Register that receives the result.
+          int dest;
+
+          /// Registers the operation reads; unused entries are -1.
+          int src[3];
+
+          /// Constant parameters of the operation.
+          double params[3];
+
+          /// Module evaluated or consulted by the operation, if any.
+          const Module* pModule;
+        };
+
+      protected:
+
+        /// Runs the program for one block of at most BATCH_BLOCK_SIZE
+        /// input values.
+        void RunBlock (const double* pX, const double* pY, const double* pZ,
+          double* pDest, int count, double* pScratch) const;
+
+        /// The compiled program.
+        std::vector<Instruction> m_program;
+
+        /// Modules created by the compiler, such as the distortion modules
+        /// of expanded Turbulence modules.
+        std::vector<std::unique_ptr<Module> > m_ownedModules;
+
+        /// Number of registers, including the three input registers.
+        int m_registerCount;
+
+        /// Register that holds the output value after the program ran.
+        int m_resultRegister;
+
+        /// Output value when the whole graph folded into a constant.
+        double m_resultConst;
+
+        /// Determines if the whole graph folded into a constant.
+        bool m_isResultConst;
+
+        /// Determines if Compile() was called.
+        bool m_isCompiled;
+
+    };
+
+    /// @}
+
+    /// @}
+
+    /// @}
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,75 @@
+// fastvoronoi.h
+//
+// Faster counterpart of the Voronoi noise module.  Not part of the original
+// libnoise distribution; it is compiled with the game sources.
+//
+
+#ifndef NOISE_MODULE_FASTVORONOI_H
+#define NOISE_MODULE_FASTVORONOI_H
+
+#include "voronoi.h"
+
+namespace noise
+{
+
+  namespace module
+  {
+
+    /// @addtogroup libnoise
+    /// @{
+
+    /// @addtogroup modules
+    /// @{
+
+    /// @addtogroup generatormodules
+    /// @{
+
+    /// Noise module that outputs the same Voronoi cells as the
+    /// noise::module::Voronoi noise module, with a pruned search for the
+    /// nearest seed point.
+    ///
+    /// The seed point of a unit cube lies within one unit of the cube in
+    /// every direction, so noise::module::Voronoi::GetValue() hashes the
+    /// seed points of all 125 cubes within two cubes of the input value.
+    /// This noise module visits those cubes nearest first, one axis at a
+    /// time, and skips the remaining cubes of an axis as soon as the
+    /// nearest point their seed points could occupy is farther away than
+    /// the nearest seed point found so far.  Seed points at the same
+    /// distance resolve in the order noise::module::Voronoi visits them, so
+    /// both noise modules return the same output value for the same seed,
+    /// frequency, displacement and distance setting.
+    ///
+    /// The batch evaluator (noise::GetValues()) evaluates both noise modules
+    /// with a kernel that computes the seed points of all cubes a block of
+    /// input values touches once, and then searches those cached seed
+    /// points.
+    ///
+    /// This noise module can replace a noise::module::Voronoi noise module
+    /// anywhere in a module graph.
+    ///
+    /// This noise module does not require any source modules.
+    class FastVoronoi: public Voronoi
+    {
+
+      public:
+
+        /// Constructor.
+        ///
+        /// The parameters are the defaults of noise::module::Voronoi.
+        FastVoronoi ();
+
+        virtual double GetValue (double x, double y, double z) const;
+
+    };
+
+    /// @}
+
+    /// @}
+
+    /// @}
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,172 @@
+// lrucache.h
+//
+// Multi-entry, thread-safe counterpart of the Cache noise module.  Not part
+// of the original libnoise distribution; it is compiled with the game
+// sources.
+//
+
+#ifndef NOISE_MODULE_LRUCACHE_H
+#define NOISE_MODULE_LRUCACHE_H
+
+#include <atomic>
+
+#include "modulebase.h"
+
+namespace noise
+{
+
+  namespace module
+  {
+
+    /// @addtogroup libnoise
+    /// @{
+
+    /// @addtogroup modules
+    /// @{
+
+    /// @addtogroup miscmodules
+    /// @{
+
+    /// Default number of cached values per thread for the
+    /// noise::module::LruCache noise module.
+    const int DEFAULT_LRU_CACHE_CAPACITY = 256;
+
+    /// Maximum number of cached values per thread for the
+    /// noise::module::LruCache noise module.
+    const int LRU_CACHE_MAX_CAPACITY = 1 << 20;
+
+    /// Noise module that caches the most recently used output values
+    /// generated by a source module, separately for every thread.
+    ///
+    /// The noise::module::Cache noise module only remembers the last input
+    /// value it was given.  A source module shared by several noise modules
+    /// that sample it at interleaved input values (the control module of a
+    /// Select module that also feeds its source modules, the displacement
+    /// modules of a Displace module, the source module of a Turbulence
+    /// module) therefore almost always misses.  This noise module remembers
+    /// up to GetCapacity() input values in a hash table and, when the table
+    /// is full, replaces the least recently used one.
+    ///
+    /// As with the noise::module::ThreadCache noise module, every thread
+    /// that calls GetValue() has its own table, so a module graph that
+    /// contains this noise module can be evaluated by several threads at the
+    /// same time.  A thread allocates its table on its first call to
+    /// GetValue().  If more than THREAD_CACHE_MAX_THREADS threads use the
+    /// module at the same time, the extra threads bypass the cache.
+    ///
+    /// The module counts cache hits and misses over all threads; see
+    /// GetHitCount() and GetMissCount().
+    ///
+    /// If an application passes a new source module to the SetSourceModule()
+    /// method or changes the capacity, the cached values of all threads are
+    /// invalidated.
+    ///
+    /// This noise module can replace a noise::module::Cache noise module
+    /// anywhere in a module graph.
+    ///
+    /// This noise module requires one source module.
+    class LruCache: public Module
+    {
+
+      public:
+
+        /// Constructor.
+        ///
+        /// The default capacity is set to DEFAULT_LRU_CACHE_CAPACITY.
+        LruCache ();
+
+        /// Destructor.
+        ~LruCache ();
+
+        /// Returns the number of output values each thread caches.
+        ///
+        /// @returns The capacity of the cache of each thread.
+        int GetCapacity () const
+        {
+          return m_capacity;
+        }
+
+        /// Returns the number of GetValue() calls, over all threads, that
+        /// were answered from the cache since the last call to
+        /// ResetCounters().
+        ///
+        /// While other threads are evaluating this noise module, the count
+        /// is approximate.
+        unsigned long long GetHitCount () const;
+
+        /// Returns the number of GetValue() calls, over all threads, that
+        /// asked the source module since the last call to
+        /// ResetCounters().
+        ///
+        /// While other threads are evaluating this noise module, the count
+        /// is approximate.
+        unsigned long long GetMissCount () const;
+
+        virtual int GetSourceModuleCount () const
+        {
+          return 1;
+        }
+
+        virtual double GetValue (double x, double y, double z) const;
+
+        /// Resets the hit and miss counters of all threads to zero.
+        ///
+        /// Do not call this method while other threads are evaluating this
+        /// noise module.
+        void ResetCounters ();
+
+        /// Sets the number of output values each thread caches.
+        ///
+        /// @param capacity The capacity of the cache of each thread.
+        ///
+        /// @pre The capacity is between 1 and LRU_CACHE_MAX_CAPACITY.
+        ///
+        /// @throw noise::ExceptionInvalidParam An invalid parameter was
+        /// specified; see the preconditions for more information.
+        ///
+        /// Do not call this method while other threads are evaluating this
+        /// noise module.
+        void SetCapacity (int capacity);
+
+        virtual void SetSourceModule (int index, const Module& sourceModule)
+        {
+          Module::SetSourceModule (index, sourceModule);
+          m_generation++;
+        }
+
+      protected:
+
+        /// Hash table of one thread (defined in lrucache.cpp.)
+        struct Table;
+
+        /// Returns the table of the calling thread, creating it or clearing
+        /// it if necessary.
+        ///
+        /// @returns The table, or NULL if the calling thread has no thread
+        /// slot.
+        Table* GetThreadTable () const;
+
+        /// The tables, one per thread slot; NULL until the thread that owns
+        /// the slot first uses this noise module.  Atomic so that
+        /// GetHitCount() and GetMissCount() can read them from any thread.
+        std::atomic<Table*>* m_pTables;
+
+        /// Number of output values each thread caches.
+        int m_capacity;
+
+        /// Incremented each time the source module or the capacity changes.
+        unsigned int m_generation;
+
+    };
+
+    /// @}
+
+    /// @}
+
+    /// @}
+
+  }
+
+}
+
+#endif
@@ -30,12 +30,15 @@
 #include "cache.h"
 #include "checkerboard.h"
 #include "clamp.h"
+#include "compiledgraph.h"
 #include "const.h"
 #include "curve.h"
 #include "cylinders.h"
 #include "displace.h"
 #include "exponent.h"
+#include "fastvoronoi.h"
 #include "invert.h"
+#include "lrucache.h"
 #include "max.h"
 #include "min.h"
 #include "multiply.h"
@@ -46,8 +49,10 @@
 #include "scalebias.h"
 #include "scalepoint.h"
 #include "select.h"
+#include "simplex.h"
 #include "spheres.h"
 #include "terrace.h"
+#include "threadcache.h"
 #include "translatepoint.h"
 #include "turbulence.h"
 #include "voronoi.h"
@@ -0,0 +1,333 @@
+// simplex.h
+//
+// Simplex-noise generator module.  Not part of the original libnoise
+// distribution; it is compiled with the game sources.
+//
+
+#ifndef NOISE_MODULE_SIMPLEX_H
+#define NOISE_MODULE_SIMPLEX_H
+
+#include "modulebase.h"
+
+namespace noise
+{
+
+  namespace module
+  {
+
+    /// @addtogroup libnoise
+    /// @{
+
+    /// @addtogroup modules
+    /// @{
+
+    /// @addtogroup generatormodules
+    /// @{
+
+    /// Ways the noise::module::Simplex noise module combines its octaves.
+    enum SimplexType
+    {
+
+      /// The octaves are summed like the octaves of the
+      /// noise::module::Perlin noise module (fractional Brownian motion).
+      SIMPLEX_FBM = 0,
+
+      /// The absolute values of the octaves are summed like the octaves of
+      /// the noise::module::Billow noise module.
+      SIMPLEX_BILLOW = 1,
+
+      /// The octaves are inverted, squared and weighted like the octaves of
+      /// the noise::module::RidgedMulti noise module.
+      SIMPLEX_RIDGED = 2
+
+    };
+
+    /// Default frequency for the noise::module::Simplex noise module.
+    const double DEFAULT_SIMPLEX_FREQUENCY = 1.0;
+
+    /// Default lacunarity for the noise::module::Simplex noise module.
+    const double DEFAULT_SIMPLEX_LACUNARITY = 2.0;
+
+    /// Default number of octaves for the noise::module::Simplex noise
+    /// module.
+    const int DEFAULT_SIMPLEX_OCTAVE_COUNT = 6;
+
+    /// Default persistence value for the noise::module::Simplex noise
+    /// module.
+    const double DEFAULT_SIMPLEX_PERSISTENCE = 0.5;
+
+    /// Default noise seed for the noise::module::Simplex noise module.
+    const int DEFAULT_SIMPLEX_SEED = 0;
+
+    /// Default octave combination for the noise::module::Simplex noise
+    /// module.
+    const SimplexType DEFAULT_SIMPLEX_TYPE = SIMPLEX_FBM;
+
+    /// Maximum number of octaves for the noise::module::Simplex noise
+    /// module.
+    const int SIMPLEX_MAX_OCTAVE = 30;
+
+    /// Noise module that outputs fractal simplex noise.
+    ///
+    /// Simplex noise divides space into simplices (triangles in two
+    /// dimensions, tetrahedra in three) instead of the unit squares and
+    /// cubes of the gradient coherent noise of the noise::module::Perlin
+    /// noise module.  Each octave of n-dimensional simplex noise sums the
+    /// radially attenuated gradients of the n + 1 corners of one simplex,
+    /// where gradient coherent noise interpolates the gradients of the 2^n
+    /// corners of a cube.  A three-dimensional octave therefore touches 4
+    /// lattice points instead of 8, and needs no interpolation.  The noise
+    /// also has fewer axis-aligned artifacts.
+    ///
+    /// The octaves are combined the same way as the octaves of the
+    /// noise::module::Perlin, noise::module::Billow or
+    /// noise::module::RidgedMulti noise modules, depending on the type set
+    /// by SetType(), and the frequency, lacunarity, octave count,
+    /// persistence and seed have the same meaning.  Octave @a i uses the
+    /// seed value plus @a i.  The output values usually range from -1.0 to
+    /// +1.0, but there are no guarantees that all output values will exist
+    /// within that range.
+    ///
+    /// GetValue() outputs three-dimensional simplex noise, which the noise
+    /// map builders sample through noise::GetValues(), four input values at
+    /// a time when the processor supports AVX2.  GetValue2D() and
+    /// GetValue4D() output two- and four-dimensional simplex noise with the
+    /// same parameters.  These are separate noise functions; the
+    /// two-dimensional noise is not the y = 0 plane of the
+    /// three-dimensional noise.
+    ///
+    /// This noise module does not require any source modules.
+    class Simplex: public Module
+    {
+
+      public:
+
+        /// Constructor.
+        ///
+        /// The default frequency is set to
+        /// noise::module::DEFAULT_SIMPLEX_FREQUENCY.
+        ///
+        /// The default lacunarity is set to
+        /// noise::module::DEFAULT_SIMPLEX_LACUNARITY.
+        ///
+        /// The default number of octaves is set to
+        /// noise::module::DEFAULT_SIMPLEX_OCTAVE_COUNT.
+        ///
+        /// The default persistence value is set to
+        /// noise::module::DEFAULT_SIMPLEX_PERSISTENCE.
+        ///
+        /// The default seed value is set to
+        /// noise::module::DEFAULT_SIMPLEX_SEED.
+        ///
+        /// The default type is set to noise::module::DEFAULT_SIMPLEX_TYPE.
+        Simplex ();
+
+        /// Returns the frequency of the first octave.
+        ///
+        /// @returns The frequency of the first octave.
+        double GetFrequency () const
+        {
+          return m_frequency;
+        }
+
+        /// Returns the lacunarity of the simplex noise.
+        ///
+        /// @returns The lacunarity of the simplex noise.
+        ///
+        /// The lacunarity is the frequency multiplier between successive
+        /// octaves.
+        double GetLacunarity () const
+        {
+          return m_lacunarity;
+        }
+
+        /// Returns the number of octaves that generate the simplex noise.
+        ///
+        /// @returns The number of octaves that generate the simplex noise.
+        ///
+        /// The number of octaves controls the amount of detail in the
+        /// simplex noise.
+        int GetOctaveCount () const
+        {
+          return m_octaveCount;
+        }
+
+        /// Returns the persistence value of the simplex noise.
+        ///
+        /// @returns The persistence value of the simplex noise.
+        ///
+        /// The persistence value controls the roughness of the simplex
+        /// noise.  The SIMPLEX_RIDGED type ignores it, like the
+        /// noise::module::RidgedMulti noise module.
+        double GetPersistence () const
+        {
+          return m_persistence;
+        }
+
+        /// Returns the seed value used by the simplex-noise function.
+        ///
+        /// @returns The seed value.
+        int GetSeed () const
+        {
+          return m_seed;
+        }
+
+        /// Returns the way the octaves are combined.
+        ///
+        /// @returns The octave combination.
+        SimplexType GetType () const
+        {
+          return m_type;
+        }
+
+        virtual int GetSourceModuleCount () const
+        {
+          return 0;
+        }
+
+        virtual double GetValue (double x, double y, double z) const;
+
+        /// Generates an output value of the two-dimensional simplex noise.
+        ///
+        /// @param x The @a x coordinate of the input value.
+        /// @param y The @a y coordinate of the input value.
+        ///
+        /// @returns The output value.
+        double GetValue2D (double x, double y) const;
+
+        /// Generates an output value of the four-dimensional simplex noise.
+        ///
+        /// @param x The @a x coordinate of the input value.
+        /// @param y The @a y coordinate of the input value.
+        /// @param z The @a z coordinate of the input value.
+        /// @param w The @a w coordinate of the input value.
+        ///
+        /// @returns The output value.
+        ///
+        /// The fourth coordinate is commonly time, which animates
+        /// three-dimensional noise without repeating it.
+        double GetValue4D (double x, double y, double z, double w) const;
+
+        /// Sets the frequency of the first octave.
+        ///
+        /// @param frequency The frequency of the first octave.
+        void SetFrequency (double frequency)
+        {
+          m_frequency = frequency;
+        }
+
+        /// Sets the lacunarity of the simplex noise.
+        ///
+        /// @param lacunarity The lacunarity of the simplex noise.
+        ///
+        /// The lacunarity is the frequency multiplier between successive
+        /// octaves.
+        ///
+        /// For best results, set the lacunarity to a number between 1.5 and
+        /// 3.5.
+        void SetLacunarity (double lacunarity)
+        {
+          m_lacunarity = lacunarity;
+          CalcSpectralWeights ();
+        }
+
+        /// Sets the number of octaves that generate the simplex noise.
+        ///
+        /// @param octaveCount The number of octaves that generate the simplex
+        /// noise.
+        ///
+        /// @pre The number of octaves ranges from 1 to
+        /// noise::module::SIMPLEX_MAX_OCTAVE.
+        ///
+        /// @throw noise::ExceptionInvalidParam An invalid parameter was
+        /// specified; see the preconditions for more information.
+        ///
+        /// The number of octaves controls the amount of detail in the
+        /// simplex noise.
+        void SetOctaveCount (int octaveCount)
+        {
+          if (octaveCount < 1 || octaveCount > SIMPLEX_MAX_OCTAVE) {
+            throw noise::ExceptionInvalidParam ();
+          }
+          m_octaveCount = octaveCount;
+        }
+
+        /// Sets the persistence value of the simplex noise.
+        ///
+        /// @param persistence The persistence value of the simplex noise.
+        ///
+        /// The persistence value controls the roughness of the simplex
+        /// noise.
+        ///
+        /// For best results, set the persistence to a number between 0.0 and
+        /// 1.0.
+        void SetPersistence (double persistence)
+        {
+          m_persistence = persistence;
+        }
+
+        /// Sets the seed value used by the simplex-noise function.
+        ///
+        /// @param seed The seed value.
+        void SetSeed (int seed)
+        {
+          m_seed = seed;
+        }
+
+        /// Sets the way the octaves are combined.
+        ///
+        /// @param type The octave combination.
+        void SetType (SimplexType type)
+        {
+          m_type = type;
+        }
+
+      protected:
+
+        /// Calculates the spectral weights of the SIMPLEX_RIDGED octaves,
+        /// the same weights as noise::module::RidgedMulti.
+        void CalcSpectralWeights ();
+
+        /// Combines the octaves of the simplex noise.
+        ///
+        /// @param octaveNoise Returns the simplex noise of one octave, given
+        /// the scale of the input value and the octave's seed.
+        ///
+        /// @returns The output value.
+        template <class OctaveNoise>
+        double GetFractalValue (OctaveNoise octaveNoise) const;
+
+        /// Frequency of the first octave.
+        double m_frequency;
+
+        /// Frequency multiplier between successive octaves.
+        double m_lacunarity;
+
+        /// Total number of octaves that generate the simplex noise.
+        int m_octaveCount;
+
+        /// Persistence value of the simplex noise.
+        double m_persistence;
+
+        /// Seed value used by the simplex-noise function.
+        int m_seed;
+
+        /// Way the octaves are combined.
+        SimplexType m_type;
+
+        /// Contains the spectral weights for each octave.
+        double m_pSpectralWeights[SIMPLEX_MAX_OCTAVE];
+
+    };
+
+    /// @}
+
+    /// @}
+
+    /// @}
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,122 @@
+// threadcache.h
+//
+// Thread-safe counterpart of the Cache noise module.  Not part of the
+// original libnoise distribution; it is compiled with the game sources.
+//
+
+#ifndef NOISE_MODULE_THREADCACHE_H
+#define NOISE_MODULE_THREADCACHE_H
+
+#include "modulebase.h"
+
+namespace noise
+{
+
+  namespace module
+  {
+
+    /// @addtogroup libnoise
+    /// @{
+
+    /// @addtogroup modules
+    /// @{
+
+    /// @addtogroup miscmodules
+    /// @{
+
+    /// Maximum number of threads that can hold a cached value in a
+    /// ThreadCache noise module at the same time.
+    ///
+    /// Further threads bypass the cache and always ask the source module.
+    const int THREAD_CACHE_MAX_THREADS = 64;
+
+    /// Returns the thread slot of the calling thread.
+    ///
+    /// @returns The slot, between 0 and THREAD_CACHE_MAX_THREADS - 1, or -1
+    /// if every slot is taken.
+    ///
+    /// A thread keeps its slot until it exits; the slot is then handed to
+    /// the next thread that asks for one.  Noise modules that keep
+    /// per-thread state (ThreadCache, LruCache) index it by this slot.
+    int GetThreadCacheSlot ();
+
+    /// Noise module that caches the last output value generated by a source
+    /// module, separately for every thread.
+    ///
+    /// This noise module behaves like the noise::module::Cache noise module,
+    /// but every thread that calls GetValue() has its own cached input and
+    /// output value.  Threads never see or overwrite each other's values, so
+    /// a module graph that contains this noise module can be evaluated by
+    /// several threads at the same time (for example, by the row-parallel
+    /// noise map builders.)
+    ///
+    /// If an application passes a new source module to the SetSourceModule()
+    /// method, the cached values of all threads are invalidated.
+    ///
+    /// This noise module requires one source module.
+    class ThreadCache: public Module
+    {
+
+      public:
+
+        /// Constructor.
+        ThreadCache ();
+
+        /// Destructor.
+        ~ThreadCache ();
+
+        virtual int GetSourceModuleCount () const
+        {
+          return 1;
+        }
+
+        virtual double GetValue (double x, double y, double z) const;
+
+        virtual void SetSourceModule (int index, const Module& sourceModule)
+        {
+          Module::SetSourceModule (index, sourceModule);
+          m_generation++;
+        }
+
+      protected:
+
+        /// Cached value of one thread.  Each entry fills its own cache line
+        /// so that threads do not invalidate each other's lines.
+        struct alignas (64) Entry
+        {
+          /// The cached output value at the cached input value.
+          double value;
+
+          /// @a x coordinate of the cached input value.
+          double x;
+
+          /// @a y coordinate of the cached input value.
+          double y;
+
+          /// @a z coordinate of the cached input value.
+          double z;
+
+          /// Value of m_generation when the entry was stored; the entry is
+          /// empty if this does not match.
+          unsigned int generation;
+        };
+
+        /// The cached values, one entry per thread slot.
+        Entry* m_pEntries;
+
+        /// Incremented each time the source module changes.
+        unsigned int m_generation;
+
+    };
+
+    /// @}
+
+    /// @}
+
+    /// @}
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,243 @@
+// noisegen2d.h
+//
+// Two-dimensional gradient noise for planar input values.  Not part of the
+// original libnoise distribution; it is compiled with the game sources.
+//
+
+#ifndef NOISE_NOISEGEN2D_H
+#define NOISE_NOISEGEN2D_H
+
+#include "noisegen.h"
+
+namespace noise
+{
+
+  namespace module
+  {
+
+    class Billow;
+    class Perlin;
+    class RidgedMulti;
+
+  }
+
+  /// @addtogroup libnoise
+  /// @{
+
+  /// Generates a gradient-coherent-noise value from the coordinates of an
+  /// input value on the @a y = 0 plane.
+  ///
+  /// @param x The @a x coordinate of the input value.
+  /// @param z The @a z coordinate of the input value.
+  /// @param seed The random number seed.
+  /// @param noiseQuality The quality of the coherent-noise.
+  ///
+  /// @returns The generated gradient-coherent-noise value.
+  ///
+  /// The return value is the value GradientCoherentNoise3D() returns for
+  /// the input value ( @a x, 0, @a z ), but it is calculated from the four
+  /// lattice points of the plane instead of the eight lattice points of the
+  /// surrounding cube.  Both functions return the same value, apart from
+  /// the sign of a zero result, so planar and three-dimensional samples of
+  /// the same module graph can be mixed freely.
+  ///
+  /// The return value ranges from -1.0 to +1.0.
+  double GradientCoherentNoise2D (double x, double z, int seed = 0,
+    NoiseQuality noiseQuality = QUALITY_STD);
+
+  /// Generates a gradient-coherent-noise value and its gradient from the
+  /// coordinates of an input value on the @a y = 0 plane.
+  ///
+  /// @param x The @a x coordinate of the input value.
+  /// @param z The @a z coordinate of the input value.
+  /// @param dx Receives the derivative of the value along the @a x axis.
+  /// @param dz Receives the derivative of the value along the @a z axis.
+  /// @param seed The random number seed.
+  /// @param noiseQuality The quality of the coherent-noise.
+  ///
+  /// @returns The value GradientCoherentNoise2D() returns for the same
+  /// input value.
+  ///
+  /// The derivatives are those of the interpolation itself, S-curve
+  /// included, so they come from the same four lattice points as the value
+  /// instead of from extra samples.  With QUALITY_FAST, the derivatives
+  /// jump at the edges of the lattice cells.
+  double GradientCoherentNoiseDeriv2D (double x, double z, double& dx,
+    double& dz, int seed = 0, NoiseQuality noiseQuality = QUALITY_STD);
+
+  /// Generates a gradient-noise value from the coordinates of an input value
+  /// on the @a y = 0 plane and the integer coordinates of a nearby lattice
+  /// point on that plane.
+  ///
+  /// @param fx The floating-point @a x coordinate of the input value.
+  /// @param fz The floating-point @a z coordinate of the input value.
+  /// @param ix The integer @a x coordinate of a nearby value.
+  /// @param iz The integer @a z coordinate of a nearby value.
+  /// @param seed The random number seed.
+  ///
+  /// @returns The value GradientNoise3D() returns for ( @a fx, 0, @a fz )
+  /// and ( @a ix, 0, @a iz ).
+  ///
+  /// @pre The difference between @a fx and @a ix must be less than or equal
+  /// to one.
+  ///
+  /// @pre The difference between @a fz and @a iz must be less than or equal
+  /// to one.
+  double GradientNoise2D (double fx, double fz, int ix, int iz,
+    int seed = 0);
+
+  /// Maps a coordinate into the range [0, @a period ).
+  ///
+  /// @param n A floating-point coordinate.
+  /// @param period The period, in lattice units.
+  ///
+  /// @returns The coordinate minus the largest multiple of @a period that
+  /// does not exceed it.
+  ///
+  /// @pre The period is positive.
+  ///
+  /// Periodic noise functions call this function instead of
+  /// MakeInt32Range(), so large input values keep their precision.
+  inline double MakePeriodicRange (double n, int period)
+  {
+    double r = n - floor (n / (double)period) * (double)period;
+    if (r >= (double)period) {
+      r -= (double)period;
+    } else if (r < 0.0) {
+      r += (double)period;
+    }
+    return r;
+  }
+
+  /// Generates a gradient-coherent-noise value on the @a y = 0 plane from a
+  /// lattice that repeats itself every @a periodX units along the @a x axis
+  /// and every @a periodZ units along the @a z axis.
+  ///
+  /// @param x The @a x coordinate of the input value.
+  /// @param z The @a z coordinate of the input value.
+  /// @param periodX The period along the @a x axis, in lattice units.
+  /// @param periodZ The period along the @a z axis, in lattice units.
+  /// @param seed The random number seed.
+  /// @param noiseQuality The quality of the coherent-noise.
+  ///
+  /// @returns The generated gradient-coherent-noise value.
+  ///
+  /// @pre Both periods are positive.
+  ///
+  /// The lattice coordinates are wrapped around the periods before they are
+  /// hashed, so ( @a x + @a periodX, @a z ) and ( @a x, @a z + @a periodZ )
+  /// return the same value as ( @a x, @a z ).  Within one period the
+  /// gradients differ from the gradients GradientCoherentNoise2D() uses.
+  ///
+  /// The return value ranges from -1.0 to +1.0.
+  double PeriodicGradientCoherentNoise2D (double x, double z, int periodX,
+    int periodZ, int seed = 0, NoiseQuality noiseQuality = QUALITY_STD);
+
+  /// Generates the output value of a Perlin noise module at an input value
+  /// on the @a y = 0 plane.
+  ///
+  /// @returns The value of @a perlin.GetValue (@a x, 0, @a z), calculated
+  /// with GradientCoherentNoise2D().
+  double GetValue2D (const module::Perlin& perlin, double x, double z);
+
+  /// Generates the output value of a Billow noise module at an input value
+  /// on the @a y = 0 plane.
+  ///
+  /// @returns The value of @a billow.GetValue (@a x, 0, @a z), calculated
+  /// with GradientCoherentNoise2D().
+  double GetValue2D (const module::Billow& billow, double x, double z);
+
+  /// Generates the output value of a RidgedMulti noise module at an input
+  /// value on the @a y = 0 plane.
+  ///
+  /// @returns The value of @a ridged.GetValue (@a x, 0, @a z), calculated
+  /// with GradientCoherentNoise2D().
+  double GetValue2D (const module::RidgedMulti& ridged, double x, double z);
+
+  /// Generates the output value of a Perlin noise module and its gradient
+  /// at an input value on the @a y = 0 plane.
+  ///
+  /// @param perlin The noise module.
+  /// @param x The @a x coordinate of the input value.
+  /// @param z The @a z coordinate of the input value.
+  /// @param dx Receives the derivative of the output value along the @a x
+  /// axis, per unit.
+  /// @param dz Receives the derivative of the output value along the @a z
+  /// axis, per unit.
+  ///
+  /// @returns The value GetValue2D() returns for the same input value.
+  ///
+  /// Each octave is sampled with GradientCoherentNoiseDeriv2D(), and its
+  /// derivatives are scaled by the frequency of the octave and summed like
+  /// the octave values, so the gradient costs no extra samples.
+  double GetValueDeriv2D (const module::Perlin& perlin, double x, double z,
+    double& dx, double& dz);
+
+  /// Generates the output value of a Billow noise module and its gradient
+  /// at an input value on the @a y = 0 plane.
+  ///
+  /// See GetValueDeriv2D (const module::Perlin&, double, double, double&,
+  /// double&).  Where an octave signal crosses zero, its absolute value has
+  /// a crease, and the gradient jumps across it.
+  double GetValueDeriv2D (const module::Billow& billow, double x, double z,
+    double& dx, double& dz);
+
+  /// Generates the output value of a RidgedMulti noise module and its
+  /// gradient at an input value on the @a y = 0 plane.
+  ///
+  /// See GetValueDeriv2D (const module::Perlin&, double, double, double&,
+  /// double&).  The weight each octave passes to the next one is
+  /// differentiated as well; the gradient jumps along the ridges, where an
+  /// octave signal crosses zero.
+  double GetValueDeriv2D (const module::RidgedMulti& ridged, double x,
+    double z, double& dx, double& dz);
+
+  /// Generates the output value of a Perlin noise module at an input value
+  /// on the @a y = 0 plane, with a lattice that repeats itself every
+  /// @a periodX units along the @a x axis and every @a periodZ units along
+  /// the @a z axis.
+  ///
+  /// @param perlin The noise module.
+  /// @param x The @a x coordinate of the input value.
+  /// @param z The @a z coordinate of the input value.
+  /// @param periodX The period along the @a x axis, in units.
+  /// @param periodZ The period along the @a z axis, in units.
+  ///
+  /// @returns The output value.
+  ///
+  /// @pre IsPeriodSupported() returns @a true for the noise module and the
+  /// periods.
+  ///
+  /// @throw noise::ExceptionInvalidParam An invalid parameter was
+  /// specified; see the preconditions for more information.
+  ///
+  /// Each octave samples PeriodicGradientCoherentNoise2D() with the period
+  /// scaled by the frequency of that octave.
+  double GetPeriodicValue2D (const module::Perlin& perlin, double x,
+    double z, double periodX, double periodZ);
+
+  /// Generates the output value of a Billow noise module at an input value
+  /// on the @a y = 0 plane, with a lattice that repeats itself every
+  /// @a periodX units along the @a x axis and every @a periodZ units along
+  /// the @a z axis.
+  ///
+  /// See GetPeriodicValue2D (const module::Perlin&, double, double, double,
+  /// double).
+  double GetPeriodicValue2D (const module::Billow& billow, double x,
+    double z, double periodX, double periodZ);
+
+  /// Generates the output value of a RidgedMulti noise module at an input
+  /// value on the @a y = 0 plane, with a lattice that repeats itself every
+  /// @a periodX units along the @a x axis and every @a periodZ units along
+  /// the @a z axis.
+  ///
+  /// See GetPeriodicValue2D (const module::Perlin&, double, double, double,
+  /// double).
+  double GetPeriodicValue2D (const module::RidgedMulti& ridged, double x,
+    double z, double periodX, double periodZ);
+
+  // @}
+
+}
+
+#endif
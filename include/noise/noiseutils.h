@@ -25,7 +25,10 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <fstream>
+#include <functional>
 #include <string>
+#include <vector>
 
 #include <noise/noise.h>
 
@@ -97,6 +100,22 @@ namespace noise
     /// method.
     typedef void(*NoiseMapCallback) (int row);
 
+    /// Determines whether a module graph can be evaluated by several threads
+    /// at the same time.
+    ///
+    /// @param sourceModule The module at the root of the graph.
+    ///
+    /// @returns
+    /// - @a true if no module in the graph keeps per-sample state.
+    /// - @a false if the graph contains a noise::module::Cache module.
+    ///
+    /// Use noise::module::ThreadCache or noise::module::LruCache instead of
+    /// noise::module::Cache in graphs that are built by several threads.
+    ///
+    /// The noise map builders only split a build across threads when this
+    /// function returns @a true.
+    bool IsThreadSafeModule (const module::Module& sourceModule);
+
     /// Number of meters per point in a Terragen terrain (TER) file.
     const double DEFAULT_METERS_PER_POINT = 30.0;
 
@@ -104,6 +123,9 @@ namespace noise
     /// canuckleheads.
     const double DEFAULT_METRES_PER_POINT = DEFAULT_METERS_PER_POINT;
 
+    /// Number of entries in the color table of a color gradient.
+    const int GRADIENT_TABLE_SIZE = 4096;
+
     /// Defines a color.
     ///
     /// A color object contains four 8-bit channels: red, green, blue, and an
@@ -197,6 +219,14 @@ namespace noise
     /// If an application passes 0.25 to the GetColor() method, this method
     /// will return a very light pink color that is one quarter of the way
     /// between white and red.
+    ///
+    /// <b>Color table</b>
+    ///
+    /// GetColor() searches the gradient points and interpolates for every
+    /// call.  An application that colors many values can instead call
+    /// UpdateColorTable() once and then GetTableColor() for each value,
+    /// which returns the color of the nearest of GRADIENT_TABLE_SIZE evenly
+    /// spaced positions between the first and the last gradient point.
     class GradientColor
     {
 
@@ -256,6 +286,65 @@ namespace noise
           return m_gradientPointCount;
         }
 
+        /// Returns the color at the specified position in the color
+        /// gradient, from the color table.
+        ///
+        /// @param gradientPos The specified position.
+        ///
+        /// @returns The color of the table entry nearest to that position.
+        ///
+        /// @pre UpdateColorTable() has been called since the gradient points
+        /// last changed.
+        ///
+        /// Positions outside the gradient return the color of the nearest
+        /// gradient point, as GetColor() does.  This method does not modify
+        /// the object, so several threads may call it at the same time.
+        const Color& GetTableColor (double gradientPos) const
+        {
+          return m_pColorTable[GetTableIndex (gradientPos)];
+        }
+
+        /// Returns the color table filled by UpdateColorTable().
+        ///
+        /// @returns A pointer to GRADIENT_TABLE_SIZE colors, or NULL if the
+        /// table was never filled.
+        const Color* GetColorTable () const
+        {
+          return m_pColorTable;
+        }
+
+        /// Returns the index of the color table entry nearest to the
+        /// specified position in the color gradient.
+        ///
+        /// @param gradientPos The specified position.
+        ///
+        /// @returns The index, from 0 to GRADIENT_TABLE_SIZE - 1.
+        ///
+        /// @pre UpdateColorTable() has been called since the gradient points
+        /// last changed.
+        int GetTableIndex (double gradientPos) const
+        {
+          double index = (gradientPos - m_colorTableOffset)
+            * m_colorTableScale + 0.5;
+          if (!(index > 0.0)) {
+            return 0;
+          } else if (index >= (double)(GRADIENT_TABLE_SIZE - 1)) {
+            return GRADIENT_TABLE_SIZE - 1;
+          }
+          return (int)index;
+        }
+
+        /// Fills the color table used by GetTableColor(), if the gradient
+        /// points changed since it was last filled.
+        ///
+        /// @pre There are at least two gradient points in the color gradient.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.
+        ///
+        /// The table is filled with GetColor(), so it must not be filled
+        /// while other threads use this object.
+        void UpdateColorTable () const;
+
       private:
 
         /// Determines the array index in which to insert the gradient point
@@ -302,6 +391,21 @@ namespace noise
         /// A color object that is used by a gradient object to store a
         /// temporary value.
         mutable Color m_workingColor;
+
+        /// Colors at GRADIENT_TABLE_SIZE evenly spaced positions between the
+        /// first and the last gradient point, or NULL until the table is
+        /// first filled.
+        mutable Color* m_pColorTable;
+
+        /// Position of the first gradient point, which maps to the first
+        /// table entry.
+        mutable double m_colorTableOffset;
+
+        /// Number of table entries per unit of position.
+        mutable double m_colorTableScale;
+
+        /// Determines if the color table matches the gradient points.
+        mutable bool m_isColorTableValid;
     };
 
     /// Implements a noise map, a 2-dimensional array of floating-point
@@ -702,6 +806,296 @@ namespace noise
 
     };
 
+    /// Largest value stored in a quantized noise map.
+    const int QUANTIZED_MAX_VALUE = 65535;
+
+    /// Implements a noise map that stores 16-bit fixed-point values.
+    ///
+    /// A quantized noise map holds the same kind of values as a NoiseMap,
+    /// but each value is stored as an unsigned 16-bit integer @a q that
+    /// represents the value <i>bias + q * scale</i>.  The scale and the bias
+    /// are set with the SetRange() or SetScaleBias() methods; values outside
+    /// of the range are clamped to it when they are stored.
+    ///
+    /// A quantized noise map uses half the memory of a noise map of the same
+    /// size.  With the default range, -1.0 to +1.0, the values are stored
+    /// with a resolution of about 0.00003, which is finer than any terrain
+    /// height or color gradient built from them needs.
+    ///
+    /// The GetSlabPtr() and GetConstSlabPtr() methods return the stored
+    /// integers, so that a consumer can apply the scale and the bias itself
+    /// (or fold them into its own scale and bias) instead of converting the
+    /// whole noise map to floating point.  The GetValue() and
+    /// DequantizeRow() methods return floating-point values.
+    ///
+    /// The QuantizeRows() method stores rows of a NoiseMap; since a noise
+    /// map builder can build a noise map one strip of rows at a time (see
+    /// NoiseMapBuilder::SetDestRowRange()), a large quantized noise map can
+    /// be built without ever holding the floating-point noise map.
+    ///
+    /// The rows are stored like the rows of a NoiseMap; the stride is
+    /// measured in 16-bit values.
+    class QuantizedNoiseMap
+    {
+
+      public:
+
+        /// Constructor.
+        ///
+        /// Creates an empty quantized noise map with a range of -1.0 to +1.0.
+        QuantizedNoiseMap ();
+
+        /// Constructor.
+        ///
+        /// @param width The width of the new noise map.
+        /// @param height The height of the new noise map.
+        ///
+        /// @pre The width and height values are positive.
+        /// @pre The width and height values do not exceed the maximum
+        /// possible width and height for the noise map.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.
+        /// @throw noise::ExceptionOutOfMemory Out of memory.
+        ///
+        /// Creates a quantized noise map with uninitialized values and a
+        /// range of -1.0 to +1.0.
+        QuantizedNoiseMap (int width, int height);
+
+        /// Clears the noise map to a specified value.
+        ///
+        /// @param value The value that all positions within the noise map are
+        /// cleared to.
+        void Clear (float value);
+
+        /// Returns the value of a stored integer.
+        ///
+        /// @param quantized The stored integer.
+        ///
+        /// @returns The value, <i>bias + quantized * scale</i>.
+        float Dequantize (noise::uint16 quantized) const
+        {
+          return m_bias + (float)quantized * m_scale;
+        }
+
+        /// Converts a row of the noise map to floating-point values.
+        ///
+        /// @param row The row, from 0 to GetHeight() - 1.
+        /// @param pDest The array that receives GetWidth() values.
+        ///
+        /// This method does not perform bounds checking so be careful when
+        /// calling it.
+        void DequantizeRow (int row, float* pDest) const;
+
+        /// Returns the bias of the stored values.
+        ///
+        /// @returns The value that a stored 0 represents.
+        float GetBias () const
+        {
+          return m_bias;
+        }
+
+        /// Returns the value used for all positions outside of the noise map.
+        float GetBorderValue () const
+        {
+          return m_borderValue;
+        }
+
+        /// Returns a const pointer to the stored integers of a row.
+        ///
+        /// @param row The row, or @a y coordinate.
+        ///
+        /// @returns A const pointer to the stored integer at the position
+        /// ( 0, @a row ), or @a NULL if the noise map is empty.
+        ///
+        /// This method does not perform bounds checking so be careful when
+        /// calling it.
+        const noise::uint16* GetConstSlabPtr (int row) const
+        {
+          return m_values.empty ()? NULL:
+            &m_values[0] + (size_t)m_stride * (size_t)row;
+        }
+
+        /// Returns the height of the noise map.
+        int GetHeight () const
+        {
+          return m_height;
+        }
+
+        /// Returns the amount of memory allocated for this noise map.
+        ///
+        /// This method returns the number of 16-bit values allocated.
+        size_t GetMemUsed () const
+        {
+          return m_values.size ();
+        }
+
+        /// Returns the scale of the stored values.
+        ///
+        /// @returns The difference between the values that two adjacent
+        /// stored integers represent.
+        float GetScale () const
+        {
+          return m_scale;
+        }
+
+        /// Returns a pointer to the stored integers of a row.
+        ///
+        /// @param row The row, or @a y coordinate.
+        ///
+        /// @returns A pointer to the stored integer at the position
+        /// ( 0, @a row ), or @a NULL if the noise map is empty.
+        ///
+        /// This method does not perform bounds checking so be careful when
+        /// calling it.
+        noise::uint16* GetSlabPtr (int row)
+        {
+          return m_values.empty ()? NULL:
+            &m_values[0] + (size_t)m_stride * (size_t)row;
+        }
+
+        /// Returns the stride amount of the noise map, in 16-bit values.
+        int GetStride () const
+        {
+          return m_stride;
+        }
+
+        /// Returns a value from the specified position in the noise map.
+        ///
+        /// @param x The x coordinate of the position.
+        /// @param y The y coordinate of the position.
+        ///
+        /// @returns The value at that position.
+        ///
+        /// This method returns the border value if the coordinates exist
+        /// outside of the noise map.
+        float GetValue (int x, int y) const;
+
+        /// Returns the width of the noise map.
+        int GetWidth () const
+        {
+          return m_width;
+        }
+
+        /// Returns the stored integer that represents a value.
+        ///
+        /// @param value The value.
+        ///
+        /// @returns The stored integer nearest to the value, clamped to the
+        /// range of the noise map.
+        noise::uint16 Quantize (float value) const
+        {
+          float quantized = (value - m_bias) * m_invScale + 0.5f;
+          quantized = (quantized < 0.0f)? 0.0f: quantized;
+          quantized = (quantized > (float)QUANTIZED_MAX_VALUE)?
+            (float)QUANTIZED_MAX_VALUE: quantized;
+          return (noise::uint16)quantized;
+        }
+
+        /// Stores rows of a noise map.
+        ///
+        /// @param source The noise map that holds the rows.
+        /// @param sourceRow The first row to store, in @a source.
+        /// @param destRow The row of this noise map that receives
+        /// @a sourceRow.
+        /// @param rowCount The number of rows to store.
+        ///
+        /// @pre The widths of both noise maps are the same.
+        /// @pre The rows exist in both noise maps.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.
+        void QuantizeRows (const NoiseMap& source, int sourceRow, int destRow,
+          int rowCount);
+
+        /// Sets the value to use for all positions outside of the noise map.
+        void SetBorderValue (float borderValue)
+        {
+          m_borderValue = borderValue;
+        }
+
+        /// Sets the range of the stored values.
+        ///
+        /// @param lowerBound The value that a stored 0 represents.
+        /// @param upperBound The value that a stored QUANTIZED_MAX_VALUE
+        /// represents.
+        ///
+        /// @pre The lower bound is less than the upper bound.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.
+        ///
+        /// The stored integers are not converted; set the range before
+        /// storing any value.
+        void SetRange (float lowerBound, float upperBound);
+
+        /// Sets the scale and the bias of the stored values.
+        ///
+        /// @param scale The difference between the values that two adjacent
+        /// stored integers represent.
+        /// @param bias The value that a stored 0 represents.
+        ///
+        /// @pre The scale is positive.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.
+        ///
+        /// The stored integers are not converted; set the scale and the bias
+        /// before storing any value, or to the scale and the bias of the
+        /// integers copied into the noise map.
+        void SetScaleBias (float scale, float bias);
+
+        /// Sets the new size for the noise map.
+        ///
+        /// @param width The new width for the noise map.
+        /// @param height The new height for the noise map.
+        ///
+        /// @pre The width and height values are positive.
+        /// @pre The width and height values do not exceed the maximum
+        /// possible width and height for the noise map.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.
+        /// @throw noise::ExceptionOutOfMemory Out of memory.
+        ///
+        /// On exit, the contents of the noise map are undefined.  The scale
+        /// and the bias are unchanged.
+        void SetSize (int width, int height);
+
+        /// Sets a value at a specified position in the noise map.
+        ///
+        /// @param x The x coordinate of the position.
+        /// @param y The y coordinate of the position.
+        /// @param value The value to set at the given position.
+        ///
+        /// This method does nothing if the position is outside the bounds of
+        /// the noise map.
+        void SetValue (int x, int y, float value);
+
+      private:
+
+        /// The value that a stored 0 represents.
+        float m_bias;
+
+        /// Value used for all positions outside of the noise map.
+        float m_borderValue;
+
+        /// The current height of the noise map.
+        int m_height;
+
+        /// The reciprocal of the scale.
+        float m_invScale;
+
+        /// The difference between the values that two adjacent stored
+        /// integers represent.
+        float m_scale;
+
+        /// The stride amount of the noise map, in 16-bit values.
+        int m_stride;
+
+        /// The stored integers.
+        std::vector<noise::uint16> m_values;
+
+        /// The current width of the noise map.
+        int m_width;
+
+    };
+
     /// Implements an image, a 2-dimensional array of color values.
     ///
     /// An image can be used to store a color texture.
@@ -1109,6 +1503,9 @@ namespace noise
     ///
     /// The SetDestFilename() and SetSourceImage() methods must be called
     /// before calling the WriteDestFile() method.
+    ///
+    /// To write an image that does not fit into memory, see the
+    /// StreamWriterBMP class.
     class WriterBMP
     {
 
@@ -1205,6 +1602,9 @@ namespace noise
     ///
     /// The SetDestFilename() and SetSourceNoiseMap() methods must be called
     /// before calling the WriteDestFile() method.
+    ///
+    /// To write a noise map that does not fit into memory, see the
+    /// StreamWriterTER class.
     class WriterTER
     {
 
@@ -1334,6 +1734,11 @@ namespace noise
     /// function has a single integer parameter that contains a count of the
     /// rows that have been completed.  It returns void.
     ///
+    /// Large noise maps are built by several threads of the engine's job
+    /// system if the source module graph is thread safe (see
+    /// IsThreadSafeModule().)  The callback function is still called on the
+    /// thread that called Build(), once per row and in row order.
+    ///
     /// Note that SetBounds() is not defined in the abstract base class; it is
     /// only defined in the derived classes.  This is because each model uses
     /// a different coordinate system.
@@ -1364,8 +1769,18 @@ namespace noise
         /// If this method is successful, the destination noise map contains
         /// the coherent-noise values from the noise module specified by
         /// SetSourceModule().
+        ///
+        /// If a row range was set with SetDestRowRange(), the destination
+        /// noise map only holds the rows of that range.
         virtual void Build () = 0;
 
+        /// Clears the row range set by SetDestRowRange(), so that Build()
+        /// builds every row of the noise map again.
+        void ClearDestRowRange ()
+        {
+          SetDestRowRange (0, 0);
+        }
+
         /// Returns the height of the destination noise map.
         ///
         /// @returns The height of the destination noise map, in points.
@@ -1399,6 +1814,23 @@ namespace noise
         /// method.
         void SetCallback (NoiseMapCallback pCallback);
 
+        /// Sets the range of rows that Build() builds.
+        ///
+        /// @param firstRow The first row to build.
+        /// @param lastRow The row after the last row to build.
+        ///
+        /// @pre 0 <= @a firstRow < @a lastRow <= the height specified by
+        /// SetDestSize(), checked by Build().
+        ///
+        /// Build() then resizes the destination noise map to @a lastRow -
+        /// @a firstRow rows and fills its row @a y with row @a firstRow +
+        /// @a y of the noise map of the size specified by SetDestSize().
+        /// The values are the same as the values of a full build, so a noise
+        /// map that does not fit into memory can be built strip by strip
+        /// (see StreamWriterBMP::WriteStrips().)  The callback function
+        /// still receives the rows of the full noise map.
+        void SetDestRowRange (int firstRow, int lastRow);
+
         /// Sets the destination noise map.
         ///
         /// @param destNoiseMap The destination noise map.
@@ -1444,6 +1876,31 @@ namespace noise
 
       protected:
 
+        /// Fills every row of the destination noise map, splitting the rows
+        /// across the job system when that is safe.
+        ///
+        /// @param fillRows Fills the rows in the range [ @a firstRow,
+        /// @a lastRow ) of the destination noise map.  It may be called by
+        /// several threads at the same time for different rows.
+        ///
+        /// The rows are handed to @a fillRows in runs of several rows.
+        /// Small noise maps and module graphs that are not thread safe are
+        /// filled on the calling thread.  In every case the callback
+        /// function is called on the calling thread in row order, once the
+        /// run that contains the row is filled.
+        void FillRows (const std::function<void (int firstRow, int lastRow)>&
+          fillRows);
+
+        /// Returns the first row Build() builds.
+        int GetBuildFirstRow () const;
+
+        /// Returns the row after the last row Build() builds.
+        int GetBuildLastRow () const;
+
+        /// Determines if the row range set by SetDestRowRange() lies within
+        /// the noise map.
+        bool IsBuildRangeValid () const;
+
         /// The callback function that Build() calls each time it fills a row
         /// of the noise map with coherent-noise values.
         ///
@@ -1453,9 +1910,16 @@ namespace noise
         /// method.
         NoiseMapCallback m_pCallback;
 
+        /// First row that Build() builds.
+        int m_destFirstRow;
+
         /// Height of the destination noise map, in points.
         int m_destHeight;
 
+        /// Row after the last row that Build() builds, or 0 to build every
+        /// row.
+        int m_destLastRow;
+
         /// Width of the destination noise map, in points.
         int m_destWidth;
 
@@ -1488,6 +1952,11 @@ namespace noise
     /// The application must provide the lower and upper angle bounds of the
     /// noise map, in degrees, and the lower and upper height bounds of the
     /// noise map, in units.
+    ///
+    /// The builder computes the cosine and sine of each column angle once
+    /// and evaluates the source module a row at a time with
+    /// noise::GetValues(); the input values are the ones
+    /// noise::model::Cylinder computes.
     class NoiseMapBuilderCylinder: public NoiseMapBuilder
     {
 
@@ -1613,6 +2082,16 @@ namespace noise
         ///
         /// Enabling seamless tiling builds a noise map with no seams at the
         /// edges.  This allows the noise map to be tileable.
+        ///
+        /// If the source module is a Perlin, Billow or RidgedMulti noise
+        /// module and noise::IsPeriodSupported() accepts the extents of the
+        /// noise map as periods, the noise map is built from a lattice that
+        /// repeats itself over those extents (see
+        /// noise::GetPeriodicGridValues()), which costs one evaluation per
+        /// point.  Otherwise, each point blends four output values from the
+        /// source module, sampled one extent apart, which costs four
+        /// evaluations per point and lowers the contrast towards the middle
+        /// of the noise map.
         void EnableSeamless (bool enable = true)
         {
           m_isSeamlessEnabled = enable;
@@ -1663,6 +2142,25 @@ namespace noise
           return m_isSeamlessEnabled;
         }
 
+        /// Stops filling gradient maps.
+        ///
+        /// Later calls to Build() only fill the destination noise map.
+        void ClearDestGradientMaps ()
+        {
+          m_pDestXGradientMap = NULL;
+          m_pDestZGradientMap = NULL;
+        }
+
+        /// Determines if Build() fills gradient maps.
+        ///
+        /// @returns
+        /// - @a true if gradient maps were set with SetDestGradientMaps().
+        /// - @a false if not.
+        bool IsGradientEnabled () const
+        {
+          return m_pDestXGradientMap != NULL;
+        }
+
         /// Sets the boundaries of the planar noise map.
         ///
         /// @param lowerXBound The lower x boundary of the noise map, in
@@ -1692,6 +2190,33 @@ namespace noise
           m_upperZBound = upperZBound;
         }
 
+        /// Sets the noise maps that receive the gradient of the output
+        /// values.
+        ///
+        /// @param destXGradientMap Receives the derivative of each output
+        /// value along the @a x axis, per unit.
+        /// @param destZGradientMap Receives the derivative of each output
+        /// value along the @a z axis, per unit.
+        ///
+        /// Build() sizes both maps like the destination noise map.  The
+        /// gradients are analytic and come from the same evaluation as the
+        /// output values (see noise::GetGridGradients()), so a mesh can be
+        /// lit from them without sampling its neighbours.  Multiply them by
+        /// the extent of a map cell to get the change per cell.
+        ///
+        /// @pre The source module is one that noise::IsGradientSupported()
+        /// accepts when Build() is called.
+        /// @pre Seamless tiling is disabled when Build() is called.
+        ///
+        /// Build() throws noise::ExceptionInvalidParam if a precondition
+        /// does not hold.
+        void SetDestGradientMaps (NoiseMap& destXGradientMap,
+          NoiseMap& destZGradientMap)
+        {
+          m_pDestXGradientMap = &destXGradientMap;
+          m_pDestZGradientMap = &destZGradientMap;
+        }
+
       private:
 
         /// A flag specifying whether seamless tiling is enabled.
@@ -1709,6 +2234,12 @@ namespace noise
         /// Upper z boundary of the planar noise map, in units.
         double m_upperZBound;
 
+        /// Receives the derivatives along the x axis, or NULL.
+        NoiseMap* m_pDestXGradientMap;
+
+        /// Receives the derivatives along the z axis, or NULL.
+        NoiseMap* m_pDestZGradientMap;
+
     };
 
 
@@ -1730,6 +2261,11 @@ namespace noise
     ///
     /// The application must provide the southern, northern, western, and
     /// eastern bounds of the noise map, in degrees.
+    ///
+    /// The builder computes the cosines and sines of each row latitude and
+    /// each column longitude once and evaluates the source module a row at a
+    /// time with noise::GetValues(); the input values are the ones
+    /// noise::model::Sphere computes.
     class NoiseMapBuilderSphere: public NoiseMapBuilder
     {
 
@@ -1912,6 +2448,12 @@ namespace noise
     /// - Pass an Image object to the SetDestImage() method.
     /// - Pass an Image object to the SetBackgroundImage() method (optional)
     /// - Call the Render() method.
+    ///
+    /// The Render() method colors the noise map from the color table of the
+    /// color gradient (see GradientColor::UpdateColorTable()), so a noise
+    /// value is colored with the nearest of GRADIENT_TABLE_SIZE gradient
+    /// positions.  Large images are rendered in parallel, a run of rows per
+    /// job.
     class RendererImage
     {
 
@@ -2264,10 +2806,36 @@ namespace noise
         void SetSourceNoiseMap (const NoiseMap& sourceNoiseMap)
         {
           m_pSourceNoiseMap = &sourceNoiseMap;
+          m_pSourceQuantizedMap = NULL;
+        }
+
+        /// Sets a quantized noise map as the source noise map.
+        ///
+        /// @param sourceNoiseMap The source noise map.
+        ///
+        /// The Render() method converts the rows of a quantized noise map to
+        /// floating-point values as it renders them, so the whole noise map
+        /// is never converted; the image is the same as the image rendered
+        /// from a NoiseMap that holds the dequantized values.
+        ///
+        /// The source noise map must exist throughout the lifetime of this
+        /// object unless another noise map replaces that noise map.
+        void SetSourceNoiseMap (const QuantizedNoiseMap& sourceNoiseMap)
+        {
+          m_pSourceQuantizedMap = &sourceNoiseMap;
+          m_pSourceNoiseMap = NULL;
         }
 
       private:
 
+        /// Returns the height of the source noise map, or 0 if no source
+        /// noise map has been set.
+        int GetSourceHeight () const;
+
+        /// Returns the width of the source noise map, or 0 if no source
+        /// noise map has been set.
+        int GetSourceWidth () const;
+
         /// Calculates the destination color.
         ///
         /// @param sourceColor The source color generated from the color
@@ -2295,6 +2863,41 @@ namespace noise
         double CalcLightIntensity (double center, double left, double right,
           double down, double up) const;
 
+        /// Calculates the coefficients of the light intensity, which
+        /// CalcLightIntensity() applies to the slopes of the noise map.
+        ///
+        /// @param ix Receives the coefficient of the slope along the rows.
+        /// @param iy Receives the coefficient of the slope along the
+        /// columns.
+        /// @param io Receives the intensity of a flat point.
+        ///
+        /// The sine and cosine of the light direction must be up to date
+        /// (see UpdateLightValues()).
+        void CalcLightCoefficients (double& ix, double& iy, double& io)
+          const;
+
+        /// Renders the rows from @a firstRow up to, but not including,
+        /// @a lastRow of the destination image.
+        ///
+        /// @param firstRow The first row.
+        /// @param lastRow The row after the last row.
+        /// @param pDestColors The destination color of each entry of the
+        /// color table, or NULL if the destination colors depend on the
+        /// background image or on the light source.
+        /// @param pBlendedChannels The red, green and blue channels of each
+        /// entry of the color table blended to a white background, as three
+        /// arrays of GRADIENT_TABLE_SIZE values, or NULL if there is a
+        /// background image or no light source.
+        ///
+        /// Render() fills the color table and the light values first, so
+        /// several threads may render different rows at the same time.
+        void RenderRows (int firstRow, int lastRow, const Color* pDestColors,
+          const double* pBlendedChannels) const;
+
+        /// Recalculates the sine and cosine of the light direction if the
+        /// light parameters changed.
+        void UpdateLightValues () const;
+
         /// The cosine of the azimuth of the light source.
         mutable double m_cosAzimuth;
 
@@ -2334,9 +2937,12 @@ namespace noise
         /// A pointer to the destination image.
         Image* m_pDestImage;
 
-        /// A pointer to the source noise map.
+        /// A pointer to the source noise map, if it is a NoiseMap.
         const NoiseMap* m_pSourceNoiseMap;
 
+        /// A pointer to the source noise map, if it is a QuantizedNoiseMap.
+        const QuantizedNoiseMap* m_pSourceQuantizedMap;
+
         /// Used by the CalcLightIntensity() method to recalculate the light
         /// values only if the light parameters change.
         ///
@@ -2353,12 +2959,49 @@ namespace noise
 
     };
 
+    /// Pixel formats of the buffers into which the RendererNormalMap class
+    /// renders.
+    ///
+    /// Both formats can be uploaded to a texture as they are.  A shader
+    /// decodes a channel @a c to the normal coordinate @a c * 2.0 - 1.0.
+    enum NormalMapFormat
+    {
+
+      /// Two 8-bit channels per pixel, the x and y coordinates of the normal
+      /// vector.  The z coordinate of a normal map is never negative, so a
+      /// shader restores it as sqrt (1.0 - x * x - y * y).  This format
+      /// matches a GL_RG8 texture with GL_RG / GL_UNSIGNED_BYTE pixels.
+      NORMAL_MAP_RG8 = 0,
+
+      /// One 32-bit word per pixel, with the x, y and z coordinates in bits
+      /// 0-9, 10-19 and 20-29 and a 2-bit alpha of 0 in bits 30-31.  This
+      /// format matches a GL_RGB10_A2 texture with GL_RGBA /
+      /// GL_UNSIGNED_INT_2_10_10_10_REV pixels.
+      NORMAL_MAP_RGB10A2 = 1
+
+    };
+
+    /// Returns the number of bytes of one pixel of a normal map buffer.
+    ///
+    /// @param format The pixel format.
+    ///
+    /// @returns The size of a pixel, in bytes.
+    inline int GetNormalMapPixelSize (NormalMapFormat format)
+    {
+      return (format == NORMAL_MAP_RG8)? 2: 4;
+    }
+
     /// Renders a normal map from a noise map.
     ///
     /// This class renders an image containing the normal vectors from a noise
     /// map object.  This image can then be used as a bump map for a 3D
     /// application or game.
     ///
+    /// Instead of an image, this class can render into a caller-owned buffer
+    /// in one of the NormalMapFormat pixel formats, ready to be uploaded to
+    /// a texture without any conversion.  Either way, the rows are rendered
+    /// in parallel by the job system, several pixels at a time.
+    ///
     /// This class encodes the (x, y, z) components of the normal vector into
     /// the (red, green, blue) channels of the image.  Like any 24-bit
     /// true-color image, the channel values range from 0 to 255.  0
@@ -2375,8 +3018,10 @@ namespace noise
     ///
     /// To render the image containing the normal map, perform the following
     /// steps:
-    /// - Pass a NoiseMap object to the SetSourceNoiseMap() method.
-    /// - Pass an Image object to the SetDestImage() method.
+    /// - Pass a NoiseMap or a QuantizedNoiseMap object to the
+    ///   SetSourceNoiseMap() method.
+    /// - Pass an Image object to the SetDestImage() method, or a buffer of
+    ///   GetDestBufferSize() bytes to the SetDestBuffer() method.
     /// - Call the Render() method.
     class RendererNormalMap
     {
@@ -2421,6 +3066,21 @@ namespace noise
           return m_bumpHeight;
         }
 
+        /// Returns the size of the buffer that the normal map of the source
+        /// noise map needs in the given pixel format.
+        ///
+        /// @param format The pixel format.
+        ///
+        /// @returns The size of the buffer, in bytes, or 0 if no source noise
+        /// map has been set.
+        ///
+        /// The rows of the buffer follow each other without any padding.
+        size_t GetDestBufferSize (NormalMapFormat format) const
+        {
+          return (size_t)GetSourceWidth () * (size_t)GetSourceHeight ()
+            * (size_t)GetNormalMapPixelSize (format);
+        }
+
         /// Determines if noise-map wrapping is enabled.
         ///
         /// @returns
@@ -2442,14 +3102,18 @@ namespace noise
           return m_isWrapEnabled;
         }
 
-        /// Renders the noise map to the destination image.
+        /// Renders the noise map to the destination image or buffer.
         ///
         /// @pre SetSourceNoiseMap() has been previously called.
-        /// @pre SetDestImage() has been previously called.
+        /// @pre SetDestImage() or SetDestBuffer() has been previously called.
         ///
-        /// @post The original contents of the destination image is destroyed.
+        /// @post The original contents of the destination image or buffer is
+        /// destroyed.
         ///
         /// @throw noise::ExceptionInvalidParam See the preconditions.
+        ///
+        /// The image and the buffer get the same normal vectors; the buffer
+        /// stores them with the precision of its pixel format.
         void Render ();
 
         /// Sets the bump height.
@@ -2480,6 +3144,25 @@ namespace noise
         void SetDestImage (Image& destImage)
         {
           m_pDestImage = &destImage;
+          m_pDestBuffer = NULL;
+        }
+
+        /// Sets a buffer in a GPU pixel format as the destination.
+        ///
+        /// @param pDestBuffer The destination buffer.
+        /// @param format The pixel format of the buffer.
+        ///
+        /// The buffer must hold GetDestBufferSize() bytes; the first pixel of
+        /// the buffer is the first point of row 0 of the source noise map.
+        /// It replaces the destination image, if one was set.
+        ///
+        /// The destination buffer must exist throughout the lifetime of this
+        /// object unless another buffer or an image replaces that buffer.
+        void SetDestBuffer (void* pDestBuffer, NormalMapFormat format)
+        {
+          m_pDestBuffer = (noise::uint8*)pDestBuffer;
+          m_destFormat = format;
+          m_pDestImage = NULL;
         }
 
         /// Sets the source noise map.
@@ -2491,33 +3174,44 @@ namespace noise
         void SetSourceNoiseMap (const NoiseMap& sourceNoiseMap)
         {
           m_pSourceNoiseMap = &sourceNoiseMap;
+          m_pSourceQuantizedMap = NULL;
         }
 
-      private:
-
-        /// Calculates the normal vector at a given point on the noise map.
+        /// Sets a quantized noise map as the source noise map.
         ///
-        /// @param nc The height of the given point in the noise map.
-        /// @param nr The height of the left neighbor.
-        /// @param nu The height of the up neighbor.
-        /// @param bumpHeight The bump height.
+        /// @param sourceNoiseMap The source noise map.
         ///
-        /// @returns The normal vector represented as a color.
+        /// The rows are converted to floating point while they are rendered,
+        /// so the normal map is the same as the one of the floating-point
+        /// values that the quantized noise map returns.
+        ///
+        /// The source noise map must exist throughout the lifetime of this
+        /// object unless another noise map replaces that noise map.
+        void SetSourceNoiseMap (const QuantizedNoiseMap& sourceNoiseMap)
+        {
+          m_pSourceQuantizedMap = &sourceNoiseMap;
+          m_pSourceNoiseMap = NULL;
+        }
+
+      private:
+
+        /// Returns the height of the source noise map, or 0 if no source
+        /// noise map has been set.
+        int GetSourceHeight () const;
+
+        /// Returns the width of the source noise map, or 0 if no source
+        /// noise map has been set.
+        int GetSourceWidth () const;
+
+        /// Renders the rows from @a firstRow up to, but not including,
+        /// @a lastRow of the destination image or buffer.
         ///
-        /// This method encodes the (x, y, z) components of the normal vector
-        /// into the (red, green, blue) channels of the returned color.  In
-        /// order to represent the vector as a color, each coordinate of the
-        /// normal is mapped from the -1.0 to 1.0 range to the 0 to 255 range.
+        /// @param firstRow The first row.
+        /// @param lastRow The row after the last row.
         ///
-        /// The bump height specifies the ratio of spatial resolution to
-        /// elevation resolution.  For example, if your noise map has a
-        /// spatial resolution of 30 meters and an elevation resolution of one
-        /// meter, set the bump height to 1.0 / 30.0.
-        /// 
-        /// The spatial resolution and elevation resolution are determined by
-        /// the application.
-        Color CalcNormalColor (double nc, double nr, double nu,
-          double bumpHeight) const;
+        /// Each row only reads the source noise map, so several threads may
+        /// render different rows at the same time.
+        void RenderRows (int firstRow, int lastRow) const;
 
         /// The bump height for the normal map.
         double m_bumpHeight;
@@ -2525,12 +3219,353 @@ namespace noise
         /// A flag specifying whether wrapping is enabled.
         bool m_isWrapEnabled;
 
+        /// The pixel format of the destination buffer.
+        NormalMapFormat m_destFormat;
+
+        /// A pointer to the destination buffer, if the normal map is rendered
+        /// into a buffer instead of an image.
+        noise::uint8* m_pDestBuffer;
+
         /// A pointer to the destination image.
         Image* m_pDestImage;
 
-        /// A pointer to the source noise map.
+        /// A pointer to the source noise map, if it is a NoiseMap.
         const NoiseMap* m_pSourceNoiseMap;
 
+        /// A pointer to the source noise map, if it is a QuantizedNoiseMap.
+        const QuantizedNoiseMap* m_pSourceQuantizedMap;
+
+    };
+
+    /// Default number of rows that the StreamWriterBMP::WriteStrips() and
+    /// StreamWriterTER::WriteStrips() methods build at a time.
+    const int DEFAULT_STRIP_HEIGHT = 64;
+
+    /// Windows bitmap image writer class that writes the image row by row.
+    ///
+    /// This class writes the same file as the WriterBMP class, but it never
+    /// needs the whole image: the rows are passed to the WriteRows() method
+    /// in order, in strips of any height, and are encoded into a large
+    /// buffer that is written to the file whenever it fills up.
+    ///
+    /// <b>Writing the image</b>
+    ///
+    /// To write the image to a file, perform the following steps:
+    /// - Call the Open() method with the size of the whole image.
+    /// - Pass the rows, from the first row to the last row, to the
+    ///   WriteRows() method; or call the WriteStrips() method, which builds,
+    ///   renders and writes the image one strip at a time.
+    /// - Call the Close() method.
+    class StreamWriterBMP
+    {
+
+      public:
+
+        /// Constructor.
+        StreamWriterBMP ();
+
+        /// Destructor.
+        ///
+        /// Closes a file that is still open, without writing the missing
+        /// rows.
+        ~StreamWriterBMP ();
+
+        /// Writes the buffered rows and closes the file.
+        ///
+        /// @pre The Open() method has been previously called.
+        /// @pre Every row of the image has been written.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.  The
+        /// file is closed anyway.
+        /// @throw noise::ExceptionUnknown The file could not be written.
+        void Close ();
+
+        /// Returns the height of the image, in points.
+        int GetHeight () const
+        {
+          return m_height;
+        }
+
+        /// Returns the number of rows written so far.
+        int GetRowCount () const
+        {
+          return m_rowCount;
+        }
+
+        /// Returns the width of the image, in points.
+        int GetWidth () const
+        {
+          return m_width;
+        }
+
+        /// Determines if a file is open.
+        bool IsOpen () const
+        {
+          return m_pBuffer != NULL;
+        }
+
+        /// Creates the file and writes its header.
+        ///
+        /// @param filename The name of the file to write.
+        /// @param width The width of the whole image, in points.
+        /// @param height The height of the whole image, in points.
+        ///
+        /// @pre No file is open.
+        /// @pre The width and the height are positive.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.
+        /// @throw noise::ExceptionOutOfMemory Out of memory.
+        /// @throw noise::ExceptionUnknown The file could not be created.
+        void Open (const std::string& filename, int width, int height);
+
+        /// Writes the next rows of the image.
+        ///
+        /// @param sourceImage An image that holds the rows.
+        /// @param firstRow The row of @a sourceImage that holds the next row
+        /// of the image.
+        /// @param rowCount The number of rows to write.
+        ///
+        /// @pre A file is open.
+        /// @pre The width of @a sourceImage is the width of the image.
+        /// @pre The rows exist in @a sourceImage, and the image does not
+        /// have fewer than GetRowCount() + @a rowCount rows.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.
+        /// @throw noise::ExceptionUnknown The file could not be written.
+        void WriteRows (const Image& sourceImage, int firstRow, int rowCount);
+
+        /// Builds, renders and writes every row of the image, one strip of
+        /// rows at a time.
+        ///
+        /// @param builder The noise-map builder, with its bounds, size and
+        /// source module set.
+        /// @param renderer The renderer, with its gradient and light set.
+        /// @param stripHeight The number of rows in a strip.
+        ///
+        /// @pre A file is open and no row has been written.
+        /// @pre The size of the image is the size specified by the
+        /// builder's SetDestSize() method.
+        /// @pre The renderer has no background image.
+        /// @pre The renderer does not both light and wrap the image; the
+        /// first and the last rows of a lit image cannot be wrapped
+        /// across strips.
+        /// @pre @a stripHeight is positive.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.
+        /// @throw noise::ExceptionOutOfMemory Out of memory.
+        /// @throw noise::ExceptionUnknown The file could not be written.
+        ///
+        /// Only two strips of noise values and colors are in memory at a
+        /// time: while a worker thread writes one strip, this method builds
+        /// and renders the next one.  The builder's destination noise map
+        /// and row range and the renderer's source noise map and
+        /// destination image are replaced; the row range is cleared
+        /// afterwards.  A lit image is built with one extra row above and
+        /// below each strip, so that the light values match the light
+        /// values of the whole image.
+        void WriteStrips (NoiseMapBuilder& builder, RendererImage& renderer,
+          int stripHeight = DEFAULT_STRIP_HEIGHT);
+
+      private:
+
+        /// Copy constructor, not implemented; the writer owns its file.
+        StreamWriterBMP (const StreamWriterBMP& other);
+
+        /// Assignment operator, not implemented.
+        StreamWriterBMP& operator= (const StreamWriterBMP& other);
+
+        /// The buffer that collects the encoded rows, or NULL if no file is
+        /// open.
+        noise::uint8* m_pBuffer;
+
+        /// The number of bytes in the buffer.
+        size_t m_bufferUsed;
+
+        /// The height of the image, in points.
+        int m_height;
+
+        /// The number of rows written so far.
+        int m_rowCount;
+
+        /// The file.
+        std::ofstream m_stream;
+
+        /// The width of the image, in points.
+        int m_width;
+
+    };
+
+    /// Terragen Terrain writer class that writes the noise map row by row.
+    ///
+    /// This class writes the same file as the WriterTER class, but it never
+    /// needs the whole noise map: the rows are passed to the WriteRows()
+    /// method in order, in strips of any height, and are encoded into a
+    /// large buffer that is written to the file whenever it fills up.
+    ///
+    /// <b>Writing the noise map</b>
+    ///
+    /// To write the noise map to a file, perform the following steps:
+    /// - Optionally pass the distance between points to the
+    ///   SetMetersPerPoint() method.
+    /// - Call the Open() method with the size of the whole noise map.
+    /// - Pass the rows, from the first row to the last row, to the
+    ///   WriteRows() method; or call the WriteStrips() method, which builds
+    ///   and writes the noise map one strip at a time.
+    /// - Call the Close() method.
+    class StreamWriterTER
+    {
+
+      public:
+
+        /// Constructor.
+        StreamWriterTER ();
+
+        /// Destructor.
+        ///
+        /// Closes a file that is still open, without writing the missing
+        /// rows.
+        ~StreamWriterTER ();
+
+        /// Writes the buffered rows and closes the file.
+        ///
+        /// @pre The Open() method has been previously called.
+        /// @pre Every row of the noise map has been written.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.  The
+        /// file is closed anyway.
+        /// @throw noise::ExceptionUnknown The file could not be written.
+        void Close ();
+
+        /// Returns the height of the noise map, in points.
+        int GetHeight () const
+        {
+          return m_height;
+        }
+
+        /// Returns the distance separating adjacent points in the noise map,
+        /// in meters.
+        float GetMetersPerPoint () const
+        {
+          return m_metersPerPoint;
+        }
+
+        /// Returns the number of rows written so far.
+        int GetRowCount () const
+        {
+          return m_rowCount;
+        }
+
+        /// Returns the width of the noise map, in points.
+        int GetWidth () const
+        {
+          return m_width;
+        }
+
+        /// Determines if a file is open.
+        bool IsOpen () const
+        {
+          return m_pBuffer != NULL;
+        }
+
+        /// Creates the file and writes its header.
+        ///
+        /// @param filename The name of the file to write.
+        /// @param width The width of the whole noise map, in points.
+        /// @param height The height of the whole noise map, in points.
+        ///
+        /// @pre No file is open.
+        /// @pre The width and the height are positive.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.
+        /// @throw noise::ExceptionOutOfMemory Out of memory.
+        /// @throw noise::ExceptionUnknown The file could not be created.
+        void Open (const std::string& filename, int width, int height);
+
+        /// Sets the distance separating adjacent points in the noise map, in
+        /// meters.
+        ///
+        /// @param metersPerPoint The distance separating adjacent points in
+        /// the noise map.
+        ///
+        /// Call this method before calling the Open() method; the distance
+        /// is stored in the header of the file.
+        void SetMetersPerPoint (float metersPerPoint)
+        {
+          m_metersPerPoint = metersPerPoint;
+        }
+
+        /// Writes the next rows of the noise map.
+        ///
+        /// @param sourceNoiseMap A noise map that holds the rows.
+        /// @param firstRow The row of @a sourceNoiseMap that holds the next
+        /// row of the noise map.
+        /// @param rowCount The number of rows to write.
+        ///
+        /// @pre A file is open.
+        /// @pre The width of @a sourceNoiseMap is the width of the noise
+        /// map.
+        /// @pre The rows exist in @a sourceNoiseMap, and the noise map does
+        /// not have fewer than GetRowCount() + @a rowCount rows.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.
+        /// @throw noise::ExceptionUnknown The file could not be written.
+        void WriteRows (const NoiseMap& sourceNoiseMap, int firstRow,
+          int rowCount);
+
+        /// Builds and writes every row of the noise map, one strip of rows
+        /// at a time.
+        ///
+        /// @param builder The noise-map builder, with its bounds, size and
+        /// source module set.
+        /// @param stripHeight The number of rows in a strip.
+        ///
+        /// @pre A file is open and no row has been written.
+        /// @pre The size of the noise map is the size specified by the
+        /// builder's SetDestSize() method.
+        /// @pre @a stripHeight is positive.
+        ///
+        /// @throw noise::ExceptionInvalidParam See the preconditions.
+        /// @throw noise::ExceptionOutOfMemory Out of memory.
+        /// @throw noise::ExceptionUnknown The file could not be written.
+        ///
+        /// Only two strips of noise values are in memory at a time: while a
+        /// worker thread writes one strip, this method builds the next one.
+        /// The builder's destination noise map and row range are replaced;
+        /// the row range is cleared afterwards.
+        void WriteStrips (NoiseMapBuilder& builder,
+          int stripHeight = DEFAULT_STRIP_HEIGHT);
+
+      private:
+
+        /// Copy constructor, not implemented; the writer owns its file.
+        StreamWriterTER (const StreamWriterTER& other);
+
+        /// Assignment operator, not implemented.
+        StreamWriterTER& operator= (const StreamWriterTER& other);
+
+        /// The buffer that collects the encoded rows, or NULL if no file is
+        /// open.
+        noise::uint8* m_pBuffer;
+
+        /// The number of bytes in the buffer.
+        size_t m_bufferUsed;
+
+        /// The height of the noise map, in points.
+        int m_height;
+
+        /// The distance separating adjacent points in the noise map, in
+        /// meters.
+        float m_metersPerPoint;
+
+        /// The number of rows written so far.
+        int m_rowCount;
+
+        /// The file.
+        std::ofstream m_stream;
+
+        /// The width of the noise map, in points.
+        int m_width;
+
     };
 
   }
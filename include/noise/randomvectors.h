@@ -0,0 +1,28 @@
+// randomvectors.h
+//
+// Declaration of the gradient vector table for the game's noise kernels.
+// Not part of the original libnoise distribution; it is compiled with the
+// game sources.
+//
+
+#ifndef NOISE_RANDOMVECTORS_H
+#define NOISE_RANDOMVECTORS_H
+
+namespace noise
+{
+
+  /// @addtogroup libnoise
+  /// @{
+
+  /// Gradient vector table of the library's gradient coherent noise,
+  /// defined by the library (vectortable.h).
+  ///
+  /// Each entry holds the @a x, @a y and @a z components of a random unit
+  /// vector plus one unused value; the lattice hash picks the entry.
+  extern double g_randomVectors[256 * 4];
+
+  /// @}
+
+}
+
+#endif
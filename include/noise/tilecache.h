@@ -0,0 +1,292 @@
+// tilecache.h
+//
+// Disk cache of generated noise map tiles.  Not part of the original libnoise
+// distribution; it is compiled with the game sources.
+//
+
+#ifndef NOISE_TILECACHE_H
+#define NOISE_TILECACHE_H
+
+#include <cstddef>
+#include <string>
+
+#include "module/modulebase.h"
+#include "noiseutils.h"
+
+namespace noise
+{
+
+  namespace utils
+  {
+
+    /// @addtogroup libnoise
+    /// @{
+
+    /// Version of the tile file format.  Files written with another version
+    /// are treated as stale.
+    const int TILE_FILE_VERSION = 2;
+
+    /// Computes a hash of the structure and the parameters of a noise module
+    /// graph.
+    ///
+    /// @param sourceModule The noise module at the root of the graph.
+    /// @param hash Receives the hash.
+    ///
+    /// @returns @a true if every module in the graph is a libnoise module
+    /// (or one of the modules compiled with the game sources), @a false if
+    /// the graph contains a module whose parameters this function does not
+    /// know, such as a module defined by the application.
+    ///
+    /// @throw noise::ExceptionNoModule A module in the graph is missing a
+    /// source module.
+    ///
+    /// Two graphs with the same modules, connected the same way and with the
+    /// same parameters, have the same hash.  Changing any parameter that
+    /// affects the output values (a frequency, a seed, a control point...)
+    /// changes the hash.  Caching modules do not contribute to the hash,
+    /// since they do not change the output values.
+    bool GetModuleGraphHash (const module::Module& sourceModule,
+      unsigned long long& hash);
+
+    /// Identifies a noise map tile: the module graph that generated it and
+    /// the area and resolution it covers.
+    struct NoiseMapTileKey
+    {
+
+      /// Hash of the module graph; see GetModuleGraphHash().
+      unsigned long long graphHash;
+
+      /// Seed of the world the tile belongs to.
+      int seed;
+
+      /// Lower @a x boundary of the tile.
+      double lowerXBound;
+
+      /// Upper @a x boundary of the tile.
+      double upperXBound;
+
+      /// Lower @a z boundary of the tile.
+      double lowerZBound;
+
+      /// Upper @a z boundary of the tile.
+      double upperZBound;
+
+      /// Width of the tile, in samples.
+      int width;
+
+      /// Height of the tile, in samples.
+      int height;
+
+      /// What the tile holds: 0 for the output values of the graph, other
+      /// numbers for data an application derives from the same graph and
+      /// area, such as gradients.  Each channel is a tile file of its own.
+      int channel;
+
+    };
+
+    /// Noise map tile loaded from a NoiseMapTileCache.
+    ///
+    /// The values are not copied from the tile file; the file is mapped into
+    /// memory and the tile points into the mapping until it is released.
+    /// Rows are stored without padding, so the stride equals the width.
+    ///
+    /// Like the values of a QuantizedNoiseMap, the values are stored as
+    /// 16-bit integers @a q that represent <i>bias + q * scale</i>.
+    class NoiseMapTile
+    {
+
+      public:
+
+        /// Constructor.
+        ///
+        /// The tile is empty until a NoiseMapTileCache loads it.
+        NoiseMapTile ();
+
+        /// Destructor.
+        ~NoiseMapTile ();
+
+        /// Returns the bias of the stored values.
+        float GetBias () const
+        {
+          return m_bias;
+        }
+
+        /// Returns a const pointer to a row of stored integers in the tile.
+        ///
+        /// @param row The row, from 0 to GetHeight() - 1.
+        ///
+        /// @returns A const pointer to the first stored integer of the row.
+        const noise::uint16* GetConstSlabPtr (int row) const
+        {
+          return m_pValues + (size_t)row * m_width;
+        }
+
+        /// Returns the height of the tile, in samples.
+        int GetHeight () const
+        {
+          return m_height;
+        }
+
+        /// Returns the scale of the stored values.
+        float GetScale () const
+        {
+          return m_scale;
+        }
+
+        /// Returns the stride of the tile, in values.
+        int GetStride () const
+        {
+          return m_width;
+        }
+
+        /// Returns the width of the tile, in samples.
+        int GetWidth () const
+        {
+          return m_width;
+        }
+
+        /// Determines if the tile holds values.
+        bool IsLoaded () const
+        {
+          return m_pValues != NULL;
+        }
+
+        /// Unmaps the tile file and empties the tile.
+        void Release ();
+
+      private:
+
+        friend class NoiseMapTileCache;
+
+        /// Copy constructor, not implemented; a tile owns its mapping.
+        NoiseMapTile (const NoiseMapTile& other);
+
+        /// Assignment operator, not implemented.
+        NoiseMapTile& operator= (const NoiseMapTile& other);
+
+        /// Start of the mapped file, or of the buffer the file was read
+        /// into on platforms without memory mapping.
+        void* m_pMapping;
+
+        /// Size of the mapping, in bytes.
+        size_t m_mappingSize;
+
+        /// The first stored integer of the tile, inside the mapping.
+        const noise::uint16* m_pValues;
+
+        /// The scale of the stored values.
+        float m_scale;
+
+        /// The bias of the stored values.
+        float m_bias;
+
+        /// Width of the tile, in samples.
+        int m_width;
+
+        /// Height of the tile, in samples.
+        int m_height;
+
+    };
+
+    /// Disk cache of noise map tiles.
+    ///
+    /// Each tile is stored in its own file in the cache directory.  The
+    /// file name is derived from the seed, the bounds and the resolution of
+    /// the tile; the header of the file records the complete key, including
+    /// the hash of the module graph that generated the values.  A tile file
+    /// whose header does not match the requested key (because the module
+    /// parameters changed, or the file was written by another format
+    /// version, or is truncated) is stale: Load() counts it, deletes it and
+    /// reports a miss, and the next Store() replaces it.
+    ///
+    /// Tile files hold a fixed 72-byte header, which includes the scale and
+    /// the bias of the values, followed by the values as 16-bit integers,
+    /// row by row, in the byte order of the machine that wrote them.  Store() writes a temporary file and renames it, so a
+    /// concurrent Load() never sees a partially written tile.
+    ///
+    /// The cache is best-effort: a tile that cannot be read counts as a
+    /// miss and a tile that cannot be written is skipped, so the
+    /// application only loses time, never values.
+    class NoiseMapTileCache
+    {
+
+      public:
+
+        /// Constructor.
+        ///
+        /// @param directory The cache directory.  It is created, if
+        /// necessary, by the first call to Store().
+        explicit NoiseMapTileCache (const std::string& directory);
+
+        /// Returns the cache directory.
+        const std::string& GetDirectory () const
+        {
+          return m_directory;
+        }
+
+        /// Returns the number of Load() calls that found their tile.
+        int GetHitCount () const
+        {
+          return m_hitCount;
+        }
+
+        /// Returns the number of Load() calls that found no tile, or a
+        /// stale one.
+        int GetMissCount () const
+        {
+          return m_missCount;
+        }
+
+        /// Returns the number of stale tile files Load() found.
+        int GetStaleCount () const
+        {
+          return m_staleCount;
+        }
+
+        /// Loads a tile from the cache.
+        ///
+        /// @param key The key of the tile.
+        /// @param tile Receives the tile on a hit.
+        ///
+        /// @returns @a true on a hit, @a false on a miss.
+        bool Load (const NoiseMapTileKey& key, NoiseMapTile& tile);
+
+        /// Stores a quantized noise map as a tile.
+        ///
+        /// @param key The key of the tile.
+        /// @param noiseMap The noise map; its size must match the width and
+        /// the height of the key.  The tile keeps its scale and its bias.
+        ///
+        /// @returns @a true if the tile was written.
+        ///
+        /// @throw noise::ExceptionInvalidParam The size of the noise map
+        /// does not match the key.
+        bool Store (const NoiseMapTileKey& key,
+          const QuantizedNoiseMap& noiseMap);
+
+      private:
+
+        /// Returns the path of the tile file for a key.
+        std::string GetTilePath (const NoiseMapTileKey& key) const;
+
+        /// The cache directory.
+        std::string m_directory;
+
+        /// Number of hits.
+        int m_hitCount;
+
+        /// Number of misses.
+        int m_missCount;
+
+        /// Number of stale tile files.
+        int m_staleCount;
+
+    };
+
+    /// @}
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Final vertex buffers of every chunk of the world in one file
+ *
+ * A baked world is written once (by the bake_world application, or by the
+ * game after it generated the world itself) and memory-mapped on the next
+ * start. The file holds a header, an index with one entry per chunk in
+ * chunk-major order (i * worldSize + j) and the packed vertex buffers, so the
+ * game uploads each chunk straight from the mapped pages without generating
+ * or meshing anything.
+ *
+ * The header records the world size, the chunk size, the file version and a
+ * hash of the terrain generator. A file whose header does not match what the
+ * game expects is ignored and rebuilt. Bump FILE_VERSION whenever the meshing
+ * or the vertex encoding changes.
+ */
+class BakedWorld {
+  private:
+    void* mapping;                    // Mapped file, or the buffer it was read into
+    size_t mappingSize;               // Size of the mapping in bytes
+    std::vector<char> buffer;         // File contents where memory mapping is unavailable
+    const uint64_t* index;            // Offset and float count of each chunk
+    int worldSize;                    // World size in chunks along each axis
+
+    // Not copyable, the object owns its mapping
+    BakedWorld(const BakedWorld&) = delete;
+    BakedWorld& operator=(const BakedWorld&) = delete;
+
+  public:
+    static constexpr uint32_t FILE_VERSION = 3;
+
+    /**
+     * @brief Construct a closed BakedWorld
+     *
+     */
+    BakedWorld();
+
+    /**
+     * @brief Destroy the BakedWorld object and unmap its file
+     *
+     */
+    ~BakedWorld();
+
+    /**
+     * @brief Write the vertex buffers of every chunk to a baked world file
+     *
+     * The file is written next to its destination and renamed into place, so
+     * a running game never maps a half-written file.
+     *
+     * @param filename   Destination file; its directory is created if needed
+     * @param worldSize  World size in chunks along each axis
+     * @param sourceHash Hash of the terrain generator, see Heightfield::getSourceHash()
+     * @param meshes     worldSize * worldSize vertex buffers in chunk-major order
+     * @return true      The file was written
+     */
+    static bool bake(const std::string& filename, int worldSize, uint64_t sourceHash,
+                     const std::vector<std::vector<float>>& meshes);
+
+    /**
+     * @brief Map a baked world file
+     *
+     * @param filename   File written by bake()
+     * @param worldSize  Expected world size in chunks along each axis
+     * @param sourceHash Expected hash of the terrain generator
+     * @return true      The file exists, is complete and matches the
+     *                   expected world; false leaves the object closed
+     */
+    bool open(const std::string& filename, int worldSize, uint64_t sourceHash);
+
+    /**
+     * @brief Unmap the file
+     *
+     * Pointers returned by getMesh() become invalid.
+     */
+    void close();
+
+    /**
+     * @brief Check whether a baked world file is mapped
+     */
+    bool isOpen() const { return index != nullptr; }
+
+    /**
+     * @brief Get the vertex buffer of a chunk
+     *
+     * @param i             Chunk index along x
+     * @param j             Chunk index along z
+     * @param floatCount    Receives the number of floats in the buffer
+     * @return const float* First float of the buffer inside the mapping
+     */
+    const float* getMesh(int i, int j, size_t& floatCount) const;
+};
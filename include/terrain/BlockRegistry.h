@@ -17,7 +17,6 @@ private:
 
     // Singleton
     BlockRegistry();
-    static BlockRegistry* instance;
 
 public:
     /**
@@ -5,25 +5,46 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <random>
 
-#include <noise/noise.h>
-#include <noise/noiseutils.h>
-
 #include <terrain/Block.h>
+#include <terrain/Heightfield.h>
 #include <general/Renderer.h>
 #include "vector"
 #include "map"
 
 class Chunk {
   private:
-    module::Perlin myModule;                      // Generates Perlin noise
-    utils::NoiseMap heightMap;                    // Floating-point values of noise
-    utils::NoiseMapBuilderPlane heightMapBuilder; // Fills a Noise map
-    utils::RendererImage renderer;                // Converts Noise map into an image
-    utils::Image image;                           // Store image into memory
-    utils::WriterBMP writer;                      // File writer for BMP images
+    Block*** block3D;                             // 3D array of blocks, nullptr until first needed
+    HeightfieldView heightfield;                  // Shared noise samples (33x33 for seamless edges)
+    bool voxelsPending;                           // Blocks still have to be filled from the heightfield
 
-    Block*** block3D;                             // 3D array of blocks
-    float heightMapData[33][33];                  // Store height values for smooth terrain (33x33 for seamless edges)
+    /**
+     * @brief Allocate the block array and fill it from the heightfield if a
+     * smooth landscape is waiting to be voxelized
+     *
+     */
+    void materializeBlocks();
+
+    /**
+     * @brief Get the terrain height at a corner of the smooth surface
+     *
+     * @param x      x position, from 0 to CHUNK_SIZE
+     * @param z      z position, from 0 to CHUNK_SIZE
+     * @return float Height in blocks, from 1 to CHUNK_SIZE
+     */
+    float getSurfaceHeight(int x, int z) const;
+
+    /**
+     * @brief Get the normal of the smooth surface at a corner
+     *
+     * Taken from the heightfield's analytic noise gradient, not from the
+     * neighbouring heights, so the view needs slopes (see
+     * Heightfield::setSlopeMaps()).
+     *
+     * @param x          x position, from 0 to CHUNK_SIZE
+     * @param z          z position, from 0 to CHUNK_SIZE
+     * @return glm::vec3 Unit normal, in blocks
+     */
+    glm::vec3 getSurfaceNormal(int x, int z) const;
 
   public:
     /**
@@ -45,12 +66,6 @@ class Chunk {
      */
     void update(float dt);
 
-    /**
-     * @brief Configure the Perlin noise module
-     * 
-     */
-    void setupHeightMap();
-
     /**
      * @brief Get the Texture From Height object
      * 
@@ -83,25 +98,39 @@ class Chunk {
     /**
      * @brief Get access to internal block array
      *
+     * Smooth chunks are created without blocks; the first call voxelizes the
+     * heightfield (see createSmoothLandscape()). Not safe to call for the same
+     * chunk from several threads at once.
+     *
      * @return Block*** Pointer to 3D block array
      */
-    Block*** getBlocks() { return block3D; }
+    Block*** getBlocks();
+
+    /**
+     * @brief Check whether the block array has been allocated
+     *
+     * @return true  Blocks exist in memory
+     * @return false The chunk is backed by its heightfield only
+     */
+    bool hasBlocks() const { return block3D != nullptr; }
 
     /**
      * @brief Create Terrain based on noise
      *
-     * @param dx Starting x coordinate
-     * @param dy Starting y coordinate
+     * @param view Samples of this chunk in the shared Heightfield
      */
-    void createLandscape(double dx, double dy);
+    void createLandscape(const HeightfieldView& view);
 
     /**
      * @brief Create SMOOTH terrain mesh with interpolated vertices
      *
-     * @param dx Starting x coordinate
-     * @param dy Starting y coordinate
+     * The chunk keeps the view, so the Heightfield must outlive the chunk's
+     * use of renderSmooth(). No blocks are created: they are filled below
+     * the surface the first time getBlocks(), render() or an edit needs them.
+     *
+     * @param view Samples of this chunk in the shared Heightfield, with slopes
      */
-    void createSmoothLandscape(double dx, double dy);
+    void createSmoothLandscape(const HeightfieldView& view);
 
     /**
      * @brief Clear Blocks
@@ -112,6 +141,8 @@ class Chunk {
     /**
      * @brief Check if block is hidden 
      * 
+     * The blocks must exist (see hasBlocks()); render() creates them.
+     *
      * @param x      x position
      * @param y      y position
      * @param z      z position
@@ -123,6 +154,8 @@ class Chunk {
     /**
      * @brief Create mesh for visible blocks
      *
+     * Voxelizes a smooth chunk first.
+     *
      * @return std::vector<float> Vertex data
      */
     std::vector<float> render();
@@ -130,9 +163,14 @@ class Chunk {
     /**
      * @brief Create smooth terrain mesh using height map data
      *
+     * Vertices are Vertex_Smooth_Octahedral: heights in steps of
+     * 1 / SMOOTH_HEIGHT_STEPS blocks and one octahedral-packed normal per
+     * corner, drawn with SmoothShader.GLSL.
+     *
      * @return std::vector<float> Vertex data for smooth terrain
      */
     std::vector<float> renderSmooth();
 
     static const int CHUNK_SIZE = 32;
+    static const int SMOOTH_HEIGHT_STEPS = 8;  // Height steps per block in smooth vertices
 };
\ No newline at end of file
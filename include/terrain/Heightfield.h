@@ -0,0 +1,241 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <noise/noise.h>
+#include <noise/noiseutils.h>
+#include <noise/tilecache.h>
+
+/**
+ * @brief Read-only window onto the samples of a Heightfield
+ *
+ * A view only points into the heightfield's quantized samples, nothing is
+ * copied. It stays valid until the heightfield is built again or destroyed.
+ */
+class HeightfieldView {
+  private:
+    const uint16_t* samples;  // Sample at column 0, row 0 of the view
+    const uint16_t* xSlopes;  // Slopes along x and along the rows, same layout
+    const uint16_t* zSlopes;
+    int stride;               // Samples between two rows of the noise map
+    float scale;              // Noise value of one quantization step
+    float bias;               // Noise value of a stored 0
+    float slopeScale;         // Slope of one quantization step
+    float slopeBias;          // Slope of a stored 0
+
+  public:
+    HeightfieldView()
+        : samples(nullptr), xSlopes(nullptr), zSlopes(nullptr), stride(0), scale(0.0f), bias(0.0f),
+          slopeScale(0.0f), slopeBias(0.0f) {}
+
+    HeightfieldView(const uint16_t* samples, const uint16_t* xSlopes, const uint16_t* zSlopes, int stride,
+                    float scale, float bias, float slopeScale, float slopeBias)
+        : samples(samples), xSlopes(xSlopes), zSlopes(zSlopes), stride(stride), scale(scale), bias(bias),
+          slopeScale(slopeScale), slopeBias(slopeBias) {}
+
+    /**
+     * @brief Check whether the view points at any samples
+     */
+    bool isValid() const { return samples != nullptr; }
+
+    /**
+     * @brief Check whether the view has slopes, see Heightfield::setSlopeMaps()
+     */
+    bool hasSlopes() const { return xSlopes != nullptr; }
+
+    /**
+     * @brief Get the noise value of a sample
+     *
+     * @param x     Column, from 0 to CHUNK_SIZE
+     * @param row   Row, from 0 to CHUNK_SIZE
+     * @return float Noise value, roughly in the -1..1 range
+     */
+    float getValue(int x, int row) const { return bias + (float)samples[row * stride + x] * scale; }
+
+    /**
+     * @brief Get the analytic gradient of the noise at a sample
+     *
+     * Only valid if hasSlopes() is true.
+     *
+     * @param x     Column, from 0 to CHUNK_SIZE
+     * @param row   Row, from 0 to CHUNK_SIZE
+     * @param dx    Receives the change of the noise value per block along x
+     * @param dRow  Receives the change per block towards the next row
+     */
+    void getSlope(int x, int row, float& dx, float& dRow) const {
+      dx = slopeBias + (float)xSlopes[row * stride + x] * slopeScale;
+      dRow = slopeBias + (float)zSlopes[row * stride + x] * slopeScale;
+    }
+};
+
+/**
+ * @brief Height map shared by every chunk of a rectangular region of the world
+ *
+ * One noise module and one noise map builder sample the whole region in a
+ * single (row-parallel) pass, one sample per block. Neighbouring chunks share
+ * their edge samples instead of each building its own (CHUNK_SIZE + 1)^2 map,
+ * so the edges line up exactly and no sample is computed twice. Chunks read
+ * the samples through a HeightfieldView.
+ *
+ * The samples are kept as 16-bit fixed-point values over -1..1, half the
+ * size of floats. Chunks clamp their heights to that range anyway, and one
+ * step is well below a thousandth of a block. The builder fills a strip of
+ * float rows at a time, so the whole region never exists as floats.
+ *
+ * If setSlopeMaps() enabled them, the builder also computes the analytic
+ * gradient of the noise along with each sample (see noise::GetGridGradients()),
+ * stored the same way over -MAX_NOISE_SLOPE..MAX_NOISE_SLOPE, so meshed chunks
+ * get exact normals without sampling their neighbours. The height tiles take
+ * their normals from the samples and do without.
+ *
+ * With a tile cache attached, build() first looks the region up on disk and
+ * maps the cached tiles (values and the slopes if enabled) instead of
+ * evaluating any noise; a freshly built region is stored for the next start.
+ */
+class Heightfield {
+  private:
+    module::Perlin perlin;                  // Generates Perlin noise
+    utils::QuantizedNoiseMap heightMap;     // Samples of the whole region
+    utils::QuantizedNoiseMap xSlopeMap;     // Noise gradient along x, per block
+    utils::QuantizedNoiseMap zSlopeMap;     // Noise gradient along the builder's z
+    utils::NoiseMapBuilderPlane builder;    // Fills the height and slope maps
+    utils::NoiseMapTileCache* tileCache;    // Optional disk cache, not owned
+    utils::NoiseMapTile tile;               // Cached samples mapped from disk
+    utils::NoiseMapTile xSlopeTile;         // Cached slopes mapped from disk
+    utils::NoiseMapTile zSlopeTile;
+    const uint16_t* samples;                // Row 0 of the height map or the tile
+    const uint16_t* xSlopes;                // Row 0 of the slope maps or tiles
+    const uint16_t* zSlopes;
+    int stride;                             // Samples between two rows
+    float scale;                            // Noise value of one quantization step
+    float bias;                             // Noise value of a stored 0
+    float slopeScale;                       // Slope of one quantization step
+    float slopeBias;                        // Slope of a stored 0
+    bool withSlopes;                        // Whether build() fills the slope maps
+    int firstChunkX;                        // Region origin, in chunks
+    int firstChunkZ;
+    int chunkCountX;                        // Region size, in chunks
+    int chunkCountZ;
+
+  public:
+    /**
+     * @brief Construct an empty Heightfield
+     *
+     */
+    Heightfield();
+
+    /**
+     * @brief Attach a disk cache for the built regions
+     *
+     * @param cache Cache that outlives the heightfield, or nullptr to always
+     *              generate the samples
+     */
+    void setTileCache(utils::NoiseMapTileCache* cache);
+
+    /**
+     * @brief Choose whether build() computes the slopes of the samples
+     *
+     * Only chunk meshes (Chunk::getSurfaceNormal()) read the slopes. Without
+     * them build() evaluates the noise values alone and the views have no
+     * slopes. Off by default; takes effect on the next build().
+     *
+     * @param enable true to build the slope maps along with the samples
+     */
+    void setSlopeMaps(bool enable);
+
+    /**
+     * @brief Build the height map of a region of chunks
+     *
+     * Chunk (cx, cz) covers noise coordinates cx * CHUNK_SIZE to
+     * (cx + 1) * CHUNK_SIZE along x and the same range along the builder's z.
+     * Previously returned views become invalid. On a tile cache hit the
+     * samples are mapped from disk and no noise is evaluated.
+     *
+     * @param firstChunkX First chunk along x
+     * @param firstChunkZ First chunk along z
+     * @param countX      Number of chunks along x
+     * @param countZ      Number of chunks along z
+     */
+    void build(int firstChunkX, int firstChunkZ, int countX, int countZ);
+
+    /**
+     * @brief Get the (CHUNK_SIZE + 1)^2 samples of one chunk
+     *
+     * Row r of the view lies r samples along the builder's z axis from the
+     * chunk origin, so the last column and the last row are the first
+     * column and row of the next chunks.
+     *
+     * @param chunkX           Chunk index along x, as passed to build()
+     * @param chunkZ           Chunk index along z
+     * @return HeightfieldView View of the chunk, or an invalid view if the
+     *                         chunk lies outside the built region
+     */
+    HeightfieldView getChunkView(int chunkX, int chunkZ) const;
+
+    /**
+     * @brief Copy the samples of one chunk with a one-sample apron around them
+     *
+     * The tile is (CHUNK_SIZE + 3)^2 samples: sample (x, row) of the chunk's
+     * view lands at (x + 1, row + 1), and the apron holds the neighbouring
+     * chunks' samples so that normals can be taken across the chunk edges.
+     * At the edges of the region the outermost samples are repeated.
+     *
+     * @param chunkX Chunk index along x, as passed to build()
+     * @param chunkZ Chunk index along z
+     * @param tile   Destination of (CHUNK_SIZE + 3)^2 samples, row by row
+     * @return true  The chunk lies inside the built region
+     */
+    bool copyChunkTile(int chunkX, int chunkZ, uint16_t* tile) const;
+
+    /**
+     * @brief Render the normals of the built region at a finer resolution
+     *
+     * Samples the noise `detail` times per block over the built region and
+     * renders its normal map straight into a GPU-ready buffer, row-parallel
+     * (see utils::RendererNormalMap). The normals are scaled for blocks as
+     * high as they are wide, and like the chunks' heights the noise is
+     * clamped to -1..1. Pixel (x, row) lies at x / detail blocks along x and
+     * row / detail along the builder's z from the region origin, the same
+     * axes as the samples. The noise is built a strip at a time and kept as
+     * 16 bits.
+     *
+     * @param detail  Pixels per block along each axis
+     * @param format  Pixel format of the buffer
+     * @param pixels  Receives the pixels, row by row without padding
+     * @param width   Receives the pixels per row
+     * @param height  Receives the rows
+     * @return true   A region has been built
+     */
+    bool renderNormalMap(int detail, utils::NormalMapFormat format, std::vector<uint8_t>& pixels, int& width,
+                         int& height);
+
+    /**
+     * @brief Get the noise value of one quantization step of the samples
+     */
+    float getScale() const { return scale; }
+
+    /**
+     * @brief Get the noise value of a stored 0
+     */
+    float getBias() const { return bias; }
+
+    /**
+     * @brief Get a hash of the noise that generates the samples
+     *
+     * Two heightfields with the same hash produce the same samples for the
+     * same region, so data derived from them (such as baked chunk meshes)
+     * can be reused.
+     *
+     * @return unsigned long long Hash of the noise module graph and its seed
+     */
+    unsigned long long getSourceHash() const;
+
+    /**
+     * @brief Render the height map and write it as a BMP image for debugging
+     *
+     * @param filename Destination file
+     */
+    void writeDebugImage(const std::string& filename = "terrain.bmp") const;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <general/JobSystem.h>
+#include <terrain/Chunk.h>
+
+/**
+ * @brief Saves and loads the blocks of chunks in region files
+ *
+ * A region file holds REGION_SIZE x REGION_SIZE chunks: a small header, an
+ * offset table with one (offset, size) entry per chunk and the chunk records
+ * appended behind it. A record is the chunk's blocks, one byte each (texture
+ * plus an active bit), run-length encoded layer by layer from the bottom up,
+ * so the air above the terrain collapses into a handful of runs.
+ *
+ * Reads map the region file and decode the record straight from the mapped
+ * pages. markDirty() encodes a snapshot of the chunk right away; flushAsync()
+ * hands every snapshot to a worker, which appends the records of each region
+ * in one write and then updates that region's offset table, so the frame
+ * never waits for the disk. Replaced records stay in the file as garbage
+ * until it outweighs the live records, then the region is rewritten.
+ *
+ * Loads see snapshots that are still waiting to be written, so a chunk always
+ * loads as it was last marked dirty.
+ */
+class RegionStore {
+  private:
+    struct Region {
+      std::mutex mutex;            // Serializes reads, appends and compaction
+      std::string path;            // Region file
+      void* mapping;               // Mapped file, nullptr until the first read
+      size_t mappingSize;          // Size of the mapping in bytes
+      std::vector<char> buffer;    // File contents where memory mapping is unavailable
+
+      Region() : mapping(nullptr), mappingSize(0) {}
+    };
+
+    // Encoded records waiting for the disk, by region and by chunk slot
+    using RecordBatch = std::map<std::pair<int, int>, std::map<int, std::vector<uint8_t>>>;
+
+    std::string directory;                                          // Holds the region files
+    std::mutex regionsMutex;                                        // Guards regions
+    std::map<std::pair<int, int>, std::unique_ptr<Region>> regions; // Opened regions
+    std::mutex pendingMutex;                                        // Guards pending and writing
+    RecordBatch pending;                                            // Marked dirty, not yet flushed
+    RecordBatch writing;                                            // Taken by the running flush
+    std::mutex flushMutex;                                          // Keeps flushes in order
+    JobCounter flushJobs;                                           // Flushes still running
+
+    Region& getRegion(int regionX, int regionZ);
+    void unmapRegion(Region& region);
+    bool mapRegion(Region& region);
+    bool writeRecords(Region& region, const std::map<int, std::vector<uint8_t>>& records);
+    void compactRegion(Region& region);
+    void flushPending();
+
+    // Not copyable, flush jobs refer to the store
+    RegionStore(const RegionStore&) = delete;
+    RegionStore& operator=(const RegionStore&) = delete;
+
+  public:
+    static const int REGION_SIZE = 32;          // Chunks along each side of a region
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    /**
+     * @brief Construct a RegionStore
+     *
+     * @param directory Directory of the region files, created on the first flush
+     */
+    explicit RegionStore(const std::string& directory);
+
+    /**
+     * @brief Wait for running flushes, write what is still dirty and unmap
+     * every region file
+     *
+     */
+    ~RegionStore();
+
+    /**
+     * @brief Load the blocks of a chunk
+     *
+     * Safe to call from any thread, also while a flush is running.
+     *
+     * @param chunkX Chunk coordinate along x
+     * @param chunkZ Chunk coordinate along z
+     * @param chunk  Receives the blocks; untouched if nothing was saved
+     * @return true  The chunk was saved before and has been loaded
+     * @return false No saved blocks for this chunk
+     */
+    bool loadChunk(int chunkX, int chunkZ, Chunk& chunk);
+
+    /**
+     * @brief Load the blocks of a chunk on a worker thread
+     *
+     * @param chunkX  Chunk coordinate along x
+     * @param chunkZ  Chunk coordinate along z
+     * @param chunk   Receives the blocks, must stay alive until the counter drops to zero
+     * @param loaded  Set to the result of loadChunk() before the counter drops
+     * @param counter Counter to wait on with JobSystem::wait()
+     */
+    void loadChunkAsync(int chunkX, int chunkZ, Chunk* chunk, bool* loaded, JobCounter& counter);
+
+    /**
+     * @brief Take a snapshot of a chunk's blocks to be written by the next flush
+     *
+     * Creates the blocks of a smooth chunk that has none yet. Marking the same
+     * chunk again before the flush replaces the earlier snapshot.
+     *
+     * @param chunkX Chunk coordinate along x
+     * @param chunkZ Chunk coordinate along z
+     * @param chunk  Chunk to save
+     */
+    void markDirty(int chunkX, int chunkZ, Chunk& chunk);
+
+    /**
+     * @brief Write every snapshot taken so far on a worker thread
+     *
+     */
+    void flushAsync();
+
+    /**
+     * @brief Write every snapshot taken so far and wait until it is on disk
+     *
+     */
+    void flush();
+};
@@ -53,6 +53,13 @@ public:
      */
     void create(double dx, double dy);
 
+    /**
+     * @brief Get the chunk holding the waterfall's blocks, to save or load them
+     *
+     * @return Chunk& The terrain chunk
+     */
+    Chunk& getTerrain();
+
     /**
      * @brief Create a tall tower to demonstrate shadows
      *
@@ -0,0 +1,167 @@
+#include <general/HeightmapTerrain.h>
+#include <iostream>
+
+HeightmapTerrain::HeightmapTerrain(int worldSize)
+    : normalMap(0), worldSize(worldSize), indexCount(0), heightScale(0.0f), heightBias(0.0f), normalMapWidth(0),
+      normalMapHeight(0), normalDetail(0), hasTile(worldSize * worldSize, false) {
+  // Two triangles per quad, wound like Chunk::renderSmooth(). The grid has no
+  // vertex buffer: the shader finds a vertex's column and row from gl_VertexID
+  std::vector<uint16_t> indices;
+  indices.reserve((GRID_SIZE - 1) * (GRID_SIZE - 1) * 6);
+  for (int z = 0; z < GRID_SIZE - 1; z++) {
+    for (int x = 0; x < GRID_SIZE - 1; x++) {
+      uint16_t v00 = z * GRID_SIZE + x;
+      uint16_t v10 = v00 + 1;
+      uint16_t v01 = v00 + GRID_SIZE;
+      uint16_t v11 = v01 + 1;
+      indices.insert(indices.end(), {v00, v10, v01, v10, v11, v01});
+    }
+  }
+  indexCount = (int)indices.size();
+
+  glGenVertexArrays(1, &vArray);
+  glBindVertexArray(vArray);
+
+  glGenBuffers(1, &indexBuffer);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+
+  // One chunk index per instance
+  glGenBuffers(1, &instanceBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+  glBufferData(GL_ARRAY_BUFFER, hasTile.size() * sizeof(int), nullptr, GL_STREAM_DRAW);
+  glVertexAttribIPointer(0, 1, GL_INT, sizeof(int), (void*)0);
+  glVertexAttribDivisor(0, 1);
+  glEnableVertexAttribArray(0);
+
+  GLint maxLayers = 0;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+  if ((int)hasTile.size() > maxLayers) {
+    std::cout << "[TERRAIN] " << hasTile.size() << " chunk tiles exceed the " << maxLayers
+              << " texture array layers of this GPU" << std::endl;
+  }
+
+  // Texels are the heightfield's 16-bit samples, normalized to 0..1
+  glGenTextures(1, &heightTiles);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, heightTiles);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R16, TILE_SIZE, TILE_SIZE, (GLsizei)hasTile.size(), 0, GL_RED,
+               GL_UNSIGNED_SHORT, nullptr);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+
+  glBindVertexArray(0);
+}
+
+HeightmapTerrain::~HeightmapTerrain() {
+  if (normalMap != 0) {
+    glDeleteTextures(1, &normalMap);
+  }
+  glDeleteTextures(1, &heightTiles);
+  glDeleteBuffers(1, &instanceBuffer);
+  glDeleteBuffers(1, &indexBuffer);
+  glDeleteVertexArrays(1, &vArray);
+}
+
+bool HeightmapTerrain::uploadChunk(int i, int j, const Heightfield& heightfield, int chunkX, int chunkZ) {
+  int index = i * worldSize + j;
+  uint16_t tile[TILE_SIZE * TILE_SIZE];
+  if (i < 0 || i >= worldSize || j < 0 || j >= worldSize || !heightfield.copyChunkTile(chunkX, chunkZ, tile)) {
+    return false;
+  }
+
+  // Same mapping as Chunk::getSurfaceHeight(), before the clamp to 1..CHUNK_SIZE
+  const float halfChunk = Config::World::CHUNK_SIZE / 2.0f;
+  heightScale = heightfield.getScale() * 65535.0f * halfChunk;
+  heightBias = (heightfield.getBias() + 1.0f) * halfChunk;
+
+  // Tile rows are an odd number of bytes wide
+  glBindTexture(GL_TEXTURE_2D_ARRAY, heightTiles);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, index, TILE_SIZE, TILE_SIZE, 1, GL_RED, GL_UNSIGNED_SHORT, tile);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  hasTile[index] = true;
+  return true;
+}
+
+bool HeightmapTerrain::uploadNormalMap(const uint8_t* pixels, utils::NormalMapFormat format, int width, int height,
+                                       int detail) {
+  GLint maxSize = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+  if (width > maxSize || height > maxSize) {
+    std::cout << "[TERRAIN] A " << width << "x" << height << " normal map exceeds the " << maxSize
+              << " texture size of this GPU" << std::endl;
+    return false;
+  }
+
+  if (normalMap == 0) {
+    glGenTextures(1, &normalMap);
+  }
+  glBindTexture(GL_TEXTURE_2D, normalMap);
+
+  // The buffer's pixels are GL pixels as they are; RG8 rows are an odd number
+  // of pixels wide
+  if (format == utils::NORMAL_MAP_RG8) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, width, height, 0, GL_RG, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  } else {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB10_A2, width, height, 0, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, pixels);
+  }
+
+  // Distant chunks cover few pixels per texel; the mipmaps average the
+  // normals and the shader normalizes them again
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  normalMapWidth = width;
+  normalMapHeight = height;
+  normalDetail = detail;
+  std::cout << "[TERRAIN] Uploaded a " << width << "x" << height << " normal map" << std::endl;
+  return true;
+}
+
+void HeightmapTerrain::draw(Shader& shader, const std::vector<int>& visibleChunks) {
+  instances.clear();
+  for (int index : visibleChunks) {
+    if (index >= 0 && index < (int)hasTile.size() && hasTile[index]) {
+      instances.push_back(index);
+    }
+  }
+  if (instances.empty()) {
+    return;
+  }
+
+  glBindVertexArray(vArray);
+  glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(int), instances.data());
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, heightTiles);
+  if (normalMap != 0) {
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, normalMap);
+    glActiveTexture(GL_TEXTURE0);
+  }
+
+  shader.use();
+  shader.setInt("heightTiles", 0);
+  shader.setInt("worldSize", worldSize);
+  shader.setFloat("heightScale", heightScale);
+  shader.setFloat("heightBias", heightBias);
+  shader.setFloat("chunkUnits", (float)Config::World::CHUNK_WORLD_UNITS);
+  shader.setFloat("sandHeight", Config::Terrain::SAND_THRESHOLD * Config::World::CHUNK_SIZE);
+  shader.setFloat("grassHeight", Config::Terrain::GRASS_THRESHOLD * Config::World::CHUNK_SIZE);
+  shader.setInt("normalMap", 1);
+  shader.setInt("useNormalMap", normalMap != 0 ? 1 : 0);
+  shader.setVec2("normalMapSize", (float)normalMapWidth, (float)normalMapHeight);
+  shader.setFloat("normalDetail", (float)normalDetail);
+
+  glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, (void*)0, (GLsizei)instances.size());
+  glBindVertexArray(0);
+}
@@ -0,0 +1,177 @@
+#include <general/JobSystem.h>
+#include <algorithm>
+
+namespace {
+    // Worker identity of the current thread; non-workers use queue 0
+    thread_local const JobSystem* t_owner = nullptr;
+    thread_local int t_queueIndex = 0;
+}
+
+JobSystem::JobSystem(int threadCount) : queuedJobs(0), stopping(false) {
+    startWorkers(threadCount);
+}
+
+JobSystem::~JobSystem() {
+    stopWorkers();
+}
+
+JobSystem& JobSystem::getInstance() {
+    static JobSystem instance(std::max(1, (int)std::thread::hardware_concurrency()));
+    return instance;
+}
+
+void JobSystem::setThreadCount(int threadCount) {
+    stopWorkers();
+    startWorkers(threadCount);
+}
+
+void JobSystem::startWorkers(int threadCount) {
+    int workerCount = std::max(0, threadCount - 1);
+
+    stopping.store(false);
+    queues.clear();
+    for (int i = 0; i <= workerCount; i++) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (int i = 1; i <= workerCount; i++) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+void JobSystem::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping.store(true);
+    }
+    wakeup.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+int JobSystem::currentQueueIndex() const {
+    return (t_owner == this) ? t_queueIndex : 0;
+}
+
+void JobSystem::run(JobCounter& counter, JobFunction function) {
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+    WorkQueue& queue = *queues[currentQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back({std::move(function), &counter});
+    }
+    queuedJobs.fetch_add(1, std::memory_order_release);
+
+    // Taking the lock orders this against a worker that is about to sleep
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wakeup.notify_one();
+}
+
+bool JobSystem::popJob(int queueIndex, Job& job) {
+    WorkQueue& queue = *queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty()) {
+        return false;
+    }
+    job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool JobSystem::stealJob(int thiefIndex, Job& job) {
+    int queueCount = (int)queues.size();
+    for (int offset = 1; offset < queueCount; offset++) {
+        WorkQueue& queue = *queues[(thiefIndex + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(Job& job) {
+    JobCounter* counter = job.counter;
+    try {
+        job.function();
+    }
+    catch (...) {
+        // Keep the first failure, wait() rethrows it on the waiting thread
+        if (!counter->failed.exchange(true)) {
+            counter->error = std::current_exception();
+        }
+    }
+    counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::workerLoop(int queueIndex) {
+    t_owner = this;
+    t_queueIndex = queueIndex;
+
+    Job job;
+    while (true) {
+        if (popJob(queueIndex, job) || stealJob(queueIndex, job)) {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeup.wait(lock, [this] {
+            return stopping.load() || queuedJobs.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping.load() && queuedJobs.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool JobSystem::runPendingJob() {
+    int queueIndex = currentQueueIndex();
+
+    Job job;
+    if (popJob(queueIndex, job) || stealJob(queueIndex, job)) {
+        execute(job);
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    // Help instead of blocking: nested waits inside jobs keep the pool busy
+    while (counter.pending.load(std::memory_order_acquire) > 0) {
+        if (!runPendingJob()) {
+            std::this_thread::yield();
+        }
+    }
+
+    if (counter.failed.load()) {
+        counter.failed.store(false);
+        std::exception_ptr error = counter.error;
+        counter.error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void JobSystem::parallelFor(int begin, int end, int grainSize, const std::function<void(int, int)>& function) {
+    grainSize = std::max(1, grainSize);
+    if (end - begin <= grainSize || getThreadCount() == 1) {
+        if (begin < end) {
+            function(begin, end);
+        }
+        return;
+    }
+
+    JobCounter counter;
+    for (int rangeBegin = begin; rangeBegin < end; rangeBegin += grainSize) {
+        int rangeEnd = std::min(end, rangeBegin + grainSize);
+        run(counter, [&function, rangeBegin, rangeEnd] { function(rangeBegin, rangeEnd); });
+    }
+    wait(counter);
+}
@@ -0,0 +1,160 @@
+#include <general/SimulationThread.h>
+#include <general/Config.h>
+#include <general/Rain.h>
+#include <terrain/Waterfall.h>
+#include <chrono>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    long long elapsedNs(Clock::time_point start, Clock::time_point end) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    }
+}
+
+SimulationThread::SimulationThread(Waterfall* waterfall, Rain& rain, int worldSize)
+    : waterfall(waterfall), rain(rain), worldSize(worldSize), submittedFrames(0), pendingDeltaNs(0), running(false),
+      simulationNs(0), idleNs(0), stepCount(0), renderNs(0), frameCount(0) {
+}
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+void SimulationThread::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    worker = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+    running.store(false);
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void SimulationThread::submitFrame(float deltaTime, const glm::mat4& viewProjection) {
+    SimulationInput& input = inputs.writeSlot();
+    input.frame = ++submittedFrames;
+    input.viewProjection = viewProjection;
+
+    // Added before publishing, so the step that acquires this input sees it
+    pendingDeltaNs += (long long)((double)deltaTime * 1.0e9);
+    inputs.publish();
+}
+
+const SimulationSnapshot& SimulationThread::latestSnapshot() {
+    snapshots.acquire();
+    return snapshots.readSlot();
+}
+
+void SimulationThread::recordRenderTime(float milliseconds) {
+    renderNs += (long long)(milliseconds * 1.0e6f);
+    frameCount++;
+}
+
+ThreadTimings SimulationThread::takeTimings() {
+    ThreadTimings timings;
+    timings.steps = stepCount.exchange(0);
+    timings.frames = frameCount.exchange(0);
+
+    long long sim = simulationNs.exchange(0);
+    long long idle = idleNs.exchange(0);
+    long long render = renderNs.exchange(0);
+    timings.simulationMs = timings.steps > 0 ? (float)(sim / timings.steps) / 1.0e6f : 0.0f;
+    timings.idleMs = timings.steps > 0 ? (float)(idle / timings.steps) / 1.0e6f : 0.0f;
+    timings.renderMs = timings.frames > 0 ? (float)(render / timings.frames) / 1.0e6f : 0.0f;
+    return timings;
+}
+
+void SimulationThread::run() {
+    Clock::time_point idleStart = Clock::now();
+
+    while (running.load()) {
+        // Wait for the render thread to hand over the next frame's input
+        if (!inputs.acquire()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+
+        Clock::time_point stepStart = Clock::now();
+        idleNs += elapsedNs(idleStart, stepStart);
+
+        // Everything submitted since the previous step, including skipped inputs
+        float deltaTime = (float)((double)pendingDeltaNs.exchange(0) / 1.0e9);
+        step(inputs.readSlot(), deltaTime, snapshots.writeSlot());
+        snapshots.publish();
+
+        idleStart = Clock::now();
+        simulationNs += elapsedNs(stepStart, idleStart);
+        stepCount++;
+    }
+}
+
+void SimulationThread::step(const SimulationInput& input, float deltaTime, SimulationSnapshot& snapshot) {
+    // 1. Advance particle physics
+    if (waterfall) {
+        waterfall->updateParticles(deltaTime);
+    }
+    rain.updateParticles(deltaTime);
+
+    // 2. Build vertex data the render thread will upload
+    snapshot.frame = input.frame;
+    if (waterfall) {
+        snapshot.waterfallParticles = waterfall->renderParticles();
+    } else {
+        snapshot.waterfallParticles.clear();
+    }
+
+    snapshot.chunkRain.resize(worldSize * worldSize);
+    for (int i = 0; i < worldSize; ++i) {
+        for (int j = 0; j < worldSize; ++j) {
+            snapshot.chunkRain[i * worldSize + j] = rain.renderParticlesForChunk(i, j);
+        }
+    }
+
+    // 3. Visible chunk list for this camera
+    collectVisibleChunks(input.viewProjection, snapshot.visibleChunks);
+}
+
+void SimulationThread::collectVisibleChunks(const glm::mat4& viewProjection, std::vector<int>& visible) const {
+    const float units = (float)Config::World::CHUNK_WORLD_UNITS;
+    const float half = units / 2.0f;
+
+    visible.clear();
+    for (int i = 0; i < worldSize; ++i) {
+        for (int j = 0; j < worldSize; ++j) {
+            // Chunk bounds in world space (see model matrix in renderWorld)
+            glm::vec3 center(i * units, 0.0f, -j * units);
+
+            // A chunk is culled only if all 8 corners lie outside one clip plane
+            int outside[6] = {0, 0, 0, 0, 0, 0};
+            for (int corner = 0; corner < 8; ++corner) {
+                glm::vec4 p = viewProjection * glm::vec4(
+                    center.x + ((corner & 1) ? half : -half),
+                    center.y + ((corner & 2) ? half : -half),
+                    center.z + ((corner & 4) ? half : -half),
+                    1.0f);
+                if (p.x < -p.w) outside[0]++;
+                if (p.x >  p.w) outside[1]++;
+                if (p.y < -p.w) outside[2]++;
+                if (p.y >  p.w) outside[3]++;
+                if (p.z < -p.w) outside[4]++;
+                if (p.z >  p.w) outside[5]++;
+            }
+
+            bool culled = false;
+            for (int plane = 0; plane < 6; ++plane) {
+                if (outside[plane] == 8) {
+                    culled = true;
+                    break;
+                }
+            }
+            if (!culled) {
+                visible.push_back(i * worldSize + j);
+            }
+        }
+    }
+}
@@ -62,17 +62,25 @@ int VertexArrayWrapper::getVertexSizeBytes() const {
     case Vertex_Normal_RGB_Optimized:
       size *= 1;
       break;
+    case Vertex_Smooth_Octahedral:
+      size *= 2;
+      break;
   }
 
   return size;
 }
 
-void VertexArrayWrapper::createVBO(std::string key, std::vector<float> vertices) {
+void VertexArrayWrapper::createVBO(std::string key, const std::vector<float>& vertices) {
+  createVBO(key, vertices.data(), vertices.size());
+}
+
+void VertexArrayWrapper::createVBO(const std::string& key, const float* vertices, size_t count) {
   // Check if VBO already exists - if so, update it instead of creating new one
   auto it = VBOs.find(key);
   if (it != VBOs.end()) {
-    // VBO exists - use editVBO instead to avoid memory leak
-    editVBO(key, vertices);
+    // VBO exists - reuse it to avoid memory leak
+    glBindBuffer(GL_ARRAY_BUFFER, it->second);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(float), vertices, GL_STATIC_DRAW);
     return;
   }
 
@@ -84,18 +92,18 @@ void VertexArrayWrapper::createVBO(std::string key, std::vector<float> vertices)
   glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
   // 3. Upload Vertex data into GPU
-  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, count * sizeof(float), vertices, GL_STATIC_DRAW);
 
   // 4. Store VBO
   VBOs[key] = VBO;
 }
 
-void VertexArrayWrapper::editVBO(std::string key, std::vector<float> vertices) {
+void VertexArrayWrapper::editVBO(std::string key, const std::vector<float>& vertices) {
   // 1. Get VBO based on key
   glBindBuffer(GL_ARRAY_BUFFER, VBOs[key]);
 
   // 2. Edit the VBO
-  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
 }
 
 void VertexArrayWrapper::bindVBO(std::string key) const{
@@ -152,6 +160,11 @@ void VertexArrayWrapper::bindVBO(std::string key) const{
       glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, 1 * sizeof(GLfloat), (void*)0);
       glEnableVertexAttribArray(0);
       break;
+    case Vertex_Smooth_Octahedral:
+      // Attribute 0 : Position + RGB, Normal
+      glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (void*)0);
+      glEnableVertexAttribArray(0);
+      break;
   }
 }
 
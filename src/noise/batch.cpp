@@ -0,0 +1,3419 @@
+// batch.cpp
+//
+// Batch evaluation of noise module graphs.  Not part of the original libnoise
+// distribution; it is compiled with the game sources.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include <typeinfo>
+#include <vector>
+
+#include <noise/batch.h>
+#include <noise/batchkernels.h>
+#include <noise/interp.h>
+#include <noise/mathconsts.h>
+#include <noise/misc.h>
+#include <noise/noise.h>
+#include <noise/noisegen2d.h>
+#include <noise/randomvectors.h>
+#include <noise/module/threadcache.h>
+
+#if (defined (__GNUC__) || defined (__clang__)) \
+  && (defined (__x86_64__) || defined (__i386__))
+#define NOISE_BATCH_AVX2 1
+#include <immintrin.h>
+#define NOISE_TARGET_AVX2 __attribute__ ((target ("avx2")))
+#else
+#define NOISE_BATCH_AVX2 0
+#endif
+
+using namespace noise;
+using namespace noise::module;
+
+namespace
+{
+
+  // Constants of the lattice hash (noisegen.cpp).
+  const int X_NOISE_GEN = 1619;
+  const int Y_NOISE_GEN = 31337;
+  const int Z_NOISE_GEN = 6971;
+  const int SEED_NOISE_GEN = 1013;
+  const int SHIFT_NOISE_GEN = 8;
+
+  // Constants of the three-dimensional simplex noise (simplex.cpp).
+  const double SIMPLEX_SKEW_3D   = 1.0 / 3.0;
+  const double SIMPLEX_UNSKEW_3D = 1.0 / 6.0;
+  const double SIMPLEX_SCALE_3D  = 108.0;
+
+  // Offsets that Turbulence adds to the input value before sampling each of
+  // its distortion modules (turbulence.cpp).
+  const double TURBULENCE_OFFSETS[3][3] = {
+    {12414.0 / 65536.0, 65124.0 / 65536.0, 31337.0 / 65536.0},
+    {26519.0 / 65536.0, 18128.0 / 65536.0, 60493.0 / 65536.0},
+    {53820.0 / 65536.0, 11213.0 / 65536.0, 44845.0 / 65536.0}
+  };
+
+  std::atomic<bool> g_isSimdEnabled (true);
+  std::atomic<bool> g_isOctaveSpecializationEnabled (true);
+
+  // Which octave loop a fractal kernel runs.
+  enum FractalType
+  {
+    FRACTAL_PERLIN,
+    FRACTAL_BILLOW,
+    FRACTAL_RIDGED
+  };
+
+  // Parameters of a Perlin, Billow or RidgedMulti noise module.
+  struct FractalParams
+  {
+    FractalType type;
+    double frequency;
+    double lacunarity;
+    double persistence;
+    int octaveCount;
+    int seed;
+    NoiseQuality noiseQuality;
+    double spectralWeights[RIDGED_MAX_OCTAVE];
+
+    // Lattice periods of every octave along the x and z axes, set by
+    // SetupPeriods (); zero if the lattice does not repeat.
+    int periodX[RIDGED_MAX_OCTAVE];
+    int periodZ[RIDGED_MAX_OCTAVE];
+  };
+
+  void ClearPeriods (FractalParams& params)
+  {
+    std::fill (params.periodX, params.periodX + RIDGED_MAX_OCTAVE, 0);
+    std::fill (params.periodZ, params.periodZ + RIDGED_MAX_OCTAVE, 0);
+  }
+
+  FractalParams GetPerlinParams (const Perlin& perlin)
+  {
+    FractalParams params;
+    params.type = FRACTAL_PERLIN;
+    params.frequency = perlin.GetFrequency ();
+    params.lacunarity = perlin.GetLacunarity ();
+    params.persistence = perlin.GetPersistence ();
+    params.octaveCount = perlin.GetOctaveCount ();
+    params.seed = perlin.GetSeed ();
+    params.noiseQuality = perlin.GetNoiseQuality ();
+    ClearPeriods (params);
+    return params;
+  }
+
+  FractalParams GetBillowParams (const Billow& billow)
+  {
+    FractalParams params;
+    params.type = FRACTAL_BILLOW;
+    params.frequency = billow.GetFrequency ();
+    params.lacunarity = billow.GetLacunarity ();
+    params.persistence = billow.GetPersistence ();
+    params.octaveCount = billow.GetOctaveCount ();
+    params.seed = billow.GetSeed ();
+    params.noiseQuality = billow.GetNoiseQuality ();
+    ClearPeriods (params);
+    return params;
+  }
+
+  FractalParams GetRidgedParams (const RidgedMulti& ridged)
+  {
+    FractalParams params;
+    params.type = FRACTAL_RIDGED;
+    params.frequency = ridged.GetFrequency ();
+    params.lacunarity = ridged.GetLacunarity ();
+    params.persistence = 1.0;
+    params.octaveCount = ridged.GetOctaveCount ();
+    params.seed = ridged.GetSeed ();
+    params.noiseQuality = ridged.GetNoiseQuality ();
+
+    // Same weights as RidgedMulti::CalcSpectralWeights (); octaves beyond
+    // the octave count are never read.
+    double frequency = 1.0;
+    for (int i = 0; i < params.octaveCount; i++) {
+      params.spectralWeights[i] = pow (frequency, -1.0);
+      frequency *= params.lacunarity;
+    }
+    ClearPeriods (params);
+    return params;
+  }
+
+  // The octaves of a Simplex module combine like the octaves of Perlin,
+  // Billow and RidgedMulti; the noise quality is not used.
+  FractalParams GetSimplexParams (const Simplex& simplex)
+  {
+    FractalParams params;
+    switch (simplex.GetType ()) {
+      case SIMPLEX_BILLOW:
+        params.type = FRACTAL_BILLOW;
+        break;
+      case SIMPLEX_RIDGED:
+        params.type = FRACTAL_RIDGED;
+        break;
+      default:
+        params.type = FRACTAL_PERLIN;
+        break;
+    }
+    params.frequency = simplex.GetFrequency ();
+    params.lacunarity = simplex.GetLacunarity ();
+    params.persistence = simplex.GetPersistence ();
+    params.octaveCount = simplex.GetOctaveCount ();
+    params.seed = simplex.GetSeed ();
+    params.noiseQuality = QUALITY_STD;
+
+    // Same weights as Simplex::CalcSpectralWeights ().
+    double frequency = 1.0;
+    for (int i = 0; i < params.octaveCount; i++) {
+      params.spectralWeights[i] = pow (frequency, -1.0);
+      frequency *= params.lacunarity;
+    }
+    ClearPeriods (params);
+    return params;
+  }
+
+  // The distortion modules of a Turbulence module are Perlin modules that
+  // only differ in their seeds.
+  FractalParams GetTurbulenceParams (const Turbulence& turbulence, int axis)
+  {
+    FractalParams params;
+    params.type = FRACTAL_PERLIN;
+    params.frequency = turbulence.GetFrequency ();
+    params.lacunarity = DEFAULT_PERLIN_LACUNARITY;
+    params.persistence = DEFAULT_PERLIN_PERSISTENCE;
+    params.octaveCount = turbulence.GetRoughnessCount ();
+    params.seed = turbulence.GetSeed () + axis;
+    params.noiseQuality = DEFAULT_PERLIN_QUALITY;
+    ClearPeriods (params);
+    return params;
+  }
+
+  // Converts a period in input units into the lattice period of every
+  // octave.  Returns false unless the period of every octave is a whole
+  // number of lattice cells; the lattice of a fractional period cannot wrap
+  // without a seam.
+  bool SetupPeriod (const FractalParams& params, double period,
+    int* pLatticePeriods)
+  {
+    // Scaled the way the octave loop scales the input coordinates.
+    double latticePeriod = period * params.frequency;
+    for (int curOctave = 0; curOctave < params.octaveCount; curOctave++) {
+      double rounded = floor (latticePeriod + 0.5);
+      if (!(rounded >= 1.0 && rounded <= 1073741824.0)
+        || fabs (latticePeriod - rounded) > rounded * 1.0e-6) {
+        return false;
+      }
+      pLatticePeriods[curOctave] = (int)rounded;
+      latticePeriod *= params.lacunarity;
+    }
+    return true;
+  }
+
+  bool SetupPeriods (FractalParams& params, double periodX, double periodZ)
+  {
+    return SetupPeriod (params, periodX, params.periodX)
+      && SetupPeriod (params, periodZ, params.periodZ);
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Scalar kernels
+
+  // Adds the signal of one octave to the value of an input value, the way
+  // the GetValue () method of the module does.
+  inline void AddOctave (const FractalParams& params, int curOctave,
+    double curPersistence, double signal, double& value, double& weight)
+  {
+    switch (params.type) {
+      case FRACTAL_PERLIN:
+        value += signal * curPersistence;
+        break;
+      case FRACTAL_BILLOW:
+        signal = 2.0 * fabs (signal) - 1.0;
+        value += signal * curPersistence;
+        break;
+      case FRACTAL_RIDGED:
+        signal = 1.0 - fabs (signal);
+        signal *= signal;
+        signal *= weight;
+        weight = signal * 2.0;
+        if (weight > 1.0) {
+          weight = 1.0;
+        }
+        if (weight < 0.0) {
+          weight = 0.0;
+        }
+        value += signal * params.spectralWeights[curOctave];
+        break;
+    }
+  }
+
+  inline double FinishFractal (const FractalParams& params, double value)
+  {
+    if (params.type == FRACTAL_BILLOW) {
+      return value + 0.5;
+    } else if (params.type == FRACTAL_RIDGED) {
+      return (value * 1.25) - 1.0;
+    }
+    return value;
+  }
+
+  inline int OctaveSeed (const FractalParams& params, int curOctave)
+  {
+    int seed = params.seed + curOctave;
+    if (params.type == FRACTAL_RIDGED) {
+      seed &= 0x7fffffff;
+    }
+    return seed;
+  }
+
+  // If isPlanar is set, every y coordinate is zero and the octaves sample
+  // the two-dimensional lattice.
+  void FractalValuesScalar (const FractalParams& params, const double* pX,
+    const double* pY, const double* pZ, double* pDest, int count,
+    bool isPlanar)
+  {
+    for (int i = 0; i < count; i++) {
+      double x = pX[i] * params.frequency;
+      double y = pY[i] * params.frequency;
+      double z = pZ[i] * params.frequency;
+      double value = 0.0;
+      double curPersistence = 1.0;
+      double weight = 1.0;
+      for (int curOctave = 0; curOctave < params.octaveCount; curOctave++) {
+        double nx = MakeInt32Range (x);
+        double ny = MakeInt32Range (y);
+        double nz = MakeInt32Range (z);
+        int seed = OctaveSeed (params, curOctave);
+        double signal = isPlanar?
+          GradientCoherentNoise2D (nx, nz, seed, params.noiseQuality):
+          GradientCoherentNoise3D (nx, ny, nz, seed, params.noiseQuality);
+        AddOctave (params, curOctave, curPersistence, signal, value, weight);
+        x *= params.lacunarity;
+        y *= params.lacunarity;
+        z *= params.lacunarity;
+        curPersistence *= params.persistence;
+      }
+      pDest[i] = FinishFractal (params, value);
+    }
+  }
+
+  // The output value of a module with a periodic lattice at (x, 0, z).
+  double PeriodicFractalValue (const FractalParams& params, double x,
+    double z)
+  {
+    x *= params.frequency;
+    z *= params.frequency;
+    double value = 0.0;
+    double curPersistence = 1.0;
+    double weight = 1.0;
+    for (int curOctave = 0; curOctave < params.octaveCount; curOctave++) {
+      double signal = PeriodicGradientCoherentNoise2D (x, z,
+        params.periodX[curOctave], params.periodZ[curOctave],
+        OctaveSeed (params, curOctave), params.noiseQuality);
+      AddOctave (params, curOctave, curPersistence, signal, value, weight);
+      x *= params.lacunarity;
+      z *= params.lacunarity;
+      curPersistence *= params.persistence;
+    }
+    return FinishFractal (params, value);
+  }
+
+  // AddOctave () along with the derivatives of the value along the x and z
+  // axes, which follow the octave signal by the chain rule.  The signal
+  // derivatives are per unit of the input value.  The value is computed in
+  // the order AddOctave () uses, so it is the same.
+  inline void AddOctaveDeriv (const FractalParams& params, int curOctave,
+    double curPersistence, double signal, double signalDX, double signalDZ,
+    double& value, double& valueDX, double& valueDZ, double& weight,
+    double& weightDX, double& weightDZ)
+  {
+    double sign = (signal < 0.0)? -1.0: 1.0;
+    switch (params.type) {
+      case FRACTAL_PERLIN:
+        value += signal * curPersistence;
+        valueDX += signalDX * curPersistence;
+        valueDZ += signalDZ * curPersistence;
+        break;
+      case FRACTAL_BILLOW:
+        signal = 2.0 * fabs (signal) - 1.0;
+        value += signal * curPersistence;
+        valueDX += 2.0 * sign * signalDX * curPersistence;
+        valueDZ += 2.0 * sign * signalDZ * curPersistence;
+        break;
+      case FRACTAL_RIDGED: {
+        double ridge = 1.0 - fabs (signal);
+        double ridgeDX = -sign * signalDX;
+        double ridgeDZ = -sign * signalDZ;
+        signal = ridge * ridge;
+        signal *= weight;
+        signalDX = 2.0 * ridge * ridgeDX * weight + ridge * ridge * weightDX;
+        signalDZ = 2.0 * ridge * ridgeDZ * weight + ridge * ridge * weightDZ;
+        weight = signal * 2.0;
+        weightDX = signalDX * 2.0;
+        weightDZ = signalDZ * 2.0;
+        if (weight > 1.0) {
+          weight = 1.0;
+          weightDX = weightDZ = 0.0;
+        }
+        if (weight < 0.0) {
+          weight = 0.0;
+          weightDX = weightDZ = 0.0;
+        }
+        value += signal * params.spectralWeights[curOctave];
+        valueDX += signalDX * params.spectralWeights[curOctave];
+        valueDZ += signalDZ * params.spectralWeights[curOctave];
+        break;
+      }
+    }
+  }
+
+  // FinishFractal () only offsets and scales the value; this is the scale
+  // of its derivatives.
+  inline double FinishFractalDeriv (const FractalParams& params)
+  {
+    return (params.type == FRACTAL_RIDGED)? 1.25: 1.0;
+  }
+
+  // The output value of a module at (x, 0, z) and its derivatives along the
+  // x and z axes.  The octave signals come with their analytic gradients
+  // (GradientCoherentNoiseDeriv2D ()), which follow the signals through the
+  // octave loop by the chain rule.
+  double FractalValueDeriv2D (const FractalParams& params, double x,
+    double z, double& dx, double& dz)
+  {
+    x *= params.frequency;
+    z *= params.frequency;
+    double octaveScale = params.frequency;
+    double value = 0.0, valueDX = 0.0, valueDZ = 0.0;
+    double curPersistence = 1.0;
+    double weight = 1.0, weightDX = 0.0, weightDZ = 0.0;
+    for (int curOctave = 0; curOctave < params.octaveCount; curOctave++) {
+      double signalDX, signalDZ;
+      double signal = GradientCoherentNoiseDeriv2D (MakeInt32Range (x),
+        MakeInt32Range (z), signalDX, signalDZ,
+        OctaveSeed (params, curOctave), params.noiseQuality);
+
+      // Per unit of the input value rather than per lattice unit.
+      AddOctaveDeriv (params, curOctave, curPersistence, signal,
+        signalDX * octaveScale, signalDZ * octaveScale, value, valueDX,
+        valueDZ, weight, weightDX, weightDZ);
+      x *= params.lacunarity;
+      z *= params.lacunarity;
+      octaveScale *= params.lacunarity;
+      curPersistence *= params.persistence;
+    }
+    dx = valueDX * FinishFractalDeriv (params);
+    dz = valueDZ * FinishFractalDeriv (params);
+    return FinishFractal (params, value);
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Grid kernel
+  //
+  // A regular grid of input values on the y = 0 plane crosses each lattice
+  // cell of an octave many times when the grid is dense.  The grid kernel
+  // works on strips of up to BATCH_BLOCK_SIZE columns.  For each octave of a
+  // strip it computes what only depends on the column (lattice cell,
+  // s-curve weight, offsets from the cell corners) once, and the corner
+  // gradients of every column only when a row enters a new lattice row.
+  // What is left per sample is the dot products and interpolations of
+  // GradientCoherentNoise2D (), in the same order, so the output values are
+  // identical.
+  //
+  // With a periodic lattice, the coordinates are mapped into the first
+  // period and the hashed corners wrap around it, the way
+  // PeriodicGradientCoherentNoise2D () does.
+  //
+  // The gradient form of the kernel also carries the derivatives along the
+  // x and z axes, with the arithmetic of GradientCoherentNoiseDeriv2D (), so
+  // its output equals that of FractalValueDeriv2D ().
+
+  inline double ApplyQuality (double a, NoiseQuality noiseQuality)
+  {
+    switch (noiseQuality) {
+      case QUALITY_FAST:
+        return a;
+      case QUALITY_STD:
+        return SCurve3 (a);
+      case QUALITY_BEST:
+        return SCurve5 (a);
+    }
+    return a;
+  }
+
+  // Slope of the s-curve ApplyQuality () applies.
+  inline double ApplyQualityDeriv (double a, NoiseQuality noiseQuality)
+  {
+    switch (noiseQuality) {
+      case QUALITY_FAST:
+        return 1.0;
+      case QUALITY_STD:
+        return 6.0 * a * (1.0 - a);
+      case QUALITY_BEST: {
+        double b = a * (1.0 - a);
+        return 30.0 * b * b;
+      }
+    }
+    return 1.0;
+  }
+
+  inline int LatticeCoord (double n)
+  {
+    return (n > 0.0? (int)n: (int)n - 1);
+  }
+
+  // The x and z components of the gradient GradientNoise2D () uses at the
+  // lattice point (ix, 0, iz).
+  inline void LatticeGradient2D (int ix, int iz, int seed,
+    double& xGradient, double& zGradient)
+  {
+    unsigned int hash = (unsigned int)X_NOISE_GEN * (unsigned int)ix
+      + (unsigned int)Z_NOISE_GEN * (unsigned int)iz
+      + (unsigned int)SEED_NOISE_GEN * (unsigned int)seed;
+    int vectorIndex = (int)hash;
+    vectorIndex ^= (vectorIndex >> SHIFT_NOISE_GEN);
+    vectorIndex &= 0xff;
+    xGradient = g_randomVectors[(vectorIndex << 2)    ];
+    zGradient = g_randomVectors[(vectorIndex << 2) + 2];
+  }
+
+  // Lattice data of one octave of a strip of columns.
+  struct GridOctave
+  {
+    int seed;
+
+    // Per column: hashed cell corners, s-curve weight and slope, and
+    // offsets from the two cell corners.
+    int x0[BATCH_BLOCK_SIZE];
+    int x1[BATCH_BLOCK_SIZE];
+    double xs[BATCH_BLOCK_SIZE];
+    double xsDeriv[BATCH_BLOCK_SIZE];
+    double dx0[BATCH_BLOCK_SIZE];
+    double dx1[BATCH_BLOCK_SIZE];
+
+    // Lattice row the gradients below belong to, and whether they are set.
+    int z0;
+    bool hasGradients;
+
+    // Per column: gradients of the four cell corners, (x0, z0), (x1, z0),
+    // (x0, z1) and (x1, z1).
+    double xGradient00[BATCH_BLOCK_SIZE];
+    double zGradient00[BATCH_BLOCK_SIZE];
+    double xGradient10[BATCH_BLOCK_SIZE];
+    double zGradient10[BATCH_BLOCK_SIZE];
+    double xGradient01[BATCH_BLOCK_SIZE];
+    double zGradient01[BATCH_BLOCK_SIZE];
+    double xGradient11[BATCH_BLOCK_SIZE];
+    double zGradient11[BATCH_BLOCK_SIZE];
+  };
+
+  // Lattice data of one octave of a row.
+  struct GridRow
+  {
+    int z0;
+    int z1;
+    double zs;
+    double zsDeriv;
+    double dz0;
+    double dz1;
+  };
+
+  // Wraps a lattice coordinate of a coordinate in [0, period) around the
+  // period; a period of zero leaves it unchanged.
+  inline int WrapLatticeCoord (int n, int period)
+  {
+    if (period == 0) {
+      return n;
+    }
+    return (n < 0? n + period: (n >= period? n - period: n));
+  }
+
+  // A period of zero sets up the lattice of the module; any other period
+  // sets up a lattice that repeats itself after that many cells.
+  void SetupGridColumns (GridOctave& octave, const double* pX, int count,
+    NoiseQuality noiseQuality, int period)
+  {
+    for (int i = 0; i < count; i++) {
+      double nx = (period == 0? MakeInt32Range (pX[i]):
+        MakePeriodicRange (pX[i], period));
+      int x0 = LatticeCoord (nx);
+      octave.x0[i] = WrapLatticeCoord (x0, period);
+      octave.x1[i] = WrapLatticeCoord (x0 + 1, period);
+      octave.xs[i] = ApplyQuality (nx - (double)x0, noiseQuality);
+      octave.xsDeriv[i] = ApplyQualityDeriv (nx - (double)x0, noiseQuality);
+      octave.dx0[i] = nx - (double)x0;
+      octave.dx1[i] = nx - (double)(x0 + 1);
+    }
+    octave.hasGradients = false;
+  }
+
+  GridRow SetupGridRow (double z, NoiseQuality noiseQuality, int period)
+  {
+    GridRow row;
+    double nz = (period == 0? MakeInt32Range (z):
+      MakePeriodicRange (z, period));
+    int z0 = LatticeCoord (nz);
+    row.z0 = WrapLatticeCoord (z0, period);
+    row.z1 = WrapLatticeCoord (z0 + 1, period);
+    row.zs = ApplyQuality (nz - (double)z0, noiseQuality);
+    row.zsDeriv = ApplyQualityDeriv (nz - (double)z0, noiseQuality);
+    row.dz0 = nz - (double)z0;
+    row.dz1 = nz - (double)(z0 + 1);
+    return row;
+  }
+
+  // Looks up the corner gradients of every column for the lattice row of
+  // a row.  Neighbouring columns in the same or the next cell share
+  // corners.
+  void SetupGridGradients (GridOctave& octave, const GridRow& row,
+    int count)
+  {
+    int z0 = row.z0;
+    int z1 = row.z1;
+    if (octave.hasGradients && octave.z0 == z0) {
+      return;
+    }
+    for (int i = 0; i < count; i++) {
+      int x0 = octave.x0[i];
+      if (i > 0 && x0 == octave.x0[i - 1]) {
+        octave.xGradient00[i] = octave.xGradient00[i - 1];
+        octave.zGradient00[i] = octave.zGradient00[i - 1];
+        octave.xGradient10[i] = octave.xGradient10[i - 1];
+        octave.zGradient10[i] = octave.zGradient10[i - 1];
+        octave.xGradient01[i] = octave.xGradient01[i - 1];
+        octave.zGradient01[i] = octave.zGradient01[i - 1];
+        octave.xGradient11[i] = octave.xGradient11[i - 1];
+        octave.zGradient11[i] = octave.zGradient11[i - 1];
+        continue;
+      }
+      if (i > 0 && x0 == octave.x1[i - 1]) {
+        octave.xGradient00[i] = octave.xGradient10[i - 1];
+        octave.zGradient00[i] = octave.zGradient10[i - 1];
+        octave.xGradient01[i] = octave.xGradient11[i - 1];
+        octave.zGradient01[i] = octave.zGradient11[i - 1];
+      } else {
+        LatticeGradient2D (x0, z0, octave.seed, octave.xGradient00[i],
+          octave.zGradient00[i]);
+        LatticeGradient2D (x0, z1, octave.seed, octave.xGradient01[i],
+          octave.zGradient01[i]);
+      }
+      LatticeGradient2D (octave.x1[i], z0, octave.seed,
+        octave.xGradient10[i], octave.zGradient10[i]);
+      LatticeGradient2D (octave.x1[i], z1, octave.seed,
+        octave.xGradient11[i], octave.zGradient11[i]);
+    }
+    octave.z0 = z0;
+    octave.hasGradients = true;
+  }
+
+  void GridOctaveValuesScalar (const FractalParams& params, int curOctave,
+    double curPersistence, const GridOctave& octave, const GridRow& row,
+    double* pValue, double* pWeight, int count)
+  {
+    for (int i = 0; i < count; i++) {
+      double dx0 = octave.dx0[i];
+      double dx1 = octave.dx1[i];
+      double xs = octave.xs[i];
+      double n0, n1, ix0, ix1;
+      n0  = ((octave.xGradient00[i] * dx0)
+        + (octave.zGradient00[i] * row.dz0)) * 2.12;
+      n1  = ((octave.xGradient10[i] * dx1)
+        + (octave.zGradient10[i] * row.dz0)) * 2.12;
+      ix0 = LinearInterp (n0, n1, xs);
+      n0  = ((octave.xGradient01[i] * dx0)
+        + (octave.zGradient01[i] * row.dz1)) * 2.12;
+      n1  = ((octave.xGradient11[i] * dx1)
+        + (octave.zGradient11[i] * row.dz1)) * 2.12;
+      ix1 = LinearInterp (n0, n1, xs);
+      double signal = LinearInterp (ix0, ix1, row.zs);
+      AddOctave (params, curOctave, curPersistence, signal, pValue[i],
+        pWeight[i]);
+    }
+  }
+
+  // Values and derivatives of one octave of a row, accumulated for each
+  // column.  The corner values and their interpolations are those of
+  // GridOctaveValuesScalar (); each corner's derivatives are the components
+  // of its gradient.  The octave scale converts the derivatives from
+  // lattice units to units of the input value.
+  struct GridDerivs
+  {
+    double* pValue;
+    double* pWeight;
+    double* pValueDX;
+    double* pValueDZ;
+    double* pWeightDX;
+    double* pWeightDZ;
+  };
+
+  void GridOctaveDerivsScalar (const FractalParams& params, int curOctave,
+    double curPersistence, double octaveScale, const GridOctave& octave,
+    const GridRow& row, const GridDerivs& derivs, int count)
+  {
+    for (int i = 0; i < count; i++) {
+      double dx0 = octave.dx0[i];
+      double dx1 = octave.dx1[i];
+      double xs = octave.xs[i];
+      double n00 = ((octave.xGradient00[i] * dx0)
+        + (octave.zGradient00[i] * row.dz0)) * 2.12;
+      double n10 = ((octave.xGradient10[i] * dx1)
+        + (octave.zGradient10[i] * row.dz0)) * 2.12;
+      double n01 = ((octave.xGradient01[i] * dx0)
+        + (octave.zGradient01[i] * row.dz1)) * 2.12;
+      double n11 = ((octave.xGradient11[i] * dx1)
+        + (octave.zGradient11[i] * row.dz1)) * 2.12;
+      double ix0 = LinearInterp (n00, n10, xs);
+      double ix1 = LinearInterp (n01, n11, xs);
+      double signal = LinearInterp (ix0, ix1, row.zs);
+
+      // Product rule on each interpolation, as in
+      // GradientCoherentNoiseDeriv2D ().
+      double ix0DX = LinearInterp (octave.xGradient00[i] * 2.12,
+        octave.xGradient10[i] * 2.12, xs) + octave.xsDeriv[i] * (n10 - n00);
+      double ix0DZ = LinearInterp (octave.zGradient00[i] * 2.12,
+        octave.zGradient10[i] * 2.12, xs);
+      double ix1DX = LinearInterp (octave.xGradient01[i] * 2.12,
+        octave.xGradient11[i] * 2.12, xs) + octave.xsDeriv[i] * (n11 - n01);
+      double ix1DZ = LinearInterp (octave.zGradient01[i] * 2.12,
+        octave.zGradient11[i] * 2.12, xs);
+      double signalDX = LinearInterp (ix0DX, ix1DX, row.zs);
+      double signalDZ = LinearInterp (ix0DZ, ix1DZ, row.zs)
+        + row.zsDeriv * (ix1 - ix0);
+      AddOctaveDeriv (params, curOctave, curPersistence, signal,
+        signalDX * octaveScale, signalDZ * octaveScale, derivs.pValue[i],
+        derivs.pValueDX[i], derivs.pValueDZ[i], derivs.pWeight[i],
+        derivs.pWeightDX[i], derivs.pWeightDZ[i]);
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Row kernel
+  //
+  // In a plane noise map, the distortion modules of a Turbulence module and
+  // the displacement modules of a Displace module receive blocks of input
+  // values that share their y and z coordinates: one row of the map, moved
+  // by a constant offset.  For each octave of such a block, the row kernel
+  // computes the y and z lattice data once, and the gradients of the eight
+  // cube corners only when an input value enters a new cube along the x
+  // axis; the next cube shares four of them.  What is left per input value
+  // is the x term of each dot product and the interpolations of
+  // GradientCoherentNoise3D (), in the same order, so the output values are
+  // identical.  Octaves whose cubes hold few input values use the generic
+  // kernels instead.
+
+  // Fewest input values per cube, on average, for which an octave of a row
+  // takes the row kernel.  Around four, the cube setup and the partly
+  // filled lanes of short runs cost as much as the kernel saves.
+  const int ROW_MIN_VALUES_PER_CUBE = 8;
+
+  // Lattice data of one octave of a row.
+  struct RowOctave
+  {
+    int seed;
+    int y0;
+    int z0;
+    double ys;
+    double zs;
+    double dy0;
+    double dy1;
+    double dz0;
+    double dz1;
+  };
+
+  // Corner gradients of the cube that contains the current input values.
+  // Corner c is (x0 + (c & 1), y0 + ((c >> 1) & 1), z0 + (c >> 2)); its y
+  // and z gradient components are stored multiplied by the offsets of the
+  // row from the corner, the terms they contribute to every dot product.
+  struct RowCube
+  {
+    int x0;
+    double xGradient[8];
+    double yTerm[8];
+    double zTerm[8];
+  };
+
+  // The gradient GradientNoise3D () uses at the lattice point (ix, iy, iz).
+  inline void LatticeGradient3D (int ix, int iy, int iz, int seed,
+    double& xGradient, double& yGradient, double& zGradient)
+  {
+    unsigned int hash = (unsigned int)X_NOISE_GEN * (unsigned int)ix
+      + (unsigned int)Y_NOISE_GEN * (unsigned int)iy
+      + (unsigned int)Z_NOISE_GEN * (unsigned int)iz
+      + (unsigned int)SEED_NOISE_GEN * (unsigned int)seed;
+    int vectorIndex = (int)hash;
+    vectorIndex ^= (vectorIndex >> SHIFT_NOISE_GEN);
+    vectorIndex &= 0xff;
+    xGradient = g_randomVectors[(vectorIndex << 2)    ];
+    yGradient = g_randomVectors[(vectorIndex << 2) + 1];
+    zGradient = g_randomVectors[(vectorIndex << 2) + 2];
+  }
+
+  RowOctave SetupRowOctave (double ny, double nz, int seed,
+    NoiseQuality noiseQuality)
+  {
+    RowOctave row;
+    row.seed = seed;
+    row.y0 = LatticeCoord (ny);
+    row.z0 = LatticeCoord (nz);
+    row.ys = ApplyQuality (ny - (double)row.y0, noiseQuality);
+    row.zs = ApplyQuality (nz - (double)row.z0, noiseQuality);
+    row.dy0 = ny - (double)row.y0;
+    row.dy1 = ny - (double)(row.y0 + 1);
+    row.dz0 = nz - (double)row.z0;
+    row.dz1 = nz - (double)(row.z0 + 1);
+    return row;
+  }
+
+  // Moves the cube to x0.  If the cube was at x0 - 1, its x1 corners are
+  // the new x0 corners.
+  void SetupRowCube (RowCube& cube, bool hasCube, int x0,
+    const RowOctave& row)
+  {
+    bool isNext = hasCube && x0 == cube.x0 + 1;
+    for (int c = 0; c < 8; c++) {
+      if (isNext && (c & 1) == 0) {
+        cube.xGradient[c] = cube.xGradient[c + 1];
+        cube.yTerm[c] = cube.yTerm[c + 1];
+        cube.zTerm[c] = cube.zTerm[c + 1];
+        continue;
+      }
+      double xGradient, yGradient, zGradient;
+      LatticeGradient3D (x0 + (c & 1), row.y0 + ((c >> 1) & 1),
+        row.z0 + (c >> 2), row.seed, xGradient, yGradient, zGradient);
+      cube.xGradient[c] = xGradient;
+      cube.yTerm[c] = yGradient * ((c & 2)? row.dy1: row.dy0);
+      cube.zTerm[c] = zGradient * ((c & 4)? row.dz1: row.dz0);
+    }
+    cube.x0 = x0;
+  }
+
+  // Adds an octave at input values that all lie in the same cube.
+  void RowRunValuesScalar (const FractalParams& params, int curOctave,
+    double curPersistence, const RowOctave& row, const RowCube& cube,
+    const double* pNx, double* pValue, double* pWeight, int count)
+  {
+    for (int i = 0; i < count; i++) {
+      double dx0 = pNx[i] - (double)cube.x0;
+      double dx1 = pNx[i] - (double)(cube.x0 + 1);
+      double xs = ApplyQuality (dx0, params.noiseQuality);
+      double n[8];
+      for (int c = 0; c < 8; c++) {
+        n[c] = (((cube.xGradient[c] * ((c & 1)? dx1: dx0)) + cube.yTerm[c])
+          + cube.zTerm[c]) * 2.12;
+      }
+      double ix0, ix1, iy0, iy1;
+      ix0 = LinearInterp (n[0], n[1], xs);
+      ix1 = LinearInterp (n[2], n[3], xs);
+      iy0 = LinearInterp (ix0, ix1, row.ys);
+      ix0 = LinearInterp (n[4], n[5], xs);
+      ix1 = LinearInterp (n[6], n[7], xs);
+      iy1 = LinearInterp (ix0, ix1, row.ys);
+      double signal = LinearInterp (iy0, iy1, row.zs);
+      AddOctave (params, curOctave, curPersistence, signal, pValue[i],
+        pWeight[i]);
+    }
+  }
+
+  // Adds an octave at a row of input values without the row kernel.  The x
+  // coordinates are scaled but not yet mapped into the 32-bit range.
+  void RowGenericValuesScalar (const FractalParams& params, int curOctave,
+    double curPersistence, int seed, const double* pX, double ny, double nz,
+    double* pValue, double* pWeight, int count)
+  {
+    for (int i = 0; i < count; i++) {
+      double signal = GradientCoherentNoise3D (MakeInt32Range (pX[i]), ny, nz,
+        seed, params.noiseQuality);
+      AddOctave (params, curOctave, curPersistence, signal, pValue[i],
+        pWeight[i]);
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Fixed octave kernels
+  //
+  // Instantiations of the planar octave loop for one fractal type, octave
+  // count and noise quality.  The octave loop is unrolled by OctaveLoop,
+  // the quality and fractal type branches are resolved with if constexpr,
+  // and the seed and amplitude of each octave are computed once per block.
+  // They require the default lacunarity of 2.0: the octave scales are then
+  // exact powers of two, so scaling the input value of the first octave by
+  // OCTAVE_SCALES gives the same coordinates as the repeated multiplication
+  // of GetValue ().  An input value whose last octave stays within the
+  // range of MakeInt32Range () skips that function altogether.
+  //
+  // Only the y = 0 plane has kernels.  Off the plane, hashing the eight
+  // lattice points dominates, the kernels gained at most 1.1x and lost at
+  // three octaves, and they doubled the code the instantiations add.
+
+  // Most octaves for which fixed octave kernels are instantiated.
+  const int FIXED_OCTAVE_MAX = 8;
+
+  const double FIXED_OCTAVE_LACUNARITY = 2.0;
+
+  // Scale of the input value of each octave, relative to the first.
+  constexpr double OCTAVE_SCALES[FIXED_OCTAVE_MAX] = {
+    1.0, 2.0, 4.0, 8.0, 16.0, 32.0, 64.0, 128.0
+  };
+
+  // Spectral weight of each octave of a RidgedMulti module, pow (scale, -1).
+  constexpr double RIDGED_OCTAVE_WEIGHTS[FIXED_OCTAVE_MAX] = {
+    1.0, 0.5, 0.25, 0.125, 0.0625, 0.03125, 0.015625, 0.0078125
+  };
+
+  // Input values below this magnitude, after scaling by the frequency, stay
+  // within the range of MakeInt32Range () up to the last octave.
+  constexpr double FixedOctaveRange (int octaveCount)
+  {
+    return 1073741824.0 / OCTAVE_SCALES[octaveCount - 1];
+  }
+
+  // Per-block constants of a fixed octave kernel.
+  struct FixedOctaves
+  {
+    int seeds[FIXED_OCTAVE_MAX];
+    double amplitudes[FIXED_OCTAVE_MAX];
+  };
+
+  template <FractalType TYPE, int OCTAVE_COUNT>
+  FixedOctaves SetupFixedOctaves (const FractalParams& params)
+  {
+    FixedOctaves octaves;
+    double curPersistence = 1.0;
+    for (int curOctave = 0; curOctave < OCTAVE_COUNT; curOctave++) {
+      octaves.seeds[curOctave] = OctaveSeed (params, curOctave);
+      if constexpr (TYPE == FRACTAL_RIDGED) {
+        octaves.amplitudes[curOctave] = RIDGED_OCTAVE_WEIGHTS[curOctave];
+      } else {
+        octaves.amplitudes[curOctave] = curPersistence;
+      }
+      curPersistence *= params.persistence;
+    }
+    return octaves;
+  }
+
+  template <NoiseQuality QUALITY>
+  inline double ApplyQuality (double a)
+  {
+    if constexpr (QUALITY == QUALITY_STD) {
+      return SCurve3 (a);
+    } else if constexpr (QUALITY == QUALITY_BEST) {
+      return SCurve5 (a);
+    } else {
+      return a;
+    }
+  }
+
+  // GradientCoherentNoise2D () for a fixed noise quality.
+  template <NoiseQuality QUALITY>
+  double FixedCoherentNoise2D (double x, double z, int seed)
+  {
+    int x0 = LatticeCoord (x);
+    int z0 = LatticeCoord (z);
+    double xs = ApplyQuality<QUALITY> (x - (double)x0);
+    double zs = ApplyQuality<QUALITY> (z - (double)z0);
+
+    double n[4];
+    for (int c = 0; c < 4; c++) {
+      int ix = x0 + (c & 1);
+      int iz = z0 + (c >> 1);
+      double xGradient, zGradient;
+      LatticeGradient2D (ix, iz, seed, xGradient, zGradient);
+      n[c] = ((xGradient * (x - (double)ix)) + (zGradient * (z - (double)iz)))
+        * 2.12;
+    }
+    return LinearInterp (LinearInterp (n[0], n[1], xs),
+      LinearInterp (n[2], n[3], xs), zs);
+  }
+
+  // AddOctave () for a fixed fractal type; the amplitude is the persistence
+  // or the spectral weight of the octave.
+  template <FractalType TYPE>
+  inline void AddOctave (double amplitude, double signal, double& value,
+    double& weight)
+  {
+    if constexpr (TYPE == FRACTAL_PERLIN) {
+      value += signal * amplitude;
+    } else if constexpr (TYPE == FRACTAL_BILLOW) {
+      signal = 2.0 * fabs (signal) - 1.0;
+      value += signal * amplitude;
+    } else {
+      signal = 1.0 - fabs (signal);
+      signal *= signal;
+      signal *= weight;
+      weight = signal * 2.0;
+      if (weight > 1.0) {
+        weight = 1.0;
+      }
+      if (weight < 0.0) {
+        weight = 0.0;
+      }
+      value += signal * amplitude;
+    }
+  }
+
+  template <FractalType TYPE>
+  inline double FinishFractal (double value)
+  {
+    if constexpr (TYPE == FRACTAL_BILLOW) {
+      return value + 0.5;
+    } else if constexpr (TYPE == FRACTAL_RIDGED) {
+      return (value * 1.25) - 1.0;
+    } else {
+      return value;
+    }
+  }
+
+  // Evaluates octaves OCTAVE to OCTAVE_COUNT - 1 of one input value on the
+  // y = 0 plane, whose coordinates (x, z) are already scaled by the
+  // frequency.
+  template <FractalType TYPE, NoiseQuality QUALITY, int OCTAVE,
+    int OCTAVE_COUNT>
+  inline void OctaveLoop (const FixedOctaves& octaves, double x, double z,
+    bool isInRange, double& value, double& weight)
+  {
+    double nx = x * OCTAVE_SCALES[OCTAVE];
+    double nz = z * OCTAVE_SCALES[OCTAVE];
+    if (!isInRange) {
+      nx = MakeInt32Range (nx);
+      nz = MakeInt32Range (nz);
+    }
+    double signal = FixedCoherentNoise2D<QUALITY> (nx, nz,
+      octaves.seeds[OCTAVE]);
+    AddOctave<TYPE> (octaves.amplitudes[OCTAVE], signal, value, weight);
+    if constexpr (OCTAVE + 1 < OCTAVE_COUNT) {
+      OctaveLoop<TYPE, QUALITY, OCTAVE + 1, OCTAVE_COUNT> (octaves, x, z,
+        isInRange, value, weight);
+    }
+  }
+
+  // FractalValuesScalar () for a planar block, whose y coordinates are all
+  // zero.
+  template <FractalType TYPE, int OCTAVE_COUNT, NoiseQuality QUALITY>
+  void FixedFractalValuesScalar (const FractalParams& params,
+    const double* pX, const double* pZ, double* pDest, int count)
+  {
+    const FixedOctaves octaves = SetupFixedOctaves<TYPE, OCTAVE_COUNT> (
+      params);
+    const double range = FixedOctaveRange (OCTAVE_COUNT);
+    for (int i = 0; i < count; i++) {
+      double x = pX[i] * params.frequency;
+      double z = pZ[i] * params.frequency;
+      bool isInRange = fabs (x) < range && fabs (z) < range;
+      double value = 0.0;
+      double weight = 1.0;
+      OctaveLoop<TYPE, QUALITY, 0, OCTAVE_COUNT> (octaves, x, z, isInRange,
+        value, weight);
+      pDest[i] = FinishFractal<TYPE> (value);
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Voronoi kernel
+  //
+  // The seed point of the unit cube (xCur, yCur, zCur) lies in the range
+  // (xCur - 1, xCur + 1] along the x axis, and likewise along the other
+  // axes, so Voronoi::GetValue () visits the 5 x 5 x 5 cubes around the
+  // input value in order of z, y and x.  The kernels below visit the cubes
+  // of each axis nearest first and stop an axis as soon as the gap between
+  // the input value and the seed range of the next cube exceeds the nearest
+  // distance found so far.  The gaps are rounded the same way the distances
+  // are, so a skipped seed point is never nearer; ties go to the cube
+  // Voronoi::GetValue () visits first.
+
+  const int VORONOI_CUBE_COUNT = 5;
+
+  // Most cubes the seed point table of a block may hold.
+  const int VORONOI_TABLE_MAX_CUBES = 2048;
+
+  // Most cubes per input value for which a table is cheaper than hashing
+  // the seed points each input value visits.
+  const int VORONOI_TABLE_CUBES_PER_VALUE = 32;
+
+  // Cubes of one axis around an input value, nearest seed range first.
+  struct VoronoiAxis
+  {
+    int offset[VORONOI_CUBE_COUNT];
+    double gap[VORONOI_CUBE_COUNT];
+  };
+
+  // The seed point nearest to an input value so far.
+  struct VoronoiCandidate
+  {
+    double dist;
+    int order;
+    double x;
+    double y;
+    double z;
+  };
+
+  void SetupVoronoiAxis (double n, int nInt, VoronoiAxis& axis)
+  {
+    for (int i = 0; i < VORONOI_CUBE_COUNT; i++) {
+      int cur = nInt + i - 2;
+      double gap = std::max (0.0,
+        std::max ((double)(cur - 1) - n, n - (double)(cur + 1)));
+      gap *= gap;
+      int j = i;
+      while (j > 0 && axis.gap[j - 1] > gap) {
+        axis.offset[j] = axis.offset[j - 1];
+        axis.gap[j] = axis.gap[j - 1];
+        j--;
+      }
+      axis.offset[j] = i - 2;
+      axis.gap[j] = gap;
+    }
+  }
+
+  // Position of a cube in the visiting order of Voronoi::GetValue ().
+  inline int VoronoiOrder (int xOffset, int yOffset, int zOffset)
+  {
+    return ((zOffset + 2) * VORONOI_CUBE_COUNT + (yOffset + 2))
+      * VORONOI_CUBE_COUNT + (xOffset + 2);
+  }
+
+  inline void VisitSeedPoint (double xPos, double yPos, double zPos,
+    double x, double y, double z, int order, VoronoiCandidate& nearest)
+  {
+    double xDist = xPos - x;
+    double yDist = yPos - y;
+    double zDist = zPos - z;
+    double dist = xDist * xDist + yDist * yDist + zDist * zDist;
+    if (dist < nearest.dist
+      || (dist == nearest.dist && order < nearest.order)) {
+      nearest.dist = dist;
+      nearest.order = order;
+      nearest.x = xPos;
+      nearest.y = yPos;
+      nearest.z = zPos;
+    }
+  }
+
+  inline void ResetCandidate (VoronoiCandidate& nearest)
+  {
+    nearest.dist = 2147483647.0;
+    nearest.order = VORONOI_CUBE_COUNT * VORONOI_CUBE_COUNT
+      * VORONOI_CUBE_COUNT;
+    nearest.x = 0.0;
+    nearest.y = 0.0;
+    nearest.z = 0.0;
+  }
+
+  // Seed points hashed on demand, the way Voronoi::GetValue () does.
+  struct HashedSeedPoints
+  {
+    int seed;
+
+    void Get (int xCur, int yCur, int zCur, double& xPos, double& yPos,
+      double& zPos) const
+    {
+      xPos = xCur + ValueNoise3D (xCur, yCur, zCur, seed    );
+      yPos = yCur + ValueNoise3D (xCur, yCur, zCur, seed + 1);
+      zPos = zCur + ValueNoise3D (xCur, yCur, zCur, seed + 2);
+    }
+  };
+
+  // Seed points of every cube of a box, cached for a block of input values.
+  struct VoronoiTable
+  {
+    int x0;
+    int y0;
+    int z0;
+    int xSize;
+    int ySize;
+    int zSize;
+    double xPos[VORONOI_TABLE_MAX_CUBES];
+    double yPos[VORONOI_TABLE_MAX_CUBES];
+    double zPos[VORONOI_TABLE_MAX_CUBES];
+
+    int Index (int xCur, int yCur, int zCur) const
+    {
+      return ((zCur - z0) * ySize + (yCur - y0)) * xSize + (xCur - x0);
+    }
+
+    void Get (int xCur, int yCur, int zCur, double& xPosOut,
+      double& yPosOut, double& zPosOut) const
+    {
+      int index = Index (xCur, yCur, zCur);
+      xPosOut = xPos[index];
+      yPosOut = yPos[index];
+      zPosOut = zPos[index];
+    }
+  };
+
+  void FillVoronoiTableScalar (VoronoiTable& table, int seed)
+  {
+    HashedSeedPoints seedPoints = {seed};
+    int index = 0;
+    for (int zCur = table.z0; zCur < table.z0 + table.zSize; zCur++) {
+      for (int yCur = table.y0; yCur < table.y0 + table.ySize; yCur++) {
+        for (int xCur = table.x0; xCur < table.x0 + table.xSize; xCur++) {
+          seedPoints.Get (xCur, yCur, zCur, table.xPos[index],
+            table.yPos[index], table.zPos[index]);
+          index++;
+        }
+      }
+    }
+  }
+
+  // Finds the seed point nearest to the input value (x, y, z), whose unit
+  // cube is (xInt, yInt, zInt).
+  template <class SeedPoints>
+  void FindNearestSeedPoint (const SeedPoints& seedPoints, double x,
+    double y, double z, int xInt, int yInt, int zInt,
+    VoronoiCandidate& nearest)
+  {
+    VoronoiAxis xAxis;
+    VoronoiAxis yAxis;
+    VoronoiAxis zAxis;
+    SetupVoronoiAxis (x, xInt, xAxis);
+    SetupVoronoiAxis (y, yInt, yAxis);
+    SetupVoronoiAxis (z, zInt, zAxis);
+    ResetCandidate (nearest);
+
+    for (int k = 0; k < VORONOI_CUBE_COUNT; k++) {
+      double zGap = zAxis.gap[k];
+      if (zGap > nearest.dist) {
+        break;
+      }
+      int zCur = zInt + zAxis.offset[k];
+      for (int j = 0; j < VORONOI_CUBE_COUNT; j++) {
+        if (yAxis.gap[j] + zGap > nearest.dist) {
+          break;
+        }
+        int yCur = yInt + yAxis.offset[j];
+        for (int i = 0; i < VORONOI_CUBE_COUNT; i++) {
+          if (xAxis.gap[i] + yAxis.gap[j] + zGap > nearest.dist) {
+            break;
+          }
+          int xCur = xInt + xAxis.offset[i];
+          double xPos, yPos, zPos;
+          seedPoints.Get (xCur, yCur, zCur, xPos, yPos, zPos);
+          VisitSeedPoint (xPos, yPos, zPos, x, y, z,
+            VoronoiOrder (xAxis.offset[i], yAxis.offset[j], zAxis.offset[k]),
+            nearest);
+        }
+      }
+    }
+  }
+
+  // The output value of Voronoi::GetValue () for the nearest seed point.
+  // The distance is measured again, as Voronoi::GetValue () measures it:
+  // far from the origin no seed point may be nearer than the initial
+  // distance, and the candidate stays at the origin.
+  inline double VoronoiValue (const Voronoi& voronoi,
+    const VoronoiCandidate& nearest, double x, double y, double z)
+  {
+    double value = 0.0;
+    if (voronoi.IsDistanceEnabled ()) {
+      double xDist = nearest.x - x;
+      double yDist = nearest.y - y;
+      double zDist = nearest.z - z;
+      value = (sqrt (xDist * xDist + yDist * yDist + zDist * zDist))
+        * SQRT_3 - 1.0;
+    }
+    return value + (voronoi.GetDisplacement () * (double)ValueNoise3D (
+      (int)(floor (nearest.x)),
+      (int)(floor (nearest.y)),
+      (int)(floor (nearest.z))));
+  }
+
+#if NOISE_BATCH_AVX2
+
+  //////////////////////////////////////////////////////////////////////////
+  // AVX2 kernels
+  //
+  // Each kernel processes four input values per iteration and performs the
+  // same floating-point operations in the same order as the scalar code.
+  // FMA is deliberately not enabled so that no operations are fused.
+
+  bool IsAvx2Supported ()
+  {
+    static const bool isSupported = __builtin_cpu_supports ("avx2");
+    return isSupported;
+  }
+
+  // Loads up to four values, padding the missing lanes with zeros.
+  NOISE_TARGET_AVX2 inline __m256d LoadLanes (const double* pSource,
+    int laneCount)
+  {
+    if (laneCount == 4) {
+      return _mm256_loadu_pd (pSource);
+    }
+    double lanes[4] = {0.0, 0.0, 0.0, 0.0};
+    for (int i = 0; i < laneCount; i++) {
+      lanes[i] = pSource[i];
+    }
+    return _mm256_loadu_pd (lanes);
+  }
+
+  NOISE_TARGET_AVX2 inline void StoreLanes (double* pDest, __m256d value,
+    int laneCount)
+  {
+    if (laneCount == 4) {
+      _mm256_storeu_pd (pDest, value);
+      return;
+    }
+    double lanes[4];
+    _mm256_storeu_pd (lanes, value);
+    for (int i = 0; i < laneCount; i++) {
+      pDest[i] = lanes[i];
+    }
+  }
+
+  // Returns (x > 0.0? (int)x: (int)x - 1) as doubles.
+  NOISE_TARGET_AVX2 inline __m256d LatticeCoord (__m256d x)
+  {
+    __m256d truncated = _mm256_round_pd (x,
+      _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m256d notPositive = _mm256_cmp_pd (x, _mm256_setzero_pd (),
+      _CMP_NGT_UQ);
+    return _mm256_sub_pd (truncated,
+      _mm256_and_pd (notPositive, _mm256_set1_pd (1.0)));
+  }
+
+  // MakeInt32Range () for four values.  Values outside the range are rare,
+  // so they are handled by the scalar function.
+  NOISE_TARGET_AVX2 inline __m256d MakeInt32Range4 (__m256d n)
+  {
+    __m256d magnitude = _mm256_andnot_pd (_mm256_set1_pd (-0.0), n);
+    __m256d isOutside = _mm256_cmp_pd (magnitude,
+      _mm256_set1_pd (1073741824.0), _CMP_GE_OQ);
+    if (_mm256_movemask_pd (isOutside) == 0) {
+      return n;
+    }
+    double lanes[4];
+    _mm256_storeu_pd (lanes, n);
+    for (int i = 0; i < 4; i++) {
+      lanes[i] = MakeInt32Range (lanes[i]);
+    }
+    return _mm256_loadu_pd (lanes);
+  }
+
+  NOISE_TARGET_AVX2 inline __m256d LinearInterp4 (__m256d n0, __m256d n1,
+    __m256d a)
+  {
+    return _mm256_add_pd (
+      _mm256_mul_pd (_mm256_sub_pd (_mm256_set1_pd (1.0), a), n0),
+      _mm256_mul_pd (a, n1));
+  }
+
+  NOISE_TARGET_AVX2 inline __m256d SCurve3x4 (__m256d a)
+  {
+    __m256d b = _mm256_sub_pd (_mm256_set1_pd (3.0),
+      _mm256_mul_pd (_mm256_set1_pd (2.0), a));
+    return _mm256_mul_pd (_mm256_mul_pd (a, a), b);
+  }
+
+  NOISE_TARGET_AVX2 inline __m256d SCurve5x4 (__m256d a)
+  {
+    __m256d a3 = _mm256_mul_pd (_mm256_mul_pd (a, a), a);
+    __m256d a4 = _mm256_mul_pd (a3, a);
+    __m256d a5 = _mm256_mul_pd (a4, a);
+    return _mm256_add_pd (
+      _mm256_sub_pd (_mm256_mul_pd (_mm256_set1_pd (6.0), a5),
+        _mm256_mul_pd (_mm256_set1_pd (15.0), a4)),
+      _mm256_mul_pd (_mm256_set1_pd (10.0), a3));
+  }
+
+  NOISE_TARGET_AVX2 inline __m256d ApplyQuality (__m256d a,
+    NoiseQuality noiseQuality)
+  {
+    switch (noiseQuality) {
+      case QUALITY_FAST:
+        return a;
+      case QUALITY_STD:
+        return SCurve3x4 (a);
+      case QUALITY_BEST:
+        return SCurve5x4 (a);
+    }
+    return a;
+  }
+
+  template <NoiseQuality QUALITY>
+  NOISE_TARGET_AVX2 inline __m256d ApplyQuality (__m256d a)
+  {
+    if constexpr (QUALITY == QUALITY_STD) {
+      return SCurve3x4 (a);
+    } else if constexpr (QUALITY == QUALITY_BEST) {
+      return SCurve5x4 (a);
+    } else {
+      return a;
+    }
+  }
+
+  // GradientNoise3D () for four lattice points.  The hash terms of the
+  // lattice coordinates are passed in precomputed.
+  NOISE_TARGET_AVX2 inline __m256d GradientNoise4 (__m256d fx, __m256d fy,
+    __m256d fz, __m256d ix, __m256d iy, __m256d iz, __m128i xHash,
+    __m128i yHash, __m128i zHash, __m128i seedHash)
+  {
+    __m128i vectorIndex = _mm_add_epi32 (_mm_add_epi32 (xHash, yHash),
+      _mm_add_epi32 (zHash, seedHash));
+    vectorIndex = _mm_xor_si128 (vectorIndex,
+      _mm_srai_epi32 (vectorIndex, SHIFT_NOISE_GEN));
+    vectorIndex = _mm_and_si128 (vectorIndex, _mm_set1_epi32 (0xff));
+    vectorIndex = _mm_slli_epi32 (vectorIndex, 2);
+
+    // The masked form with every lane enabled; the plain form leaves its
+    // source operand undefined.
+    const __m256d zero = _mm256_setzero_pd ();
+    const __m256d allLanes = _mm256_castsi256_pd (_mm256_set1_epi64x (-1));
+
+    __m256d xvGradient = _mm256_mask_i32gather_pd (zero,
+      g_randomVectors, vectorIndex, allLanes, 8);
+    __m256d yvGradient = _mm256_mask_i32gather_pd (zero,
+      g_randomVectors + 1, vectorIndex, allLanes, 8);
+    __m256d zvGradient = _mm256_mask_i32gather_pd (zero,
+      g_randomVectors + 2, vectorIndex, allLanes, 8);
+
+    __m256d xvPoint = _mm256_sub_pd (fx, ix);
+    __m256d yvPoint = _mm256_sub_pd (fy, iy);
+    __m256d zvPoint = _mm256_sub_pd (fz, iz);
+
+    __m256d dot = _mm256_add_pd (
+      _mm256_add_pd (_mm256_mul_pd (xvGradient, xvPoint),
+        _mm256_mul_pd (yvGradient, yvPoint)),
+      _mm256_mul_pd (zvGradient, zvPoint));
+    return _mm256_mul_pd (dot, _mm256_set1_pd (2.12));
+  }
+
+  // GradientCoherentNoise3D () for four input values and a fixed noise
+  // quality.
+  template <NoiseQuality QUALITY>
+  NOISE_TARGET_AVX2 __m256d FixedCoherentNoise4 (__m256d x, __m256d y,
+    __m256d z, int seed)
+  {
+    const __m256d one = _mm256_set1_pd (1.0);
+    __m256d x0 = LatticeCoord (x);
+    __m256d y0 = LatticeCoord (y);
+    __m256d z0 = LatticeCoord (z);
+    __m256d x1 = _mm256_add_pd (x0, one);
+    __m256d y1 = _mm256_add_pd (y0, one);
+    __m256d z1 = _mm256_add_pd (z0, one);
+
+    __m256d xs = ApplyQuality<QUALITY> (_mm256_sub_pd (x, x0));
+    __m256d ys = ApplyQuality<QUALITY> (_mm256_sub_pd (y, y0));
+    __m256d zs = ApplyQuality<QUALITY> (_mm256_sub_pd (z, z0));
+
+    // Hash terms of both lattice coordinates on each axis.
+    __m128i xHash0 = _mm_mullo_epi32 (_mm256_cvttpd_epi32 (x0),
+      _mm_set1_epi32 (X_NOISE_GEN));
+    __m128i yHash0 = _mm_mullo_epi32 (_mm256_cvttpd_epi32 (y0),
+      _mm_set1_epi32 (Y_NOISE_GEN));
+    __m128i zHash0 = _mm_mullo_epi32 (_mm256_cvttpd_epi32 (z0),
+      _mm_set1_epi32 (Z_NOISE_GEN));
+    __m128i xHash1 = _mm_add_epi32 (xHash0, _mm_set1_epi32 (X_NOISE_GEN));
+    __m128i yHash1 = _mm_add_epi32 (yHash0, _mm_set1_epi32 (Y_NOISE_GEN));
+    __m128i zHash1 = _mm_add_epi32 (zHash0, _mm_set1_epi32 (Z_NOISE_GEN));
+    __m128i seedHash = _mm_set1_epi32 (
+      (int)((unsigned int)SEED_NOISE_GEN * (unsigned int)seed));
+
+    __m256d n0, n1, ix0, ix1, iy0, iy1;
+    n0  = GradientNoise4 (x, y, z, x0, y0, z0, xHash0, yHash0, zHash0,
+      seedHash);
+    n1  = GradientNoise4 (x, y, z, x1, y0, z0, xHash1, yHash0, zHash0,
+      seedHash);
+    ix0 = LinearInterp4 (n0, n1, xs);
+    n0  = GradientNoise4 (x, y, z, x0, y1, z0, xHash0, yHash1, zHash0,
+      seedHash);
+    n1  = GradientNoise4 (x, y, z, x1, y1, z0, xHash1, yHash1, zHash0,
+      seedHash);
+    ix1 = LinearInterp4 (n0, n1, xs);
+    iy0 = LinearInterp4 (ix0, ix1, ys);
+    n0  = GradientNoise4 (x, y, z, x0, y0, z1, xHash0, yHash0, zHash1,
+      seedHash);
+    n1  = GradientNoise4 (x, y, z, x1, y0, z1, xHash1, yHash0, zHash1,
+      seedHash);
+    ix0 = LinearInterp4 (n0, n1, xs);
+    n0  = GradientNoise4 (x, y, z, x0, y1, z1, xHash0, yHash1, zHash1,
+      seedHash);
+    n1  = GradientNoise4 (x, y, z, x1, y1, z1, xHash1, yHash1, zHash1,
+      seedHash);
+    ix1 = LinearInterp4 (n0, n1, xs);
+    iy1 = LinearInterp4 (ix0, ix1, ys);
+    return LinearInterp4 (iy0, iy1, zs);
+  }
+
+  // GradientCoherentNoise3D () for four input values.
+  NOISE_TARGET_AVX2 __m256d GradientCoherentNoise4 (__m256d x, __m256d y,
+    __m256d z, int seed, NoiseQuality noiseQuality)
+  {
+    switch (noiseQuality) {
+      case QUALITY_FAST:
+        return FixedCoherentNoise4<QUALITY_FAST> (x, y, z, seed);
+      case QUALITY_STD:
+        return FixedCoherentNoise4<QUALITY_STD> (x, y, z, seed);
+      case QUALITY_BEST:
+        return FixedCoherentNoise4<QUALITY_BEST> (x, y, z, seed);
+    }
+    return FixedCoherentNoise4<QUALITY_STD> (x, y, z, seed);
+  }
+
+  // GradientNoise2D () for four lattice points.
+  NOISE_TARGET_AVX2 inline __m256d GradientNoise2x4 (__m256d fx, __m256d fz,
+    __m256d ix, __m256d iz, __m128i xHash, __m128i zHash, __m128i seedHash)
+  {
+    __m128i vectorIndex = _mm_add_epi32 (_mm_add_epi32 (xHash, zHash),
+      seedHash);
+    vectorIndex = _mm_xor_si128 (vectorIndex,
+      _mm_srai_epi32 (vectorIndex, SHIFT_NOISE_GEN));
+    vectorIndex = _mm_and_si128 (vectorIndex, _mm_set1_epi32 (0xff));
+    vectorIndex = _mm_slli_epi32 (vectorIndex, 2);
+
+    const __m256d zero = _mm256_setzero_pd ();
+    const __m256d allLanes = _mm256_castsi256_pd (_mm256_set1_epi64x (-1));
+
+    __m256d xvGradient = _mm256_mask_i32gather_pd (zero,
+      g_randomVectors, vectorIndex, allLanes, 8);
+    __m256d zvGradient = _mm256_mask_i32gather_pd (zero,
+      g_randomVectors + 2, vectorIndex, allLanes, 8);
+
+    __m256d xvPoint = _mm256_sub_pd (fx, ix);
+    __m256d zvPoint = _mm256_sub_pd (fz, iz);
+
+    __m256d dot = _mm256_add_pd (_mm256_mul_pd (xvGradient, xvPoint),
+      _mm256_mul_pd (zvGradient, zvPoint));
+    return _mm256_mul_pd (dot, _mm256_set1_pd (2.12));
+  }
+
+  // GradientCoherentNoise2D () for four input values and a fixed noise
+  // quality.
+  template <NoiseQuality QUALITY>
+  NOISE_TARGET_AVX2 __m256d FixedCoherentNoise2x4 (__m256d x, __m256d z,
+    int seed)
+  {
+    const __m256d one = _mm256_set1_pd (1.0);
+    __m256d x0 = LatticeCoord (x);
+    __m256d z0 = LatticeCoord (z);
+    __m256d x1 = _mm256_add_pd (x0, one);
+    __m256d z1 = _mm256_add_pd (z0, one);
+
+    __m256d xs = ApplyQuality<QUALITY> (_mm256_sub_pd (x, x0));
+    __m256d zs = ApplyQuality<QUALITY> (_mm256_sub_pd (z, z0));
+
+    __m128i xHash0 = _mm_mullo_epi32 (_mm256_cvttpd_epi32 (x0),
+      _mm_set1_epi32 (X_NOISE_GEN));
+    __m128i zHash0 = _mm_mullo_epi32 (_mm256_cvttpd_epi32 (z0),
+      _mm_set1_epi32 (Z_NOISE_GEN));
+    __m128i xHash1 = _mm_add_epi32 (xHash0, _mm_set1_epi32 (X_NOISE_GEN));
+    __m128i zHash1 = _mm_add_epi32 (zHash0, _mm_set1_epi32 (Z_NOISE_GEN));
+    __m128i seedHash = _mm_set1_epi32 (
+      (int)((unsigned int)SEED_NOISE_GEN * (unsigned int)seed));
+
+    __m256d n0, n1, ix0, ix1;
+    n0  = GradientNoise2x4 (x, z, x0, z0, xHash0, zHash0, seedHash);
+    n1  = GradientNoise2x4 (x, z, x1, z0, xHash1, zHash0, seedHash);
+    ix0 = LinearInterp4 (n0, n1, xs);
+    n0  = GradientNoise2x4 (x, z, x0, z1, xHash0, zHash1, seedHash);
+    n1  = GradientNoise2x4 (x, z, x1, z1, xHash1, zHash1, seedHash);
+    ix1 = LinearInterp4 (n0, n1, xs);
+    return LinearInterp4 (ix0, ix1, zs);
+  }
+
+  // GradientCoherentNoise2D () for four input values.
+  NOISE_TARGET_AVX2 __m256d GradientCoherentNoise2x4 (__m256d x, __m256d z,
+    int seed, NoiseQuality noiseQuality)
+  {
+    switch (noiseQuality) {
+      case QUALITY_FAST:
+        return FixedCoherentNoise2x4<QUALITY_FAST> (x, z, seed);
+      case QUALITY_STD:
+        return FixedCoherentNoise2x4<QUALITY_STD> (x, z, seed);
+      case QUALITY_BEST:
+        return FixedCoherentNoise2x4<QUALITY_BEST> (x, z, seed);
+    }
+    return FixedCoherentNoise2x4<QUALITY_STD> (x, z, seed);
+  }
+
+  // AddOctave () for four input values.
+  NOISE_TARGET_AVX2 inline void AddOctave4 (const FractalParams& params,
+    int curOctave, double curPersistence, __m256d signal, __m256d& value,
+    __m256d& weight)
+  {
+    const __m256d signMask = _mm256_set1_pd (-0.0);
+    const __m256d zero = _mm256_setzero_pd ();
+    const __m256d one = _mm256_set1_pd (1.0);
+    const __m256d two = _mm256_set1_pd (2.0);
+    switch (params.type) {
+      case FRACTAL_PERLIN:
+        value = _mm256_add_pd (value,
+          _mm256_mul_pd (signal, _mm256_set1_pd (curPersistence)));
+        break;
+      case FRACTAL_BILLOW:
+        signal = _mm256_sub_pd (
+          _mm256_mul_pd (two, _mm256_andnot_pd (signMask, signal)), one);
+        value = _mm256_add_pd (value,
+          _mm256_mul_pd (signal, _mm256_set1_pd (curPersistence)));
+        break;
+      case FRACTAL_RIDGED:
+        signal = _mm256_sub_pd (one, _mm256_andnot_pd (signMask, signal));
+        signal = _mm256_mul_pd (signal, signal);
+        signal = _mm256_mul_pd (signal, weight);
+        weight = _mm256_mul_pd (signal, two);
+        weight = _mm256_max_pd (_mm256_min_pd (weight, one), zero);
+        value = _mm256_add_pd (value, _mm256_mul_pd (signal,
+          _mm256_set1_pd (params.spectralWeights[curOctave])));
+        break;
+    }
+  }
+
+  // GridOctaveValuesScalar () four columns at a time.
+  NOISE_TARGET_AVX2 void GridOctaveValuesAvx2 (const FractalParams& params,
+    int curOctave, double curPersistence, const GridOctave& octave,
+    const GridRow& row, double* pValue, double* pWeight, int count)
+  {
+    const __m256d dz0 = _mm256_set1_pd (row.dz0);
+    const __m256d dz1 = _mm256_set1_pd (row.dz1);
+    const __m256d zs = _mm256_set1_pd (row.zs);
+    const __m256d scale = _mm256_set1_pd (2.12);
+    for (int i = 0; i < count; i += 4) {
+      int laneCount = std::min (4, count - i);
+      __m256d dx0 = LoadLanes (octave.dx0 + i, laneCount);
+      __m256d dx1 = LoadLanes (octave.dx1 + i, laneCount);
+      __m256d xs = LoadLanes (octave.xs + i, laneCount);
+      __m256d n0, n1, ix0, ix1;
+      n0  = _mm256_mul_pd (_mm256_add_pd (
+        _mm256_mul_pd (LoadLanes (octave.xGradient00 + i, laneCount), dx0),
+        _mm256_mul_pd (LoadLanes (octave.zGradient00 + i, laneCount), dz0)),
+        scale);
+      n1  = _mm256_mul_pd (_mm256_add_pd (
+        _mm256_mul_pd (LoadLanes (octave.xGradient10 + i, laneCount), dx1),
+        _mm256_mul_pd (LoadLanes (octave.zGradient10 + i, laneCount), dz0)),
+        scale);
+      ix0 = LinearInterp4 (n0, n1, xs);
+      n0  = _mm256_mul_pd (_mm256_add_pd (
+        _mm256_mul_pd (LoadLanes (octave.xGradient01 + i, laneCount), dx0),
+        _mm256_mul_pd (LoadLanes (octave.zGradient01 + i, laneCount), dz1)),
+        scale);
+      n1  = _mm256_mul_pd (_mm256_add_pd (
+        _mm256_mul_pd (LoadLanes (octave.xGradient11 + i, laneCount), dx1),
+        _mm256_mul_pd (LoadLanes (octave.zGradient11 + i, laneCount), dz1)),
+        scale);
+      ix1 = LinearInterp4 (n0, n1, xs);
+      __m256d signal = LinearInterp4 (ix0, ix1, zs);
+      __m256d value = LoadLanes (pValue + i, laneCount);
+      __m256d weight = LoadLanes (pWeight + i, laneCount);
+      AddOctave4 (params, curOctave, curPersistence, signal, value, weight);
+      StoreLanes (pValue + i, value, laneCount);
+      StoreLanes (pWeight + i, weight, laneCount);
+    }
+  }
+
+  // AddOctaveDeriv () for four input values.
+  NOISE_TARGET_AVX2 inline void AddOctaveDeriv4 (const FractalParams& params,
+    int curOctave, double curPersistence, __m256d signal, __m256d signalDX,
+    __m256d signalDZ, __m256d& value, __m256d& valueDX, __m256d& valueDZ,
+    __m256d& weight, __m256d& weightDX, __m256d& weightDZ)
+  {
+    const __m256d signMask = _mm256_set1_pd (-0.0);
+    const __m256d zero = _mm256_setzero_pd ();
+    const __m256d one = _mm256_set1_pd (1.0);
+    const __m256d two = _mm256_set1_pd (2.0);
+    const __m256d persistence = _mm256_set1_pd (curPersistence);
+    __m256d sign = _mm256_blendv_pd (one, _mm256_set1_pd (-1.0),
+      _mm256_cmp_pd (signal, zero, _CMP_LT_OQ));
+    switch (params.type) {
+      case FRACTAL_PERLIN:
+        value = _mm256_add_pd (value, _mm256_mul_pd (signal, persistence));
+        valueDX = _mm256_add_pd (valueDX,
+          _mm256_mul_pd (signalDX, persistence));
+        valueDZ = _mm256_add_pd (valueDZ,
+          _mm256_mul_pd (signalDZ, persistence));
+        break;
+      case FRACTAL_BILLOW: {
+        signal = _mm256_sub_pd (
+          _mm256_mul_pd (two, _mm256_andnot_pd (signMask, signal)), one);
+        __m256d twoSign = _mm256_mul_pd (two, sign);
+        value = _mm256_add_pd (value, _mm256_mul_pd (signal, persistence));
+        valueDX = _mm256_add_pd (valueDX, _mm256_mul_pd (
+          _mm256_mul_pd (twoSign, signalDX), persistence));
+        valueDZ = _mm256_add_pd (valueDZ, _mm256_mul_pd (
+          _mm256_mul_pd (twoSign, signalDZ), persistence));
+        break;
+      }
+      case FRACTAL_RIDGED: {
+        __m256d ridge = _mm256_sub_pd (one,
+          _mm256_andnot_pd (signMask, signal));
+        __m256d ridgeDX = _mm256_mul_pd (_mm256_xor_pd (sign, signMask),
+          signalDX);
+        __m256d ridgeDZ = _mm256_mul_pd (_mm256_xor_pd (sign, signMask),
+          signalDZ);
+        __m256d ridge2 = _mm256_mul_pd (ridge, ridge);
+        __m256d twoRidge = _mm256_mul_pd (two, ridge);
+        signal = _mm256_mul_pd (ridge2, weight);
+        signalDX = _mm256_add_pd (
+          _mm256_mul_pd (_mm256_mul_pd (twoRidge, ridgeDX), weight),
+          _mm256_mul_pd (ridge2, weightDX));
+        signalDZ = _mm256_add_pd (
+          _mm256_mul_pd (_mm256_mul_pd (twoRidge, ridgeDZ), weight),
+          _mm256_mul_pd (ridge2, weightDZ));
+        weight = _mm256_mul_pd (signal, two);
+
+        // A clamped weight is constant.
+        __m256d clamped = _mm256_or_pd (
+          _mm256_cmp_pd (weight, one, _CMP_GT_OQ),
+          _mm256_cmp_pd (weight, zero, _CMP_LT_OQ));
+        weightDX = _mm256_andnot_pd (clamped, _mm256_mul_pd (signalDX, two));
+        weightDZ = _mm256_andnot_pd (clamped, _mm256_mul_pd (signalDZ, two));
+        weight = _mm256_max_pd (_mm256_min_pd (weight, one), zero);
+        __m256d spectralWeight =
+          _mm256_set1_pd (params.spectralWeights[curOctave]);
+        value = _mm256_add_pd (value, _mm256_mul_pd (signal, spectralWeight));
+        valueDX = _mm256_add_pd (valueDX,
+          _mm256_mul_pd (signalDX, spectralWeight));
+        valueDZ = _mm256_add_pd (valueDZ,
+          _mm256_mul_pd (signalDZ, spectralWeight));
+        break;
+      }
+    }
+  }
+
+  // GridOctaveDerivsScalar () four columns at a time.
+  NOISE_TARGET_AVX2 void GridOctaveDerivsAvx2 (const FractalParams& params,
+    int curOctave, double curPersistence, double octaveScale,
+    const GridOctave& octave, const GridRow& row, const GridDerivs& derivs,
+    int count)
+  {
+    const __m256d dz0 = _mm256_set1_pd (row.dz0);
+    const __m256d dz1 = _mm256_set1_pd (row.dz1);
+    const __m256d zs = _mm256_set1_pd (row.zs);
+    const __m256d zsDeriv = _mm256_set1_pd (row.zsDeriv);
+    const __m256d scale = _mm256_set1_pd (2.12);
+    const __m256d lattice = _mm256_set1_pd (octaveScale);
+    for (int i = 0; i < count; i += 4) {
+      int laneCount = std::min (4, count - i);
+      __m256d dx0 = LoadLanes (octave.dx0 + i, laneCount);
+      __m256d dx1 = LoadLanes (octave.dx1 + i, laneCount);
+      __m256d xs = LoadLanes (octave.xs + i, laneCount);
+      __m256d xsDeriv = LoadLanes (octave.xsDeriv + i, laneCount);
+      __m256d gx00 = _mm256_mul_pd (
+        LoadLanes (octave.xGradient00 + i, laneCount), scale);
+      __m256d gz00 = _mm256_mul_pd (
+        LoadLanes (octave.zGradient00 + i, laneCount), scale);
+      __m256d gx10 = _mm256_mul_pd (
+        LoadLanes (octave.xGradient10 + i, laneCount), scale);
+      __m256d gz10 = _mm256_mul_pd (
+        LoadLanes (octave.zGradient10 + i, laneCount), scale);
+      __m256d gx01 = _mm256_mul_pd (
+        LoadLanes (octave.xGradient01 + i, laneCount), scale);
+      __m256d gz01 = _mm256_mul_pd (
+        LoadLanes (octave.zGradient01 + i, laneCount), scale);
+      __m256d gx11 = _mm256_mul_pd (
+        LoadLanes (octave.xGradient11 + i, laneCount), scale);
+      __m256d gz11 = _mm256_mul_pd (
+        LoadLanes (octave.zGradient11 + i, laneCount), scale);
+
+      // The corner values scale the dot products by 2.12 like
+      // GridOctaveValuesAvx2 () does, so the signal is the same.
+      __m256d n00 = _mm256_mul_pd (_mm256_add_pd (
+        _mm256_mul_pd (LoadLanes (octave.xGradient00 + i, laneCount), dx0),
+        _mm256_mul_pd (LoadLanes (octave.zGradient00 + i, laneCount), dz0)),
+        scale);
+      __m256d n10 = _mm256_mul_pd (_mm256_add_pd (
+        _mm256_mul_pd (LoadLanes (octave.xGradient10 + i, laneCount), dx1),
+        _mm256_mul_pd (LoadLanes (octave.zGradient10 + i, laneCount), dz0)),
+        scale);
+      __m256d n01 = _mm256_mul_pd (_mm256_add_pd (
+        _mm256_mul_pd (LoadLanes (octave.xGradient01 + i, laneCount), dx0),
+        _mm256_mul_pd (LoadLanes (octave.zGradient01 + i, laneCount), dz1)),
+        scale);
+      __m256d n11 = _mm256_mul_pd (_mm256_add_pd (
+        _mm256_mul_pd (LoadLanes (octave.xGradient11 + i, laneCount), dx1),
+        _mm256_mul_pd (LoadLanes (octave.zGradient11 + i, laneCount), dz1)),
+        scale);
+      __m256d ix0 = LinearInterp4 (n00, n10, xs);
+      __m256d ix1 = LinearInterp4 (n01, n11, xs);
+      __m256d signal = LinearInterp4 (ix0, ix1, zs);
+
+      __m256d ix0DX = _mm256_add_pd (LinearInterp4 (gx00, gx10, xs),
+        _mm256_mul_pd (xsDeriv, _mm256_sub_pd (n10, n00)));
+      __m256d ix0DZ = LinearInterp4 (gz00, gz10, xs);
+      __m256d ix1DX = _mm256_add_pd (LinearInterp4 (gx01, gx11, xs),
+        _mm256_mul_pd (xsDeriv, _mm256_sub_pd (n11, n01)));
+      __m256d ix1DZ = LinearInterp4 (gz01, gz11, xs);
+      __m256d signalDX = _mm256_mul_pd (LinearInterp4 (ix0DX, ix1DX, zs),
+        lattice);
+      __m256d signalDZ = _mm256_mul_pd (_mm256_add_pd (
+        LinearInterp4 (ix0DZ, ix1DZ, zs),
+        _mm256_mul_pd (zsDeriv, _mm256_sub_pd (ix1, ix0))), lattice);
+
+      __m256d value = LoadLanes (derivs.pValue + i, laneCount);
+      __m256d valueDX = LoadLanes (derivs.pValueDX + i, laneCount);
+      __m256d valueDZ = LoadLanes (derivs.pValueDZ + i, laneCount);
+      __m256d weight = LoadLanes (derivs.pWeight + i, laneCount);
+      __m256d weightDX = LoadLanes (derivs.pWeightDX + i, laneCount);
+      __m256d weightDZ = LoadLanes (derivs.pWeightDZ + i, laneCount);
+      AddOctaveDeriv4 (params, curOctave, curPersistence, signal, signalDX,
+        signalDZ, value, valueDX, valueDZ, weight, weightDX, weightDZ);
+      StoreLanes (derivs.pValue + i, value, laneCount);
+      StoreLanes (derivs.pValueDX + i, valueDX, laneCount);
+      StoreLanes (derivs.pValueDZ + i, valueDZ, laneCount);
+      StoreLanes (derivs.pWeight + i, weight, laneCount);
+      StoreLanes (derivs.pWeightDX + i, weightDX, laneCount);
+      StoreLanes (derivs.pWeightDZ + i, weightDZ, laneCount);
+    }
+  }
+
+  // RowRunValuesScalar () four input values at a time.
+  NOISE_TARGET_AVX2 void RowRunValuesAvx2 (const FractalParams& params,
+    int curOctave, double curPersistence, const RowOctave& row,
+    const RowCube& cube, const double* pNx, double* pValue, double* pWeight,
+    int count)
+  {
+    const __m256d x0 = _mm256_set1_pd ((double)cube.x0);
+    const __m256d x1 = _mm256_set1_pd ((double)(cube.x0 + 1));
+    const __m256d ys = _mm256_set1_pd (row.ys);
+    const __m256d zs = _mm256_set1_pd (row.zs);
+    const __m256d scale = _mm256_set1_pd (2.12);
+    for (int i = 0; i < count; i += 4) {
+      int laneCount = std::min (4, count - i);
+      __m256d nx = LoadLanes (pNx + i, laneCount);
+      __m256d dx0 = _mm256_sub_pd (nx, x0);
+      __m256d dx1 = _mm256_sub_pd (nx, x1);
+      __m256d xs = ApplyQuality (dx0, params.noiseQuality);
+      __m256d n[8];
+      for (int c = 0; c < 8; c++) {
+        n[c] = _mm256_mul_pd (_mm256_add_pd (_mm256_add_pd (
+          _mm256_mul_pd (_mm256_set1_pd (cube.xGradient[c]),
+            (c & 1)? dx1: dx0),
+          _mm256_set1_pd (cube.yTerm[c])),
+          _mm256_set1_pd (cube.zTerm[c])), scale);
+      }
+      __m256d ix0, ix1, iy0, iy1;
+      ix0 = LinearInterp4 (n[0], n[1], xs);
+      ix1 = LinearInterp4 (n[2], n[3], xs);
+      iy0 = LinearInterp4 (ix0, ix1, ys);
+      ix0 = LinearInterp4 (n[4], n[5], xs);
+      ix1 = LinearInterp4 (n[6], n[7], xs);
+      iy1 = LinearInterp4 (ix0, ix1, ys);
+      __m256d signal = LinearInterp4 (iy0, iy1, zs);
+      __m256d value = LoadLanes (pValue + i, laneCount);
+      __m256d weight = LoadLanes (pWeight + i, laneCount);
+      AddOctave4 (params, curOctave, curPersistence, signal, value, weight);
+      StoreLanes (pValue + i, value, laneCount);
+      StoreLanes (pWeight + i, weight, laneCount);
+    }
+  }
+
+  // RowGenericValuesScalar () four input values at a time.
+  NOISE_TARGET_AVX2 void RowGenericValuesAvx2 (const FractalParams& params,
+    int curOctave, double curPersistence, int seed, const double* pX,
+    double ny, double nz, double* pValue, double* pWeight, int count)
+  {
+    const __m256d y = _mm256_set1_pd (ny);
+    const __m256d z = _mm256_set1_pd (nz);
+    for (int i = 0; i < count; i += 4) {
+      int laneCount = std::min (4, count - i);
+      __m256d signal = GradientCoherentNoise4 (
+        MakeInt32Range4 (LoadLanes (pX + i, laneCount)), y, z, seed,
+        params.noiseQuality);
+      __m256d value = LoadLanes (pValue + i, laneCount);
+      __m256d weight = LoadLanes (pWeight + i, laneCount);
+      AddOctave4 (params, curOctave, curPersistence, signal, value, weight);
+      StoreLanes (pValue + i, value, laneCount);
+      StoreLanes (pWeight + i, weight, laneCount);
+    }
+  }
+
+  NOISE_TARGET_AVX2 void FractalValuesAvx2 (const FractalParams& params,
+    const double* pX, const double* pY, const double* pZ, double* pDest,
+    int count, bool isPlanar)
+  {
+    const __m256d frequency = _mm256_set1_pd (params.frequency);
+    const __m256d lacunarity = _mm256_set1_pd (params.lacunarity);
+    const __m256d zero = _mm256_setzero_pd ();
+    const __m256d one = _mm256_set1_pd (1.0);
+
+    for (int i = 0; i < count; i += 4) {
+      int laneCount = std::min (4, count - i);
+      __m256d x = _mm256_mul_pd (LoadLanes (pX + i, laneCount), frequency);
+      __m256d y = _mm256_mul_pd (LoadLanes (pY + i, laneCount), frequency);
+      __m256d z = _mm256_mul_pd (LoadLanes (pZ + i, laneCount), frequency);
+      __m256d value = zero;
+      __m256d weight = one;
+      double curPersistence = 1.0;
+
+      for (int curOctave = 0; curOctave < params.octaveCount; curOctave++) {
+        __m256d nx = MakeInt32Range4 (x);
+        __m256d ny = MakeInt32Range4 (y);
+        __m256d nz = MakeInt32Range4 (z);
+        int seed = OctaveSeed (params, curOctave);
+        __m256d signal = isPlanar?
+          GradientCoherentNoise2x4 (nx, nz, seed, params.noiseQuality):
+          GradientCoherentNoise4 (nx, ny, nz, seed, params.noiseQuality);
+        AddOctave4 (params, curOctave, curPersistence, signal, value,
+          weight);
+        x = _mm256_mul_pd (x, lacunarity);
+        y = _mm256_mul_pd (y, lacunarity);
+        z = _mm256_mul_pd (z, lacunarity);
+        curPersistence *= params.persistence;
+      }
+
+      if (params.type == FRACTAL_BILLOW) {
+        value = _mm256_add_pd (value, _mm256_set1_pd (0.5));
+      } else if (params.type == FRACTAL_RIDGED) {
+        value = _mm256_sub_pd (_mm256_mul_pd (value, _mm256_set1_pd (1.25)),
+          one);
+      }
+      StoreLanes (pDest + i, value, laneCount);
+    }
+  }
+
+  // Returns the low 32 bits of four integral values whose magnitudes are
+  // below 2^51.  Adding 2^52 + 2^51 moves the integer into the low bits of
+  // the mantissa, in two's complement.
+  NOISE_TARGET_AVX2 inline __m128i LowBits4 (__m256d n)
+  {
+    __m256i bits = _mm256_castpd_si256 (
+      _mm256_add_pd (n, _mm256_set1_pd (6755399441055744.0)));
+    bits = _mm256_permutevar8x32_epi32 (bits,
+      _mm256_setr_epi32 (0, 2, 4, 6, 0, 2, 4, 6));
+    return _mm256_castsi256_si128 (bits);
+  }
+
+  // Adds the hash terms of the steps (zero or one) of four simplex corners
+  // along the axes to the hash of the first corner.
+  NOISE_TARGET_AVX2 inline __m128i SimplexCornerHash4 (__m128i hash,
+    __m256d xStep, __m256d yStep, __m256d zStep)
+  {
+    return _mm_add_epi32 (hash, _mm_add_epi32 (_mm_add_epi32 (
+      _mm_mullo_epi32 (_mm256_cvttpd_epi32 (xStep),
+        _mm_set1_epi32 (X_NOISE_GEN)),
+      _mm_mullo_epi32 (_mm256_cvttpd_epi32 (yStep),
+        _mm_set1_epi32 (Y_NOISE_GEN))),
+      _mm_mullo_epi32 (_mm256_cvttpd_epi32 (zStep),
+        _mm_set1_epi32 (Z_NOISE_GEN))));
+  }
+
+  // The contribution of four simplex corners with the given lattice hashes,
+  // at the given offsets from the corners (Contribution () of simplex.cpp).
+  NOISE_TARGET_AVX2 inline __m256d SimplexCorner4 (__m128i hash, __m256d px,
+    __m256d py, __m256d pz)
+  {
+    __m128i vectorIndex = _mm_xor_si128 (hash,
+      _mm_srli_epi32 (hash, SHIFT_NOISE_GEN));
+    vectorIndex = _mm_and_si128 (vectorIndex, _mm_set1_epi32 (0xff));
+    vectorIndex = _mm_slli_epi32 (vectorIndex, 2);
+
+    const __m256d zero = _mm256_setzero_pd ();
+    const __m256d allLanes = _mm256_castsi256_pd (_mm256_set1_epi64x (-1));
+    __m256d xvGradient = _mm256_mask_i32gather_pd (zero,
+      g_randomVectors, vectorIndex, allLanes, 8);
+    __m256d yvGradient = _mm256_mask_i32gather_pd (zero,
+      g_randomVectors + 1, vectorIndex, allLanes, 8);
+    __m256d zvGradient = _mm256_mask_i32gather_pd (zero,
+      g_randomVectors + 2, vectorIndex, allLanes, 8);
+    __m256d product = _mm256_add_pd (
+      _mm256_add_pd (_mm256_mul_pd (xvGradient, px),
+        _mm256_mul_pd (yvGradient, py)),
+      _mm256_mul_pd (zvGradient, pz));
+
+    const __m256d half = _mm256_set1_pd (0.5);
+    __m256d t = _mm256_sub_pd (_mm256_sub_pd (
+      _mm256_sub_pd (half, _mm256_mul_pd (px, px)), _mm256_mul_pd (py, py)),
+      _mm256_mul_pd (pz, pz));
+    t = _mm256_mul_pd (half,
+      _mm256_add_pd (t, _mm256_andnot_pd (_mm256_set1_pd (-0.0), t)));
+    t = _mm256_mul_pd (t, t);
+    return _mm256_mul_pd (_mm256_mul_pd (t, t), product);
+  }
+
+  // SimplexNoise3D () of simplex.cpp for four input values.
+  NOISE_TARGET_AVX2 __m256d SimplexNoise3Dx4 (__m256d x, __m256d y, __m256d z,
+    int seed)
+  {
+    const __m256d one = _mm256_set1_pd (1.0);
+    const __m256d unskew = _mm256_set1_pd (SIMPLEX_UNSKEW_3D);
+    __m256d s = _mm256_mul_pd (_mm256_add_pd (_mm256_add_pd (x, y), z),
+      _mm256_set1_pd (SIMPLEX_SKEW_3D));
+    __m256d i = _mm256_floor_pd (_mm256_add_pd (x, s));
+    __m256d j = _mm256_floor_pd (_mm256_add_pd (y, s));
+    __m256d k = _mm256_floor_pd (_mm256_add_pd (z, s));
+    __m256d t = _mm256_mul_pd (_mm256_add_pd (_mm256_add_pd (i, j), k),
+      unskew);
+    __m256d x0 = _mm256_sub_pd (x, _mm256_sub_pd (i, t));
+    __m256d y0 = _mm256_sub_pd (y, _mm256_sub_pd (j, t));
+    __m256d z0 = _mm256_sub_pd (z, _mm256_sub_pd (k, t));
+
+    // The steps of the second and third corners, as ones and zeros.
+    __m256d xy = _mm256_cmp_pd (x0, y0, _CMP_GE_OQ);
+    __m256d xz = _mm256_cmp_pd (x0, z0, _CMP_GE_OQ);
+    __m256d yz = _mm256_cmp_pd (y0, z0, _CMP_GE_OQ);
+    __m256d i1 = _mm256_and_pd (_mm256_and_pd (xy, xz), one);
+    __m256d j1 = _mm256_and_pd (_mm256_andnot_pd (xy, yz), one);
+    __m256d k1 = _mm256_andnot_pd (_mm256_or_pd (xz, yz), one);
+    __m256d i2 = _mm256_and_pd (_mm256_or_pd (xy, xz), one);
+    __m256d j2 = _mm256_andnot_pd (_mm256_andnot_pd (yz, xy), one);
+    __m256d k2 = _mm256_andnot_pd (_mm256_and_pd (xz, yz), one);
+
+    __m256d offset1 = unskew;
+    __m256d offset2 = _mm256_set1_pd (2.0 * SIMPLEX_UNSKEW_3D);
+    __m256d offset3 = _mm256_set1_pd (3.0 * SIMPLEX_UNSKEW_3D);
+    __m256d x3 = _mm256_add_pd (_mm256_sub_pd (x0, one), offset3);
+    __m256d y3 = _mm256_add_pd (_mm256_sub_pd (y0, one), offset3);
+    __m256d z3 = _mm256_add_pd (_mm256_sub_pd (z0, one), offset3);
+
+    __m128i hash = _mm_add_epi32 (_mm_add_epi32 (
+      _mm_mullo_epi32 (LowBits4 (i), _mm_set1_epi32 (X_NOISE_GEN)),
+      _mm_mullo_epi32 (LowBits4 (j), _mm_set1_epi32 (Y_NOISE_GEN))),
+      _mm_add_epi32 (
+        _mm_mullo_epi32 (LowBits4 (k), _mm_set1_epi32 (Z_NOISE_GEN)),
+        _mm_set1_epi32 ((int)((unsigned int)SEED_NOISE_GEN
+          * (unsigned int)seed))));
+    __m128i hash3 = _mm_add_epi32 (hash,
+      _mm_set1_epi32 (X_NOISE_GEN + Y_NOISE_GEN + Z_NOISE_GEN));
+
+    __m256d n = _mm256_add_pd (_mm256_add_pd (_mm256_add_pd (
+      SimplexCorner4 (hash, x0, y0, z0),
+      SimplexCorner4 (SimplexCornerHash4 (hash, i1, j1, k1),
+        _mm256_add_pd (_mm256_sub_pd (x0, i1), offset1),
+        _mm256_add_pd (_mm256_sub_pd (y0, j1), offset1),
+        _mm256_add_pd (_mm256_sub_pd (z0, k1), offset1))),
+      SimplexCorner4 (SimplexCornerHash4 (hash, i2, j2, k2),
+        _mm256_add_pd (_mm256_sub_pd (x0, i2), offset2),
+        _mm256_add_pd (_mm256_sub_pd (y0, j2), offset2),
+        _mm256_add_pd (_mm256_sub_pd (z0, k2), offset2))),
+      SimplexCorner4 (hash3, x3, y3, z3));
+    return _mm256_mul_pd (n, _mm256_set1_pd (SIMPLEX_SCALE_3D));
+  }
+
+  // Simplex::GetValue () for four input values at a time.  Unlike Perlin,
+  // Simplex multiplies the input value by the scale of each octave.
+  NOISE_TARGET_AVX2 void SimplexValuesAvx2 (const FractalParams& params,
+    const double* pX, const double* pY, const double* pZ, double* pDest,
+    int count)
+  {
+    const __m256d zero = _mm256_setzero_pd ();
+    const __m256d one = _mm256_set1_pd (1.0);
+
+    for (int i = 0; i < count; i += 4) {
+      int laneCount = std::min (4, count - i);
+      __m256d x = LoadLanes (pX + i, laneCount);
+      __m256d y = LoadLanes (pY + i, laneCount);
+      __m256d z = LoadLanes (pZ + i, laneCount);
+      __m256d value = zero;
+      __m256d weight = one;
+      double curPersistence = 1.0;
+      double scale = params.frequency;
+
+      for (int curOctave = 0; curOctave < params.octaveCount; curOctave++) {
+        __m256d octaveScale = _mm256_set1_pd (scale);
+        __m256d signal = SimplexNoise3Dx4 (
+          MakeInt32Range4 (_mm256_mul_pd (x, octaveScale)),
+          MakeInt32Range4 (_mm256_mul_pd (y, octaveScale)),
+          MakeInt32Range4 (_mm256_mul_pd (z, octaveScale)),
+          OctaveSeed (params, curOctave));
+        AddOctave4 (params, curOctave, curPersistence, signal, value,
+          weight);
+        scale *= params.lacunarity;
+        curPersistence *= params.persistence;
+      }
+
+      if (params.type == FRACTAL_BILLOW) {
+        value = _mm256_add_pd (value, _mm256_set1_pd (0.5));
+      } else if (params.type == FRACTAL_RIDGED) {
+        value = _mm256_sub_pd (_mm256_mul_pd (value, _mm256_set1_pd (1.25)),
+          one);
+      }
+      StoreLanes (pDest + i, value, laneCount);
+    }
+  }
+
+  // AddOctave () for four input values and a fixed fractal type.
+  template <FractalType TYPE>
+  NOISE_TARGET_AVX2 inline void AddOctave4 (double amplitude, __m256d signal,
+    __m256d& value, __m256d& weight)
+  {
+    const __m256d signMask = _mm256_set1_pd (-0.0);
+    const __m256d one = _mm256_set1_pd (1.0);
+    const __m256d two = _mm256_set1_pd (2.0);
+    if constexpr (TYPE == FRACTAL_BILLOW) {
+      signal = _mm256_sub_pd (
+        _mm256_mul_pd (two, _mm256_andnot_pd (signMask, signal)), one);
+    } else if constexpr (TYPE == FRACTAL_RIDGED) {
+      signal = _mm256_sub_pd (one, _mm256_andnot_pd (signMask, signal));
+      signal = _mm256_mul_pd (signal, signal);
+      signal = _mm256_mul_pd (signal, weight);
+      weight = _mm256_mul_pd (signal, two);
+      weight = _mm256_max_pd (_mm256_min_pd (weight, one),
+        _mm256_setzero_pd ());
+    }
+    value = _mm256_add_pd (value,
+      _mm256_mul_pd (signal, _mm256_set1_pd (amplitude)));
+  }
+
+  // OctaveLoop () for four input values.
+  template <FractalType TYPE, NoiseQuality QUALITY, int OCTAVE,
+    int OCTAVE_COUNT>
+  NOISE_TARGET_AVX2 inline void OctaveLoop4 (const FixedOctaves& octaves,
+    __m256d x, __m256d z, bool isInRange, __m256d& value, __m256d& weight)
+  {
+    const __m256d scale = _mm256_set1_pd (OCTAVE_SCALES[OCTAVE]);
+    __m256d nx = _mm256_mul_pd (x, scale);
+    __m256d nz = _mm256_mul_pd (z, scale);
+    if (!isInRange) {
+      nx = MakeInt32Range4 (nx);
+      nz = MakeInt32Range4 (nz);
+    }
+    __m256d signal = FixedCoherentNoise2x4<QUALITY> (nx, nz,
+      octaves.seeds[OCTAVE]);
+    AddOctave4<TYPE> (octaves.amplitudes[OCTAVE], signal, value, weight);
+    if constexpr (OCTAVE + 1 < OCTAVE_COUNT) {
+      OctaveLoop4<TYPE, QUALITY, OCTAVE + 1, OCTAVE_COUNT> (octaves, x, z,
+        isInRange, value, weight);
+    }
+  }
+
+  // FixedFractalValuesScalar () four input values at a time.
+  template <FractalType TYPE, int OCTAVE_COUNT, NoiseQuality QUALITY>
+  NOISE_TARGET_AVX2 void FixedFractalValuesAvx2 (const FractalParams& params,
+    const double* pX, const double* pZ, double* pDest, int count)
+  {
+    const FixedOctaves octaves = SetupFixedOctaves<TYPE, OCTAVE_COUNT> (
+      params);
+    const __m256d frequency = _mm256_set1_pd (params.frequency);
+    const __m256d signMask = _mm256_set1_pd (-0.0);
+    const __m256d range = _mm256_set1_pd (FixedOctaveRange (OCTAVE_COUNT));
+    for (int i = 0; i < count; i += 4) {
+      int laneCount = std::min (4, count - i);
+      __m256d x = _mm256_mul_pd (LoadLanes (pX + i, laneCount), frequency);
+      __m256d z = _mm256_mul_pd (LoadLanes (pZ + i, laneCount), frequency);
+      __m256d magnitude = _mm256_max_pd (_mm256_andnot_pd (signMask, x),
+        _mm256_andnot_pd (signMask, z));
+      bool isInRange = _mm256_movemask_pd (
+        _mm256_cmp_pd (magnitude, range, _CMP_LT_OQ)) == 0xf;
+      __m256d value = _mm256_setzero_pd ();
+      __m256d weight = _mm256_set1_pd (1.0);
+      OctaveLoop4<TYPE, QUALITY, 0, OCTAVE_COUNT> (octaves, x, z, isInRange,
+        value, weight);
+      if constexpr (TYPE == FRACTAL_BILLOW) {
+        value = _mm256_add_pd (value, _mm256_set1_pd (0.5));
+      } else if constexpr (TYPE == FRACTAL_RIDGED) {
+        value = _mm256_sub_pd (_mm256_mul_pd (value, _mm256_set1_pd (1.25)),
+          _mm256_set1_pd (1.0));
+      }
+      StoreLanes (pDest + i, value, laneCount);
+    }
+  }
+
+  // ValueNoise3D () for four lattice points, given their combined
+  // coordinate hash.
+  NOISE_TARGET_AVX2 inline __m256d ValueNoise4 (__m128i coordHash, int seed)
+  {
+    __m128i n = _mm_add_epi32 (coordHash, _mm_set1_epi32 (
+      (int)((unsigned int)SEED_NOISE_GEN * (unsigned int)seed)));
+    n = _mm_and_si128 (n, _mm_set1_epi32 (0x7fffffff));
+    n = _mm_xor_si128 (_mm_srai_epi32 (n, 13), n);
+    __m128i nn = _mm_add_epi32 (
+      _mm_mullo_epi32 (_mm_mullo_epi32 (n, n), _mm_set1_epi32 (60493)),
+      _mm_set1_epi32 (19990303));
+    n = _mm_add_epi32 (_mm_mullo_epi32 (n, nn), _mm_set1_epi32 (1376312589));
+    n = _mm_and_si128 (n, _mm_set1_epi32 (0x7fffffff));
+    return _mm256_sub_pd (_mm256_set1_pd (1.0), _mm256_div_pd (
+      _mm256_cvtepi32_pd (n), _mm256_set1_pd (1073741824.0)));
+  }
+
+  NOISE_TARGET_AVX2 inline __m128i CoordHash4 (__m128i x, __m128i y,
+    __m128i z)
+  {
+    return _mm_add_epi32 (_mm_add_epi32 (
+      _mm_mullo_epi32 (x, _mm_set1_epi32 (X_NOISE_GEN)),
+      _mm_mullo_epi32 (y, _mm_set1_epi32 (Y_NOISE_GEN))),
+      _mm_mullo_epi32 (z, _mm_set1_epi32 (Z_NOISE_GEN)));
+  }
+
+  // FillVoronoiTableScalar () four cubes of a row at a time.
+  NOISE_TARGET_AVX2 void FillVoronoiTableAvx2 (VoronoiTable& table,
+    int seed)
+  {
+    int index = 0;
+    for (int zCur = table.z0; zCur < table.z0 + table.zSize; zCur++) {
+      __m128i z = _mm_set1_epi32 (zCur);
+      for (int yCur = table.y0; yCur < table.y0 + table.ySize; yCur++) {
+        __m128i y = _mm_set1_epi32 (yCur);
+        for (int xCur = table.x0; xCur < table.x0 + table.xSize;
+          xCur += 4) {
+          int laneCount = std::min (4, table.x0 + table.xSize - xCur);
+          __m128i x = _mm_add_epi32 (_mm_set1_epi32 (xCur),
+            _mm_setr_epi32 (0, 1, 2, 3));
+          __m128i coordHash = CoordHash4 (x, y, z);
+          StoreLanes (table.xPos + index, _mm256_add_pd (
+            _mm256_cvtepi32_pd (x), ValueNoise4 (coordHash, seed    )),
+            laneCount);
+          StoreLanes (table.yPos + index, _mm256_add_pd (
+            _mm256_cvtepi32_pd (y), ValueNoise4 (coordHash, seed + 1)),
+            laneCount);
+          StoreLanes (table.zPos + index, _mm256_add_pd (
+            _mm256_cvtepi32_pd (z), ValueNoise4 (coordHash, seed + 2)),
+            laneCount);
+          index += laneCount;
+        }
+      }
+    }
+  }
+
+#endif
+
+  //////////////////////////////////////////////////////////////////////////
+  // Kernel dispatch
+
+  bool UseAvx2 ()
+  {
+#if NOISE_BATCH_AVX2
+    return g_isSimdEnabled.load (std::memory_order_relaxed)
+      && IsAvx2Supported ();
+#else
+    return false;
+#endif
+  }
+
+  // A fixed octave kernel; the arguments are those of FractalValuesScalar ()
+  // for a planar block, without the y coordinates.
+  typedef void (*FixedFractalKernel) (const FractalParams& params,
+    const double* pX, const double* pZ, double* pDest, int count);
+
+  // The fixed octave kernels of one fractal type and noise quality, indexed
+  // by octave count minus one.
+  template <FractalType TYPE, NoiseQuality QUALITY>
+  struct FixedFractalKernels
+  {
+    static const FixedFractalKernel scalarKernels[FIXED_OCTAVE_MAX];
+#if NOISE_BATCH_AVX2
+    static const FixedFractalKernel avx2Kernels[FIXED_OCTAVE_MAX];
+#endif
+  };
+
+  template <FractalType TYPE, NoiseQuality QUALITY>
+  const FixedFractalKernel FixedFractalKernels<TYPE, QUALITY>::scalarKernels[
+    FIXED_OCTAVE_MAX] = {
+    FixedFractalValuesScalar<TYPE, 1, QUALITY>,
+    FixedFractalValuesScalar<TYPE, 2, QUALITY>,
+    FixedFractalValuesScalar<TYPE, 3, QUALITY>,
+    FixedFractalValuesScalar<TYPE, 4, QUALITY>,
+    FixedFractalValuesScalar<TYPE, 5, QUALITY>,
+    FixedFractalValuesScalar<TYPE, 6, QUALITY>,
+    FixedFractalValuesScalar<TYPE, 7, QUALITY>,
+    FixedFractalValuesScalar<TYPE, 8, QUALITY>
+  };
+
+#if NOISE_BATCH_AVX2
+  template <FractalType TYPE, NoiseQuality QUALITY>
+  const FixedFractalKernel FixedFractalKernels<TYPE, QUALITY>::avx2Kernels[
+    FIXED_OCTAVE_MAX] = {
+    FixedFractalValuesAvx2<TYPE, 1, QUALITY>,
+    FixedFractalValuesAvx2<TYPE, 2, QUALITY>,
+    FixedFractalValuesAvx2<TYPE, 3, QUALITY>,
+    FixedFractalValuesAvx2<TYPE, 4, QUALITY>,
+    FixedFractalValuesAvx2<TYPE, 5, QUALITY>,
+    FixedFractalValuesAvx2<TYPE, 6, QUALITY>,
+    FixedFractalValuesAvx2<TYPE, 7, QUALITY>,
+    FixedFractalValuesAvx2<TYPE, 8, QUALITY>
+  };
+#endif
+
+  template <FractalType TYPE, NoiseQuality QUALITY>
+  FixedFractalKernel GetFixedFractalKernel (int octaveCount, bool useAvx2)
+  {
+#if NOISE_BATCH_AVX2
+    if (useAvx2) {
+      return FixedFractalKernels<TYPE, QUALITY>::avx2Kernels[octaveCount - 1];
+    }
+#endif
+    return FixedFractalKernels<TYPE, QUALITY>::scalarKernels[octaveCount - 1];
+  }
+
+  template <FractalType TYPE>
+  FixedFractalKernel GetFixedFractalKernel (const FractalParams& params,
+    bool useAvx2)
+  {
+    switch (params.noiseQuality) {
+      case QUALITY_FAST:
+        return GetFixedFractalKernel<TYPE, QUALITY_FAST> (params.octaveCount,
+          useAvx2);
+      case QUALITY_STD:
+        return GetFixedFractalKernel<TYPE, QUALITY_STD> (params.octaveCount,
+          useAvx2);
+      case QUALITY_BEST:
+        return GetFixedFractalKernel<TYPE, QUALITY_BEST> (params.octaveCount,
+          useAvx2);
+    }
+    return NULL;
+  }
+
+  // Picks the planar fixed octave kernel for the parameters of a module, or
+  // returns NULL if there is none and the runtime octave loop has to run.
+  FixedFractalKernel GetFixedFractalKernel (const FractalParams& params,
+    bool useAvx2)
+  {
+    if (!g_isOctaveSpecializationEnabled.load (std::memory_order_relaxed)
+      || params.lacunarity != FIXED_OCTAVE_LACUNARITY
+      || params.octaveCount < 1 || params.octaveCount > FIXED_OCTAVE_MAX) {
+      return NULL;
+    }
+    switch (params.type) {
+      case FRACTAL_PERLIN:
+        return GetFixedFractalKernel<FRACTAL_PERLIN> (params, useAvx2);
+      case FRACTAL_BILLOW:
+        return GetFixedFractalKernel<FRACTAL_BILLOW> (params, useAvx2);
+      case FRACTAL_RIDGED:
+        return GetFixedFractalKernel<FRACTAL_RIDGED> (params, useAvx2);
+    }
+    return NULL;
+  }
+
+  // FractalValuesScalar () through the fixed octave kernel, if the block is
+  // planar and there is one.
+  void ScalarFractalValues (const FractalParams& params, const double* pX,
+    const double* pY, const double* pZ, double* pDest, int count,
+    bool isPlanar)
+  {
+    FixedFractalKernel pKernel = isPlanar?
+      GetFixedFractalKernel (params, false): NULL;
+    if (pKernel != NULL) {
+      pKernel (params, pX, pZ, pDest, count);
+      return;
+    }
+    FractalValuesScalar (params, pX, pY, pZ, pDest, count, isPlanar);
+  }
+
+  void FractalValues (const FractalParams& params, const double* pX,
+    const double* pY, const double* pZ, double* pDest, int count)
+  {
+    // Blocks from the plane builder (and any graph that keeps y at zero up
+    // to its generators) take the two-dimensional lattice, which evaluates
+    // half as many corners per octave for the same output values.
+    bool isPlanar = true;
+    for (int i = 0; i < count && isPlanar; i++) {
+      isPlanar = (pY[i] == 0.0);
+    }
+    bool useAvx2 = UseAvx2 ();
+    FixedFractalKernel pKernel = isPlanar?
+      GetFixedFractalKernel (params, useAvx2): NULL;
+    if (pKernel != NULL) {
+      pKernel (params, pX, pZ, pDest, count);
+      return;
+    }
+#if NOISE_BATCH_AVX2
+    if (useAvx2) {
+      FractalValuesAvx2 (params, pX, pY, pZ, pDest, count, isPlanar);
+      return;
+    }
+#endif
+    FractalValuesScalar (params, pX, pY, pZ, pDest, count, isPlanar);
+  }
+
+  void RowRunValues (const FractalParams& params, int curOctave,
+    double curPersistence, const RowOctave& row, const RowCube& cube,
+    const double* pNx, double* pValue, double* pWeight, int count)
+  {
+#if NOISE_BATCH_AVX2
+    if (UseAvx2 ()) {
+      RowRunValuesAvx2 (params, curOctave, curPersistence, row, cube, pNx,
+        pValue, pWeight, count);
+      return;
+    }
+#endif
+    RowRunValuesScalar (params, curOctave, curPersistence, row, cube, pNx,
+      pValue, pWeight, count);
+  }
+
+  void RowGenericValues (const FractalParams& params, int curOctave,
+    double curPersistence, int seed, const double* pX, double ny, double nz,
+    double* pValue, double* pWeight, int count)
+  {
+#if NOISE_BATCH_AVX2
+    if (UseAvx2 ()) {
+      RowGenericValuesAvx2 (params, curOctave, curPersistence, seed, pX, ny,
+        nz, pValue, pWeight, count);
+      return;
+    }
+#endif
+    RowGenericValuesScalar (params, curOctave, curPersistence, seed, pX, ny,
+      nz, pValue, pWeight, count);
+  }
+
+  // Fills the values of a Perlin, Billow or RidgedMulti noise module at the
+  // input values (pX[i] + pOffset[0], y + pOffset[1], z + pOffset[2]), the
+  // way the GetValue () method of the module does for each of them.
+  void RowFractalValues (const FractalParams& params, const double* pOffset,
+    const double* pX, double y, double z, double* pDest, int count)
+  {
+    double x[BATCH_BLOCK_SIZE];
+    double nx[BATCH_BLOCK_SIZE];
+    int x0[BATCH_BLOCK_SIZE];
+    double value[BATCH_BLOCK_SIZE];
+    double weight[BATCH_BLOCK_SIZE];
+    for (int i = 0; i < count; i++) {
+      x[i] = (pX[i] + pOffset[0]) * params.frequency;
+    }
+    y = (y + pOffset[1]) * params.frequency;
+    z = (z + pOffset[2]) * params.frequency;
+    std::fill (value, value + count, 0.0);
+    std::fill (weight, weight + count, 1.0);
+
+    // With a lacunarity of at least 1, the cubes of an octave are no larger
+    // than those of the previous one, so once an octave falls back to the
+    // generic kernel, the rest do as well without counting their cubes.
+    bool useRowKernel = true;
+    double curPersistence = 1.0;
+    for (int curOctave = 0; curOctave < params.octaveCount; curOctave++) {
+      double ny = MakeInt32Range (y);
+      double nz = MakeInt32Range (z);
+      int seed = OctaveSeed (params, curOctave);
+      if (useRowKernel || params.lacunarity < 1.0) {
+        int cubeCount = 0;
+        for (int i = 0; i < count; i++) {
+          nx[i] = MakeInt32Range (x[i]);
+          x0[i] = LatticeCoord (nx[i]);
+          if (i == 0 || x0[i] != x0[i - 1]) {
+            cubeCount++;
+          }
+        }
+        useRowKernel = (count >= ROW_MIN_VALUES_PER_CUBE * cubeCount);
+      }
+
+      if (useRowKernel) {
+        // Runs of input values in the same cube.
+        RowOctave row = SetupRowOctave (ny, nz, seed, params.noiseQuality);
+        RowCube cube;
+        int first = 0;
+        while (first < count) {
+          SetupRowCube (cube, first > 0, x0[first], row);
+          int last = first + 1;
+          while (last < count && x0[last] == x0[first]) {
+            last++;
+          }
+          RowRunValues (params, curOctave, curPersistence, row, cube,
+            nx + first, value + first, weight + first, last - first);
+          first = last;
+        }
+      } else {
+        RowGenericValues (params, curOctave, curPersistence, seed, x, ny, nz,
+          value, weight, count);
+      }
+
+      for (int i = 0; i < count; i++) {
+        x[i] *= params.lacunarity;
+      }
+      y *= params.lacunarity;
+      z *= params.lacunarity;
+      curPersistence *= params.persistence;
+    }
+
+    for (int i = 0; i < count; i++) {
+      pDest[i] = FinishFractal (params, value[i]);
+    }
+  }
+
+  void GridOctaveValues (const FractalParams& params, int curOctave,
+    double curPersistence, const GridOctave& octave, const GridRow& row,
+    double* pValue, double* pWeight, int count)
+  {
+#if NOISE_BATCH_AVX2
+    if (UseAvx2 ()) {
+      GridOctaveValuesAvx2 (params, curOctave, curPersistence, octave, row,
+        pValue, pWeight, count);
+      return;
+    }
+#endif
+    GridOctaveValuesScalar (params, curOctave, curPersistence, octave, row,
+      pValue, pWeight, count);
+  }
+
+  // Fills the values of a Perlin, Billow or RidgedMulti noise module on the
+  // grid pX x pZ, one strip of columns at a time.  Uses the periodic lattice
+  // if the periods of the parameters are set.
+  void FractalGridValues (const FractalParams& params, const double* pX,
+    int width, const double* pZ, int height, double* pDest)
+  {
+    std::vector<GridOctave> octaves (params.octaveCount);
+    double x[BATCH_BLOCK_SIZE];
+    double value[BATCH_BLOCK_SIZE];
+    double weight[BATCH_BLOCK_SIZE];
+
+    for (int firstColumn = 0; firstColumn < width;
+      firstColumn += BATCH_BLOCK_SIZE) {
+      int count = std::min (BATCH_BLOCK_SIZE, width - firstColumn);
+
+      // Column data of every octave, with the coordinates scaled the way
+      // the octave loop of the module scales them.
+      for (int i = 0; i < count; i++) {
+        x[i] = pX[firstColumn + i] * params.frequency;
+      }
+      for (int curOctave = 0; curOctave < params.octaveCount; curOctave++) {
+        GridOctave& octave = octaves[curOctave];
+        octave.seed = OctaveSeed (params, curOctave);
+        SetupGridColumns (octave, x, count, params.noiseQuality,
+          params.periodX[curOctave]);
+        for (int i = 0; i < count; i++) {
+          x[i] *= params.lacunarity;
+        }
+      }
+
+      for (int row = 0; row < height; row++) {
+        std::fill (value, value + count, 0.0);
+        std::fill (weight, weight + count, 1.0);
+        double z = pZ[row] * params.frequency;
+        double curPersistence = 1.0;
+        for (int curOctave = 0; curOctave < params.octaveCount;
+          curOctave++) {
+          GridOctave& octave = octaves[curOctave];
+          GridRow gridRow = SetupGridRow (z, params.noiseQuality,
+            params.periodZ[curOctave]);
+          SetupGridGradients (octave, gridRow, count);
+          GridOctaveValues (params, curOctave, curPersistence, octave,
+            gridRow, value, weight, count);
+          z *= params.lacunarity;
+          curPersistence *= params.persistence;
+        }
+        double* pRow = pDest + (size_t)row * width + firstColumn;
+        for (int i = 0; i < count; i++) {
+          pRow[i] = FinishFractal (params, value[i]);
+        }
+      }
+    }
+  }
+
+  void GridOctaveDerivs (const FractalParams& params, int curOctave,
+    double curPersistence, double octaveScale, const GridOctave& octave,
+    const GridRow& row, const GridDerivs& derivs, int count)
+  {
+#if NOISE_BATCH_AVX2
+    if (UseAvx2 ()) {
+      GridOctaveDerivsAvx2 (params, curOctave, curPersistence, octaveScale,
+        octave, row, derivs, count);
+      return;
+    }
+#endif
+    GridOctaveDerivsScalar (params, curOctave, curPersistence, octaveScale,
+      octave, row, derivs, count);
+  }
+
+  // FractalGridValues () along with the derivatives of the values along the
+  // x and z axes.
+  void FractalGridGradients (const FractalParams& params, const double* pX,
+    int width, const double* pZ, int height, double* pDest, double* pDestDX,
+    double* pDestDZ)
+  {
+    std::vector<GridOctave> octaves (params.octaveCount);
+    double x[BATCH_BLOCK_SIZE];
+    double value[BATCH_BLOCK_SIZE];
+    double weight[BATCH_BLOCK_SIZE];
+    double valueDX[BATCH_BLOCK_SIZE];
+    double valueDZ[BATCH_BLOCK_SIZE];
+    double weightDX[BATCH_BLOCK_SIZE];
+    double weightDZ[BATCH_BLOCK_SIZE];
+    GridDerivs derivs = {value, weight, valueDX, valueDZ, weightDX,
+      weightDZ};
+    double finishScale = FinishFractalDeriv (params);
+
+    for (int firstColumn = 0; firstColumn < width;
+      firstColumn += BATCH_BLOCK_SIZE) {
+      int count = std::min (BATCH_BLOCK_SIZE, width - firstColumn);
+      for (int i = 0; i < count; i++) {
+        x[i] = pX[firstColumn + i] * params.frequency;
+      }
+      for (int curOctave = 0; curOctave < params.octaveCount; curOctave++) {
+        GridOctave& octave = octaves[curOctave];
+        octave.seed = OctaveSeed (params, curOctave);
+        SetupGridColumns (octave, x, count, params.noiseQuality,
+          params.periodX[curOctave]);
+        for (int i = 0; i < count; i++) {
+          x[i] *= params.lacunarity;
+        }
+      }
+
+      for (int row = 0; row < height; row++) {
+        std::fill (value, value + count, 0.0);
+        std::fill (weight, weight + count, 1.0);
+        std::fill (valueDX, valueDX + count, 0.0);
+        std::fill (valueDZ, valueDZ + count, 0.0);
+        std::fill (weightDX, weightDX + count, 0.0);
+        std::fill (weightDZ, weightDZ + count, 0.0);
+        double z = pZ[row] * params.frequency;
+        double octaveScale = params.frequency;
+        double curPersistence = 1.0;
+        for (int curOctave = 0; curOctave < params.octaveCount;
+          curOctave++) {
+          GridOctave& octave = octaves[curOctave];
+          GridRow gridRow = SetupGridRow (z, params.noiseQuality,
+            params.periodZ[curOctave]);
+          SetupGridGradients (octave, gridRow, count);
+          GridOctaveDerivs (params, curOctave, curPersistence, octaveScale,
+            octave, gridRow, derivs, count);
+          z *= params.lacunarity;
+          octaveScale *= params.lacunarity;
+          curPersistence *= params.persistence;
+        }
+        size_t offset = (size_t)row * width + firstColumn;
+        for (int i = 0; i < count; i++) {
+          pDest[offset + i] = FinishFractal (params, value[i]);
+          pDestDX[offset + i] = valueDX[i] * finishScale;
+          pDestDZ[offset + i] = valueDZ[i] * finishScale;
+        }
+      }
+    }
+  }
+
+  void FillVoronoiTable (VoronoiTable& table, int seed)
+  {
+#if NOISE_BATCH_AVX2
+    if (UseAvx2 ()) {
+      FillVoronoiTableAvx2 (table, seed);
+      return;
+    }
+#endif
+    FillVoronoiTableScalar (table, seed);
+  }
+
+  // Evaluates a Voronoi noise module for a block of input values.  If the
+  // cubes around the input values fit in a table, their seed points are
+  // computed once; otherwise each input value hashes the seed points it
+  // visits.
+  void VoronoiValues (const Voronoi& voronoi, const double* pX,
+    const double* pY, const double* pZ, double* pDest, int count)
+  {
+    double frequency = voronoi.GetFrequency ();
+    double x[BATCH_BLOCK_SIZE];
+    double y[BATCH_BLOCK_SIZE];
+    double z[BATCH_BLOCK_SIZE];
+    int xInt[BATCH_BLOCK_SIZE];
+    int yInt[BATCH_BLOCK_SIZE];
+    int zInt[BATCH_BLOCK_SIZE];
+    for (int i = 0; i < count; i++) {
+      x[i] = pX[i] * frequency;
+      y[i] = pY[i] * frequency;
+      z[i] = pZ[i] * frequency;
+      xInt[i] = LatticeCoord (x[i]);
+      yInt[i] = LatticeCoord (y[i]);
+      zInt[i] = LatticeCoord (z[i]);
+    }
+
+    // The box of cubes around the input values.
+    VoronoiTable table;
+    long long cubeCount = 0;
+    if (count > 0) {
+      table.x0 = *std::min_element (xInt, xInt + count) - 2;
+      table.y0 = *std::min_element (yInt, yInt + count) - 2;
+      table.z0 = *std::min_element (zInt, zInt + count) - 2;
+      long long xSize = (long long)*std::max_element (xInt, xInt + count)
+        + 3 - table.x0;
+      long long ySize = (long long)*std::max_element (yInt, yInt + count)
+        + 3 - table.y0;
+      long long zSize = (long long)*std::max_element (zInt, zInt + count)
+        + 3 - table.z0;
+      cubeCount = xSize * ySize * zSize;
+      if (cubeCount <= VORONOI_TABLE_MAX_CUBES) {
+        table.xSize = (int)xSize;
+        table.ySize = (int)ySize;
+        table.zSize = (int)zSize;
+      }
+    }
+
+    // A table costs one hash per cube; without one, each input value
+    // hashes the few dozen cubes it visits.
+    bool useTable = cubeCount <= VORONOI_TABLE_MAX_CUBES
+      && cubeCount <= VORONOI_TABLE_CUBES_PER_VALUE * count;
+    VoronoiCandidate nearest;
+    if (!useTable) {
+      HashedSeedPoints seedPoints = {voronoi.GetSeed ()};
+      for (int i = 0; i < count; i++) {
+        FindNearestSeedPoint (seedPoints, x[i], y[i], z[i], xInt[i], yInt[i],
+          zInt[i], nearest);
+        pDest[i] = VoronoiValue (voronoi, nearest, x[i], y[i], z[i]);
+      }
+      return;
+    }
+
+    FillVoronoiTable (table, voronoi.GetSeed ());
+    for (int i = 0; i < count; i++) {
+      FindNearestSeedPoint (table, x[i], y[i], z[i], xInt[i], yInt[i],
+        zInt[i], nearest);
+      pDest[i] = VoronoiValue (voronoi, nearest, x[i], y[i], z[i]);
+    }
+  }
+
+  void SimplexValues (const Simplex& simplex, const double* pX,
+    const double* pY, const double* pZ, double* pDest, int count)
+  {
+#if NOISE_BATCH_AVX2
+    if (UseAvx2 ()) {
+      SimplexValuesAvx2 (GetSimplexParams (simplex), pX, pY, pZ, pDest,
+        count);
+      return;
+    }
+#endif
+    // The scalar noise is the module's own, without the virtual call.
+    for (int i = 0; i < count; i++) {
+      pDest[i] = simplex.Simplex::GetValue (pX[i], pY[i], pZ[i]);
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////
+  // Module graph walk
+
+  void GetBlockValues (const Module& sourceModule, const double* pX,
+    const double* pY, const double* pZ, double* pDest, int count);
+
+  // Returns the module as a T if it is exactly a T.  Subclasses may
+  // override GetValue (), so they take the reference path instead.
+  template <class T>
+  inline const T* AsModule (const Module& sourceModule)
+  {
+    return (typeid (sourceModule) == typeid (T))?
+      static_cast<const T*> (&sourceModule): NULL;
+  }
+
+  // Gets the parameters of a Perlin, Billow or RidgedMulti noise module.
+  // Returns false for any other module.
+  bool GetFractalParams (const Module& sourceModule, FractalParams& params)
+  {
+    if (const Perlin* pPerlin = AsModule<Perlin> (sourceModule)) {
+      params = GetPerlinParams (*pPerlin);
+    } else if (const Billow* pBillow = AsModule<Billow> (sourceModule)) {
+      params = GetBillowParams (*pBillow);
+    } else if (const RidgedMulti* pRidged =
+      AsModule<RidgedMulti> (sourceModule)) {
+      params = GetRidgedParams (*pRidged);
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  // Evaluates source module @a index of a module for the block.
+  inline void GetSourceValues (const Module& sourceModule, int index,
+    const double* pX, const double* pY, const double* pZ, double* pDest,
+    int count)
+  {
+    GetBlockValues (sourceModule.GetSourceModule (index), pX, pY, pZ, pDest,
+      count);
+  }
+
+  // Determines if the input values of a block share their y and z
+  // coordinates, as the input values of a row of a plane noise map do.
+  bool IsRowBlock (const double* pY, const double* pZ, int count)
+  {
+    for (int i = 1; i < count; i++) {
+      if (pY[i] != pY[0] || pZ[i] != pZ[0]) {
+        return false;
+      }
+    }
+    return count > 0;
+  }
+
+  // The three distortion modules are evaluated with the row kernel when the
+  // block is a row, and their results feed the source module as one block.
+  void TurbulenceValues (const Turbulence& turbulence, const double* pX,
+    const double* pY, const double* pZ, double* pDest, int count)
+  {
+    double xDistort[BATCH_BLOCK_SIZE];
+    double yDistort[BATCH_BLOCK_SIZE];
+    double zDistort[BATCH_BLOCK_SIZE];
+    double* pDistort[3] = {xDistort, yDistort, zDistort};
+    const double* pCoords[3] = {pX, pY, pZ};
+    double power = turbulence.GetPower ();
+    bool isRow = IsRowBlock (pY, pZ, count);
+
+    double xOffset[BATCH_BLOCK_SIZE];
+    double yOffset[BATCH_BLOCK_SIZE];
+    double zOffset[BATCH_BLOCK_SIZE];
+    for (int axis = 0; axis < 3; axis++) {
+      FractalParams params = GetTurbulenceParams (turbulence, axis);
+      if (isRow) {
+        RowFractalValues (params, TURBULENCE_OFFSETS[axis], pX, pY[0], pZ[0],
+          pDistort[axis], count);
+      } else {
+        for (int i = 0; i < count; i++) {
+          xOffset[i] = pX[i] + TURBULENCE_OFFSETS[axis][0];
+          yOffset[i] = pY[i] + TURBULENCE_OFFSETS[axis][1];
+          zOffset[i] = pZ[i] + TURBULENCE_OFFSETS[axis][2];
+        }
+        FractalValues (params, xOffset, yOffset, zOffset, pDistort[axis],
+          count);
+      }
+      for (int i = 0; i < count; i++) {
+        pDistort[axis][i] = pCoords[axis][i] + (pDistort[axis][i] * power);
+      }
+    }
+    GetSourceValues (turbulence, 0, xDistort, yDistort, zDistort, pDest,
+      count);
+  }
+
+  // Output of one cache module for the last block of input values it was
+  // asked for.
+  struct CacheBlock
+  {
+    const Module* pModule;
+    int count;
+    double x[BATCH_BLOCK_SIZE];
+    double y[BATCH_BLOCK_SIZE];
+    double z[BATCH_BLOCK_SIZE];
+    double value[BATCH_BLOCK_SIZE];
+  };
+
+  // Cache blocks of the noise::GetValues () call running on this thread,
+  // one per cache module.  They are dropped when the outermost call returns,
+  // so a module destroyed between calls never matches.
+  thread_local std::vector<CacheBlock> t_cacheBlocks;
+  thread_local int t_cacheDepth = 0;
+
+  // Keeps the cache blocks for the lifetime of a noise::GetValues () call.
+  // Compiled graphs call it again for their opaque modules.
+  class CacheScope
+  {
+
+    public:
+
+      CacheScope ()
+      {
+        t_cacheDepth++;
+      }
+
+      ~CacheScope ()
+      {
+        if (--t_cacheDepth == 0) {
+          t_cacheBlocks.clear ();
+        }
+      }
+
+  };
+
+  // A cache module in a graph is shared: Select, Blend and Displace
+  // modules often get the same subgraph through one Cache as control and
+  // as source, and the scalar path evaluates it once per input value.  The
+  // batch path likewise evaluates it once per block.  The input arrays are
+  // compared by value, since blocks are rebuilt in reused stack buffers.
+  void CacheValues (const Module& cache, const double* pX, const double* pY,
+    const double* pZ, double* pDest, int count)
+  {
+    if (t_cacheDepth == 0) {
+      GetSourceValues (cache, 0, pX, pY, pZ, pDest, count);
+      return;
+    }
+
+    size_t index = 0;
+    while (index < t_cacheBlocks.size ()
+      && t_cacheBlocks[index].pModule != &cache) {
+      index++;
+    }
+    if (index < t_cacheBlocks.size ()) {
+      const CacheBlock& block = t_cacheBlocks[index];
+      if (block.count == count && std::equal (pX, pX + count, block.x)
+        && std::equal (pY, pY + count, block.y)
+        && std::equal (pZ, pZ + count, block.z)) {
+        std::copy (block.value, block.value + count, pDest);
+        return;
+      }
+    }
+
+    // The source module may contain cache modules of its own, which add
+    // blocks; keep no reference into the vector across the call.
+    GetSourceValues (cache, 0, pX, pY, pZ, pDest, count);
+    if (index == t_cacheBlocks.size ()) {
+      t_cacheBlocks.emplace_back ();
+      t_cacheBlocks[index].pModule = &cache;
+    }
+    CacheBlock& block = t_cacheBlocks[index];
+    block.count = count;
+    std::copy (pX, pX + count, block.x);
+    std::copy (pY, pY + count, block.y);
+    std::copy (pZ, pZ + count, block.z);
+    std::copy (pDest, pDest + count, block.value);
+  }
+
+  // Perlin-family displacement modules are evaluated with the row kernel
+  // when the block is a row off the y = 0 plane; on the plane, the planar
+  // kernels are cheaper.
+  void DisplaceValues (const Module& displace, const double* pX,
+    const double* pY, const double* pZ, double* pDest, int count)
+  {
+    static const double NO_OFFSET[3] = {0.0, 0.0, 0.0};
+    double xDisplace[BATCH_BLOCK_SIZE];
+    double yDisplace[BATCH_BLOCK_SIZE];
+    double zDisplace[BATCH_BLOCK_SIZE];
+    double* pDisplace[3] = {xDisplace, yDisplace, zDisplace};
+    const double* pCoords[3] = {pX, pY, pZ};
+    bool isRow = IsRowBlock (pY, pZ, count) && pY[0] != 0.0;
+    for (int axis = 0; axis < 3; axis++) {
+      FractalParams params;
+      if (isRow
+        && GetFractalParams (displace.GetSourceModule (axis + 1), params)) {
+        RowFractalValues (params, NO_OFFSET, pX, pY[0], pZ[0],
+          pDisplace[axis], count);
+      } else {
+        GetSourceValues (displace, axis + 1, pX, pY, pZ, pDisplace[axis],
+          count);
+      }
+      kernels::Add (pCoords[axis], pDisplace[axis], pDisplace[axis], count);
+    }
+    GetSourceValues (displace, 0, xDisplace, yDisplace, zDisplace, pDest,
+      count);
+  }
+
+  void GetBlockValues (const Module& sourceModule, const double* pX,
+    const double* pY, const double* pZ, double* pDest, int count)
+  {
+    // Generators.
+    if (const Perlin* pPerlin = AsModule<Perlin> (sourceModule)) {
+      FractalValues (GetPerlinParams (*pPerlin), pX, pY, pZ, pDest, count);
+      return;
+    }
+    if (const Billow* pBillow = AsModule<Billow> (sourceModule)) {
+      FractalValues (GetBillowParams (*pBillow), pX, pY, pZ, pDest, count);
+      return;
+    }
+    if (const RidgedMulti* pRidged = AsModule<RidgedMulti> (sourceModule)) {
+      FractalValues (GetRidgedParams (*pRidged), pX, pY, pZ, pDest, count);
+      return;
+    }
+    if (const Voronoi* pVoronoi = AsModule<Voronoi> (sourceModule)) {
+      VoronoiValues (*pVoronoi, pX, pY, pZ, pDest, count);
+      return;
+    }
+    if (const FastVoronoi* pFastVoronoi =
+      AsModule<FastVoronoi> (sourceModule)) {
+      VoronoiValues (*pFastVoronoi, pX, pY, pZ, pDest, count);
+      return;
+    }
+    if (const Simplex* pSimplex = AsModule<Simplex> (sourceModule)) {
+      SimplexValues (*pSimplex, pX, pY, pZ, pDest, count);
+      return;
+    }
+    if (const Const* pConst = AsModule<Const> (sourceModule)) {
+      std::fill (pDest, pDest + count, pConst->GetConstValue ());
+      return;
+    }
+
+    // Modifiers.
+    if (AsModule<Abs> (sourceModule) != NULL) {
+      GetSourceValues (sourceModule, 0, pX, pY, pZ, pDest, count);
+      kernels::Abs (pDest, pDest, count);
+      return;
+    }
+    if (const Clamp* pClamp = AsModule<Clamp> (sourceModule)) {
+      GetSourceValues (sourceModule, 0, pX, pY, pZ, pDest, count);
+      kernels::Clamp (pDest, pClamp->GetLowerBound (),
+        pClamp->GetUpperBound (), pDest, count);
+      return;
+    }
+    const Curve* pCurve = AsModule<Curve> (sourceModule);
+    if (pCurve != NULL && pCurve->GetControlPointCount () >= 4) {
+      GetSourceValues (sourceModule, 0, pX, pY, pZ, pDest, count);
+      kernels::Curve (*pCurve, pDest, pDest, count);
+      return;
+    }
+    if (const Exponent* pExponent = AsModule<Exponent> (sourceModule)) {
+      GetSourceValues (sourceModule, 0, pX, pY, pZ, pDest, count);
+      kernels::Exponent (pDest, pExponent->GetExponent (), pDest, count);
+      return;
+    }
+    if (AsModule<Invert> (sourceModule) != NULL) {
+      GetSourceValues (sourceModule, 0, pX, pY, pZ, pDest, count);
+      kernels::Invert (pDest, pDest, count);
+      return;
+    }
+    if (const ScaleBias* pScaleBias = AsModule<ScaleBias> (sourceModule)) {
+      GetSourceValues (sourceModule, 0, pX, pY, pZ, pDest, count);
+      kernels::ScaleBias (pDest, pScaleBias->GetScale (),
+        pScaleBias->GetBias (), pDest, count);
+      return;
+    }
+    const Terrace* pTerrace = AsModule<Terrace> (sourceModule);
+    if (pTerrace != NULL && pTerrace->GetControlPointCount () >= 2) {
+      GetSourceValues (sourceModule, 0, pX, pY, pZ, pDest, count);
+      kernels::Terrace (*pTerrace, pDest, pDest, count);
+      return;
+    }
+
+    // Combiners.
+    typedef void (*CombineKernel) (const double*, const double*, double*,
+      int);
+    CombineKernel combine = NULL;
+    if (AsModule<Add> (sourceModule) != NULL) {
+      combine = kernels::Add;
+    } else if (AsModule<Max> (sourceModule) != NULL) {
+      combine = kernels::Max;
+    } else if (AsModule<Min> (sourceModule) != NULL) {
+      combine = kernels::Min;
+    } else if (AsModule<Multiply> (sourceModule) != NULL) {
+      combine = kernels::Multiply;
+    } else if (AsModule<Power> (sourceModule) != NULL) {
+      combine = kernels::Power;
+    }
+    if (combine != NULL) {
+      double value1[BATCH_BLOCK_SIZE];
+      GetSourceValues (sourceModule, 0, pX, pY, pZ, pDest, count);
+      GetSourceValues (sourceModule, 1, pX, pY, pZ, value1, count);
+      combine (pDest, value1, pDest, count);
+      return;
+    }
+
+    // Selectors.
+    if (AsModule<Blend> (sourceModule) != NULL) {
+      double value1[BATCH_BLOCK_SIZE];
+      double control[BATCH_BLOCK_SIZE];
+      GetSourceValues (sourceModule, 0, pX, pY, pZ, pDest, count);
+      GetSourceValues (sourceModule, 1, pX, pY, pZ, value1, count);
+      GetSourceValues (sourceModule, 2, pX, pY, pZ, control, count);
+      kernels::Blend (pDest, value1, control, pDest, count);
+      return;
+    }
+    if (const Select* pSelect = AsModule<Select> (sourceModule)) {
+      double value1[BATCH_BLOCK_SIZE];
+      double control[BATCH_BLOCK_SIZE];
+      GetSourceValues (sourceModule, 2, pX, pY, pZ, control, count);
+      GetSourceValues (sourceModule, 0, pX, pY, pZ, pDest, count);
+      GetSourceValues (sourceModule, 1, pX, pY, pZ, value1, count);
+      kernels::Select (pDest, value1, control, pSelect->GetLowerBound (),
+        pSelect->GetUpperBound (), pSelect->GetEdgeFalloff (), pDest, count);
+      return;
+    }
+
+    // Transformers.
+    if (AsModule<Displace> (sourceModule) != NULL) {
+      DisplaceValues (sourceModule, pX, pY, pZ, pDest, count);
+      return;
+    }
+    if (const ScalePoint* pScalePoint = AsModule<ScalePoint> (sourceModule)) {
+      double xScaled[BATCH_BLOCK_SIZE];
+      double yScaled[BATCH_BLOCK_SIZE];
+      double zScaled[BATCH_BLOCK_SIZE];
+      kernels::ScaleBias (pX, pScalePoint->GetXScale (), 0.0, xScaled, count);
+      kernels::ScaleBias (pY, pScalePoint->GetYScale (), 0.0, yScaled, count);
+      kernels::ScaleBias (pZ, pScalePoint->GetZScale (), 0.0, zScaled, count);
+      GetSourceValues (sourceModule, 0, xScaled, yScaled, zScaled, pDest,
+        count);
+      return;
+    }
+    if (const TranslatePoint* pTranslatePoint =
+      AsModule<TranslatePoint> (sourceModule)) {
+      double xMoved[BATCH_BLOCK_SIZE];
+      double yMoved[BATCH_BLOCK_SIZE];
+      double zMoved[BATCH_BLOCK_SIZE];
+      kernels::ScaleBias (pX, 1.0, pTranslatePoint->GetXTranslation (),
+        xMoved, count);
+      kernels::ScaleBias (pY, 1.0, pTranslatePoint->GetYTranslation (),
+        yMoved, count);
+      kernels::ScaleBias (pZ, 1.0, pTranslatePoint->GetZTranslation (),
+        zMoved, count);
+      GetSourceValues (sourceModule, 0, xMoved, yMoved, zMoved, pDest,
+        count);
+      return;
+    }
+    if (const Turbulence* pTurbulence = AsModule<Turbulence> (sourceModule)) {
+      TurbulenceValues (*pTurbulence, pX, pY, pZ, pDest, count);
+      return;
+    }
+
+    // Caches return exactly what their source module returns.  Their
+    // parents may ask for the same block back to back, so they remember the
+    // last block, as the modules remember the last input value.
+    if (AsModule<Cache> (sourceModule) != NULL
+      || AsModule<ThreadCache> (sourceModule) != NULL
+      || AsModule<LruCache> (sourceModule) != NULL) {
+      CacheValues (sourceModule, pX, pY, pZ, pDest, count);
+      return;
+    }
+    if (const CompiledGraph* pGraph = AsModule<CompiledGraph> (sourceModule)) {
+      pGraph->GetValues (pX, pY, pZ, pDest, count);
+      return;
+    }
+
+    // No batch form; use the reference implementation.
+    for (int i = 0; i < count; i++) {
+      pDest[i] = sourceModule.GetValue (pX[i], pY[i], pZ[i]);
+    }
+  }
+
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Array kernels
+
+void noise::kernels::ScaleBias (const double* pSource, double scale,
+  double bias, double* pDest, int count)
+{
+  for (int i = 0; i < count; i++) {
+    pDest[i] = pSource[i] * scale + bias;
+  }
+}
+
+void noise::kernels::Abs (const double* pSource, double* pDest, int count)
+{
+  for (int i = 0; i < count; i++) {
+    pDest[i] = fabs (pSource[i]);
+  }
+}
+
+void noise::kernels::Invert (const double* pSource, double* pDest, int count)
+{
+  for (int i = 0; i < count; i++) {
+    pDest[i] = -pSource[i];
+  }
+}
+
+void noise::kernels::Clamp (const double* pSource, double lowerBound,
+  double upperBound, double* pDest, int count)
+{
+  for (int i = 0; i < count; i++) {
+    double value = pSource[i];
+    pDest[i] = (value < lowerBound)? lowerBound:
+      ((value > upperBound)? upperBound: value);
+  }
+}
+
+void noise::kernels::Exponent (const double* pSource, double exponent,
+  double* pDest, int count)
+{
+  for (int i = 0; i < count; i++) {
+    pDest[i] = pow (fabs ((pSource[i] + 1.0) / 2.0), exponent) * 2.0 - 1.0;
+  }
+}
+
+void noise::kernels::Terrace (const module::Terrace& terrace,
+  const double* pSource, double* pDest, int count)
+{
+  const double* pControlPoints = terrace.GetControlPointArray ();
+  int controlPointCount = terrace.GetControlPointCount ();
+  bool isInverted = terrace.IsTerracesInverted ();
+  for (int i = 0; i < count; i++) {
+    double sourceModuleValue = pSource[i];
+    int indexPos;
+    for (indexPos = 0; indexPos < controlPointCount; indexPos++) {
+      if (sourceModuleValue < pControlPoints[indexPos]) {
+        break;
+      }
+    }
+    int index0 = ClampValue (indexPos - 1, 0, controlPointCount - 1);
+    int index1 = ClampValue (indexPos    , 0, controlPointCount - 1);
+    if (index0 == index1) {
+      pDest[i] = pControlPoints[index1];
+      continue;
+    }
+    double value0 = pControlPoints[index0];
+    double value1 = pControlPoints[index1];
+    double alpha = (sourceModuleValue - value0) / (value1 - value0);
+    if (isInverted) {
+      alpha = 1.0 - alpha;
+      SwapValues (value0, value1);
+    }
+    alpha *= alpha;
+    pDest[i] = LinearInterp (value0, value1, alpha);
+  }
+}
+
+void noise::kernels::Curve (const module::Curve& curve,
+  const double* pSource, double* pDest, int count)
+{
+  const ControlPoint* pControlPoints = curve.GetControlPointArray ();
+  int controlPointCount = curve.GetControlPointCount ();
+  for (int i = 0; i < count; i++) {
+    double sourceModuleValue = pSource[i];
+    int indexPos;
+    for (indexPos = 0; indexPos < controlPointCount; indexPos++) {
+      if (sourceModuleValue < pControlPoints[indexPos].inputValue) {
+        break;
+      }
+    }
+    int index0 = ClampValue (indexPos - 2, 0, controlPointCount - 1);
+    int index1 = ClampValue (indexPos - 1, 0, controlPointCount - 1);
+    int index2 = ClampValue (indexPos    , 0, controlPointCount - 1);
+    int index3 = ClampValue (indexPos + 1, 0, controlPointCount - 1);
+    if (index1 == index2) {
+      pDest[i] = pControlPoints[index1].outputValue;
+      continue;
+    }
+    double input0 = pControlPoints[index1].inputValue;
+    double input1 = pControlPoints[index2].inputValue;
+    double alpha = (sourceModuleValue - input0) / (input1 - input0);
+    pDest[i] = CubicInterp (
+      pControlPoints[index0].outputValue,
+      pControlPoints[index1].outputValue,
+      pControlPoints[index2].outputValue,
+      pControlPoints[index3].outputValue,
+      alpha);
+  }
+}
+
+void noise::kernels::Add (const double* pSource0, const double* pSource1,
+  double* pDest, int count)
+{
+  for (int i = 0; i < count; i++) {
+    pDest[i] = pSource0[i] + pSource1[i];
+  }
+}
+
+void noise::kernels::Multiply (const double* pSource0,
+  const double* pSource1, double* pDest, int count)
+{
+  for (int i = 0; i < count; i++) {
+    pDest[i] = pSource0[i] * pSource1[i];
+  }
+}
+
+void noise::kernels::Max (const double* pSource0, const double* pSource1,
+  double* pDest, int count)
+{
+  for (int i = 0; i < count; i++) {
+    pDest[i] = GetMax (pSource0[i], pSource1[i]);
+  }
+}
+
+void noise::kernels::Min (const double* pSource0, const double* pSource1,
+  double* pDest, int count)
+{
+  for (int i = 0; i < count; i++) {
+    pDest[i] = GetMin (pSource0[i], pSource1[i]);
+  }
+}
+
+void noise::kernels::Power (const double* pSource0, const double* pSource1,
+  double* pDest, int count)
+{
+  for (int i = 0; i < count; i++) {
+    pDest[i] = pow (pSource0[i], pSource1[i]);
+  }
+}
+
+void noise::kernels::Blend (const double* pSource0, const double* pSource1,
+  const double* pControl, double* pDest, int count)
+{
+  for (int i = 0; i < count; i++) {
+    double alpha = (pControl[i] + 1.0) / 2.0;
+    pDest[i] = LinearInterp (pSource0[i], pSource1[i], alpha);
+  }
+}
+
+void noise::kernels::Select (const double* pSource0, const double* pSource1,
+  const double* pControl, double lowerBound, double upperBound,
+  double edgeFalloff, double* pDest, int count)
+{
+  for (int i = 0; i < count; i++) {
+    double controlValue = pControl[i];
+    double value0 = pSource0[i];
+    double value1 = pSource1[i];
+    if (edgeFalloff > 0.0) {
+      if (controlValue < (lowerBound - edgeFalloff)) {
+        pDest[i] = value0;
+      } else if (controlValue < (lowerBound + edgeFalloff)) {
+        double lowerCurve = (lowerBound - edgeFalloff);
+        double upperCurve = (lowerBound + edgeFalloff);
+        double alpha = SCurve3 (
+          (controlValue - lowerCurve) / (upperCurve - lowerCurve));
+        pDest[i] = LinearInterp (value0, value1, alpha);
+      } else if (controlValue < (upperBound - edgeFalloff)) {
+        pDest[i] = value1;
+      } else if (controlValue < (upperBound + edgeFalloff)) {
+        double lowerCurve = (upperBound - edgeFalloff);
+        double upperCurve = (upperBound + edgeFalloff);
+        double alpha = SCurve3 (
+          (controlValue - lowerCurve) / (upperCurve - lowerCurve));
+        pDest[i] = LinearInterp (value1, value0, alpha);
+      } else {
+        pDest[i] = value0;
+      }
+    } else {
+      if (controlValue < lowerBound || controlValue > upperBound) {
+        pDest[i] = value0;
+      } else {
+        pDest[i] = value1;
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Batch evaluation
+
+void noise::GetValues (const Module& sourceModule, const double* pX,
+  const double* pY, const double* pZ, double* pDest, int count)
+{
+  CacheScope cacheScope;
+  for (int first = 0; first < count; first += BATCH_BLOCK_SIZE) {
+    int blockCount = std::min (BATCH_BLOCK_SIZE, count - first);
+    GetBlockValues (sourceModule, pX + first, pY + first, pZ + first,
+      pDest + first, blockCount);
+  }
+}
+
+void noise::GetGridValues (const Module& sourceModule, const double* pX,
+  int width, const double* pZ, int height, double* pDest)
+{
+  // Perlin-family modules run the grid kernel directly.
+  FractalParams params;
+  if (GetFractalParams (sourceModule, params)) {
+    FractalGridValues (params, pX, width, pZ, height, pDest);
+    return;
+  }
+
+  // Any other graph is evaluated row by row.
+  std::vector<double> yRow (width, 0.0);
+  std::vector<double> zRow (width);
+  for (int row = 0; row < height; row++) {
+    std::fill (zRow.begin (), zRow.end (), pZ[row]);
+    GetValues (sourceModule, pX, &yRow[0], &zRow[0],
+      pDest + (size_t)row * width, width);
+  }
+}
+
+void noise::GetPeriodicGridValues (const Module& sourceModule,
+  const double* pX, int width, const double* pZ, int height, double periodX,
+  double periodZ, double* pDest)
+{
+  FractalParams params;
+  if (!GetFractalParams (sourceModule, params)
+    || !SetupPeriods (params, periodX, periodZ)) {
+    throw noise::ExceptionInvalidParam ();
+  }
+  FractalGridValues (params, pX, width, pZ, height, pDest);
+}
+
+bool noise::IsPeriodSupported (const Module& sourceModule, double periodX,
+  double periodZ)
+{
+  FractalParams params;
+  return GetFractalParams (sourceModule, params)
+    && SetupPeriods (params, periodX, periodZ);
+}
+
+void noise::GetGridGradients (const Module& sourceModule, const double* pX,
+  int width, const double* pZ, int height, double* pDest, double* pDestDX,
+  double* pDestDZ)
+{
+  FractalParams params;
+  if (!GetFractalParams (sourceModule, params)) {
+    throw noise::ExceptionInvalidParam ();
+  }
+  FractalGridGradients (params, pX, width, pZ, height, pDest, pDestDX,
+    pDestDZ);
+}
+
+bool noise::IsGradientSupported (const Module& sourceModule)
+{
+  FractalParams params;
+  return GetFractalParams (sourceModule, params);
+}
+
+void noise::EnableBatchSimd (bool enable)
+{
+  g_isSimdEnabled.store (enable, std::memory_order_relaxed);
+}
+
+bool noise::IsBatchSimdEnabled ()
+{
+  return UseAvx2 ();
+}
+
+void noise::EnableOctaveSpecialization (bool enable)
+{
+  g_isOctaveSpecializationEnabled.store (enable, std::memory_order_relaxed);
+}
+
+bool noise::IsOctaveSpecializationEnabled ()
+{
+  return g_isOctaveSpecializationEnabled.load (std::memory_order_relaxed);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Planar and periodic generator values (noisegen2d.h)
+//
+// Defined here so that they share the fractal parameters and octave loop of
+// the batch kernels.
+
+double noise::GetValue2D (const Perlin& perlin, double x, double z)
+{
+  double y = 0.0;
+  double value;
+  ScalarFractalValues (GetPerlinParams (perlin), &x, &y, &z, &value, 1,
+    true);
+  return value;
+}
+
+double noise::GetValue2D (const Billow& billow, double x, double z)
+{
+  double y = 0.0;
+  double value;
+  ScalarFractalValues (GetBillowParams (billow), &x, &y, &z, &value, 1,
+    true);
+  return value;
+}
+
+double noise::GetValue2D (const RidgedMulti& ridged, double x, double z)
+{
+  double y = 0.0;
+  double value;
+  ScalarFractalValues (GetRidgedParams (ridged), &x, &y, &z, &value, 1,
+    true);
+  return value;
+}
+
+double noise::GetValueDeriv2D (const Perlin& perlin, double x, double z,
+  double& dx, double& dz)
+{
+  return FractalValueDeriv2D (GetPerlinParams (perlin), x, z, dx, dz);
+}
+
+double noise::GetValueDeriv2D (const Billow& billow, double x, double z,
+  double& dx, double& dz)
+{
+  return FractalValueDeriv2D (GetBillowParams (billow), x, z, dx, dz);
+}
+
+double noise::GetValueDeriv2D (const RidgedMulti& ridged, double x, double z,
+  double& dx, double& dz)
+{
+  return FractalValueDeriv2D (GetRidgedParams (ridged), x, z, dx, dz);
+}
+
+double noise::GetPeriodicValue2D (const Perlin& perlin, double x, double z,
+  double periodX, double periodZ)
+{
+  FractalParams params = GetPerlinParams (perlin);
+  if (!SetupPeriods (params, periodX, periodZ)) {
+    throw noise::ExceptionInvalidParam ();
+  }
+  return PeriodicFractalValue (params, x, z);
+}
+
+double noise::GetPeriodicValue2D (const Billow& billow, double x, double z,
+  double periodX, double periodZ)
+{
+  FractalParams params = GetBillowParams (billow);
+  if (!SetupPeriods (params, periodX, periodZ)) {
+    throw noise::ExceptionInvalidParam ();
+  }
+  return PeriodicFractalValue (params, x, z);
+}
+
+double noise::GetPeriodicValue2D (const RidgedMulti& ridged, double x,
+  double z, double periodX, double periodZ)
+{
+  FractalParams params = GetRidgedParams (ridged);
+  if (!SetupPeriods (params, periodX, periodZ)) {
+    throw noise::ExceptionInvalidParam ();
+  }
+  return PeriodicFractalValue (params, x, z);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// FastVoronoi noise module (module/fastvoronoi.h)
+//
+// Defined here so that it shares the seed point search of the batch kernel.
+
+FastVoronoi::FastVoronoi ()
+{
+}
+
+double FastVoronoi::GetValue (double x, double y, double z) const
+{
+  x *= GetFrequency ();
+  y *= GetFrequency ();
+  z *= GetFrequency ();
+  HashedSeedPoints seedPoints = {GetSeed ()};
+  VoronoiCandidate nearest;
+  FindNearestSeedPoint (seedPoints, x, y, z, LatticeCoord (x),
+    LatticeCoord (y), LatticeCoord (z), nearest);
+  return VoronoiValue (*this, nearest, x, y, z);
+}
@@ -0,0 +1,693 @@
+// compiledgraph.cpp
+//
+// Noise module that evaluates a module graph flattened into a linear
+// program.  Not part of the original libnoise distribution; it is compiled
+// with the game sources.
+//
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <typeinfo>
+
+#include <noise/batch.h>
+#include <noise/batchkernels.h>
+#include <noise/module/compiledgraph.h>
+#include <noise/module/module.h>
+
+using namespace noise;
+using namespace noise::module;
+
+namespace
+{
+
+  // Input coordinate registers.
+  const int X_REGISTER = 0;
+  const int Y_REGISTER = 1;
+  const int Z_REGISTER = 2;
+  const int INPUT_REGISTER_COUNT = 3;
+
+  // Offsets that Turbulence adds to the input value before sampling each of
+  // its distortion modules (turbulence.cpp).
+  const double TURBULENCE_OFFSETS[3][3] = {
+    {12414.0 / 65536.0, 65124.0 / 65536.0, 31337.0 / 65536.0},
+    {26519.0 / 65536.0, 18128.0 / 65536.0, 60493.0 / 65536.0},
+    {53820.0 / 65536.0, 11213.0 / 65536.0, 44845.0 / 65536.0}
+  };
+
+  typedef CompiledGraph::Instruction Instruction;
+
+  // Executes one instruction on blocks of @a count values.
+  void Execute (const Instruction& instruction, double* const* ppRegisters,
+    int count)
+  {
+    double* pDest = ppRegisters[instruction.dest];
+    const double* pSource0 = (instruction.src[0] >= 0)?
+      ppRegisters[instruction.src[0]]: NULL;
+    const double* pSource1 = (instruction.src[1] >= 0)?
+      ppRegisters[instruction.src[1]]: NULL;
+    const double* pSource2 = (instruction.src[2] >= 0)?
+      ppRegisters[instruction.src[2]]: NULL;
+    const double* params = instruction.params;
+
+    switch (instruction.opCode) {
+      case CompiledGraph::OP_CONST:
+        std::fill (pDest, pDest + count, params[0]);
+        break;
+      case CompiledGraph::OP_GENERATE:
+        GetValues (*instruction.pModule, pSource0, pSource1, pSource2, pDest,
+          count);
+        break;
+      case CompiledGraph::OP_SCALE_BIAS:
+        kernels::ScaleBias (pSource0, params[0], params[1], pDest, count);
+        break;
+      case CompiledGraph::OP_ABS:
+        kernels::Abs (pSource0, pDest, count);
+        break;
+      case CompiledGraph::OP_CLAMP:
+        kernels::Clamp (pSource0, params[0], params[1], pDest, count);
+        break;
+      case CompiledGraph::OP_EXPONENT:
+        kernels::Exponent (pSource0, params[0], pDest, count);
+        break;
+      case CompiledGraph::OP_CURVE:
+        kernels::Curve (static_cast<const Curve&> (*instruction.pModule),
+          pSource0, pDest, count);
+        break;
+      case CompiledGraph::OP_TERRACE:
+        kernels::Terrace (static_cast<const Terrace&> (*instruction.pModule),
+          pSource0, pDest, count);
+        break;
+      case CompiledGraph::OP_ADD:
+        kernels::Add (pSource0, pSource1, pDest, count);
+        break;
+      case CompiledGraph::OP_MULTIPLY:
+        kernels::Multiply (pSource0, pSource1, pDest, count);
+        break;
+      case CompiledGraph::OP_MAX:
+        kernels::Max (pSource0, pSource1, pDest, count);
+        break;
+      case CompiledGraph::OP_MIN:
+        kernels::Min (pSource0, pSource1, pDest, count);
+        break;
+      case CompiledGraph::OP_POWER:
+        kernels::Power (pSource0, pSource1, pDest, count);
+        break;
+      case CompiledGraph::OP_BLEND:
+        kernels::Blend (pSource0, pSource1, pSource2, pDest, count);
+        break;
+      case CompiledGraph::OP_SELECT:
+        kernels::Select (pSource0, pSource1, pSource2, params[0], params[1],
+          params[2], pDest, count);
+        break;
+    }
+  }
+
+  // A compiled value: either a constant known at compile time or a
+  // register written by the program.
+  struct Operand
+  {
+    bool isConst;
+    double value;
+    int reg;
+  };
+
+  Operand MakeConst (double value)
+  {
+    Operand operand = {true, value, -1};
+    return operand;
+  }
+
+  Operand MakeRegister (int reg)
+  {
+    Operand operand = {false, 0.0, reg};
+    return operand;
+  }
+
+  template <class T>
+  inline const T* AsModule (const Module& sourceModule)
+  {
+    return (typeid (sourceModule) == typeid (T))?
+      static_cast<const T*> (&sourceModule): NULL;
+  }
+
+  // Builds the program of a CompiledGraph.  Registers are virtual (one per
+  // instruction) until AllocateRegisters () packs them.
+  class GraphCompiler
+  {
+
+    public:
+
+      GraphCompiler (std::vector<Instruction>& program,
+        std::vector<std::unique_ptr<Module> >& ownedModules):
+        m_program (program),
+        m_ownedModules (ownedModules),
+        m_nextRegister (INPUT_REGISTER_COUNT)
+      {
+      }
+
+      Operand CompileModule (const Module& sourceModule, int x, int y, int z)
+      {
+        // A module reached twice with the same input values is evaluated
+        // once.
+        std::tuple<const Module*, int, int, int> key (&sourceModule, x, y, z);
+        std::map<std::tuple<const Module*, int, int, int>, Operand>::iterator
+          found = m_compiled.find (key);
+        if (found != m_compiled.end ()) {
+          return found->second;
+        }
+        Operand result = CompileNew (sourceModule, x, y, z);
+        m_compiled[key] = result;
+        return result;
+      }
+
+      // Forces an operand into a register.
+      int Materialize (const Operand& operand)
+      {
+        if (!operand.isConst) {
+          return operand.reg;
+        }
+        Instruction instruction = NewInstruction (CompiledGraph::OP_CONST);
+        instruction.params[0] = operand.value;
+        return Emit (instruction).reg;
+      }
+
+      int GetVirtualRegisterCount () const
+      {
+        return m_nextRegister;
+      }
+
+    private:
+
+      Instruction NewInstruction (CompiledGraph::OpCode opCode)
+      {
+        Instruction instruction;
+        instruction.opCode = opCode;
+        instruction.dest = -1;
+        instruction.src[0] = instruction.src[1] = instruction.src[2] = -1;
+        instruction.params[0] = instruction.params[1] = 0.0;
+        instruction.params[2] = 0.0;
+        instruction.pModule = NULL;
+        return instruction;
+      }
+
+      Operand Emit (Instruction instruction)
+      {
+        instruction.dest = m_nextRegister++;
+        m_program.push_back (instruction);
+        m_producers[instruction.dest] = (int)m_program.size () - 1;
+        return MakeRegister (instruction.dest);
+      }
+
+      // Emits an operation on operands, or folds it into a constant if all
+      // of its operands are constants.
+      Operand EmitOperation (Instruction instruction, const Operand* operands,
+        int operandCount)
+      {
+        bool isAllConst = true;
+        for (int i = 0; i < operandCount; i++) {
+          isAllConst = isAllConst && operands[i].isConst;
+        }
+        if (isAllConst) {
+          double values[4];
+          double* ppRegisters[4];
+          for (int i = 0; i < operandCount; i++) {
+            values[i] = operands[i].value;
+            ppRegisters[i] = &values[i];
+            instruction.src[i] = i;
+          }
+          ppRegisters[3] = &values[3];
+          instruction.dest = 3;
+          Execute (instruction, ppRegisters, 1);
+          return MakeConst (values[3]);
+        }
+        for (int i = 0; i < operandCount; i++) {
+          instruction.src[i] = Materialize (operands[i]);
+        }
+        return Emit (instruction);
+      }
+
+      // operand * scale + bias, merged into the instruction that produced
+      // the operand if that was a scale-and-bias instruction as well.
+      Operand EmitScaleBias (const Operand& operand, double scale,
+        double bias)
+      {
+        if (operand.isConst) {
+          return MakeConst (operand.value * scale + bias);
+        }
+        if (scale == 1.0 && bias == 0.0) {
+          return operand;
+        }
+        std::map<int, int>::const_iterator producer =
+          m_producers.find (operand.reg);
+        if (producer != m_producers.end ()) {
+          const Instruction& previous = m_program[producer->second];
+          if (previous.opCode == CompiledGraph::OP_SCALE_BIAS) {
+            return EmitScaleBias (MakeRegister (previous.src[0]),
+              previous.params[0] * scale, previous.params[1] * scale + bias);
+          }
+        }
+        Instruction instruction = NewInstruction (
+          CompiledGraph::OP_SCALE_BIAS);
+        instruction.src[0] = operand.reg;
+        instruction.params[0] = scale;
+        instruction.params[1] = bias;
+        return Emit (instruction);
+      }
+
+      Operand Source (const Module& sourceModule, int index, int x, int y,
+        int z)
+      {
+        return CompileModule (sourceModule.GetSourceModule (index), x, y, z);
+      }
+
+      Operand EmitGenerator (const Module& sourceModule, int x, int y, int z)
+      {
+        Instruction instruction = NewInstruction (CompiledGraph::OP_GENERATE);
+        instruction.src[0] = x;
+        instruction.src[1] = y;
+        instruction.src[2] = z;
+        instruction.pModule = &sourceModule;
+        return Emit (instruction);
+      }
+
+      Operand CompileNew (const Module& sourceModule, int x, int y, int z)
+      {
+        // Constants and transparent modules.
+        if (const Const* pConst = AsModule<Const> (sourceModule)) {
+          return MakeConst (pConst->GetConstValue ());
+        }
+        if (AsModule<Cache> (sourceModule) != NULL
+          || AsModule<ThreadCache> (sourceModule) != NULL
+          || AsModule<LruCache> (sourceModule) != NULL) {
+          return Source (sourceModule, 0, x, y, z);
+        }
+
+        // Modifiers.
+        if (const ScaleBias* pScaleBias = AsModule<ScaleBias> (sourceModule)) {
+          return EmitScaleBias (Source (sourceModule, 0, x, y, z),
+            pScaleBias->GetScale (), pScaleBias->GetBias ());
+        }
+        if (AsModule<Invert> (sourceModule) != NULL) {
+          return EmitScaleBias (Source (sourceModule, 0, x, y, z), -1.0, 0.0);
+        }
+        if (AsModule<Abs> (sourceModule) != NULL) {
+          Operand source = Source (sourceModule, 0, x, y, z);
+          return EmitOperation (NewInstruction (CompiledGraph::OP_ABS),
+            &source, 1);
+        }
+        if (const Clamp* pClamp = AsModule<Clamp> (sourceModule)) {
+          Operand source = Source (sourceModule, 0, x, y, z);
+          Instruction instruction = NewInstruction (CompiledGraph::OP_CLAMP);
+          instruction.params[0] = pClamp->GetLowerBound ();
+          instruction.params[1] = pClamp->GetUpperBound ();
+          return EmitOperation (instruction, &source, 1);
+        }
+        if (const Exponent* pExponent = AsModule<Exponent> (sourceModule)) {
+          Operand source = Source (sourceModule, 0, x, y, z);
+          Instruction instruction = NewInstruction (
+            CompiledGraph::OP_EXPONENT);
+          instruction.params[0] = pExponent->GetExponent ();
+          return EmitOperation (instruction, &source, 1);
+        }
+        const Curve* pCurve = AsModule<Curve> (sourceModule);
+        if (pCurve != NULL && pCurve->GetControlPointCount () >= 4) {
+          Operand source = Source (sourceModule, 0, x, y, z);
+          Instruction instruction = NewInstruction (CompiledGraph::OP_CURVE);
+          instruction.pModule = pCurve;
+          return EmitOperation (instruction, &source, 1);
+        }
+        const Terrace* pTerrace = AsModule<Terrace> (sourceModule);
+        if (pTerrace != NULL && pTerrace->GetControlPointCount () >= 2) {
+          Operand source = Source (sourceModule, 0, x, y, z);
+          Instruction instruction = NewInstruction (
+            CompiledGraph::OP_TERRACE);
+          instruction.pModule = pTerrace;
+          return EmitOperation (instruction, &source, 1);
+        }
+
+        // Combiners.  Additions and multiplications by a constant become
+        // scale-and-bias instructions.
+        bool isAdd = AsModule<Add> (sourceModule) != NULL;
+        bool isMultiply = AsModule<Multiply> (sourceModule) != NULL;
+        if (isAdd || isMultiply) {
+          Operand operands[2] = {
+            Source (sourceModule, 0, x, y, z),
+            Source (sourceModule, 1, x, y, z)
+          };
+          for (int i = 0; i < 2; i++) {
+            const Operand& constant = operands[i];
+            const Operand& other = operands[1 - i];
+            if (constant.isConst && !other.isConst) {
+              return isAdd?
+                EmitScaleBias (other, 1.0, constant.value):
+                EmitScaleBias (other, constant.value, 0.0);
+            }
+          }
+          return EmitOperation (NewInstruction (isAdd?
+            CompiledGraph::OP_ADD: CompiledGraph::OP_MULTIPLY), operands, 2);
+        }
+        CompiledGraph::OpCode combineOp = CompiledGraph::OP_CONST;
+        if (AsModule<Max> (sourceModule) != NULL) {
+          combineOp = CompiledGraph::OP_MAX;
+        } else if (AsModule<Min> (sourceModule) != NULL) {
+          combineOp = CompiledGraph::OP_MIN;
+        } else if (AsModule<Power> (sourceModule) != NULL) {
+          combineOp = CompiledGraph::OP_POWER;
+        }
+        if (combineOp != CompiledGraph::OP_CONST) {
+          Operand operands[2] = {
+            Source (sourceModule, 0, x, y, z),
+            Source (sourceModule, 1, x, y, z)
+          };
+          return EmitOperation (NewInstruction (combineOp), operands, 2);
+        }
+
+        // Selectors.
+        if (AsModule<Blend> (sourceModule) != NULL) {
+          Operand operands[3] = {
+            Source (sourceModule, 0, x, y, z),
+            Source (sourceModule, 1, x, y, z),
+            Source (sourceModule, 2, x, y, z)
+          };
+          return EmitOperation (NewInstruction (CompiledGraph::OP_BLEND),
+            operands, 3);
+        }
+        if (const Select* pSelect = AsModule<Select> (sourceModule)) {
+          return CompileSelect (*pSelect, x, y, z);
+        }
+
+        // Transformers.
+        if (const ScalePoint* pScalePoint =
+          AsModule<ScalePoint> (sourceModule)) {
+          return Source (sourceModule, 0,
+            Materialize (EmitScaleBias (MakeRegister (x),
+              pScalePoint->GetXScale (), 0.0)),
+            Materialize (EmitScaleBias (MakeRegister (y),
+              pScalePoint->GetYScale (), 0.0)),
+            Materialize (EmitScaleBias (MakeRegister (z),
+              pScalePoint->GetZScale (), 0.0)));
+        }
+        if (const TranslatePoint* pTranslatePoint =
+          AsModule<TranslatePoint> (sourceModule)) {
+          return Source (sourceModule, 0,
+            Materialize (EmitScaleBias (MakeRegister (x), 1.0,
+              pTranslatePoint->GetXTranslation ())),
+            Materialize (EmitScaleBias (MakeRegister (y), 1.0,
+              pTranslatePoint->GetYTranslation ())),
+            Materialize (EmitScaleBias (MakeRegister (z), 1.0,
+              pTranslatePoint->GetZTranslation ())));
+        }
+        if (AsModule<Displace> (sourceModule) != NULL) {
+          int coords[3] = {x, y, z};
+          int displaced[3];
+          for (int axis = 0; axis < 3; axis++) {
+            Operand operands[2] = {
+              MakeRegister (coords[axis]),
+              Source (sourceModule, axis + 1, x, y, z)
+            };
+            displaced[axis] = Materialize (operands[1].isConst?
+              EmitScaleBias (operands[0], 1.0, operands[1].value):
+              EmitOperation (NewInstruction (CompiledGraph::OP_ADD),
+                operands, 2));
+          }
+          return Source (sourceModule, 0, displaced[0], displaced[1],
+            displaced[2]);
+        }
+        if (const Turbulence* pTurbulence =
+          AsModule<Turbulence> (sourceModule)) {
+          return CompileTurbulence (*pTurbulence, x, y, z);
+        }
+
+        // Generators and modules without a compiled form.
+        return EmitGenerator (sourceModule, x, y, z);
+      }
+
+      Operand CompileSelect (const Select& select, int x, int y, int z)
+      {
+        double lowerBound = select.GetLowerBound ();
+        double upperBound = select.GetUpperBound ();
+        double edgeFalloff = select.GetEdgeFalloff ();
+        Operand control = Source (select, 2, x, y, z);
+
+        // A constant control value that lies outside the falloff zones
+        // picks one source module for the whole graph.
+        if (control.isConst) {
+          double controlValue = control.value;
+          bool isSource0;
+          bool isSource1;
+          if (edgeFalloff > 0.0) {
+            isSource0 = controlValue < lowerBound - edgeFalloff
+              || controlValue >= upperBound + edgeFalloff;
+            isSource1 = controlValue >= lowerBound + edgeFalloff
+              && controlValue < upperBound - edgeFalloff;
+          } else {
+            isSource0 = controlValue < lowerBound
+              || controlValue > upperBound;
+            isSource1 = !isSource0;
+          }
+          if (isSource0) {
+            return Source (select, 0, x, y, z);
+          }
+          if (isSource1) {
+            return Source (select, 1, x, y, z);
+          }
+        }
+
+        Operand operands[3] = {
+          Source (select, 0, x, y, z),
+          Source (select, 1, x, y, z),
+          control
+        };
+        Instruction instruction = NewInstruction (CompiledGraph::OP_SELECT);
+        instruction.params[0] = lowerBound;
+        instruction.params[1] = upperBound;
+        instruction.params[2] = edgeFalloff;
+        return EmitOperation (instruction, operands, 3);
+      }
+
+      Operand CompileTurbulence (const Turbulence& turbulence, int x, int y,
+        int z)
+      {
+        // The distortion modules of a Turbulence module are Perlin modules
+        // that only differ in their seeds.  They are protected, so the
+        // compiler creates its own copies.
+        int coords[3] = {x, y, z};
+        int distorted[3];
+        for (int axis = 0; axis < 3; axis++) {
+          Perlin* pDistortModule = new Perlin ();
+          m_ownedModules.push_back (std::unique_ptr<Module> (pDistortModule));
+          pDistortModule->SetFrequency (turbulence.GetFrequency ());
+          pDistortModule->SetOctaveCount (turbulence.GetRoughnessCount ());
+          pDistortModule->SetSeed (turbulence.GetSeed () + axis);
+
+          int xOffset = Materialize (EmitScaleBias (MakeRegister (x), 1.0,
+            TURBULENCE_OFFSETS[axis][0]));
+          int yOffset = Materialize (EmitScaleBias (MakeRegister (y), 1.0,
+            TURBULENCE_OFFSETS[axis][1]));
+          int zOffset = Materialize (EmitScaleBias (MakeRegister (z), 1.0,
+            TURBULENCE_OFFSETS[axis][2]));
+          Operand distortion = EmitScaleBias (
+            EmitGenerator (*pDistortModule, xOffset, yOffset, zOffset),
+            turbulence.GetPower (), 0.0);
+          Operand operands[2] = {MakeRegister (coords[axis]), distortion};
+          distorted[axis] = Materialize (EmitOperation (
+            NewInstruction (CompiledGraph::OP_ADD), operands, 2));
+        }
+        return Source (turbulence, 0, distorted[0], distorted[1],
+          distorted[2]);
+      }
+
+      std::vector<Instruction>& m_program;
+      std::vector<std::unique_ptr<Module> >& m_ownedModules;
+      std::map<std::tuple<const Module*, int, int, int>, Operand> m_compiled;
+      std::map<int, int> m_producers;
+      int m_nextRegister;
+
+  };
+
+  // Removes instructions whose results are never read, then renumbers the
+  // virtual registers so that registers are reused once their last reader
+  // has run.  Returns the number of registers.
+  int AllocateRegisters (std::vector<Instruction>& program,
+    int virtualRegisterCount, int& resultRegister)
+  {
+    // Dead instruction elimination, walking backwards from the result.
+    std::vector<bool> isLive (virtualRegisterCount, false);
+    isLive[resultRegister] = true;
+    std::vector<Instruction> liveProgram;
+    for (int i = (int)program.size () - 1; i >= 0; i--) {
+      const Instruction& instruction = program[i];
+      if (!isLive[instruction.dest]) {
+        continue;
+      }
+      for (int j = 0; j < 3; j++) {
+        if (instruction.src[j] >= 0) {
+          isLive[instruction.src[j]] = true;
+        }
+      }
+      liveProgram.push_back (instruction);
+    }
+    std::reverse (liveProgram.begin (), liveProgram.end ());
+    program.swap (liveProgram);
+
+    // Last instruction that reads each virtual register.
+    std::vector<int> lastUse (virtualRegisterCount, -1);
+    for (int i = 0; i < (int)program.size (); i++) {
+      for (int j = 0; j < 3; j++) {
+        if (program[i].src[j] >= 0) {
+          lastUse[program[i].src[j]] = i;
+        }
+      }
+    }
+    lastUse[resultRegister] = (int)program.size ();
+
+    // Linear scan.  A destination never shares a register with one of its
+    // own sources: generators read their input values while they write.
+    std::vector<int> physical (virtualRegisterCount, -1);
+    for (int i = 0; i < INPUT_REGISTER_COUNT; i++) {
+      physical[i] = i;
+    }
+    std::vector<int> freeRegisters;
+    int registerCount = INPUT_REGISTER_COUNT;
+    for (int i = 0; i < (int)program.size (); i++) {
+      Instruction& instruction = program[i];
+      int sourceRegisters[3] = {
+        instruction.src[0], instruction.src[1], instruction.src[2]
+      };
+      for (int j = 0; j < 3; j++) {
+        if (instruction.src[j] >= 0) {
+          instruction.src[j] = physical[instruction.src[j]];
+        }
+      }
+
+      int dest;
+      if (!freeRegisters.empty ()) {
+        dest = freeRegisters.back ();
+        freeRegisters.pop_back ();
+      } else {
+        dest = registerCount++;
+      }
+      physical[instruction.dest] = dest;
+
+      // Release the registers whose last reader is this instruction.
+      for (int j = 0; j < 3; j++) {
+        int source = sourceRegisters[j];
+        bool isRepeated = (j > 0 && source == sourceRegisters[0])
+          || (j > 1 && source == sourceRegisters[1]);
+        if (source >= INPUT_REGISTER_COUNT && !isRepeated
+          && lastUse[source] == i) {
+          freeRegisters.push_back (physical[source]);
+        }
+      }
+      instruction.dest = dest;
+    }
+    resultRegister = physical[resultRegister];
+    return registerCount;
+  }
+
+}
+
+CompiledGraph::CompiledGraph ():
+  Module (GetSourceModuleCount ()),
+  m_registerCount (INPUT_REGISTER_COUNT),
+  m_resultRegister (X_REGISTER),
+  m_resultConst (0.0),
+  m_isResultConst (false),
+  m_isCompiled (false)
+{
+}
+
+CompiledGraph::~CompiledGraph ()
+{
+}
+
+void CompiledGraph::Compile (const Module& sourceModule)
+{
+  std::vector<Instruction> program;
+  std::vector<std::unique_ptr<Module> > ownedModules;
+  GraphCompiler compiler (program, ownedModules);
+  Operand result = compiler.CompileModule (sourceModule, X_REGISTER,
+    Y_REGISTER, Z_REGISTER);
+
+  m_isResultConst = result.isConst;
+  m_resultConst = result.value;
+  if (result.isConst) {
+    program.clear ();
+    m_registerCount = INPUT_REGISTER_COUNT;
+    m_resultRegister = X_REGISTER;
+  } else {
+    m_resultRegister = result.reg;
+    m_registerCount = AllocateRegisters (program,
+      compiler.GetVirtualRegisterCount (), m_resultRegister);
+  }
+
+  m_program.swap (program);
+  m_ownedModules.swap (ownedModules);
+  m_isCompiled = true;
+}
+
+void CompiledGraph::RunBlock (const double* pX, const double* pY,
+  const double* pZ, double* pDest, int count, double* pScratch) const
+{
+  if (m_isResultConst) {
+    std::fill (pDest, pDest + count, m_resultConst);
+    return;
+  }
+
+  // The input registers point at the caller's arrays; instructions never
+  // write them.
+  double* ppRegisters[256];
+  std::vector<double*> registerTable;
+  double** ppTable = ppRegisters;
+  if (m_registerCount > 256) {
+    registerTable.resize (m_registerCount);
+    ppTable = &registerTable[0];
+  }
+  ppTable[X_REGISTER] = const_cast<double*> (pX);
+  ppTable[Y_REGISTER] = const_cast<double*> (pY);
+  ppTable[Z_REGISTER] = const_cast<double*> (pZ);
+  for (int i = INPUT_REGISTER_COUNT; i < m_registerCount; i++) {
+    ppTable[i] = pScratch + (size_t)(i - INPUT_REGISTER_COUNT) * count;
+  }
+
+  for (size_t i = 0; i < m_program.size (); i++) {
+    Execute (m_program[i], ppTable, count);
+  }
+  const double* pResult = ppTable[m_resultRegister];
+  std::copy (pResult, pResult + count, pDest);
+}
+
+double CompiledGraph::GetValue (double x, double y, double z) const
+{
+  double value;
+  GetValues (&x, &y, &z, &value, 1);
+  return value;
+}
+
+void CompiledGraph::GetValues (const double* pX, const double* pY,
+  const double* pZ, double* pDest, int count) const
+{
+  if (!m_isCompiled) {
+    throw noise::ExceptionNoModule ();
+  }
+
+  // One scratch block per register; small programs evaluating a single
+  // value stay on the stack.
+  int blockSize = std::min (count, BATCH_BLOCK_SIZE);
+  size_t scratchSize = (size_t)(m_registerCount - INPUT_REGISTER_COUNT)
+    * blockSize;
+  double stackScratch[64];
+  std::vector<double> heapScratch;
+  double* pScratch = stackScratch;
+  if (scratchSize > 64) {
+    heapScratch.resize (scratchSize);
+    pScratch = &heapScratch[0];
+  }
+
+  for (int first = 0; first < count; first += BATCH_BLOCK_SIZE) {
+    int blockCount = std::min (BATCH_BLOCK_SIZE, count - first);
+    RunBlock (pX + first, pY + first, pZ + first, pDest + first, blockCount,
+      pScratch);
+  }
+}
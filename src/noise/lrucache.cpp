@@ -0,0 +1,284 @@
+// lrucache.cpp
+//
+// Multi-entry, thread-safe counterpart of the Cache noise module.  Not part
+// of the original libnoise distribution; it is compiled with the game
+// sources.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <noise/module/lrucache.h>
+#include <noise/module/threadcache.h>
+
+using namespace noise::module;
+
+namespace
+{
+
+  // Hashes the bit patterns of an input value.  Inputs that compare equal
+  // but differ in their bits (0.0 and -0.0) hash differently; they miss,
+  // which costs time but never returns a wrong value.
+  inline unsigned int HashInput (double x, double y, double z)
+  {
+    unsigned long long bits[3];
+    std::memcpy (&bits[0], &x, sizeof (double));
+    std::memcpy (&bits[1], &y, sizeof (double));
+    std::memcpy (&bits[2], &z, sizeof (double));
+    unsigned long long hash = bits[0] * 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ (hash >> 29) ^ bits[1]) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 32) ^ bits[2]) * 0x94d049bb133111ebULL;
+    return (unsigned int)(hash ^ (hash >> 31));
+  }
+
+  inline void AddRelaxed (std::atomic<unsigned long long>& counter)
+  {
+    // Only the thread that owns the table writes its counters.
+    counter.store (counter.load (std::memory_order_relaxed) + 1,
+      std::memory_order_relaxed);
+  }
+
+}
+
+// Hash table of one thread.  The entries form a doubly-linked list in order
+// of use, most recently used first; the least recently used entry is
+// replaced when the table is full.
+struct LruCache::Table
+{
+  struct Entry
+  {
+    double x;
+    double y;
+    double z;
+    double value;
+    unsigned int hash;
+    int prev;
+    int next;
+    int chainNext;
+  };
+
+  explicit Table (int capacity):
+    hitCount (0),
+    missCount (0)
+  {
+    Resize (capacity);
+  }
+
+  void Resize (int newCapacity)
+  {
+    capacity = newCapacity;
+    int bucketCount = 1;
+    while (bucketCount < capacity * 2) {
+      bucketCount <<= 1;
+    }
+    entries.resize (capacity);
+    buckets.resize (bucketCount);
+    bucketMask = (unsigned int)bucketCount - 1;
+    Clear ();
+  }
+
+  void Clear ()
+  {
+    std::fill (buckets.begin (), buckets.end (), -1);
+    head = -1;
+    tail = -1;
+    size = 0;
+  }
+
+  void Unlink (int index)
+  {
+    Entry& entry = entries[index];
+    if (entry.prev >= 0) {
+      entries[entry.prev].next = entry.next;
+    } else {
+      head = entry.next;
+    }
+    if (entry.next >= 0) {
+      entries[entry.next].prev = entry.prev;
+    } else {
+      tail = entry.prev;
+    }
+  }
+
+  void PushFront (int index)
+  {
+    Entry& entry = entries[index];
+    entry.prev = -1;
+    entry.next = head;
+    if (head >= 0) {
+      entries[head].prev = index;
+    } else {
+      tail = index;
+    }
+    head = index;
+  }
+
+  // Returns the entry that holds the input value, or -1.
+  int Find (unsigned int hash, double x, double y, double z) const
+  {
+    for (int index = buckets[hash & bucketMask]; index >= 0;
+      index = entries[index].chainNext) {
+      const Entry& entry = entries[index];
+      if (entry.x == x && entry.y == y && entry.z == z) {
+        return index;
+      }
+    }
+    return -1;
+  }
+
+  void Insert (unsigned int hash, double x, double y, double z,
+    double value)
+  {
+    int index;
+    if (size < capacity) {
+      index = size++;
+    } else {
+      // Evict the least recently used entry.
+      index = tail;
+      Unlink (index);
+      const Entry& evicted = entries[index];
+      int* pLink = &buckets[evicted.hash & bucketMask];
+      while (*pLink != index) {
+        pLink = &entries[*pLink].chainNext;
+      }
+      *pLink = evicted.chainNext;
+    }
+
+    Entry& entry = entries[index];
+    entry.x = x;
+    entry.y = y;
+    entry.z = z;
+    entry.value = value;
+    entry.hash = hash;
+    entry.chainNext = buckets[hash & bucketMask];
+    buckets[hash & bucketMask] = index;
+    PushFront (index);
+  }
+
+  std::vector<Entry> entries;
+  std::vector<int> buckets;
+  unsigned int bucketMask;
+  int capacity;
+  int head;
+  int tail;
+  int size;
+  unsigned int generation;
+  std::atomic<unsigned long long> hitCount;
+  std::atomic<unsigned long long> missCount;
+};
+
+LruCache::LruCache ():
+  Module (GetSourceModuleCount ()),
+  m_pTables (NULL),
+  m_capacity (DEFAULT_LRU_CACHE_CAPACITY),
+  m_generation (1)
+{
+  m_pTables = new std::atomic<Table*>[THREAD_CACHE_MAX_THREADS];
+  for (int i = 0; i < THREAD_CACHE_MAX_THREADS; i++) {
+    m_pTables[i].store (NULL, std::memory_order_relaxed);
+  }
+}
+
+LruCache::~LruCache ()
+{
+  for (int i = 0; i < THREAD_CACHE_MAX_THREADS; i++) {
+    delete m_pTables[i].load (std::memory_order_relaxed);
+  }
+  delete[] m_pTables;
+}
+
+unsigned long long LruCache::GetHitCount () const
+{
+  unsigned long long hitCount = 0;
+  for (int i = 0; i < THREAD_CACHE_MAX_THREADS; i++) {
+    const Table* pTable = m_pTables[i].load (std::memory_order_acquire);
+    if (pTable != NULL) {
+      hitCount += pTable->hitCount.load (std::memory_order_relaxed);
+    }
+  }
+  return hitCount;
+}
+
+unsigned long long LruCache::GetMissCount () const
+{
+  unsigned long long missCount = 0;
+  for (int i = 0; i < THREAD_CACHE_MAX_THREADS; i++) {
+    const Table* pTable = m_pTables[i].load (std::memory_order_acquire);
+    if (pTable != NULL) {
+      missCount += pTable->missCount.load (std::memory_order_relaxed);
+    }
+  }
+  return missCount;
+}
+
+LruCache::Table* LruCache::GetThreadTable () const
+{
+  int slot = GetThreadCacheSlot ();
+  if (slot < 0) {
+    return NULL;
+  }
+
+  // A slot that a finished thread handed back keeps that thread's table;
+  // its values are still valid output values for their input values.
+  Table* pTable = m_pTables[slot].load (std::memory_order_relaxed);
+  if (pTable == NULL) {
+    pTable = new Table (m_capacity);
+    pTable->generation = m_generation;
+    m_pTables[slot].store (pTable, std::memory_order_release);
+  } else if (pTable->generation != m_generation) {
+    if (pTable->capacity != m_capacity) {
+      pTable->Resize (m_capacity);
+    } else {
+      pTable->Clear ();
+    }
+    pTable->generation = m_generation;
+  }
+  return pTable;
+}
+
+double LruCache::GetValue (double x, double y, double z) const
+{
+  assert (m_pSourceModule[0] != NULL);
+
+  Table* pTable = GetThreadTable ();
+  if (pTable == NULL) {
+    return m_pSourceModule[0]->GetValue (x, y, z);
+  }
+
+  unsigned int hash = HashInput (x, y, z);
+  int index = pTable->Find (hash, x, y, z);
+  if (index >= 0) {
+    AddRelaxed (pTable->hitCount);
+    if (index != pTable->head) {
+      pTable->Unlink (index);
+      pTable->PushFront (index);
+    }
+    return pTable->entries[index].value;
+  }
+
+  AddRelaxed (pTable->missCount);
+  double value = m_pSourceModule[0]->GetValue (x, y, z);
+  pTable->Insert (hash, x, y, z, value);
+  return value;
+}
+
+void LruCache::ResetCounters ()
+{
+  for (int i = 0; i < THREAD_CACHE_MAX_THREADS; i++) {
+    Table* pTable = m_pTables[i].load (std::memory_order_relaxed);
+    if (pTable != NULL) {
+      pTable->hitCount.store (0, std::memory_order_relaxed);
+      pTable->missCount.store (0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void LruCache::SetCapacity (int capacity)
+{
+  if (capacity < 1 || capacity > LRU_CACHE_MAX_CAPACITY) {
+    throw noise::ExceptionInvalidParam ();
+  }
+  m_capacity = capacity;
+  m_generation++;
+}
@@ -0,0 +1,237 @@
+// noisegen2d.cpp
+//
+// Two-dimensional gradient noise for planar input values.  Not part of the
+// original libnoise distribution; it is compiled with the game sources.
+//
+
+#include <noise/interp.h>
+#include <noise/noisegen2d.h>
+#include <noise/randomvectors.h>
+
+using namespace noise;
+
+namespace
+{
+
+  // Constants of the lattice hash (noisegen.cpp).  The y term vanishes on
+  // the y = 0 plane.
+  const unsigned int X_NOISE_GEN = 1619;
+  const unsigned int Z_NOISE_GEN = 6971;
+  const unsigned int SEED_NOISE_GEN = 1013;
+  const int SHIFT_NOISE_GEN = 8;
+
+  // GradientNoise2D () for the wrapped lattice point (ix, iz), given the
+  // offsets of the input value from the unwrapped lattice point.
+  inline double PeriodicGradientNoise2D (double dx, double dz, int ix,
+    int iz, int seed)
+  {
+    unsigned int vectorIndex = X_NOISE_GEN * (unsigned int)ix
+      + Z_NOISE_GEN * (unsigned int)iz
+      + SEED_NOISE_GEN * (unsigned int)seed;
+    int hash = (int)vectorIndex;
+    hash ^= (hash >> SHIFT_NOISE_GEN);
+    hash &= 0xff;
+    return ((noise::g_randomVectors[(hash << 2)    ] * dx)
+      + (noise::g_randomVectors[(hash << 2) + 2] * dz)) * 2.12;
+  }
+
+  // The x and z components of the gradient vector GradientNoise2D () uses
+  // at the lattice point (ix, 0, iz), premultiplied by its scaling value.
+  inline void LatticeGradient2D (int ix, int iz, int seed, double& xGradient,
+    double& zGradient)
+  {
+    unsigned int vectorIndex = X_NOISE_GEN * (unsigned int)ix
+      + Z_NOISE_GEN * (unsigned int)iz
+      + SEED_NOISE_GEN * (unsigned int)seed;
+    int hash = (int)vectorIndex;
+    hash ^= (hash >> SHIFT_NOISE_GEN);
+    hash &= 0xff;
+    xGradient = noise::g_randomVectors[(hash << 2)    ] * 2.12;
+    zGradient = noise::g_randomVectors[(hash << 2) + 2] * 2.12;
+  }
+
+  // Derivatives of the S-curves in interp.h.
+  inline double SCurve3Deriv (double a)
+  {
+    return 6.0 * a * (1.0 - a);
+  }
+
+  inline double SCurve5Deriv (double a)
+  {
+    double b = a * (1.0 - a);
+    return 30.0 * b * b;
+  }
+
+}
+
+double noise::GradientCoherentNoise2D (double x, double z, int seed,
+  NoiseQuality noiseQuality)
+{
+  // Create a unit-length square aligned along an integer boundary.  This
+  // square surrounds the input point.  On the y = 0 plane,
+  // GradientCoherentNoise3D () interpolates fully towards its y1 = 0 face,
+  // so only that face is evaluated here.
+  int x0 = (x > 0.0? (int)x: (int)x - 1);
+  int x1 = x0 + 1;
+  int z0 = (z > 0.0? (int)z: (int)z - 1);
+  int z1 = z0 + 1;
+
+  // Map the difference between the coordinates of the input value and the
+  // coordinates of the square's outer-lower-left vertex onto an S-curve.
+  double xs = 0, zs = 0;
+  switch (noiseQuality) {
+    case QUALITY_FAST:
+      xs = (x - (double)x0);
+      zs = (z - (double)z0);
+      break;
+    case QUALITY_STD:
+      xs = SCurve3 (x - (double)x0);
+      zs = SCurve3 (z - (double)z0);
+      break;
+    case QUALITY_BEST:
+      xs = SCurve5 (x - (double)x0);
+      zs = SCurve5 (z - (double)z0);
+      break;
+  }
+
+  // Interpolate between the four corners of the square, in the same order
+  // as the matching corners of GradientCoherentNoise3D ().
+  double n0, n1, ix0, ix1;
+  n0  = GradientNoise2D (x, z, x0, z0, seed);
+  n1  = GradientNoise2D (x, z, x1, z0, seed);
+  ix0 = LinearInterp (n0, n1, xs);
+  n0  = GradientNoise2D (x, z, x0, z1, seed);
+  n1  = GradientNoise2D (x, z, x1, z1, seed);
+  ix1 = LinearInterp (n0, n1, xs);
+  return LinearInterp (ix0, ix1, zs);
+}
+
+double noise::GradientCoherentNoiseDeriv2D (double x, double z, double& dx,
+  double& dz, int seed, NoiseQuality noiseQuality)
+{
+  // Same square and S-curve as GradientCoherentNoise2D (), along with the
+  // slope of the S-curve.
+  int x0 = (x > 0.0? (int)x: (int)x - 1);
+  int x1 = x0 + 1;
+  int z0 = (z > 0.0? (int)z: (int)z - 1);
+  int z1 = z0 + 1;
+  double fx = x - (double)x0;
+  double fz = z - (double)z0;
+  double xs = fx, zs = fz;
+  double xsDeriv = 1.0, zsDeriv = 1.0;
+  switch (noiseQuality) {
+    case QUALITY_FAST:
+      break;
+    case QUALITY_STD:
+      xs = SCurve3 (fx);
+      zs = SCurve3 (fz);
+      xsDeriv = SCurve3Deriv (fx);
+      zsDeriv = SCurve3Deriv (fz);
+      break;
+    case QUALITY_BEST:
+      xs = SCurve5 (fx);
+      zs = SCurve5 (fz);
+      xsDeriv = SCurve5Deriv (fx);
+      zsDeriv = SCurve5Deriv (fz);
+      break;
+  }
+
+  // Each corner value is a dot product with the corner's gradient vector, so
+  // its derivatives are the components of that vector.
+  double gx00, gz00, gx10, gz10, gx01, gz01, gx11, gz11;
+  LatticeGradient2D (x0, z0, seed, gx00, gz00);
+  LatticeGradient2D (x1, z0, seed, gx10, gz10);
+  LatticeGradient2D (x0, z1, seed, gx01, gz01);
+  LatticeGradient2D (x1, z1, seed, gx11, gz11);
+
+  // The values are interpolated in the order GradientCoherentNoise2D ()
+  // uses, so they are the same.
+  double n00 = GradientNoise2D (x, z, x0, z0, seed);
+  double n10 = GradientNoise2D (x, z, x1, z0, seed);
+  double n01 = GradientNoise2D (x, z, x0, z1, seed);
+  double n11 = GradientNoise2D (x, z, x1, z1, seed);
+  double ix0 = LinearInterp (n00, n10, xs);
+  double ix1 = LinearInterp (n01, n11, xs);
+
+  // Product rule on each interpolation: the interpolated derivatives plus
+  // the slope of the weight times the difference of the endpoints.
+  double ix0DX = LinearInterp (gx00, gx10, xs) + xsDeriv * (n10 - n00);
+  double ix0DZ = LinearInterp (gz00, gz10, xs);
+  double ix1DX = LinearInterp (gx01, gx11, xs) + xsDeriv * (n11 - n01);
+  double ix1DZ = LinearInterp (gz01, gz11, xs);
+  dx = LinearInterp (ix0DX, ix1DX, zs);
+  dz = LinearInterp (ix0DZ, ix1DZ, zs) + zsDeriv * (ix1 - ix0);
+  return LinearInterp (ix0, ix1, zs);
+}
+
+double noise::GradientNoise2D (double fx, double fz, int ix, int iz,
+  int seed)
+{
+  // Randomly generate a gradient vector given the integer coordinates of the
+  // input value.  The hash wraps around like the 32-bit arithmetic of
+  // GradientNoise3D ().
+  unsigned int vectorIndex = X_NOISE_GEN * (unsigned int)ix
+    + Z_NOISE_GEN * (unsigned int)iz
+    + SEED_NOISE_GEN * (unsigned int)seed;
+  int hash = (int)vectorIndex;
+  hash ^= (hash >> SHIFT_NOISE_GEN);
+  hash &= 0xff;
+
+  double xvGradient = g_randomVectors[(hash << 2)    ];
+  double zvGradient = g_randomVectors[(hash << 2) + 2];
+
+  // Set up us another vector equal to the distance between the two vectors
+  // passed to this function.
+  double xvPoint = (fx - (double)ix);
+  double zvPoint = (fz - (double)iz);
+
+  // Now compute the dot product of the gradient vector with the distance
+  // vector.  The resulting value is gradient noise.  Apply a scaling value
+  // so that this noise value ranges from -1.0 to 1.0.
+  return ((xvGradient * xvPoint) + (zvGradient * zvPoint)) * 2.12;
+}
+
+double noise::PeriodicGradientCoherentNoise2D (double x, double z,
+  int periodX, int periodZ, int seed, NoiseQuality noiseQuality)
+{
+  // Map the input value into the first period, then find the unit-length
+  // square that surrounds it.  The hashed corners wrap around the period;
+  // the offsets from the corners do not.
+  x = MakePeriodicRange (x, periodX);
+  z = MakePeriodicRange (z, periodZ);
+  int x0 = (x > 0.0? (int)x: (int)x - 1);
+  int z0 = (z > 0.0? (int)z: (int)z - 1);
+  double dx0 = x - (double)x0;
+  double dx1 = x - (double)(x0 + 1);
+  double dz0 = z - (double)z0;
+  double dz1 = z - (double)(z0 + 1);
+  int ix0 = (x0 < 0? x0 + periodX: x0);
+  int ix1 = (x0 + 1 >= periodX? x0 + 1 - periodX: x0 + 1);
+  int iz0 = (z0 < 0? z0 + periodZ: z0);
+  int iz1 = (z0 + 1 >= periodZ? z0 + 1 - periodZ: z0 + 1);
+
+  double xs = 0, zs = 0;
+  switch (noiseQuality) {
+    case QUALITY_FAST:
+      xs = dx0;
+      zs = dz0;
+      break;
+    case QUALITY_STD:
+      xs = SCurve3 (dx0);
+      zs = SCurve3 (dz0);
+      break;
+    case QUALITY_BEST:
+      xs = SCurve5 (dx0);
+      zs = SCurve5 (dz0);
+      break;
+  }
+
+  double n0, n1, ix0Value, ix1Value;
+  n0 = PeriodicGradientNoise2D (dx0, dz0, ix0, iz0, seed);
+  n1 = PeriodicGradientNoise2D (dx1, dz0, ix1, iz0, seed);
+  ix0Value = LinearInterp (n0, n1, xs);
+  n0 = PeriodicGradientNoise2D (dx0, dz1, ix0, iz1, seed);
+  n1 = PeriodicGradientNoise2D (dx1, dz1, ix1, iz1, seed);
+  ix1Value = LinearInterp (n0, n1, xs);
+  return LinearInterp (ix0Value, ix1Value, zs);
+}
@@ -20,13 +20,29 @@
 // off every 'zig'.)
 //
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
 
+#include <general/JobSystem.h>
+
+#include <noise/batch.h>
 #include <noise/interp.h>
 #include <noise/mathconsts.h>
 
 #include <noise/noiseutils.h>
 
+#if defined (__SSE2__)
+#define NOISE_UTILS_SSE2 1
+#include <emmintrin.h>
+#else
+#define NOISE_UTILS_SSE2 0
+#endif
+
 using namespace noise;
 using namespace noise::model;
 using namespace noise::module;
@@ -34,6 +50,24 @@ using namespace noise::module;
 // Bitmap header size.
 const int BMP_HEADER_SIZE = 54;
 
+// Number of noise map rows a builder fills at a time, and that a single job
+// builds when a noise map is built in parallel.
+const int BUILD_ROWS_PER_JOB = 16;
+
+// Noise maps with fewer points than this are always built on the calling
+// thread; splitting them costs more than it saves.  The same threshold
+// applies to the images the renderers render.
+const int MIN_PARALLEL_BUILD_POINTS = 4096;
+
+// Size of the buffer into which StreamWriterBMP and StreamWriterTER encode
+// rows before they write them to the file, in bytes.  Large writes keep the
+// file system from splitting the file into many small requests.
+const size_t STREAM_BUFFER_SIZE = 1 << 20;
+
+// Number of pixels of a row that RendererImage blends at a time.  The
+// channel arrays of a span fit into the first-level data cache.
+const int RENDER_SPAN_WIDTH = 256;
+
 // Direction of the light source, in compass degrees (0 = north, 90 = east,
 // 180 = south, 270 = east)
 const double DEFAULT_LIGHT_AZIMUTH = 45.0;
@@ -74,6 +108,277 @@ namespace noise
       out.red   = BlendChannel (color0.red  , color1.red  , alpha);
     }
 
+    // Calculates one channel of a row of destination colors with the
+    // arithmetic of RendererImage::CalcDestColor (): blends the source
+    // channel to the background channel using the source alpha, applies the
+    // light channel if pLight is not NULL, clamps the result to the (0..1)
+    // range and rescales it to the (0..255) range.
+    inline void BlendChannelRow (const double* pSource,
+      const double* pBackground, const double* pAlpha, const double* pLight,
+      double lightChannel, int* pDest, int count)
+    {
+      int x = 0;
+#if NOISE_UTILS_SSE2
+      // Two values per iteration, with the same operations in the same order
+      // as the scalar loop below.
+      const __m128d zero  = _mm_setzero_pd ();
+      const __m128d one   = _mm_set1_pd (1.0);
+      const __m128d scale = _mm_set1_pd (255.0);
+      const __m128d light = _mm_set1_pd (lightChannel);
+      for (; x + 2 <= count; x += 2) {
+        __m128d alpha = _mm_loadu_pd (pAlpha + x);
+        __m128d value = _mm_add_pd (
+          _mm_mul_pd (_mm_sub_pd (one, alpha), _mm_loadu_pd (pBackground + x)),
+          _mm_mul_pd (alpha, _mm_loadu_pd (pSource + x)));
+        if (pLight != NULL) {
+          value = _mm_mul_pd (value, _mm_div_pd (
+            _mm_mul_pd (_mm_loadu_pd (pLight + x), light), scale));
+        }
+        value = _mm_min_pd (_mm_max_pd (value, zero), one);
+        _mm_storel_epi64 ((__m128i*)(pDest + x),
+          _mm_cvttpd_epi32 (_mm_mul_pd (value, scale)));
+      }
+#endif
+      for (; x < count; x++) {
+        double value = LinearInterp (pBackground[x], pSource[x], pAlpha[x]);
+        if (pLight != NULL) {
+          value *= pLight[x] * lightChannel / 255.0;
+        }
+        value = (value < 0.0)? 0.0: value;
+        value = (value > 1.0)? 1.0: value;
+        pDest[x] = (int)((noise::uint)(value * 255.0) & 0xff);
+      }
+    }
+
+    // Multiplies a row of light intensities by one channel of the light
+    // color, divided by 255, as BlendChannelRow () does.
+    inline void ScaleLightRow (const double* pLight, double lightChannel,
+      double* pDest, int count)
+    {
+      int x = 0;
+#if NOISE_UTILS_SSE2
+      const __m128d scale = _mm_set1_pd (255.0);
+      const __m128d light = _mm_set1_pd (lightChannel);
+      for (; x + 2 <= count; x += 2) {
+        _mm_storeu_pd (pDest + x, _mm_div_pd (
+          _mm_mul_pd (_mm_loadu_pd (pLight + x), light), scale));
+      }
+#endif
+      for (; x < count; x++) {
+        pDest[x] = pLight[x] * lightChannel / 255.0;
+      }
+    }
+
+    // Calculates one channel of a row of destination colors from channels
+    // that are already blended to the background, with the arithmetic of
+    // BlendChannelRow () after the blend: multiplies the channel by the
+    // light scaled by ScaleLightRow (), clamps the result to the (0..1)
+    // range and rescales it to the (0..255) range.
+    inline void LightChannelRow (const double* pBlended, const double* pScale,
+      int* pDest, int count)
+    {
+      int x = 0;
+#if NOISE_UTILS_SSE2
+      const __m128d zero  = _mm_setzero_pd ();
+      const __m128d one   = _mm_set1_pd (1.0);
+      const __m128d scale = _mm_set1_pd (255.0);
+      for (; x + 2 <= count; x += 2) {
+        __m128d value = _mm_mul_pd (_mm_loadu_pd (pBlended + x),
+          _mm_loadu_pd (pScale + x));
+        value = _mm_min_pd (_mm_max_pd (value, zero), one);
+        _mm_storel_epi64 ((__m128i*)(pDest + x),
+          _mm_cvttpd_epi32 (_mm_mul_pd (value, scale)));
+      }
+#endif
+      for (; x < count; x++) {
+        double value = pBlended[x] * pScale[x];
+        value = (value < 0.0)? 0.0: value;
+        value = (value > 1.0)? 1.0: value;
+        pDest[x] = (int)((noise::uint)(value * 255.0) & 0xff);
+      }
+    }
+
+    // Builds a row of colors from separate arrays of the channels.
+    inline void PackColorRow (const int* pRed, const int* pGreen,
+      const int* pBlue, const noise::uint8* pAlpha, Color* pDest, int count)
+    {
+      int x = 0;
+#if NOISE_UTILS_SSE2
+      // Four colors per iteration.  The channels of a color are stored in
+      // the order alpha, blue, green, red (see the declaration of Color).
+      if (sizeof (Color) == 4) {
+        const __m128i zero = _mm_setzero_si128 ();
+        for (; x + 4 <= count; x += 4) {
+          int alpha;
+          memcpy (&alpha, pAlpha + x, sizeof (alpha));
+          __m128i value = _mm_unpacklo_epi16 (_mm_unpacklo_epi8 (
+            _mm_cvtsi32_si128 (alpha), zero), zero);
+          value = _mm_or_si128 (value, _mm_slli_epi32 (
+            _mm_loadu_si128 ((const __m128i*)(pBlue + x)), 8));
+          value = _mm_or_si128 (value, _mm_slli_epi32 (
+            _mm_loadu_si128 ((const __m128i*)(pGreen + x)), 16));
+          value = _mm_or_si128 (value, _mm_slli_epi32 (
+            _mm_loadu_si128 ((const __m128i*)(pRed + x)), 24));
+          _mm_storeu_si128 ((__m128i*)(pDest + x), value);
+        }
+      }
+#endif
+      for (; x < count; x++) {
+        pDest[x] = Color ((noise::uint8)pRed[x], (noise::uint8)pGreen[x],
+          (noise::uint8)pBlue[x], pAlpha[x]);
+      }
+    }
+
+    // Calculates the light intensities of a span of points for the
+    // RendererImage class with the arithmetic of
+    // RendererImage::CalcLightIntensity (), given the noise values of the
+    // left, right, down and up neighbors of the points, and scales them by
+    // the light brightness.
+    inline void CalcLightSpan (const float* pLeft, const float* pRight, const float* pDown, const float* pUp, double ix,
+      double iy, double io, double brightness, double* pDest, int count)
+    {
+      int x = 0;
+#if NOISE_UTILS_SSE2
+      // Two points per iteration, with the same operations in the same order
+      // as the scalar loop below.
+      const __m128d zero   = _mm_setzero_pd ();
+      const __m128d xScale = _mm_set1_pd (ix);
+      const __m128d yScale = _mm_set1_pd (iy);
+      const __m128d flat   = _mm_set1_pd (io);
+      const __m128d bright = _mm_set1_pd (brightness);
+      for (; x + 2 <= count; x += 2) {
+        __m128d nl = _mm_cvtps_pd (_mm_castsi128_ps (
+          _mm_loadl_epi64 ((const __m128i*)(pLeft + x))));
+        __m128d nr = _mm_cvtps_pd (_mm_castsi128_ps (
+          _mm_loadl_epi64 ((const __m128i*)(pRight + x))));
+        __m128d nd = _mm_cvtps_pd (_mm_castsi128_ps (
+          _mm_loadl_epi64 ((const __m128i*)(pDown + x))));
+        __m128d nu = _mm_cvtps_pd (_mm_castsi128_ps (
+          _mm_loadl_epi64 ((const __m128i*)(pUp + x))));
+        __m128d intensity = _mm_add_pd (_mm_add_pd (
+          _mm_mul_pd (xScale, _mm_sub_pd (nl, nr)),
+          _mm_mul_pd (yScale, _mm_sub_pd (nd, nu))), flat);
+        _mm_storeu_pd (pDest + x,
+          _mm_mul_pd (_mm_max_pd (intensity, zero), bright));
+      }
+#endif
+      for (; x < count; x++) {
+        double intensity = (ix * ((double)pLeft[x] - (double)pRight[x])
+          + iy * ((double)pDown[x] - (double)pUp[x]) + io);
+        if (intensity < 0.0) {
+          intensity = 0.0;
+        }
+        pDest[x] = intensity * brightness;
+      }
+    }
+
+    // Calculates the normal vectors of a span of points for the
+    // RendererNormalMap class, given the noise values of the points and of
+    // their right and up neighbors.  Each coordinate is mapped from the
+    // (-1.0 .. +1.0) range to the (0 .. 2 * channelScale) range and rounded
+    // down.
+    inline void CalcNormalSpan (const float* pCenter, const float* pRight,
+      const float* pUp, double bumpHeight, double channelScale, int* pDestX,
+      int* pDestY, int* pDestZ, int count)
+    {
+      int x = 0;
+#if NOISE_UTILS_SSE2
+      // Two points per iteration, with the same operations in the same order
+      // as the scalar loop below.  The coordinates plus one are never
+      // negative, so truncating them rounds them down.
+      const __m128d one   = _mm_set1_pd (1.0);
+      const __m128d bump  = _mm_set1_pd (bumpHeight);
+      const __m128d scale = _mm_set1_pd (channelScale);
+      for (; x + 2 <= count; x += 2) {
+        __m128d nc = _mm_mul_pd (_mm_cvtps_pd (_mm_castsi128_ps (
+          _mm_loadl_epi64 ((const __m128i*)(pCenter + x)))), bump);
+        __m128d nr = _mm_mul_pd (_mm_cvtps_pd (_mm_castsi128_ps (
+          _mm_loadl_epi64 ((const __m128i*)(pRight + x)))), bump);
+        __m128d nu = _mm_mul_pd (_mm_cvtps_pd (_mm_castsi128_ps (
+          _mm_loadl_epi64 ((const __m128i*)(pUp + x)))), bump);
+        __m128d ncr = _mm_sub_pd (nc, nr);
+        __m128d ncu = _mm_sub_pd (nc, nu);
+        __m128d d = _mm_sqrt_pd (_mm_add_pd (_mm_add_pd (
+          _mm_mul_pd (ncu, ncu), _mm_mul_pd (ncr, ncr)), one));
+        _mm_storel_epi64 ((__m128i*)(pDestX + x), _mm_cvttpd_epi32 (
+          _mm_mul_pd (_mm_add_pd (_mm_div_pd (ncr, d), one), scale)));
+        _mm_storel_epi64 ((__m128i*)(pDestY + x), _mm_cvttpd_epi32 (
+          _mm_mul_pd (_mm_add_pd (_mm_div_pd (ncu, d), one), scale)));
+        _mm_storel_epi64 ((__m128i*)(pDestZ + x), _mm_cvttpd_epi32 (
+          _mm_mul_pd (_mm_add_pd (_mm_div_pd (one, d), one), scale)));
+      }
+#endif
+      for (; x < count; x++) {
+        double nc = (double)pCenter[x] * bumpHeight;
+        double nr = (double)pRight [x] * bumpHeight;
+        double nu = (double)pUp    [x] * bumpHeight;
+        double ncr = (nc - nr);
+        double ncu = (nc - nu);
+        double d = sqrt ((ncu * ncu) + (ncr * ncr) + 1);
+        pDestX[x] = (int)floor (((ncr / d) + 1.0) * channelScale);
+        pDestY[x] = (int)floor (((ncu / d) + 1.0) * channelScale);
+        pDestZ[x] = (int)floor (((1.0 / d) + 1.0) * channelScale);
+      }
+    }
+
+    // Returns the number of bytes in one row of a Windows bitmap file; each
+    // row is aligned on a 4-byte boundary.
+    inline int CalcBMPRowByteCount (int width)
+    {
+      return ((width * 3) + 3) & ~0x03;
+    }
+
+    // Writes the bytes collected in a stream writer's buffer to its file and
+    // empties the buffer.
+    inline void FlushStreamBuffer (std::ofstream& os,
+      const noise::uint8* pBuffer, size_t& bufferUsed)
+    {
+      os.write ((const char*)pBuffer, bufferUsed);
+      bufferUsed = 0;
+      if (os.fail () || os.bad ()) {
+        throw noise::ExceptionUnknown ();
+      }
+    }
+
+    // Writes the bytes collected in a stream writer's buffer, closes its file
+    // and releases the buffer.  Returns false if the file could not be
+    // written.
+    inline bool CloseStream (std::ofstream& os, noise::uint8*& pBuffer,
+      size_t& bufferUsed)
+    {
+      os.write ((const char*)pBuffer, bufferUsed);
+      bool isWritten = !(os.fail () || os.bad ());
+      os.close ();
+      isWritten = isWritten && !os.fail ();
+      os.clear ();
+      delete[] pBuffer;
+      pBuffer    = NULL;
+      bufferUsed = 0;
+      return isWritten;
+    }
+
+    // Creates the file of a stream writer and allocates its buffer.
+    inline noise::uint8* OpenStream (std::ofstream& os,
+      const std::string& filename)
+    {
+      noise::uint8* pBuffer = NULL;
+      try {
+        pBuffer = new noise::uint8[STREAM_BUFFER_SIZE];
+      }
+      catch (...) {
+        throw noise::ExceptionOutOfMemory ();
+      }
+      os.clear ();
+      os.open (filename.c_str (),
+        std::ios::out | std::ios::binary | std::ios::trunc);
+      if (os.fail () || os.bad ()) {
+        os.clear ();
+        delete[] pBuffer;
+        throw noise::ExceptionUnknown ();
+      }
+      return pBuffer;
+    }
+
     // Unpacks a floating-point value into four bytes.  This function is
     // specific to Intel machines.  A portable version will come soon (I
     // hope.)
@@ -118,14 +423,20 @@ using namespace noise::utils;
 //////////////////////////////////////////////////////////////////////////////
 // GradientColor class
 
-GradientColor::GradientColor ()
+GradientColor::GradientColor ():
+  m_gradientPointCount (0),
+  m_pGradientPoints (NULL),
+  m_pColorTable (NULL),
+  m_colorTableOffset (0.0),
+  m_colorTableScale (0.0),
+  m_isColorTableValid (false)
 {
-  m_pGradientPoints = NULL;
 }
 
 GradientColor::~GradientColor ()
 {
   delete[] m_pGradientPoints;
+  delete[] m_pColorTable;
 }
 
 void GradientColor::AddGradientPoint (double gradientPos,
@@ -136,6 +447,7 @@ void GradientColor::AddGradientPoint (double gradientPos,
   // remain sorted by gradient position.
   int insertionPos = FindInsertionPos (gradientPos);
   InsertAtPos (insertionPos, gradientPos, gradientColor);
+  m_isColorTableValid = false;
 }
 
 void GradientColor::Clear ()
@@ -143,6 +455,7 @@ void GradientColor::Clear ()
   delete[] m_pGradientPoints;
   m_pGradientPoints = NULL;
   m_gradientPointCount = 0;
+  m_isColorTableValid = false;
 }
 
 int GradientColor::FindInsertionPos (double gradientPos)
@@ -203,6 +516,30 @@ const Color& GradientColor::GetColor (double gradientPos) const
   return m_workingColor;
 }
 
+void GradientColor::UpdateColorTable () const
+{
+  if (m_gradientPointCount < 2) {
+    throw noise::ExceptionInvalidParam ();
+  }
+  if (m_isColorTableValid) {
+    return;
+  }
+  if (m_pColorTable == NULL) {
+    m_pColorTable = new Color[GRADIENT_TABLE_SIZE];
+  }
+
+  double firstPos = m_pGradientPoints[0].pos;
+  double lastPos  = m_pGradientPoints[m_gradientPointCount - 1].pos;
+  double posDelta = (lastPos - firstPos) / (double)(GRADIENT_TABLE_SIZE - 1);
+  for (int i = 0; i < GRADIENT_TABLE_SIZE - 1; i++) {
+    m_pColorTable[i] = GetColor (firstPos + (double)i * posDelta);
+  }
+  m_pColorTable[GRADIENT_TABLE_SIZE - 1] = GetColor (lastPos);
+  m_colorTableOffset = firstPos;
+  m_colorTableScale = (double)(GRADIENT_TABLE_SIZE - 1) / (lastPos - firstPos);
+  m_isColorTableValid = true;
+}
+
 void GradientColor::InsertAtPos (int insertionPos, double gradientPos,
   const Color& gradientColor)
 {
@@ -394,6 +731,124 @@ void NoiseMap::TakeOwnership (NoiseMap& source)
   source.InitObj ();
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// QuantizedNoiseMap class
+
+QuantizedNoiseMap::QuantizedNoiseMap ():
+  m_borderValue (0.0),
+  m_height (0),
+  m_stride (0),
+  m_width (0)
+{
+  SetRange (-1.0, 1.0);
+}
+
+QuantizedNoiseMap::QuantizedNoiseMap (int width, int height):
+  m_borderValue (0.0),
+  m_height (0),
+  m_stride (0),
+  m_width (0)
+{
+  SetRange (-1.0, 1.0);
+  SetSize (width, height);
+}
+
+void QuantizedNoiseMap::Clear (float value)
+{
+  std::fill (m_values.begin (), m_values.end (), Quantize (value));
+}
+
+void QuantizedNoiseMap::DequantizeRow (int row, float* pDest) const
+{
+  const noise::uint16* pSource = GetConstSlabPtr (row);
+  for (int x = 0; x < m_width; x++) {
+    pDest[x] = m_bias + (float)pSource[x] * m_scale;
+  }
+}
+
+float QuantizedNoiseMap::GetValue (int x, int y) const
+{
+  if (x >= 0 && x < m_width && y >= 0 && y < m_height) {
+    return Dequantize (GetConstSlabPtr (y)[x]);
+  }
+  // The coordinates specified are outside the noise map.  Return the border
+  // value.
+  return m_borderValue;
+}
+
+void QuantizedNoiseMap::QuantizeRows (const NoiseMap& source, int sourceRow,
+  int destRow, int rowCount)
+{
+  if ( source.GetWidth () != m_width
+    || sourceRow < 0 || rowCount < 0 || destRow < 0
+    || sourceRow + rowCount > source.GetHeight ()
+    || destRow   + rowCount > m_height) {
+    throw noise::ExceptionInvalidParam ();
+  }
+
+  for (int row = 0; row < rowCount; row++) {
+    const float* pSource = source.GetConstSlabPtr (sourceRow + row);
+    noise::uint16* pDest = GetSlabPtr (destRow + row);
+    for (int x = 0; x < m_width; x++) {
+      pDest[x] = Quantize (pSource[x]);
+    }
+  }
+}
+
+void QuantizedNoiseMap::SetRange (float lowerBound, float upperBound)
+{
+  if (!(lowerBound < upperBound)) {
+    throw noise::ExceptionInvalidParam ();
+  }
+  SetScaleBias ((upperBound - lowerBound) / (float)QUANTIZED_MAX_VALUE,
+    lowerBound);
+}
+
+void QuantizedNoiseMap::SetScaleBias (float scale, float bias)
+{
+  if (!(scale > 0.0f)) {
+    throw noise::ExceptionInvalidParam ();
+  }
+  m_scale    = scale;
+  m_invScale = 1.0f / scale;
+  m_bias     = bias;
+}
+
+void QuantizedNoiseMap::SetSize (int width, int height)
+{
+  if (width < 0 || height < 0
+    || width > RASTER_MAX_WIDTH || height > RASTER_MAX_HEIGHT) {
+    // Invalid width or height.
+    throw noise::ExceptionInvalidParam ();
+  }
+
+  // The stride is rounded up like the stride of a NoiseMap.
+  int stride = ((width + RASTER_STRIDE_BOUNDARY - 1) / RASTER_STRIDE_BOUNDARY)
+    * RASTER_STRIDE_BOUNDARY;
+  try {
+    m_values.resize ((width == 0 || height == 0)? 0:
+      (size_t)stride * (size_t)height);
+  }
+  catch (...) {
+    m_values.clear ();
+    m_width  = 0;
+    m_height = 0;
+    m_stride = 0;
+    throw noise::ExceptionOutOfMemory ();
+  }
+  bool isEmpty = m_values.empty ();
+  m_stride = isEmpty? 0: stride;
+  m_width  = isEmpty? 0: width;
+  m_height = isEmpty? 0: height;
+}
+
+void QuantizedNoiseMap::SetValue (int x, int y, float value)
+{
+  if (x >= 0 && x < m_width && y >= 0 && y < m_height) {
+    GetSlabPtr (y)[x] = Quantize (value);
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // Image class
 
@@ -573,84 +1028,11 @@ void WriterBMP::WriteDestFile ()
     throw noise::ExceptionInvalidParam ();
   }
 
-  int width  = m_pSourceImage->GetWidth  ();
-  int height = m_pSourceImage->GetHeight ();
-
-  // The width of one line in the file must be aligned on a 4-byte boundary.
-  int bufferSize = CalcWidthByteCount (width);
-  int destSize   = bufferSize * height;
-
-  // This buffer holds one horizontal line in the destination file.
-  noise::uint8* pLineBuffer = NULL;
-
-  // File object used to write the file.
-  std::ofstream os;
-  os.clear ();
-  
-  // Allocate a buffer to hold one horizontal line in the bitmap.
-  try {
-    pLineBuffer = new noise::uint8[bufferSize];
-  }
-  catch (...) {
-    throw noise::ExceptionOutOfMemory ();
-  }
-
-  // Open the destination file.
-  os.open (m_destFilename.c_str (), std::ios::out | std::ios::binary);
-  if (os.fail () || os.bad ()) {
-    delete[] pLineBuffer;
-    throw noise::ExceptionUnknown ();
-  }
-
-  // Build the header.
-  noise::uint8 d[4];
-  os.write ("BM", 2);
-  os.write ((char*)UnpackLittle32 (d, destSize + BMP_HEADER_SIZE), 4);
-  os.write ("\0\0\0\0", 4);
-  os.write ((char*)UnpackLittle32 (d, (noise::uint32)BMP_HEADER_SIZE), 4);
-  os.write ((char*)UnpackLittle32 (d, 40), 4);   // Palette offset
-  os.write ((char*)UnpackLittle32 (d, (noise::uint32)width ), 4);
-  os.write ((char*)UnpackLittle32 (d, (noise::uint32)height), 4);
-  os.write ((char*)UnpackLittle16 (d, 1 ), 2);   // Planes per pixel
-  os.write ((char*)UnpackLittle16 (d, 24), 2);   // Bits per plane
-  os.write ("\0\0\0\0", 4); // Compression (0 = none)
-  os.write ((char*)UnpackLittle32 (d, (noise::uint32)destSize), 4);
-  os.write ((char*)UnpackLittle32 (d, 2834), 4); // X pixels per meter
-  os.write ((char*)UnpackLittle32 (d, 2834), 4); // Y pixels per meter
-  os.write ("\0\0\0\0", 4);
-  os.write ("\0\0\0\0", 4);
-  if (os.fail () || os.bad ()) {
-    os.clear ();
-    os.close ();
-    os.clear ();
-    delete[] pLineBuffer;
-    throw noise::ExceptionUnknown ();
-  }
-
-  // Build and write each horizontal line to the file.
-  for (int y = 0; y < height; y++) {
-    memset (pLineBuffer, 0, bufferSize);
-    Color* pSource = m_pSourceImage->GetSlabPtr (y);
-    noise::uint8* pDest   = pLineBuffer;
-    for (int x = 0; x < width; x++) {
-      *pDest++ = pSource->blue ;
-      *pDest++ = pSource->green;
-      *pDest++ = pSource->red  ;
-      ++pSource;
-    }
-    os.write ((char*)pLineBuffer, (size_t)bufferSize);
-    if (os.fail () || os.bad ()) {
-      os.clear ();
-      os.close ();
-      os.clear ();
-      delete[] pLineBuffer;
-      throw noise::ExceptionUnknown ();
-    }
-  }
-
-  os.close ();
-  os.clear ();
-  delete[] pLineBuffer;
+  StreamWriterBMP writer;
+  writer.Open (m_destFilename, m_pSourceImage->GetWidth (),
+    m_pSourceImage->GetHeight ());
+  writer.WriteRows (*m_pSourceImage, 0, m_pSourceImage->GetHeight ());
+  writer.Close ();
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -667,86 +1049,35 @@ void WriterTER::WriteDestFile ()
     throw noise::ExceptionInvalidParam ();
   }
 
-  int width  = m_pSourceNoiseMap->GetWidth  ();
-  int height = m_pSourceNoiseMap->GetHeight ();
-
-  int bufferSize = CalcWidthByteCount (width);
-  int destSize   = bufferSize * height;
-
-  // This buffer holds one horizontal line in the destination file.
-  noise::uint8* pLineBuffer = NULL;
-
-  // File object used to write the file.
-  std::ofstream os;
-  os.clear ();
-
-  // Allocate a buffer to hold one horizontal line in the height map.
-  try {
-    pLineBuffer = new noise::uint8[bufferSize];
-  }
-  catch (...) {
-    throw noise::ExceptionOutOfMemory ();
-  }
+  StreamWriterTER writer;
+  writer.SetMetersPerPoint (m_metersPerPoint);
+  writer.Open (m_destFilename, m_pSourceNoiseMap->GetWidth (),
+    m_pSourceNoiseMap->GetHeight ());
+  writer.WriteRows (*m_pSourceNoiseMap, 0, m_pSourceNoiseMap->GetHeight ());
+  writer.Close ();
+}
 
-  // Open the destination file.
-  os.open (m_destFilename.c_str (), std::ios::out | std::ios::binary);
-  if (os.fail () || os.bad ()) {
-    os.clear ();
-    delete[] pLineBuffer;
-    throw noise::ExceptionUnknown ();
-  }
+/////////////////////////////////////////////////////////////////////////////
+// Module graph helpers
 
-  // Build the header.
-  noise::uint8 d[4];
-  int16 heightScale = (int16)(floor (32768.0 / (double)m_metersPerPoint));
-  os.write ("TERRAGENTERRAIN ", 16);
-  os.write ("SIZE", 4);
-  os.write ((char*)UnpackLittle16 (d, GetMin (width, height) - 1), 2);
-  os.write ("\0\0", 2);
-  os.write ("XPTS", 4);
-  os.write ((char*)UnpackLittle16 (d, width), 2);
-  os.write ("\0\0", 2);
-  os.write ("YPTS", 4);
-  os.write ((char*)UnpackLittle16 (d, height), 2);
-  os.write ("\0\0", 2);
-  os.write ("SCAL", 4);
-  os.write ((char*)UnpackFloat (d, m_metersPerPoint), 4);
-  os.write ((char*)UnpackFloat (d, m_metersPerPoint), 4);
-  os.write ((char*)UnpackFloat (d, m_metersPerPoint), 4);
-  os.write ("ALTW", 4);
-  os.write ((char*)UnpackLittle16 (d, heightScale), 2);
-  os.write ("\0\0", 2);
-  if (os.fail () || os.bad ()) {
-    os.clear ();
-    os.close ();
-    os.clear ();
-    delete[] pLineBuffer;
-    throw noise::ExceptionUnknown ();
+bool noise::utils::IsThreadSafeModule (const module::Module& sourceModule)
+{
+  // module::Cache remembers its last sample in mutable members, so two
+  // threads sampling through the same cache would overwrite each other.
+  if (dynamic_cast<const module::Cache*> (&sourceModule) != NULL) {
+    return false;
   }
-
-  // Build and write each horizontal line to the file.
-  for (int y = 0; y < height; y++) {
-    float* pSource = m_pSourceNoiseMap->GetSlabPtr (y);
-    noise::uint8* pDest   = pLineBuffer;
-    for (int x = 0; x < width; x++) {
-      int16 scaledHeight = (int16)(floor (*pSource * 2.0));
-      UnpackLittle16 (pDest, scaledHeight);
-      pDest += 2;
-      ++pSource;
+  for (int i = 0; i < sourceModule.GetSourceModuleCount (); i++) {
+    try {
+      if (!IsThreadSafeModule (sourceModule.GetSourceModule (i))) {
+        return false;
+      }
     }
-    os.write ((char*)pLineBuffer, (size_t)bufferSize);
-    if (os.fail () || os.bad ()) {
-      os.clear ();
-      os.close ();
-      os.clear ();
-      delete[] pLineBuffer;
-      throw noise::ExceptionUnknown ();
+    catch (noise::ExceptionNoModule&) {
+      // Unconnected source modules are reported by GetValue () itself.
     }
   }
-
-  os.close ();
-  os.clear ();
-  delete[] pLineBuffer;
+  return true;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -754,18 +1085,130 @@ void WriterTER::WriteDestFile ()
 
 NoiseMapBuilder::NoiseMapBuilder ():
   m_pCallback (NULL),
+  m_destFirstRow (0),
   m_destHeight (0),
+  m_destLastRow (0),
   m_destWidth  (0),
   m_pDestNoiseMap (NULL),
   m_pSourceModule (NULL)
 {
 }
 
+int NoiseMapBuilder::GetBuildFirstRow () const
+{
+  return (m_destLastRow > 0)? m_destFirstRow: 0;
+}
+
+int NoiseMapBuilder::GetBuildLastRow () const
+{
+  return (m_destLastRow > 0)? m_destLastRow: m_destHeight;
+}
+
+bool NoiseMapBuilder::IsBuildRangeValid () const
+{
+  return m_destLastRow <= 0
+    || (m_destFirstRow >= 0
+      && m_destFirstRow < m_destLastRow
+      && m_destLastRow <= m_destHeight);
+}
+
 void NoiseMapBuilder::SetCallback (NoiseMapCallback pCallback)
 {
   m_pCallback = pCallback;
 }
 
+void NoiseMapBuilder::SetDestRowRange (int firstRow, int lastRow)
+{
+  m_destFirstRow = firstRow;
+  m_destLastRow  = lastRow ;
+}
+
+void NoiseMapBuilder::FillRows (const std::function<void (int, int)>& fillRows)
+{
+  JobSystem& jobs = JobSystem::getInstance ();
+  int buildFirstRow = GetBuildFirstRow ();
+  int buildLastRow  = GetBuildLastRow  ();
+  bool isParallel = jobs.getThreadCount () > 1
+    && m_destWidth * (buildLastRow - buildFirstRow)
+      >= MIN_PARALLEL_BUILD_POINTS
+    && IsThreadSafeModule (*m_pSourceModule);
+
+  // Rows are filled in runs, so that the builders can share per-column
+  // work between the rows of a run.
+  if (!isParallel) {
+    for (int firstRow = buildFirstRow; firstRow < buildLastRow;
+      firstRow += BUILD_ROWS_PER_JOB) {
+      int lastRow = std::min (buildLastRow, firstRow + BUILD_ROWS_PER_JOB);
+      fillRows (firstRow, lastRow);
+      if (m_pCallback != NULL) {
+        for (int y = firstRow; y < lastRow; y++) {
+          m_pCallback (y);
+        }
+      }
+    }
+    return;
+  }
+
+  if (m_pCallback == NULL) {
+    jobs.parallelFor (buildFirstRow, buildLastRow, BUILD_ROWS_PER_JOB,
+      fillRows);
+    return;
+  }
+
+  // Jobs flag each row as it is finished.  This thread reports the finished
+  // rows to the callback in row order and runs queued jobs in between.
+  int rowCount = buildLastRow - buildFirstRow;
+  std::unique_ptr<std::atomic<bool>[]> isRowDone (
+    new std::atomic<bool>[rowCount]);
+  for (int y = 0; y < rowCount; y++) {
+    isRowDone[y].store (false, std::memory_order_relaxed);
+  }
+
+  JobCounter rowJobs;
+  for (int firstRow = buildFirstRow; firstRow < buildLastRow;
+    firstRow += BUILD_ROWS_PER_JOB) {
+    int lastRow = std::min (buildLastRow, firstRow + BUILD_ROWS_PER_JOB);
+    jobs.run (rowJobs,
+      [&fillRows, &isRowDone, firstRow, lastRow, buildFirstRow] {
+      fillRows (firstRow, lastRow);
+      for (int y = firstRow; y < lastRow; y++) {
+        isRowDone[y - buildFirstRow].store (true, std::memory_order_release);
+      }
+    });
+  }
+
+  try {
+    int nextRow = buildFirstRow;
+    while (nextRow < buildLastRow) {
+      if (isRowDone[nextRow - buildFirstRow].load (
+        std::memory_order_acquire)) {
+        m_pCallback (nextRow++);
+      } else if (rowJobs.pending.load (std::memory_order_acquire) == 0) {
+        // Every job has finished, possibly after the row was loaded above,
+        // so the row is loaded again.  Only a row that is still not done
+        // means a job threw before finishing it; wait () rethrows it.
+        if (!isRowDone[nextRow - buildFirstRow].load (
+          std::memory_order_acquire)) {
+          break;
+        }
+      } else if (!jobs.runPendingJob ()) {
+        std::this_thread::yield ();
+      }
+    }
+  }
+  catch (...) {
+    // The callback threw.  The jobs still reference this stack frame, so
+    // let them finish before the exception leaves this method.
+    try {
+      jobs.wait (rowJobs);
+    }
+    catch (...) {
+    }
+    throw;
+  }
+  jobs.wait (rowJobs);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // NoiseMapBuilderCylinder class
 
@@ -783,40 +1226,64 @@ void NoiseMapBuilderCylinder::Build ()
     || m_upperHeightBound <= m_lowerHeightBound
     || m_destWidth <= 0
     || m_destHeight <= 0
+    || !IsBuildRangeValid ()
     || m_pSourceModule == NULL
     || m_pDestNoiseMap == NULL) {
     throw noise::ExceptionInvalidParam ();
   }
 
   // Resize the destination noise map so that it can store the new output
-  // values from the source model.
-  m_pDestNoiseMap->SetSize (m_destWidth, m_destHeight);
-
-  // Create the cylinder model.
-  model::Cylinder cylinderModel;
-  cylinderModel.SetModule (*m_pSourceModule);
+  // values from the source model.  It only stores the rows of the build
+  // range (see SetDestRowRange ().)
+  m_pDestNoiseMap->SetSize (m_destWidth,
+    GetBuildLastRow () - GetBuildFirstRow ());
+  int destRowOffset = GetBuildFirstRow ();
 
   double angleExtent  = m_upperAngleBound  - m_lowerAngleBound ;
   double heightExtent = m_upperHeightBound - m_lowerHeightBound;
   double xDelta = angleExtent  / (double)m_destWidth ;
   double yDelta = heightExtent / (double)m_destHeight;
+
+  // Precompute the angle of every column and the height of every row,
+  // accumulated the same way a row-by-row walk accumulates them.
+  std::vector<double> angles  (m_destWidth );
+  std::vector<double> heights (m_destHeight);
   double curAngle  = m_lowerAngleBound ;
   double curHeight = m_lowerHeightBound;
-
-  // Fill every point in the noise map with the output values from the model.
+  for (int x = 0; x < m_destWidth; x++) {
+    angles[x] = curAngle;
+    curAngle += xDelta;
+  }
   for (int y = 0; y < m_destHeight; y++) {
-    float* pDest = m_pDestNoiseMap->GetSlabPtr (y);
-    curAngle = m_lowerAngleBound;
-    for (int x = 0; x < m_destWidth; x++) {
-      float curValue = (float)cylinderModel.GetValue (curAngle, curHeight);
-      *pDest++ = curValue;
-      curAngle += xDelta;
-    }
+    heights[y] = curHeight;
     curHeight += yDelta;
-    if (m_pCallback != NULL) {
-      m_pCallback (y);
-    }
   }
+
+  // The x and z coordinates only depend on the angle, so their cosines and
+  // sines are computed once per column instead of once per point.  They are
+  // the same products model::Cylinder::GetValue () computes.
+  std::vector<double> xCoords (m_destWidth);
+  std::vector<double> zCoords (m_destWidth);
+  for (int x = 0; x < m_destWidth; x++) {
+    xCoords[x] = cos (angles[x] * DEG_TO_RAD);
+    zCoords[x] = sin (angles[x] * DEG_TO_RAD);
+  }
+
+  // Fill every point in the noise map with the output values from the
+  // source module, one row at a time (see noise::GetValues ().)
+  FillRows ([&] (int firstRow, int lastRow) {
+    std::vector<double> yCoords (m_destWidth);
+    std::vector<double> values (m_destWidth);
+    for (int y = firstRow; y < lastRow; y++) {
+      std::fill (yCoords.begin (), yCoords.end (), heights[y]);
+      GetValues (*m_pSourceModule, &xCoords[0], &yCoords[0], &zCoords[0],
+        &values[0], m_destWidth);
+      float* pDest = m_pDestNoiseMap->GetSlabPtr (y - destRowOffset);
+      for (int x = 0; x < m_destWidth; x++) {
+        *pDest++ = (float)values[x];
+      }
+    }
+  });
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -827,64 +1294,152 @@ NoiseMapBuilderPlane::NoiseMapBuilderPlane ():
   m_lowerXBound  (0.0),
   m_lowerZBound  (0.0),
   m_upperXBound  (0.0),
-  m_upperZBound  (0.0)
+  m_upperZBound  (0.0),
+  m_pDestXGradientMap (NULL),
+  m_pDestZGradientMap (NULL)
 {
 }
 
 void NoiseMapBuilderPlane::Build ()
 {
+  bool isGradientEnabled = IsGradientEnabled ();
   if ( m_upperXBound <= m_lowerXBound
     || m_upperZBound <= m_lowerZBound
     || m_destWidth <= 0
     || m_destHeight <= 0
+    || !IsBuildRangeValid ()
     || m_pSourceModule == NULL
-    || m_pDestNoiseMap == NULL) {
+    || m_pDestNoiseMap == NULL
+    || (isGradientEnabled && (m_isSeamlessEnabled
+      || !IsGradientSupported (*m_pSourceModule)))) {
     throw noise::ExceptionInvalidParam ();
   }
 
   // Resize the destination noise map so that it can store the new output
-  // values from the source model.
-  m_pDestNoiseMap->SetSize (m_destWidth, m_destHeight);
-
-  // Create the plane model.
-  model::Plane planeModel;
-  planeModel.SetModule (*m_pSourceModule);
+  // values from the source model.  It only stores the rows of the build
+  // range (see SetDestRowRange ().)
+  m_pDestNoiseMap->SetSize (m_destWidth,
+    GetBuildLastRow () - GetBuildFirstRow ());
+  if (isGradientEnabled) {
+    m_pDestXGradientMap->SetSize (m_destWidth,
+      GetBuildLastRow () - GetBuildFirstRow ());
+    m_pDestZGradientMap->SetSize (m_destWidth,
+      GetBuildLastRow () - GetBuildFirstRow ());
+  }
+  int destRowOffset = GetBuildFirstRow ();
 
   double xExtent = m_upperXBound - m_lowerXBound;
   double zExtent = m_upperZBound - m_lowerZBound;
   double xDelta  = xExtent / (double)m_destWidth ;
   double zDelta  = zExtent / (double)m_destHeight;
-  double xCur    = m_lowerXBound;
-  double zCur    = m_lowerZBound;
 
-  // Fill every point in the noise map with the output values from the model.
+  // Precompute the input coordinates of every column and row.  They are
+  // accumulated the same way a row-by-row walk accumulates them, so the
+  // output does not depend on how the rows are split between threads.
+  std::vector<double> xCoords (m_destWidth);
+  std::vector<double> zCoords (m_destHeight);
+  double xCur = m_lowerXBound;
+  for (int x = 0; x < m_destWidth; x++) {
+    xCoords[x] = xCur;
+    xCur += xDelta;
+  }
+  double zCur = m_lowerZBound;
   for (int z = 0; z < m_destHeight; z++) {
-    float* pDest = m_pDestNoiseMap->GetSlabPtr (z);
-    xCur = m_lowerXBound;
+    zCoords[z] = zCur;
+    zCur += zDelta;
+  }
+
+  // A Perlin-family source module whose lattice can repeat over the extents
+  // of the map tiles with one evaluation per sample.  Otherwise, the
+  // seamless blend also samples one extent to the east and one extent to
+  // the north.
+  bool isPeriodic = m_isSeamlessEnabled
+    && IsPeriodSupported (*m_pSourceModule, xExtent, zExtent);
+  std::vector<double> xEastCoords;
+  std::vector<double> zNorthCoords;
+  if (m_isSeamlessEnabled && !isPeriodic) {
+    xEastCoords.resize (m_destWidth);
     for (int x = 0; x < m_destWidth; x++) {
-      float finalValue;
-      if (!m_isSeamlessEnabled) {
-        finalValue = planeModel.GetValue (xCur, zCur);
-      } else {
-        double swValue, seValue, nwValue, neValue;
-        swValue = planeModel.GetValue (xCur          , zCur          );
-        seValue = planeModel.GetValue (xCur + xExtent, zCur          );
-        nwValue = planeModel.GetValue (xCur          , zCur + zExtent);
-        neValue = planeModel.GetValue (xCur + xExtent, zCur + zExtent);
-        double xBlend = 1.0 - ((xCur - m_lowerXBound) / xExtent);
-        double zBlend = 1.0 - ((zCur - m_lowerZBound) / zExtent);
-        double z0 = LinearInterp (swValue, seValue, xBlend);
-        double z1 = LinearInterp (nwValue, neValue, xBlend);
-        finalValue = (float)LinearInterp (z0, z1, zBlend);
-      }
-      *pDest++ = finalValue;
-      xCur += xDelta;
+      xEastCoords[x] = xCoords[x] + xExtent;
     }
-    zCur += zDelta;
-    if (m_pCallback != NULL) {
-      m_pCallback (z);
+    zNorthCoords.resize (m_destHeight);
+    for (int z = 0; z < m_destHeight; z++) {
+      zNorthCoords[z] = zCoords[z] + zExtent;
     }
   }
+
+  // Fills the rows in the range [firstRow, lastRow) with the output values
+  // from the source module.  A plane model samples the source module at
+  // (x, 0, z); the rows are evaluated as one grid (see
+  // noise::GetGridValues ().)
+  auto buildRows = [&] (int firstRow, int lastRow) {
+    int rowCount = lastRow - firstRow;
+    size_t valueCount = (size_t)rowCount * m_destWidth;
+    std::vector<double> swValues (valueCount);
+    if (isGradientEnabled) {
+      std::vector<double> xGradients (valueCount);
+      std::vector<double> zGradients (valueCount);
+      GetGridGradients (*m_pSourceModule, &xCoords[0], m_destWidth,
+        &zCoords[firstRow], rowCount, &swValues[0], &xGradients[0],
+        &zGradients[0]);
+      for (int z = firstRow; z < lastRow; z++) {
+        float* pDest = m_pDestNoiseMap->GetSlabPtr (z - destRowOffset);
+        float* pDestDX = m_pDestXGradientMap->GetSlabPtr (z - destRowOffset);
+        float* pDestDZ = m_pDestZGradientMap->GetSlabPtr (z - destRowOffset);
+        size_t offset = (size_t)(z - firstRow) * m_destWidth;
+        for (int x = 0; x < m_destWidth; x++) {
+          *pDest++   = (float)swValues  [offset + x];
+          *pDestDX++ = (float)xGradients[offset + x];
+          *pDestDZ++ = (float)zGradients[offset + x];
+        }
+      }
+      return;
+    }
+    if (isPeriodic) {
+      GetPeriodicGridValues (*m_pSourceModule, &xCoords[0], m_destWidth,
+        &zCoords[firstRow], rowCount, xExtent, zExtent, &swValues[0]);
+    } else {
+      GetGridValues (*m_pSourceModule, &xCoords[0], m_destWidth,
+        &zCoords[firstRow], rowCount, &swValues[0]);
+    }
+    if (!m_isSeamlessEnabled || isPeriodic) {
+      for (int z = firstRow; z < lastRow; z++) {
+        float* pDest = m_pDestNoiseMap->GetSlabPtr (z - destRowOffset);
+        const double* pSource = &swValues[(size_t)(z - firstRow)
+          * m_destWidth];
+        for (int x = 0; x < m_destWidth; x++) {
+          *pDest++ = (float)pSource[x];
+        }
+      }
+      return;
+    }
+
+    std::vector<double> seValues (valueCount);
+    std::vector<double> nwValues (valueCount);
+    std::vector<double> neValues (valueCount);
+    GetGridValues (*m_pSourceModule, &xEastCoords[0], m_destWidth,
+      &zCoords[firstRow], rowCount, &seValues[0]);
+    GetGridValues (*m_pSourceModule, &xCoords[0], m_destWidth,
+      &zNorthCoords[firstRow], rowCount, &nwValues[0]);
+    GetGridValues (*m_pSourceModule, &xEastCoords[0], m_destWidth,
+      &zNorthCoords[firstRow], rowCount, &neValues[0]);
+    for (int z = firstRow; z < lastRow; z++) {
+      float* pDest = m_pDestNoiseMap->GetSlabPtr (z - destRowOffset);
+      size_t offset = (size_t)(z - firstRow) * m_destWidth;
+      double zBlend = 1.0 - ((zCoords[z] - m_lowerZBound) / zExtent);
+      for (int x = 0; x < m_destWidth; x++) {
+        double xBlend = 1.0 - ((xCoords[x] - m_lowerXBound) / xExtent);
+        double z0 = LinearInterp (swValues[offset + x],
+          seValues[offset + x], xBlend);
+        double z1 = LinearInterp (nwValues[offset + x],
+          neValues[offset + x], xBlend);
+        *pDest++ = (float)LinearInterp (z0, z1, zBlend);
+      }
+    }
+  };
+
+  // Fill every point in the noise map with the output values from the model.
+  FillRows (buildRows);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -904,40 +1459,78 @@ void NoiseMapBuilderSphere::Build ()
     || m_northLatBound <= m_southLatBound
     || m_destWidth <= 0
     || m_destHeight <= 0
+    || !IsBuildRangeValid ()
     || m_pSourceModule == NULL
     || m_pDestNoiseMap == NULL) {
     throw noise::ExceptionInvalidParam ();
   }
 
   // Resize the destination noise map so that it can store the new output
-  // values from the source model.
-  m_pDestNoiseMap->SetSize (m_destWidth, m_destHeight);
-
-  // Create the plane model.
-  model::Sphere sphereModel;
-  sphereModel.SetModule (*m_pSourceModule);
+  // values from the source model.  It only stores the rows of the build
+  // range (see SetDestRowRange ().)
+  m_pDestNoiseMap->SetSize (m_destWidth,
+    GetBuildLastRow () - GetBuildFirstRow ());
+  int destRowOffset = GetBuildFirstRow ();
 
   double lonExtent = m_eastLonBound  - m_westLonBound ;
   double latExtent = m_northLatBound - m_southLatBound;
   double xDelta = lonExtent / (double)m_destWidth ;
   double yDelta = latExtent / (double)m_destHeight;
+
+  // Precompute the longitude of every column and the latitude of every row,
+  // accumulated the same way a row-by-row walk accumulates them.
+  std::vector<double> lons (m_destWidth );
+  std::vector<double> lats (m_destHeight);
   double curLon = m_westLonBound ;
   double curLat = m_southLatBound;
-
-  // Fill every point in the noise map with the output values from the model.
+  for (int x = 0; x < m_destWidth; x++) {
+    lons[x] = curLon;
+    curLon += xDelta;
+  }
   for (int y = 0; y < m_destHeight; y++) {
-    float* pDest = m_pDestNoiseMap->GetSlabPtr (y);
-    curLon = m_westLonBound;
-    for (int x = 0; x < m_destWidth; x++) {
-      float curValue = (float)sphereModel.GetValue (curLat, curLon);
-      *pDest++ = curValue;
-      curLon += xDelta;
-    }
+    lats[y] = curLat;
     curLat += yDelta;
-    if (m_pCallback != NULL) {
-      m_pCallback (y);
-    }
   }
+
+  // LatLonToXYZ () computes the cosine and sine of the latitude and the
+  // longitude for every point.  Here they are computed once per row and
+  // once per column; the products are the same, so the input values are
+  // too.
+  std::vector<double> cosLons (m_destWidth);
+  std::vector<double> sinLons (m_destWidth);
+  for (int x = 0; x < m_destWidth; x++) {
+    cosLons[x] = cos (DEG_TO_RAD * lons[x]);
+    sinLons[x] = sin (DEG_TO_RAD * lons[x]);
+  }
+  std::vector<double> cosLats (m_destHeight);
+  std::vector<double> sinLats (m_destHeight);
+  for (int y = 0; y < m_destHeight; y++) {
+    cosLats[y] = cos (DEG_TO_RAD * lats[y]);
+    sinLats[y] = sin (DEG_TO_RAD * lats[y]);
+  }
+
+  // Fill every point in the noise map with the output values from the
+  // source module, one row at a time (see noise::GetValues ().)
+  FillRows ([&] (int firstRow, int lastRow) {
+    std::vector<double> xCoords (m_destWidth);
+    std::vector<double> yCoords (m_destWidth);
+    std::vector<double> zCoords (m_destWidth);
+    std::vector<double> values (m_destWidth);
+    for (int y = firstRow; y < lastRow; y++) {
+      double r = cosLats[y];
+      for (int x = 0; x < m_destWidth; x++) {
+        xCoords[x] = r * cosLons[x];
+        zCoords[x] = r * sinLons[x];
+      }
+      std::fill (yCoords.begin (), yCoords.end (), sinLats[y]);
+      GetValues (*m_pSourceModule, &xCoords[0], &yCoords[0], &zCoords[0],
+        &values[0], m_destWidth);
+      float* pDest = m_pDestNoiseMap->GetSlabPtr (y - destRowOffset);
+      for (int x = 0; x < m_destWidth; x++) {
+        *pDest++ = (float)values[x];
+      }
+    }
+  });
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -955,6 +1548,7 @@ RendererImage::RendererImage ():
   m_pBackgroundImage  (NULL),
   m_pDestImage        (NULL),
   m_pSourceNoiseMap   (NULL),
+  m_pSourceQuantizedMap (NULL),
   m_recalcLightValues (true)
 {
   BuildGrayscaleGradient ();
@@ -1041,21 +1635,11 @@ double RendererImage::CalcLightIntensity (double center, double left,
   // Recalculate the sine and cosine of the various light values if
   // necessary so it does not have to be calculated each time this method is
   // called.
-  if (m_recalcLightValues) {
-    m_cosAzimuth = cos (m_lightAzimuth * DEG_TO_RAD);
-    m_sinAzimuth = sin (m_lightAzimuth * DEG_TO_RAD);
-    m_cosElev    = cos (m_lightElev    * DEG_TO_RAD);
-    m_sinElev    = sin (m_lightElev    * DEG_TO_RAD);
-    m_recalcLightValues = false;
-  }
+  UpdateLightValues ();
 
   // Now do the lighting calculations.
-  const double I_MAX = 1.0;
-  double io = I_MAX * SQRT_2 * m_sinElev / 2.0;
-  double ix = (I_MAX - io) * m_lightContrast * SQRT_2 * m_cosElev
-    * m_cosAzimuth;
-  double iy = (I_MAX - io) * m_lightContrast * SQRT_2 * m_cosElev
-    * m_sinAzimuth; 
+  double ix, iy, io;
+  CalcLightCoefficients (ix, iy, io);
   double intensity = (ix * (left - right) + iy * (down - up) + io);
   if (intensity < 0.0) {
     intensity = 0.0;
@@ -1063,23 +1647,47 @@ double RendererImage::CalcLightIntensity (double center, double left,
   return intensity;
 }
 
+void RendererImage::CalcLightCoefficients (double& ix, double& iy,
+  double& io) const
+{
+  const double I_MAX = 1.0;
+  io = I_MAX * SQRT_2 * m_sinElev / 2.0;
+  ix = (I_MAX - io) * m_lightContrast * SQRT_2 * m_cosElev * m_cosAzimuth;
+  iy = (I_MAX - io) * m_lightContrast * SQRT_2 * m_cosElev * m_sinAzimuth;
+}
+
 void RendererImage::ClearGradient ()
 {
   m_gradient.Clear ();
 }
 
+int RendererImage::GetSourceHeight () const
+{
+  if (m_pSourceQuantizedMap != NULL) {
+    return m_pSourceQuantizedMap->GetHeight ();
+  }
+  return (m_pSourceNoiseMap != NULL)? m_pSourceNoiseMap->GetHeight (): 0;
+}
+
+int RendererImage::GetSourceWidth () const
+{
+  if (m_pSourceQuantizedMap != NULL) {
+    return m_pSourceQuantizedMap->GetWidth ();
+  }
+  return (m_pSourceNoiseMap != NULL)? m_pSourceNoiseMap->GetWidth (): 0;
+}
+
 void RendererImage::Render ()
 {
-  if ( m_pSourceNoiseMap == NULL
+  if ( GetSourceWidth  () <= 0
+    || GetSourceHeight () <= 0
     || m_pDestImage == NULL
-    || m_pSourceNoiseMap->GetWidth  () <= 0
-    || m_pSourceNoiseMap->GetHeight () <= 0
     || m_gradient.GetGradientPointCount () < 2) {
     throw noise::ExceptionInvalidParam ();
   }
 
-  int width  = m_pSourceNoiseMap->GetWidth  ();
-  int height = m_pSourceNoiseMap->GetHeight ();
+  int width  = GetSourceWidth  ();
+  int height = GetSourceHeight ();
 
   // If a background image was provided, make sure it is the same size the
   // source noise map.
@@ -1096,204 +1704,776 @@ void RendererImage::Render ()
     m_pDestImage->SetSize (width, height);
   }
 
-  for (int y = 0; y < height; y++) {
-    const Color* pBackground = NULL;
-    if (m_pBackgroundImage != NULL) {
-      pBackground = m_pBackgroundImage->GetConstSlabPtr (y);
+  // The color table and the light values are cached in mutable members.
+  // Update them before the rows are rendered, so that the rows only read
+  // them.
+  m_gradient.UpdateColorTable ();
+  UpdateLightValues ();
+
+  // Without a background image and a light source, the destination color
+  // only depends on the color table entry, so it is calculated once per
+  // entry.
+  std::vector<Color> destColors;
+  if (m_pBackgroundImage == NULL && !m_isLightEnabled) {
+    const Color* pColorTable = m_gradient.GetColorTable ();
+    Color backgroundColor (255, 255, 255, 255);
+    destColors.resize (GRADIENT_TABLE_SIZE);
+    for (int i = 0; i < GRADIENT_TABLE_SIZE; i++) {
+      destColors[i] = CalcDestColor (pColorTable[i], backgroundColor, 1.0);
     }
-    const float* pSource = m_pSourceNoiseMap->GetConstSlabPtr (y);
-    Color* pDest = m_pDestImage->GetSlabPtr (y);
-    for (int x = 0; x < width; x++) {
+  }
+  const Color* pDestColors = destColors.empty ()? NULL: &destColors[0];
+
+  // Without a background image but with a light source, the blend of the
+  // source color to the background only depends on the color table entry;
+  // the light is applied to each pixel.
+  std::vector<double> blendedChannels;
+  if (m_pBackgroundImage == NULL && m_isLightEnabled) {
+    const Color* pColorTable = m_gradient.GetColorTable ();
+    blendedChannels.resize (GRADIENT_TABLE_SIZE * 3);
+    for (int i = 0; i < GRADIENT_TABLE_SIZE; i++) {
+      double alpha = (double)pColorTable[i].alpha / 255.0;
+      blendedChannels[i] = LinearInterp (1.0,
+        (double)pColorTable[i].red / 255.0, alpha);
+      blendedChannels[GRADIENT_TABLE_SIZE + i] = LinearInterp (1.0,
+        (double)pColorTable[i].green / 255.0, alpha);
+      blendedChannels[GRADIENT_TABLE_SIZE * 2 + i] = LinearInterp (1.0,
+        (double)pColorTable[i].blue / 255.0, alpha);
+    }
+  }
+  const double* pBlendedChannels = blendedChannels.empty ()? NULL:
+    &blendedChannels[0];
+
+  // Each row only reads its own row of the background image, so the rows
+  // can be rendered in any order, even if the background image is also the
+  // destination image.
+  JobSystem& jobs = JobSystem::getInstance ();
+  if (jobs.getThreadCount () > 1
+    && width * height >= MIN_PARALLEL_BUILD_POINTS) {
+    jobs.parallelFor (0, height, BUILD_ROWS_PER_JOB,
+      [this, pDestColors, pBlendedChannels] (int firstRow, int lastRow) {
+        RenderRows (firstRow, lastRow, pDestColors, pBlendedChannels);
+      });
+  } else {
+    RenderRows (0, height, pDestColors, pBlendedChannels);
+  }
+}
 
-      // Get the color based on the value at the current point in the noise
-      // map.
-      Color destColor = m_gradient.GetColor (*pSource);
+void RendererImage::RenderRows (int firstRow, int lastRow,
+  const Color* pDestColors, const double* pBlendedChannels) const
+{
+  int width  = GetSourceWidth  ();
+  int height = GetSourceHeight ();
+
+  // The rows of a quantized source noise map are converted into three
+  // buffers, for the current row and the rows below and above it.  A
+  // converted row stays in its buffer for the next rows that need it, so
+  // each row is converted about once even if the image is lit.
+  std::vector<float> rowBuffers;
+  int bufferRows[3] = {-1, -1, -1};
+  if (m_pSourceQuantizedMap != NULL) {
+    rowBuffers.resize ((size_t)width * 3);
+  }
+  auto getSourceRow = [&] (int row, int keepRow0, int keepRow1)
+    -> const float* {
+    if (m_pSourceQuantizedMap == NULL) {
+      return m_pSourceNoiseMap->GetConstSlabPtr (row);
+    }
+    for (int i = 0; i < 3; i++) {
+      if (bufferRows[i] == row) {
+        return &rowBuffers[(size_t)i * width];
+      }
+    }
+    int slot = 0;
+    while (bufferRows[slot] == keepRow0 || bufferRows[slot] == keepRow1) {
+      slot++;
+    }
+    bufferRows[slot] = row;
+    m_pSourceQuantizedMap->DequantizeRow (row,
+      &rowBuffers[(size_t)slot * width]);
+    return &rowBuffers[(size_t)slot * width];
+  };
+
+  if (pDestColors != NULL) {
+    for (int y = firstRow; y < lastRow; y++) {
+      const float* pSource = getSourceRow (y, y, y);
+      Color* pDest = m_pDestImage->GetSlabPtr (y);
+      for (int x = 0; x < width; x++) {
+        pDest[x] = pDestColors[m_gradient.GetTableIndex (pSource[x])];
+      }
+    }
+    return;
+  }
 
-      // If lighting is enabled, calculate the light intensity based on the
-      // rate of change at the current point in the noise map.
-      double lightIntensity;
-      if (m_isLightEnabled) {
+  // The channels of a span of a row are blended from separate arrays of the
+  // source channels, the background channels and the light intensities, so
+  // that BlendChannelRow () can process several pixels at once.
+  double unitChannels[256];
+  for (int i = 0; i < 256; i++) {
+    unitChannels[i] = (double)i / 255.0;
+  }
+  double sourceRed  [RENDER_SPAN_WIDTH];
+  double sourceGreen[RENDER_SPAN_WIDTH];
+  double sourceBlue [RENDER_SPAN_WIDTH];
+  double sourceAlpha[RENDER_SPAN_WIDTH];
+  double backgroundRed  [RENDER_SPAN_WIDTH];
+  double backgroundGreen[RENDER_SPAN_WIDTH];
+  double backgroundBlue [RENDER_SPAN_WIDTH];
+  double light[RENDER_SPAN_WIDTH];
+  double redScale  [RENDER_SPAN_WIDTH];
+  double greenScale[RENDER_SPAN_WIDTH];
+  double blueScale [RENDER_SPAN_WIDTH];
+  int destRed  [RENDER_SPAN_WIDTH];
+  int destGreen[RENDER_SPAN_WIDTH];
+  int destBlue [RENDER_SPAN_WIDTH];
+  noise::uint8 destAlpha[RENDER_SPAN_WIDTH];
+  const double* pLight = m_isLightEnabled? light: NULL;
+  double ix = 0.0, iy = 0.0, io = 0.0;
+  if (m_isLightEnabled) {
+    CalcLightCoefficients (ix, iy, io);
+  }
 
-        // Calculate the positions of the current point's four-neighbors.
-        int xLeftOffset, xRightOffset;
-        int yUpOffset  , yDownOffset ;
-        if (m_isWrapEnabled) {
-          if (x == 0) {
-            xLeftOffset  = (int)width - 1;
-            xRightOffset = 1;
-          } else if (x == (int)width - 1) {
-            xLeftOffset  = -1;
-            xRightOffset = -((int)width - 1);
-          } else {
-            xLeftOffset  = -1;
-            xRightOffset = 1;
-          }
-          if (y == 0) {
-            yDownOffset = (int)height - 1;
-            yUpOffset   = 1;
-          } else if (y == (int)height - 1) {
-            yDownOffset = -1;
-            yUpOffset   = -((int)height - 1);
-          } else {
-            yDownOffset = -1;
-            yUpOffset   = 1;
-          }
-        } else {
-          if (x == 0) {
-            xLeftOffset  = 0;
-            xRightOffset = 1;
-          } else if (x == (int)width - 1) {
-            xLeftOffset  = -1;
-            xRightOffset = 0;
-          } else {
-            xLeftOffset  = -1;
-            xRightOffset = 1;
-          }
-          if (y == 0) {
-            yDownOffset = 0;
-            yUpOffset   = 1;
-          } else if (y == (int)height - 1) {
-            yDownOffset = -1;
-            yUpOffset   = 0;
-          } else {
-            yDownOffset = -1;
-            yUpOffset   = 1;
+  const Color* pColorTable = m_gradient.GetColorTable ();
+  for (int y = firstRow; y < lastRow; y++) {
+    const Color* pBackgroundRow = NULL;
+    if (m_pBackgroundImage != NULL) {
+      pBackgroundRow = m_pBackgroundImage->GetConstSlabPtr (y);
+    }
+    Color* pDestRow = m_pDestImage->GetSlabPtr (y);
+
+    // Calculate the positions of the current row's neighbors.
+    int yUpOffset, yDownOffset;
+    if (m_isWrapEnabled) {
+      if (y == 0) {
+        yDownOffset = (int)height - 1;
+        yUpOffset   = 1;
+      } else if (y == (int)height - 1) {
+        yDownOffset = -1;
+        yUpOffset   = -((int)height - 1);
+      } else {
+        yDownOffset = -1;
+        yUpOffset   = 1;
+      }
+    } else {
+      if (y == 0) {
+        yDownOffset = 0;
+        yUpOffset   = 1;
+      } else if (y == (int)height - 1) {
+        yDownOffset = -1;
+        yUpOffset   = 0;
+      } else {
+        yDownOffset = -1;
+        yUpOffset   = 1;
+      }
+    }
+    int downRow = m_isLightEnabled? y + yDownOffset: y;
+    int upRow   = m_isLightEnabled? y + yUpOffset  : y;
+    const float* pSourceRow = getSourceRow (y, downRow, upRow);
+    const float* pDownRow   = getSourceRow (downRow, y, upRow);
+    const float* pUpRow     = getSourceRow (upRow, y, downRow);
+
+    for (int firstX = 0; firstX < width; firstX += RENDER_SPAN_WIDTH) {
+      int count = std::min (RENDER_SPAN_WIDTH, width - firstX);
+      const float* pSource = pSourceRow + firstX;
+
+      // Get the color based on the value at each point in the noise map, and
+      // the current background color from the background image.  Blended
+      // channels only need the color table index.
+      if (pBlendedChannels != NULL) {
+        for (int i = 0; i < count; i++) {
+          int index = m_gradient.GetTableIndex (pSource[i]);
+          sourceRed  [i] = pBlendedChannels[index];
+          sourceGreen[i] = pBlendedChannels[GRADIENT_TABLE_SIZE + index];
+          sourceBlue [i] = pBlendedChannels[GRADIENT_TABLE_SIZE * 2 + index];
+          destAlpha[i] = 255;
+        }
+      } else {
+        for (int i = 0; i < count; i++) {
+          const Color& sourceColor
+            = pColorTable[m_gradient.GetTableIndex (pSource[i])];
+          Color backgroundColor (255, 255, 255, 255);
+          if (pBackgroundRow != NULL) {
+            backgroundColor = pBackgroundRow[firstX + i];
           }
+          sourceRed  [i] = unitChannels[sourceColor.red  ];
+          sourceGreen[i] = unitChannels[sourceColor.green];
+          sourceBlue [i] = unitChannels[sourceColor.blue ];
+          sourceAlpha[i] = unitChannels[sourceColor.alpha];
+          backgroundRed  [i] = unitChannels[backgroundColor.red  ];
+          backgroundGreen[i] = unitChannels[backgroundColor.green];
+          backgroundBlue [i] = unitChannels[backgroundColor.blue ];
+          destAlpha[i] = GetMax (sourceColor.alpha, backgroundColor.alpha);
         }
-        yDownOffset *= m_pSourceNoiseMap->GetStride ();
-        yUpOffset   *= m_pSourceNoiseMap->GetStride ();
-
-        // Get the noise value of the current point in the source noise map
-        // and the noise values of its four-neighbors.
-        double nc = (double)(*pSource);
-        double nl = (double)(*(pSource + xLeftOffset ));
-        double nr = (double)(*(pSource + xRightOffset));
-        double nd = (double)(*(pSource + yDownOffset ));
-        double nu = (double)(*(pSource + yUpOffset   ));
-
-        // Now we can calculate the lighting intensity.
-        lightIntensity = CalcLightIntensity (nc, nl, nr, nd, nu);
-        lightIntensity *= m_lightBrightness;
+      }
 
-      } else {
+      // If lighting is enabled, calculate the light intensity based on the
+      // rate of change at each point in the noise map.  Only the first and
+      // the last point of a row have other neighbors than the adjacent
+      // points; the points in between are calculated as one span.
+      if (m_isLightEnabled) {
+        int firstInner = (firstX == 0)? 1: 0;
+        int lastInner = (firstX + count == width)? count - 1: count;
+        if (firstInner < lastInner) {
+          CalcLightSpan (pSource + firstInner - 1, pSource + firstInner + 1,
+            pDownRow + firstX + firstInner, pUpRow + firstX + firstInner, ix,
+            iy, io, m_lightBrightness, light + firstInner,
+            lastInner - firstInner);
+        }
+        for (int i = 0; i < count; i++) {
+          if (i >= firstInner && i < lastInner) {
+            continue;
+          }
 
-        // These values will apply no lighting to the destination image.
-        lightIntensity = 1.0;
-      }
+          // Calculate the positions of the current point's left and right
+          // neighbors.
+          int x = firstX + i;
+          int xLeftOffset  = -1;
+          int xRightOffset = 1;
+          if (x == 0 || x == (int)width - 1) {
+            if (m_isWrapEnabled) {
+              if (x == 0) {
+                xLeftOffset  = (int)width - 1;
+              } else {
+                xRightOffset = -((int)width - 1);
+              }
+            } else {
+              if (x == 0) {
+                xLeftOffset  = 0;
+              } else {
+                xRightOffset = 0;
+              }
+            }
+          }
 
-      // Get the current background color from the background image.
-      Color backgroundColor (255, 255, 255, 255);
-      if (m_pBackgroundImage != NULL) {
-        backgroundColor = *pBackground;
+          // Get the noise value of the current point in the source noise
+          // map and the noise values of its four-neighbors, then calculate
+          // the lighting intensity.
+          double nc = (double)pSource[i];
+          double nl = (double)pSource[i + xLeftOffset ];
+          double nr = (double)pSource[i + xRightOffset];
+          double nd = (double)pDownRow[x];
+          double nu = (double)pUpRow  [x];
+          light[i] = CalcLightIntensity (nc, nl, nr, nd, nu)
+            * m_lightBrightness;
+        }
       }
 
-      // Blend the destination color, background color, and the light
-      // intensity together, then update the destination image with that
-      // color.
-      *pDest = CalcDestColor (destColor, backgroundColor, lightIntensity);
-
-      // Go to the next point.
-      ++pSource;
-      ++pDest;
-      if (m_pBackgroundImage != NULL) {
-        ++pBackground;
+      // Blend the source colors, background colors, and the light
+      // intensities together, then update the destination image with those
+      // colors.
+      if (pBlendedChannels != NULL) {
+        // Channels of the light color with the same value share the scaled
+        // light intensities.
+        ScaleLightRow (light, (double)m_lightColor.red, redScale, count);
+        const double* pGreenScale = redScale;
+        if (m_lightColor.green != m_lightColor.red) {
+          ScaleLightRow (light, (double)m_lightColor.green, greenScale,
+            count);
+          pGreenScale = greenScale;
+        }
+        const double* pBlueScale = redScale;
+        if (m_lightColor.blue == m_lightColor.green) {
+          pBlueScale = pGreenScale;
+        } else if (m_lightColor.blue != m_lightColor.red) {
+          ScaleLightRow (light, (double)m_lightColor.blue, blueScale, count);
+          pBlueScale = blueScale;
+        }
+        LightChannelRow (sourceRed, redScale, destRed, count);
+        LightChannelRow (sourceGreen, pGreenScale, destGreen, count);
+        LightChannelRow (sourceBlue, pBlueScale, destBlue, count);
+      } else {
+        BlendChannelRow (sourceRed, backgroundRed, sourceAlpha, pLight,
+          (double)m_lightColor.red, destRed, count);
+        BlendChannelRow (sourceGreen, backgroundGreen, sourceAlpha, pLight,
+          (double)m_lightColor.green, destGreen, count);
+        BlendChannelRow (sourceBlue, backgroundBlue, sourceAlpha, pLight,
+          (double)m_lightColor.blue, destBlue, count);
       }
+      PackColorRow (destRed, destGreen, destBlue, destAlpha,
+        pDestRow + firstX, count);
     }
   }
 }
 
+void RendererImage::UpdateLightValues () const
+{
+  if (m_recalcLightValues) {
+    m_cosAzimuth = cos (m_lightAzimuth * DEG_TO_RAD);
+    m_sinAzimuth = sin (m_lightAzimuth * DEG_TO_RAD);
+    m_cosElev    = cos (m_lightElev    * DEG_TO_RAD);
+    m_sinElev    = sin (m_lightElev    * DEG_TO_RAD);
+    m_recalcLightValues = false;
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // RendererNormalMap class
 
 RendererNormalMap::RendererNormalMap ():
-  m_bumpHeight      (1.0),
-  m_isWrapEnabled   (false),
-  m_pDestImage      (NULL),
-  m_pSourceNoiseMap (NULL)
+  m_bumpHeight          (1.0),
+  m_isWrapEnabled       (false),
+  m_destFormat          (NORMAL_MAP_RG8),
+  m_pDestBuffer         (NULL),
+  m_pDestImage          (NULL),
+  m_pSourceNoiseMap     (NULL),
+  m_pSourceQuantizedMap (NULL)
 {
 };
 
-Color RendererNormalMap::CalcNormalColor (double nc, double nr, double nu,
-  double bumpHeight) const
+int RendererNormalMap::GetSourceHeight () const
 {
-  // Calculate the surface normal.
-  nc *= bumpHeight;
-  nr *= bumpHeight;
-  nu *= bumpHeight;
-  double ncr = (nc - nr);
-  double ncu = (nc - nu);
-  double d = sqrt ((ncu * ncu) + (ncr * ncr) + 1);
-  double vxc = (nc - nr) / d;
-  double vyc = (nc - nu) / d;
-  double vzc = 1.0 / d;
-
-  // Map the normal range from the (-1.0 .. +1.0) range to the (0 .. 255)
-  // range.
-  noise::uint8 xc, yc, zc;
-  xc = (noise::uint8)((noise::uint)((floor)((vxc + 1.0) * 127.5)) & 0xff);
-  yc = (noise::uint8)((noise::uint)((floor)((vyc + 1.0) * 127.5)) & 0xff);
-  zc = (noise::uint8)((noise::uint)((floor)((vzc + 1.0) * 127.5)) & 0xff);
+  if (m_pSourceQuantizedMap != NULL) {
+    return m_pSourceQuantizedMap->GetHeight ();
+  }
+  return (m_pSourceNoiseMap != NULL)? m_pSourceNoiseMap->GetHeight (): 0;
+}
 
-  return Color (xc, yc, zc, 0);
+int RendererNormalMap::GetSourceWidth () const
+{
+  if (m_pSourceQuantizedMap != NULL) {
+    return m_pSourceQuantizedMap->GetWidth ();
+  }
+  return (m_pSourceNoiseMap != NULL)? m_pSourceNoiseMap->GetWidth (): 0;
 }
 
 void RendererNormalMap::Render ()
 {
-  if ( m_pSourceNoiseMap == NULL
-    || m_pDestImage == NULL
-    || m_pSourceNoiseMap->GetWidth  () <= 0
-    || m_pSourceNoiseMap->GetHeight () <= 0) {
+  if ( GetSourceWidth  () <= 0
+    || GetSourceHeight () <= 0
+    || (m_pDestImage == NULL && m_pDestBuffer == NULL)) {
     throw noise::ExceptionInvalidParam ();
   }
 
-  int width  = m_pSourceNoiseMap->GetWidth  ();
-  int height = m_pSourceNoiseMap->GetHeight ();
+  int width  = GetSourceWidth  ();
+  int height = GetSourceHeight ();
+  if (m_pDestImage != NULL) {
+    m_pDestImage->SetSize (width, height);
+  }
 
-  for (int y = 0; y < height; y++) {
-    const float* pSource = m_pSourceNoiseMap->GetConstSlabPtr (y);
-    Color* pDest = m_pDestImage->GetSlabPtr (y);
-    for (int x = 0; x < width; x++) {
+  // Each row only reads the source noise map and writes its own row of the
+  // destination, so the rows can be rendered in any order.
+  JobSystem& jobs = JobSystem::getInstance ();
+  if (jobs.getThreadCount () > 1
+    && width * height >= MIN_PARALLEL_BUILD_POINTS) {
+    jobs.parallelFor (0, height, BUILD_ROWS_PER_JOB,
+      [this] (int firstRow, int lastRow) {
+        RenderRows (firstRow, lastRow);
+      });
+  } else {
+    RenderRows (0, height);
+  }
+}
+
+void RendererNormalMap::RenderRows (int firstRow, int lastRow) const
+{
+  int width  = GetSourceWidth  ();
+  int height = GetSourceHeight ();
+
+  // The rows of a quantized source noise map are converted into two
+  // buffers, for the current row and the row above it.  The row above is
+  // the next current row, so each row is converted about once.
+  std::vector<float> rowBuffers;
+  int bufferRows[2] = {-1, -1};
+  if (m_pSourceQuantizedMap != NULL) {
+    rowBuffers.resize ((size_t)width * 2);
+  }
+  auto getSourceRow = [&] (int row, int keepRow) -> const float* {
+    if (m_pSourceQuantizedMap == NULL) {
+      return m_pSourceNoiseMap->GetConstSlabPtr (row);
+    }
+    for (int i = 0; i < 2; i++) {
+      if (bufferRows[i] == row) {
+        return &rowBuffers[(size_t)i * width];
+      }
+    }
+    int slot = (bufferRows[0] == keepRow)? 1: 0;
+    bufferRows[slot] = row;
+    m_pSourceQuantizedMap->DequantizeRow (row,
+      &rowBuffers[(size_t)slot * width]);
+    return &rowBuffers[(size_t)slot * width];
+  };
+
+  // The last point of a row has no right neighbor; it wraps to the first
+  // point or is cropped to itself.
+  int lastX  = width - 1;
+  int rightX = m_isWrapEnabled? 0: lastX;
+
+  // An image needs 8-bit channels, as does the RG8 format.
+  bool isTenBit = m_pDestImage == NULL && m_destFormat == NORMAL_MAP_RGB10A2;
+  double channelScale = isTenBit? 511.5: 127.5;
+  size_t pixelSize = (size_t)GetNormalMapPixelSize (m_destFormat);
+
+  int destX[RENDER_SPAN_WIDTH];
+  int destY[RENDER_SPAN_WIDTH];
+  int destZ[RENDER_SPAN_WIDTH];
+  for (int y = firstRow; y < lastRow; y++) {
+
+    // Calculate the position of the current row's up neighbor.
+    int upRow = y + 1;
+    if (y == height - 1) {
+      upRow = m_isWrapEnabled? 0: y;
+    }
+    const float* pUpRow     = getSourceRow (upRow, y);
+    const float* pSourceRow = getSourceRow (y, upRow);
+
+    for (int firstX = 0; firstX < width; firstX += RENDER_SPAN_WIDTH) {
+      int count = GetMin (RENDER_SPAN_WIDTH, width - firstX);
+
+      // All points of the span but the last point of the row have their
+      // right neighbor next to them.
+      const float* pSource = pSourceRow + firstX;
+      int innerCount = GetMin (count, lastX - firstX);
+      CalcNormalSpan (pSource, pSource + 1, pUpRow + firstX, m_bumpHeight,
+        channelScale, destX, destY, destZ, innerCount);
+      if (innerCount < count) {
+        CalcNormalSpan (pSourceRow + lastX, pSourceRow + rightX,
+          pUpRow + lastX, m_bumpHeight, channelScale, destX + innerCount,
+          destY + innerCount, destZ + innerCount, 1);
+      }
 
-      // Calculate the positions of the current point's right and up
-      // neighbors.
-      int xRightOffset, yUpOffset;
-      if (m_isWrapEnabled) {
-        if (x == (int)width - 1) {
-          xRightOffset = -((int)width - 1);
-        } else {
-          xRightOffset = 1;
+      // Encode the channels in the destination format.
+      if (m_pDestImage != NULL) {
+        Color* pDest = m_pDestImage->GetSlabPtr (y) + firstX;
+        for (int i = 0; i < count; i++) {
+          pDest[i] = Color ((noise::uint8)destX[i], (noise::uint8)destY[i],
+            (noise::uint8)destZ[i], 0);
         }
-        if (y == (int)height - 1) {
-          yUpOffset = -((int)height - 1);
-        } else {
-          yUpOffset = 1;
+      } else if (isTenBit) {
+        noise::uint8* pDest = m_pDestBuffer
+          + ((size_t)y * width + firstX) * pixelSize;
+        for (int i = 0; i < count; i++) {
+          noise::uint32 pixel = (noise::uint32)destX[i]
+            | ((noise::uint32)destY[i] << 10)
+            | ((noise::uint32)destZ[i] << 20);
+          memcpy (pDest + i * pixelSize, &pixel, sizeof (pixel));
         }
       } else {
-        if (x == (int)width - 1) {
-          xRightOffset = 0;
-        } else {
-          xRightOffset = 1;
-        }
-        if (y == (int)height - 1) {
-          yUpOffset = 0;
-        } else {
-          yUpOffset = 1;
+        noise::uint8* pDest = m_pDestBuffer
+          + ((size_t)y * width + firstX) * pixelSize;
+        for (int i = 0; i < count; i++) {
+          pDest[i * 2    ] = (noise::uint8)destX[i];
+          pDest[i * 2 + 1] = (noise::uint8)destY[i];
         }
       }
-      yUpOffset *= m_pSourceNoiseMap->GetStride ();
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// StreamWriterBMP class
+
+StreamWriterBMP::StreamWriterBMP ():
+  m_pBuffer    (NULL),
+  m_bufferUsed (0),
+  m_height     (0),
+  m_rowCount   (0),
+  m_width      (0)
+{
+}
+
+StreamWriterBMP::~StreamWriterBMP ()
+{
+  if (m_pBuffer != NULL) {
+    m_stream.close ();
+    delete[] m_pBuffer;
+  }
+}
 
-      // Get the noise value of the current point in the source noise map
-      // and the noise values of its right and up neighbors.
-      double nc = (double)(*pSource);
-      double nr = (double)(*(pSource + xRightOffset));
-      double nu = (double)(*(pSource + yUpOffset   ));
+void StreamWriterBMP::Close ()
+{
+  if (m_pBuffer == NULL) {
+    throw noise::ExceptionInvalidParam ();
+  }
+  if (!CloseStream (m_stream, m_pBuffer, m_bufferUsed)) {
+    throw noise::ExceptionUnknown ();
+  }
+  if (m_rowCount != m_height) {
+    throw noise::ExceptionInvalidParam ();
+  }
+}
 
-      // Calculate the normal product.
-      *pDest = CalcNormalColor (nc, nr, nu, m_bumpHeight);
+void StreamWriterBMP::Open (const std::string& filename, int width,
+  int height)
+{
+  if ( m_pBuffer != NULL
+    || width  <= 0
+    || height <= 0
+    || width  > RASTER_MAX_WIDTH) {
+    throw noise::ExceptionInvalidParam ();
+  }
+
+  m_pBuffer    = OpenStream (m_stream, filename);
+  m_bufferUsed = BMP_HEADER_SIZE;
+  m_height     = height;
+  m_rowCount   = 0;
+  m_width      = width;
+
+  // Build the header at the start of the buffer.
+  noise::uint32 destSize = (noise::uint32)CalcBMPRowByteCount (width)
+    * (noise::uint32)height;
+  noise::uint8* d = m_pBuffer;
+  memset (d, 0, BMP_HEADER_SIZE);
+  d[0] = 'B';
+  d[1] = 'M';
+  UnpackLittle32 (d +  2, destSize + BMP_HEADER_SIZE);
+  UnpackLittle32 (d + 10, (noise::uint32)BMP_HEADER_SIZE);
+  UnpackLittle32 (d + 14, 40);   // Palette offset
+  UnpackLittle32 (d + 18, (noise::uint32)width );
+  UnpackLittle32 (d + 22, (noise::uint32)height);
+  UnpackLittle16 (d + 26, 1 );   // Planes per pixel
+  UnpackLittle16 (d + 28, 24);   // Bits per plane
+                                 // Compression (0 = none) at offset 30
+  UnpackLittle32 (d + 34, destSize);
+  UnpackLittle32 (d + 38, 2834); // X pixels per meter
+  UnpackLittle32 (d + 42, 2834); // Y pixels per meter
+}
+
+void StreamWriterBMP::WriteRows (const Image& sourceImage, int firstRow,
+  int rowCount)
+{
+  if ( m_pBuffer == NULL
+    || sourceImage.GetWidth () != m_width
+    || firstRow < 0
+    || rowCount < 0
+    || firstRow + rowCount > sourceImage.GetHeight ()
+    || rowCount > m_height - m_rowCount) {
+    throw noise::ExceptionInvalidParam ();
+  }
 
-      // Go to the next point.
+  // Encode each row into the buffer, and write the buffer whenever the next
+  // row does not fit into it.
+  size_t rowSize = (size_t)CalcBMPRowByteCount (m_width);
+  for (int y = firstRow; y < firstRow + rowCount; y++) {
+    if (m_bufferUsed + rowSize > STREAM_BUFFER_SIZE) {
+      FlushStreamBuffer (m_stream, m_pBuffer, m_bufferUsed);
+    }
+    const Color* pSource = sourceImage.GetConstSlabPtr (y);
+    noise::uint8* pDest = m_pBuffer + m_bufferUsed;
+    memset (pDest + (rowSize - 4), 0, 4);
+    for (int x = 0; x < m_width; x++) {
+      *pDest++ = pSource->blue ;
+      *pDest++ = pSource->green;
+      *pDest++ = pSource->red  ;
       ++pSource;
-      ++pDest;
     }
+    m_bufferUsed += rowSize;
+    ++m_rowCount;
+  }
+}
+
+void StreamWriterBMP::WriteStrips (NoiseMapBuilder& builder,
+  RendererImage& renderer, int stripHeight)
+{
+  if ( m_pBuffer == NULL
+    || m_rowCount != 0
+    || (int)builder.GetDestWidth  () != m_width
+    || (int)builder.GetDestHeight () != m_height
+    || stripHeight <= 0
+    || (renderer.IsLightEnabled () && renderer.IsWrapEnabled ())) {
+    throw noise::ExceptionInvalidParam ();
+  }
+
+  // The light value of a point depends on its neighbors, so each strip of a
+  // lit image is built and rendered with the row above it and the row below
+  // it; only the rows in between are written.
+  int overlap = renderer.IsLightEnabled ()? 1: 0;
+
+  // While the job system writes the rows of one strip, the next strip is
+  // built and rendered into the other noise map and image.
+  NoiseMap stripNoiseMaps[2];
+  Image stripImages[2];
+  JobSystem& jobs = JobSystem::getInstance ();
+  JobCounter writeJobs;
+  try {
+    int strip = 0;
+    for (int firstRow = 0; firstRow < m_height; firstRow += stripHeight) {
+      int lastRow = std::min (m_height, firstRow + stripHeight);
+      int buildFirstRow = std::max (0, firstRow - overlap);
+      int buildLastRow  = std::min (m_height, lastRow + overlap);
+
+      builder.SetDestNoiseMap (stripNoiseMaps[strip]);
+      builder.SetDestRowRange (buildFirstRow, buildLastRow);
+      builder.Build ();
+      renderer.SetSourceNoiseMap (stripNoiseMaps[strip]);
+      renderer.SetDestImage (stripImages[strip]);
+      renderer.Render ();
+
+      // The previous strip must be written before this one.
+      jobs.wait (writeJobs);
+      const Image* pImage = &stripImages[strip];
+      int imageFirstRow = firstRow - buildFirstRow;
+      int imageRowCount = lastRow - firstRow;
+      jobs.run (writeJobs, [this, pImage, imageFirstRow, imageRowCount] {
+        WriteRows (*pImage, imageFirstRow, imageRowCount);
+      });
+      strip ^= 1;
+    }
+    jobs.wait (writeJobs);
+  }
+  catch (...) {
+    // The strips must outlive the write job.
+    try {
+      jobs.wait (writeJobs);
+    }
+    catch (...) {
+    }
+    builder.ClearDestRowRange ();
+    throw;
+  }
+  builder.ClearDestRowRange ();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// StreamWriterTER class
+
+StreamWriterTER::StreamWriterTER ():
+  m_pBuffer        (NULL),
+  m_bufferUsed     (0),
+  m_height         (0),
+  m_metersPerPoint (DEFAULT_METERS_PER_POINT),
+  m_rowCount       (0),
+  m_width          (0)
+{
+}
+
+StreamWriterTER::~StreamWriterTER ()
+{
+  if (m_pBuffer != NULL) {
+    m_stream.close ();
+    delete[] m_pBuffer;
+  }
+}
+
+void StreamWriterTER::Close ()
+{
+  if (m_pBuffer == NULL) {
+    throw noise::ExceptionInvalidParam ();
+  }
+  if (!CloseStream (m_stream, m_pBuffer, m_bufferUsed)) {
+    throw noise::ExceptionUnknown ();
+  }
+  if (m_rowCount != m_height) {
+    throw noise::ExceptionInvalidParam ();
+  }
+}
+
+void StreamWriterTER::Open (const std::string& filename, int width,
+  int height)
+{
+  // The header stores the width and the height as 16-bit integers.
+  if ( m_pBuffer != NULL
+    || width  <= 0
+    || height <= 0
+    || width  > RASTER_MAX_WIDTH
+    || height > 65535) {
+    throw noise::ExceptionInvalidParam ();
+  }
+
+  m_pBuffer    = OpenStream (m_stream, filename);
+  m_height     = height;
+  m_rowCount   = 0;
+  m_width      = width;
+
+  // Build the header at the start of the buffer.
+  int16 heightScale = (int16)(floor (32768.0 / (double)m_metersPerPoint));
+  noise::uint8* d = m_pBuffer;
+  memcpy (d, "TERRAGENTERRAIN ", 16); d += 16;
+  memcpy (d, "SIZE", 4);              d += 4;
+  UnpackLittle16 (d, GetMin (width, height) - 1); d += 2;
+  memset (d, 0, 2);                   d += 2;
+  memcpy (d, "XPTS", 4);              d += 4;
+  UnpackLittle16 (d, width);          d += 2;
+  memset (d, 0, 2);                   d += 2;
+  memcpy (d, "YPTS", 4);              d += 4;
+  UnpackLittle16 (d, height);         d += 2;
+  memset (d, 0, 2);                   d += 2;
+  memcpy (d, "SCAL", 4);              d += 4;
+  UnpackFloat (d, m_metersPerPoint);  d += 4;
+  UnpackFloat (d, m_metersPerPoint);  d += 4;
+  UnpackFloat (d, m_metersPerPoint);  d += 4;
+  memcpy (d, "ALTW", 4);              d += 4;
+  UnpackLittle16 (d, heightScale);    d += 2;
+  memset (d, 0, 2);                   d += 2;
+  m_bufferUsed = (size_t)(d - m_pBuffer);
+}
+
+void StreamWriterTER::WriteRows (const NoiseMap& sourceNoiseMap,
+  int firstRow, int rowCount)
+{
+  if ( m_pBuffer == NULL
+    || sourceNoiseMap.GetWidth () != m_width
+    || firstRow < 0
+    || rowCount < 0
+    || firstRow + rowCount > sourceNoiseMap.GetHeight ()
+    || rowCount > m_height - m_rowCount) {
+    throw noise::ExceptionInvalidParam ();
+  }
+
+  // Encode each row into the buffer, and write the buffer whenever the next
+  // row does not fit into it.
+  size_t rowSize = (size_t)m_width * sizeof (int16);
+  for (int y = firstRow; y < firstRow + rowCount; y++) {
+    if (m_bufferUsed + rowSize > STREAM_BUFFER_SIZE) {
+      FlushStreamBuffer (m_stream, m_pBuffer, m_bufferUsed);
+    }
+    const float* pSource = sourceNoiseMap.GetConstSlabPtr (y);
+    noise::uint8* pDest = m_pBuffer + m_bufferUsed;
+    for (int x = 0; x < m_width; x++) {
+      int16 scaledHeight = (int16)(floor (*pSource * 2.0));
+      UnpackLittle16 (pDest, scaledHeight);
+      pDest += 2;
+      ++pSource;
+    }
+    m_bufferUsed += rowSize;
+    ++m_rowCount;
+  }
+}
+
+void StreamWriterTER::WriteStrips (NoiseMapBuilder& builder,
+  int stripHeight)
+{
+  if ( m_pBuffer == NULL
+    || m_rowCount != 0
+    || (int)builder.GetDestWidth  () != m_width
+    || (int)builder.GetDestHeight () != m_height
+    || stripHeight <= 0) {
+    throw noise::ExceptionInvalidParam ();
+  }
+
+  // While the job system writes the rows of one strip, the next strip is
+  // built into the other noise map.
+  NoiseMap stripNoiseMaps[2];
+  JobSystem& jobs = JobSystem::getInstance ();
+  JobCounter writeJobs;
+  try {
+    int strip = 0;
+    for (int firstRow = 0; firstRow < m_height; firstRow += stripHeight) {
+      int lastRow = std::min (m_height, firstRow + stripHeight);
+
+      builder.SetDestNoiseMap (stripNoiseMaps[strip]);
+      builder.SetDestRowRange (firstRow, lastRow);
+      builder.Build ();
+
+      // The previous strip must be written before this one.
+      jobs.wait (writeJobs);
+      const NoiseMap* pNoiseMap = &stripNoiseMaps[strip];
+      int rowCount = lastRow - firstRow;
+      jobs.run (writeJobs, [this, pNoiseMap, rowCount] {
+        WriteRows (*pNoiseMap, 0, rowCount);
+      });
+      strip ^= 1;
+    }
+    jobs.wait (writeJobs);
+  }
+  catch (...) {
+    // The strips must outlive the write job.
+    try {
+      jobs.wait (writeJobs);
+    }
+    catch (...) {
+    }
+    builder.ClearDestRowRange ();
+    throw;
   }
+  builder.ClearDestRowRange ();
 }
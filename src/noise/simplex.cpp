@@ -0,0 +1,338 @@
+// simplex.cpp
+//
+// Simplex-noise generator module.  Not part of the original libnoise
+// distribution; it is compiled with the game sources.
+//
+
+#include <cmath>
+
+#include <noise/noisegen.h>
+#include <noise/randomvectors.h>
+#include <noise/module/simplex.h>
+
+using namespace noise;
+using namespace noise::module;
+
+namespace
+{
+
+  // Constants of the lattice hash (noisegen.cpp), plus a fourth axis.
+  const unsigned int X_NOISE_GEN = 1619;
+  const unsigned int Y_NOISE_GEN = 31337;
+  const unsigned int Z_NOISE_GEN = 6971;
+  const unsigned int W_NOISE_GEN = 1999;
+  const unsigned int SEED_NOISE_GEN = 1013;
+  const int SHIFT_NOISE_GEN = 8;
+
+  // Factors that skew an input value onto the lattice of unit cells, and
+  // that unskew a lattice point back, in two, three and four dimensions.
+  const double SKEW_2D   = 0.36602540378443864676;  // (sqrt (3) - 1) / 2
+  const double UNSKEW_2D = 0.21132486540518711775;  // (3 - sqrt (3)) / 6
+  const double SKEW_3D   = 1.0 / 3.0;
+  const double UNSKEW_3D = 1.0 / 6.0;
+  const double SKEW_4D   = 0.30901699437494742410;  // (sqrt (5) - 1) / 4
+  const double UNSKEW_4D = 0.13819660112501051518;  // (5 - sqrt (5)) / 20
+
+  // Scales that bring the sums of the corner contributions to about the
+  // -1.0 to +1.0 range, measured over many random input values.
+  const double SCALE_2D = 99.0;
+  const double SCALE_3D = 108.0;
+  const double SCALE_4D = 63.0;
+
+  // Unit gradient vectors of the two-dimensional noise, at 256 evenly
+  // spaced angles.  The lattice hash picks one at random.
+  struct Gradients2D
+  {
+    double vectors[256 * 2];
+
+    Gradients2D ()
+    {
+      for (int i = 0; i < 256; i++) {
+        double angle = (i + 0.5) * (6.28318530717958647692 / 256.0);
+        vectors[i * 2    ] = cos (angle);
+        vectors[i * 2 + 1] = sin (angle);
+      }
+    }
+  };
+  const Gradients2D g_gradients2D;
+
+  // Gradient vectors of the four-dimensional noise: the 32 edges of the
+  // four-dimensional hypercube.  The three-dimensional noise uses the
+  // library's random unit vectors.
+  const double GRADIENTS_4D[32 * 4] = {
+     0,  1,  1,  1,   0,  1,  1, -1,   0,  1, -1,  1,   0,  1, -1, -1,
+     0, -1,  1,  1,   0, -1,  1, -1,   0, -1, -1,  1,   0, -1, -1, -1,
+     1,  0,  1,  1,   1,  0,  1, -1,   1,  0, -1,  1,   1,  0, -1, -1,
+    -1,  0,  1,  1,  -1,  0,  1, -1,  -1,  0, -1,  1,  -1,  0, -1, -1,
+     1,  1,  0,  1,   1,  1,  0, -1,   1, -1,  0,  1,   1, -1,  0, -1,
+    -1,  1,  0,  1,  -1,  1,  0, -1,  -1, -1,  0,  1,  -1, -1,  0, -1,
+     1,  1,  1,  0,   1,  1, -1,  0,   1, -1,  1,  0,   1, -1, -1,  0,
+    -1,  1,  1,  0,  -1,  1, -1,  0,  -1, -1,  1,  0,  -1, -1, -1,  0
+  };
+
+  // Rounds down to the lattice coordinate.  MakeInt32Range () bounds the
+  // input values, so the skewed coordinates fit into 64 bits; the lattice
+  // hash only uses their low 32 bits.
+  inline long long LatticeFloor (double n)
+  {
+    long long i = (long long)n;
+    return i - ((n < (double)i)? 1: 0);
+  }
+
+  // Returns the gradient index of the lattice point with the given hash.
+  inline unsigned int GradientIndex (unsigned int hash)
+  {
+    hash ^= (hash >> SHIFT_NOISE_GEN);
+    return hash & 0xff;
+  }
+
+  // Returns the contribution of a simplex corner with the given attenuation
+  // (0.5 minus the squared distance to the corner) and gradient product.
+  // Whether a corner is in reach is random, so the attenuation is clamped
+  // to zero arithmetically; compilers turn a comparison into a branch.
+  inline double Contribution (double t, double product)
+  {
+    t = 0.5 * (t + fabs (t));
+    t *= t;
+    return t * t * product;
+  }
+
+  double SimplexNoise2D (double x, double y, int seed)
+  {
+    // Find the unit cell of the skewed lattice, and the position of the
+    // input value relative to its first corner.
+    double s = (x + y) * SKEW_2D;
+    long long i = LatticeFloor (x + s);
+    long long j = LatticeFloor (y + s);
+    double t = (double)(i + j) * UNSKEW_2D;
+    double x0 = x - ((double)i - t);
+    double y0 = y - ((double)j - t);
+
+    // The cell splits into two triangles along its diagonal.
+    unsigned int i1 = (x0 > y0)? 1: 0;
+    unsigned int j1 = 1 - i1;
+    double x1 = x0 - i1 + UNSKEW_2D;
+    double y1 = y0 - j1 + UNSKEW_2D;
+    double x2 = x0 - 1.0 + 2.0 * UNSKEW_2D;
+    double y2 = y0 - 1.0 + 2.0 * UNSKEW_2D;
+
+    unsigned int hash = X_NOISE_GEN * (unsigned int)i
+      + Y_NOISE_GEN * (unsigned int)j + SEED_NOISE_GEN * (unsigned int)seed;
+    const double* g0 = &g_gradients2D.vectors[GradientIndex (hash) * 2];
+    const double* g1 = &g_gradients2D.vectors[GradientIndex (hash
+      + X_NOISE_GEN * i1 + Y_NOISE_GEN * j1) * 2];
+    const double* g2 = &g_gradients2D.vectors[GradientIndex (hash
+      + X_NOISE_GEN + Y_NOISE_GEN) * 2];
+
+    double n = Contribution (0.5 - x0 * x0 - y0 * y0, g0[0] * x0 + g0[1] * y0)
+      + Contribution (0.5 - x1 * x1 - y1 * y1, g1[0] * x1 + g1[1] * y1)
+      + Contribution (0.5 - x2 * x2 - y2 * y2, g2[0] * x2 + g2[1] * y2);
+    return n * SCALE_2D;
+  }
+
+  double SimplexNoise3D (double x, double y, double z, int seed)
+  {
+    double s = (x + y + z) * SKEW_3D;
+    long long i = LatticeFloor (x + s);
+    long long j = LatticeFloor (y + s);
+    long long k = LatticeFloor (z + s);
+    double t = (double)(i + j + k) * UNSKEW_3D;
+    double x0 = x - ((double)i - t);
+    double y0 = y - ((double)j - t);
+    double z0 = z - ((double)k - t);
+
+    // The cell splits into six tetrahedra; the order of the coordinates
+    // picks the one that contains the input value, and the second and
+    // third corners step along the largest coordinates first.  The order is
+    // random, so the steps come from comparisons instead of branches.
+    unsigned int xy = (x0 >= y0)? 1: 0;
+    unsigned int xz = (x0 >= z0)? 1: 0;
+    unsigned int yz = (y0 >= z0)? 1: 0;
+    unsigned int i1 = xy & xz;
+    unsigned int j1 = (xy ^ 1) & yz;
+    unsigned int k1 = (xz | yz) ^ 1;
+    unsigned int i2 = xy | xz;
+    unsigned int j2 = (xy ^ 1) | yz;
+    unsigned int k2 = (xz & yz) ^ 1;
+    double x1 = x0 - i1 + UNSKEW_3D;
+    double y1 = y0 - j1 + UNSKEW_3D;
+    double z1 = z0 - k1 + UNSKEW_3D;
+    double x2 = x0 - i2 + 2.0 * UNSKEW_3D;
+    double y2 = y0 - j2 + 2.0 * UNSKEW_3D;
+    double z2 = z0 - k2 + 2.0 * UNSKEW_3D;
+    double x3 = x0 - 1.0 + 3.0 * UNSKEW_3D;
+    double y3 = y0 - 1.0 + 3.0 * UNSKEW_3D;
+    double z3 = z0 - 1.0 + 3.0 * UNSKEW_3D;
+
+    unsigned int hash = X_NOISE_GEN * (unsigned int)i
+      + Y_NOISE_GEN * (unsigned int)j + Z_NOISE_GEN * (unsigned int)k
+      + SEED_NOISE_GEN * (unsigned int)seed;
+    const double* g0 = &g_randomVectors[GradientIndex (hash) << 2];
+    const double* g1 = &g_randomVectors[GradientIndex (hash
+      + X_NOISE_GEN * i1 + Y_NOISE_GEN * j1 + Z_NOISE_GEN * k1) << 2];
+    const double* g2 = &g_randomVectors[GradientIndex (hash
+      + X_NOISE_GEN * i2 + Y_NOISE_GEN * j2 + Z_NOISE_GEN * k2) << 2];
+    const double* g3 = &g_randomVectors[GradientIndex (hash
+      + X_NOISE_GEN + Y_NOISE_GEN + Z_NOISE_GEN) << 2];
+
+    double n
+      = Contribution (0.5 - x0 * x0 - y0 * y0 - z0 * z0,
+        g0[0] * x0 + g0[1] * y0 + g0[2] * z0)
+      + Contribution (0.5 - x1 * x1 - y1 * y1 - z1 * z1,
+        g1[0] * x1 + g1[1] * y1 + g1[2] * z1)
+      + Contribution (0.5 - x2 * x2 - y2 * y2 - z2 * z2,
+        g2[0] * x2 + g2[1] * y2 + g2[2] * z2)
+      + Contribution (0.5 - x3 * x3 - y3 * y3 - z3 * z3,
+        g3[0] * x3 + g3[1] * y3 + g3[2] * z3);
+    return n * SCALE_3D;
+  }
+
+  double SimplexNoise4D (double x, double y, double z, double w, int seed)
+  {
+    double s = (x + y + z + w) * SKEW_4D;
+    long long i = LatticeFloor (x + s);
+    long long j = LatticeFloor (y + s);
+    long long k = LatticeFloor (z + s);
+    long long l = LatticeFloor (w + s);
+    double t = (double)(i + j + k + l) * UNSKEW_4D;
+    double p0[4] = {
+      x - ((double)i - t), y - ((double)j - t), z - ((double)k - t),
+      w - ((double)l - t)
+    };
+
+    // The cell splits into 24 simplices.  Rank the coordinates by size;
+    // corner c steps along the axes of the c largest coordinates.
+    int rank[4] = {0, 0, 0, 0};
+    for (int a = 0; a < 4; a++) {
+      for (int b = a + 1; b < 4; b++) {
+        if (p0[a] > p0[b]) {
+          rank[a]++;
+        } else {
+          rank[b]++;
+        }
+      }
+    }
+
+    const unsigned int axisHash[4] = {
+      X_NOISE_GEN, Y_NOISE_GEN, Z_NOISE_GEN, W_NOISE_GEN
+    };
+    unsigned int hash = X_NOISE_GEN * (unsigned int)i
+      + Y_NOISE_GEN * (unsigned int)j + Z_NOISE_GEN * (unsigned int)k
+      + W_NOISE_GEN * (unsigned int)l + SEED_NOISE_GEN * (unsigned int)seed;
+    double n = 0.0;
+    for (int corner = 0; corner < 5; corner++) {
+      double p[4];
+      double distance = 0.0;
+      unsigned int cornerHash = hash;
+      for (int a = 0; a < 4; a++) {
+        // Corner c steps along axis a if a ranks among the c largest.
+        int step = (rank[a] >= 4 - corner)? 1: 0;
+        p[a] = p0[a] - step + corner * UNSKEW_4D;
+        cornerHash += axisHash[a] * step;
+        distance += p[a] * p[a];
+      }
+      const double* g = &GRADIENTS_4D[(GradientIndex (cornerHash) & 31) << 2];
+      n += Contribution (0.5 - distance,
+        g[0] * p[0] + g[1] * p[1] + g[2] * p[2] + g[3] * p[3]);
+    }
+    return n * SCALE_4D;
+  }
+
+}
+
+Simplex::Simplex ():
+  Module (GetSourceModuleCount ()),
+  m_frequency    (DEFAULT_SIMPLEX_FREQUENCY   ),
+  m_lacunarity   (DEFAULT_SIMPLEX_LACUNARITY  ),
+  m_octaveCount  (DEFAULT_SIMPLEX_OCTAVE_COUNT),
+  m_persistence  (DEFAULT_SIMPLEX_PERSISTENCE ),
+  m_seed         (DEFAULT_SIMPLEX_SEED        ),
+  m_type         (DEFAULT_SIMPLEX_TYPE        )
+{
+  CalcSpectralWeights ();
+}
+
+void Simplex::CalcSpectralWeights ()
+{
+  // Same weights as RidgedMulti::CalcSpectralWeights ().
+  double frequency = 1.0;
+  for (int i = 0; i < SIMPLEX_MAX_OCTAVE; i++) {
+    m_pSpectralWeights[i] = pow (frequency, -1.0);
+    frequency *= m_lacunarity;
+  }
+}
+
+template <class OctaveNoise>
+double Simplex::GetFractalValue (OctaveNoise octaveNoise) const
+{
+  // The octaves are combined like the octaves of Perlin, Billow and
+  // RidgedMulti (GetValue () of perlin.cpp, billow.cpp and ridgedmulti.cpp).
+  // Each type has its own octave loop, which keeps the type test out of it.
+  double value = 0.0;
+  double curPersistence = 1.0;
+  double scale = m_frequency;
+  switch (m_type) {
+    case SIMPLEX_BILLOW:
+      for (int curOctave = 0; curOctave < m_octaveCount; curOctave++) {
+        double signal = 2.0 * fabs (octaveNoise (scale, m_seed + curOctave))
+          - 1.0;
+        value += signal * curPersistence;
+        scale *= m_lacunarity;
+        curPersistence *= m_persistence;
+      }
+      return value + 0.5;
+
+    case SIMPLEX_RIDGED: {
+      double weight = 1.0;
+      for (int curOctave = 0; curOctave < m_octaveCount; curOctave++) {
+        int seed = (m_seed + curOctave) & 0x7fffffff;
+        double signal = 1.0 - fabs (octaveNoise (scale, seed));
+        signal *= signal;
+        signal *= weight;
+        weight = signal * 2.0;
+        if (weight > 1.0) {
+          weight = 1.0;
+        }
+        if (weight < 0.0) {
+          weight = 0.0;
+        }
+        value += signal * m_pSpectralWeights[curOctave];
+        scale *= m_lacunarity;
+      }
+      return (value * 1.25) - 1.0;
+    }
+
+    default:
+      for (int curOctave = 0; curOctave < m_octaveCount; curOctave++) {
+        value += octaveNoise (scale, m_seed + curOctave) * curPersistence;
+        scale *= m_lacunarity;
+        curPersistence *= m_persistence;
+      }
+      return value;
+  }
+}
+
+double Simplex::GetValue (double x, double y, double z) const
+{
+  return GetFractalValue ([x, y, z] (double scale, int seed) {
+    return SimplexNoise3D (MakeInt32Range (x * scale),
+      MakeInt32Range (y * scale), MakeInt32Range (z * scale), seed);
+  });
+}
+
+double Simplex::GetValue2D (double x, double y) const
+{
+  return GetFractalValue ([x, y] (double scale, int seed) {
+    return SimplexNoise2D (MakeInt32Range (x * scale),
+      MakeInt32Range (y * scale), seed);
+  });
+}
+
+double Simplex::GetValue4D (double x, double y, double z, double w) const
+{
+  return GetFractalValue ([x, y, z, w] (double scale, int seed) {
+    return SimplexNoise4D (MakeInt32Range (x * scale),
+      MakeInt32Range (y * scale), MakeInt32Range (z * scale),
+      MakeInt32Range (w * scale), seed);
+  });
+}
@@ -0,0 +1,129 @@
+// threadcache.cpp
+//
+// Thread-safe counterpart of the Cache noise module.  Not part of the
+// original libnoise distribution; it is compiled with the game sources.
+//
+
+#include <mutex>
+#include <vector>
+
+#include <noise/module/threadcache.h>
+
+using namespace noise::module;
+
+namespace
+{
+
+  // Hands out the thread slots used to index per-thread cache entries.  A
+  // slot is returned to the free list when its thread exits, so short-lived
+  // threads do not use up the slots.
+  class ThreadSlots
+  {
+
+    public:
+
+      ThreadSlots ():
+        m_nextSlot (0)
+      {
+      }
+
+      int Acquire ()
+      {
+        std::lock_guard<std::mutex> lock (m_mutex);
+        if (!m_freeSlots.empty ()) {
+          int slot = m_freeSlots.back ();
+          m_freeSlots.pop_back ();
+          return slot;
+        }
+        if (m_nextSlot < THREAD_CACHE_MAX_THREADS) {
+          return m_nextSlot++;
+        }
+        return -1;
+      }
+
+      void Release (int slot)
+      {
+        std::lock_guard<std::mutex> lock (m_mutex);
+        m_freeSlots.push_back (slot);
+      }
+
+    private:
+
+      std::mutex m_mutex;
+      std::vector<int> m_freeSlots;
+      int m_nextSlot;
+
+  };
+
+  // Never destroyed: threads of static objects (such as the job system's
+  // workers) may release their slots during static destruction.
+  ThreadSlots& GetThreadSlots ()
+  {
+    static ThreadSlots* pSlots = new ThreadSlots ();
+    return *pSlots;
+  }
+
+  // Slot of the calling thread, or -1 if every slot is taken.
+  struct ThreadSlotHandle
+  {
+    ThreadSlotHandle ():
+      slot (GetThreadSlots ().Acquire ())
+    {
+    }
+
+    ~ThreadSlotHandle ()
+    {
+      if (slot >= 0) {
+        GetThreadSlots ().Release (slot);
+      }
+    }
+
+    int slot;
+  };
+
+}
+
+int noise::module::GetThreadCacheSlot ()
+{
+  thread_local ThreadSlotHandle handle;
+  return handle.slot;
+}
+
+ThreadCache::ThreadCache ():
+  Module (GetSourceModuleCount ()),
+  m_pEntries (NULL),
+  m_generation (1)
+{
+  m_pEntries = new Entry[THREAD_CACHE_MAX_THREADS];
+  for (int i = 0; i < THREAD_CACHE_MAX_THREADS; i++) {
+    m_pEntries[i].generation = 0;
+  }
+}
+
+ThreadCache::~ThreadCache ()
+{
+  delete[] m_pEntries;
+}
+
+double ThreadCache::GetValue (double x, double y, double z) const
+{
+  assert (m_pSourceModule[0] != NULL);
+
+  int slot = GetThreadCacheSlot ();
+  if (slot < 0) {
+    return m_pSourceModule[0]->GetValue (x, y, z);
+  }
+
+  // A slot that a finished thread handed back may still hold that thread's
+  // value; it is still a valid output value for its input value.
+  Entry& entry = m_pEntries[slot];
+  if (entry.generation != m_generation
+    || x != entry.x || y != entry.y || z != entry.z) {
+    entry.value = m_pSourceModule[0]->GetValue (x, y, z);
+    entry.x = x;
+    entry.y = y;
+    entry.z = z;
+    entry.generation = m_generation;
+  }
+  return entry.value;
+}
@@ -0,0 +1,542 @@
+// tilecache.cpp
+//
+// Disk cache of generated noise map tiles.  Not part of the original libnoise
+// distribution; it is compiled with the game sources.
+//
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <typeinfo>
+
+#include <noise/module/fastvoronoi.h>
+#include <noise/module/lrucache.h>
+#include <noise/module/module.h>
+#include <noise/module/threadcache.h>
+#include <noise/tilecache.h>
+
+#if defined (__unix__) || defined (__APPLE__)
+#define NOISE_TILECACHE_MMAP 1
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define NOISE_TILECACHE_MMAP 0
+#include <direct.h>
+#endif
+
+using namespace noise;
+using namespace noise::module;
+using namespace noise::utils;
+
+namespace
+{
+
+  // Header of a tile file.  The values follow it directly.
+  struct TileHeader
+  {
+    char magic[4];
+    int32 version;
+    unsigned long long graphHash;
+    int32 seed;
+    int32 width;
+    int32 height;
+    float scale;
+    float bias;
+    int32 channel;
+    double lowerXBound;
+    double upperXBound;
+    double lowerZBound;
+    double upperZBound;
+  };
+
+  static_assert (sizeof (TileHeader) == 72,
+    "the tile header must not depend on the compiler's padding");
+
+  const char TILE_MAGIC[4] = {'N', 'M', 'T', 'C'};
+
+  // Makes every temporary file name unique within the process.
+  std::atomic<unsigned int> g_tempFileCounter (0);
+
+  // FNV-1a hash of a sequence of values.
+  class GraphHasher
+  {
+
+    public:
+
+      GraphHasher ():
+        m_hash (0xcbf29ce484222325ULL)
+      {
+      }
+
+      void Add (const void* pData, size_t size)
+      {
+        const unsigned char* pBytes = (const unsigned char*)pData;
+        for (size_t i = 0; i < size; i++) {
+          m_hash ^= pBytes[i];
+          m_hash *= 0x100000001b3ULL;
+        }
+      }
+
+      void Add (double value)
+      {
+        // -0.0 and 0.0 give the same output values.
+        if (value == 0.0) {
+          value = 0.0;
+        }
+        Add (&value, sizeof (value));
+      }
+
+      void Add (int value)
+      {
+        Add (&value, sizeof (value));
+      }
+
+      void Add (const char* pName)
+      {
+        Add (pName, strlen (pName) + 1);
+      }
+
+      unsigned long long GetHash () const
+      {
+        return m_hash;
+      }
+
+    private:
+
+      unsigned long long m_hash;
+
+  };
+
+  template <class T>
+  inline const T* AsModule (const Module& sourceModule)
+  {
+    return (typeid (sourceModule) == typeid (T))?
+      static_cast<const T*> (&sourceModule): NULL;
+  }
+
+  // Adds the type and the parameters of a module to the hash.  Returns
+  // false for a module whose parameters are unknown.
+  bool AddModuleParams (const Module& sourceModule, GraphHasher& hasher)
+  {
+    if (const Perlin* pPerlin = AsModule<Perlin> (sourceModule)) {
+      hasher.Add ("Perlin");
+      hasher.Add (pPerlin->GetFrequency ());
+      hasher.Add (pPerlin->GetLacunarity ());
+      hasher.Add ((int)pPerlin->GetNoiseQuality ());
+      hasher.Add (pPerlin->GetOctaveCount ());
+      hasher.Add (pPerlin->GetPersistence ());
+      hasher.Add (pPerlin->GetSeed ());
+    } else if (const Billow* pBillow = AsModule<Billow> (sourceModule)) {
+      hasher.Add ("Billow");
+      hasher.Add (pBillow->GetFrequency ());
+      hasher.Add (pBillow->GetLacunarity ());
+      hasher.Add ((int)pBillow->GetNoiseQuality ());
+      hasher.Add (pBillow->GetOctaveCount ());
+      hasher.Add (pBillow->GetPersistence ());
+      hasher.Add (pBillow->GetSeed ());
+    } else if (const RidgedMulti* pRidged =
+      AsModule<RidgedMulti> (sourceModule)) {
+      hasher.Add ("RidgedMulti");
+      hasher.Add (pRidged->GetFrequency ());
+      hasher.Add (pRidged->GetLacunarity ());
+      hasher.Add ((int)pRidged->GetNoiseQuality ());
+      hasher.Add (pRidged->GetOctaveCount ());
+      hasher.Add (pRidged->GetSeed ());
+    } else if (const Simplex* pSimplex = AsModule<Simplex> (sourceModule)) {
+      hasher.Add ("Simplex");
+      hasher.Add ((int)pSimplex->GetType ());
+      hasher.Add (pSimplex->GetFrequency ());
+      hasher.Add (pSimplex->GetLacunarity ());
+      hasher.Add (pSimplex->GetOctaveCount ());
+      hasher.Add (pSimplex->GetPersistence ());
+      hasher.Add (pSimplex->GetSeed ());
+    } else if (AsModule<Voronoi> (sourceModule) != NULL
+      || AsModule<FastVoronoi> (sourceModule) != NULL) {
+      // Both modules output the same values for the same parameters.
+      const Voronoi& voronoi = static_cast<const Voronoi&> (sourceModule);
+      hasher.Add ("Voronoi");
+      hasher.Add (voronoi.GetDisplacement ());
+      hasher.Add (voronoi.GetFrequency ());
+      hasher.Add (voronoi.GetSeed ());
+      hasher.Add ((int)voronoi.IsDistanceEnabled ());
+    } else if (const Const* pConst = AsModule<Const> (sourceModule)) {
+      hasher.Add ("Const");
+      hasher.Add (pConst->GetConstValue ());
+    } else if (const Cylinders* pCylinders =
+      AsModule<Cylinders> (sourceModule)) {
+      hasher.Add ("Cylinders");
+      hasher.Add (pCylinders->GetFrequency ());
+    } else if (const Spheres* pSpheres = AsModule<Spheres> (sourceModule)) {
+      hasher.Add ("Spheres");
+      hasher.Add (pSpheres->GetFrequency ());
+    } else if (AsModule<Checkerboard> (sourceModule) != NULL) {
+      hasher.Add ("Checkerboard");
+    } else if (const ScaleBias* pScaleBias =
+      AsModule<ScaleBias> (sourceModule)) {
+      hasher.Add ("ScaleBias");
+      hasher.Add (pScaleBias->GetScale ());
+      hasher.Add (pScaleBias->GetBias ());
+    } else if (const Clamp* pClamp = AsModule<Clamp> (sourceModule)) {
+      hasher.Add ("Clamp");
+      hasher.Add (pClamp->GetLowerBound ());
+      hasher.Add (pClamp->GetUpperBound ());
+    } else if (const Exponent* pExponent = AsModule<Exponent> (sourceModule)) {
+      hasher.Add ("Exponent");
+      hasher.Add (pExponent->GetExponent ());
+    } else if (const Curve* pCurve = AsModule<Curve> (sourceModule)) {
+      hasher.Add ("Curve");
+      hasher.Add (pCurve->GetControlPointCount ());
+      for (int i = 0; i < pCurve->GetControlPointCount (); i++) {
+        hasher.Add (pCurve->GetControlPointArray ()[i].inputValue);
+        hasher.Add (pCurve->GetControlPointArray ()[i].outputValue);
+      }
+    } else if (const Terrace* pTerrace = AsModule<Terrace> (sourceModule)) {
+      hasher.Add ("Terrace");
+      hasher.Add ((int)pTerrace->IsTerracesInverted ());
+      hasher.Add (pTerrace->GetControlPointCount ());
+      for (int i = 0; i < pTerrace->GetControlPointCount (); i++) {
+        hasher.Add (pTerrace->GetControlPointArray ()[i]);
+      }
+    } else if (const Select* pSelect = AsModule<Select> (sourceModule)) {
+      hasher.Add ("Select");
+      hasher.Add (pSelect->GetLowerBound ());
+      hasher.Add (pSelect->GetUpperBound ());
+      hasher.Add (pSelect->GetEdgeFalloff ());
+    } else if (const Turbulence* pTurbulence =
+      AsModule<Turbulence> (sourceModule)) {
+      hasher.Add ("Turbulence");
+      hasher.Add (pTurbulence->GetFrequency ());
+      hasher.Add (pTurbulence->GetPower ());
+      hasher.Add (pTurbulence->GetRoughnessCount ());
+      hasher.Add (pTurbulence->GetSeed ());
+    } else if (const ScalePoint* pScalePoint =
+      AsModule<ScalePoint> (sourceModule)) {
+      hasher.Add ("ScalePoint");
+      hasher.Add (pScalePoint->GetXScale ());
+      hasher.Add (pScalePoint->GetYScale ());
+      hasher.Add (pScalePoint->GetZScale ());
+    } else if (const TranslatePoint* pTranslatePoint =
+      AsModule<TranslatePoint> (sourceModule)) {
+      hasher.Add ("TranslatePoint");
+      hasher.Add (pTranslatePoint->GetXTranslation ());
+      hasher.Add (pTranslatePoint->GetYTranslation ());
+      hasher.Add (pTranslatePoint->GetZTranslation ());
+    } else if (const RotatePoint* pRotatePoint =
+      AsModule<RotatePoint> (sourceModule)) {
+      hasher.Add ("RotatePoint");
+      hasher.Add (pRotatePoint->GetXAngle ());
+      hasher.Add (pRotatePoint->GetYAngle ());
+      hasher.Add (pRotatePoint->GetZAngle ());
+    } else if (AsModule<Abs> (sourceModule) != NULL) {
+      hasher.Add ("Abs");
+    } else if (AsModule<Invert> (sourceModule) != NULL) {
+      hasher.Add ("Invert");
+    } else if (AsModule<Add> (sourceModule) != NULL) {
+      hasher.Add ("Add");
+    } else if (AsModule<Multiply> (sourceModule) != NULL) {
+      hasher.Add ("Multiply");
+    } else if (AsModule<Max> (sourceModule) != NULL) {
+      hasher.Add ("Max");
+    } else if (AsModule<Min> (sourceModule) != NULL) {
+      hasher.Add ("Min");
+    } else if (AsModule<Power> (sourceModule) != NULL) {
+      hasher.Add ("Power");
+    } else if (AsModule<Blend> (sourceModule) != NULL) {
+      hasher.Add ("Blend");
+    } else if (AsModule<Displace> (sourceModule) != NULL) {
+      hasher.Add ("Displace");
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  // Computes the hash of the graph below a module.  A module that appears
+  // several times in the graph is hashed once.
+  bool GetSubgraphHash (const Module& sourceModule,
+    std::map<const Module*, unsigned long long>& hashes,
+    unsigned long long& hash)
+  {
+    std::map<const Module*, unsigned long long>::const_iterator found
+      = hashes.find (&sourceModule);
+    if (found != hashes.end ()) {
+      hash = found->second;
+      return true;
+    }
+
+    // Caching modules pass their source module's values through.
+    if (AsModule<Cache> (sourceModule) != NULL
+      || AsModule<ThreadCache> (sourceModule) != NULL
+      || AsModule<LruCache> (sourceModule) != NULL) {
+      if (!GetSubgraphHash (sourceModule.GetSourceModule (0), hashes, hash)) {
+        return false;
+      }
+      hashes[&sourceModule] = hash;
+      return true;
+    }
+
+    GraphHasher hasher;
+    if (!AddModuleParams (sourceModule, hasher)) {
+      return false;
+    }
+    int sourceModuleCount = sourceModule.GetSourceModuleCount ();
+    hasher.Add (sourceModuleCount);
+    for (int i = 0; i < sourceModuleCount; i++) {
+      unsigned long long sourceHash;
+      if (!GetSubgraphHash (sourceModule.GetSourceModule (i), hashes,
+        sourceHash)) {
+        return false;
+      }
+      hasher.Add (&sourceHash, sizeof (sourceHash));
+    }
+    hash = hasher.GetHash ();
+    hashes[&sourceModule] = hash;
+    return true;
+  }
+
+  // Determines if two doubles have the same bits, so that a NaN bound
+  // matches itself and -0.0 does not match 0.0.
+  inline bool IsSameBits (double a, double b)
+  {
+    return memcmp (&a, &b, sizeof (double)) == 0;
+  }
+
+  // Determines if a tile header matches a key.
+  bool IsHeaderMatch (const TileHeader& header, const NoiseMapTileKey& key)
+  {
+    return memcmp (header.magic, TILE_MAGIC, sizeof (TILE_MAGIC)) == 0
+      && header.version == TILE_FILE_VERSION
+      && header.graphHash == key.graphHash
+      && header.seed == key.seed
+      && header.width == key.width
+      && header.height == key.height
+      && header.channel == key.channel
+      && header.scale > 0.0f
+      && IsSameBits (header.lowerXBound, key.lowerXBound)
+      && IsSameBits (header.upperXBound, key.upperXBound)
+      && IsSameBits (header.lowerZBound, key.lowerZBound)
+      && IsSameBits (header.upperZBound, key.upperZBound);
+  }
+
+  // Creates a directory and its parents.  Returns false if the directory
+  // does not exist afterwards.
+  bool CreateDirectories (const std::string& directory)
+  {
+    for (size_t pos = 1; pos <= directory.size (); pos++) {
+      if (pos < directory.size () && directory[pos] != '/'
+        && directory[pos] != '\\') {
+        continue;
+      }
+      std::string parent = directory.substr (0, pos);
+#if NOISE_TILECACHE_MMAP
+      if (mkdir (parent.c_str (), 0755) != 0 && errno != EEXIST) {
+        return false;
+      }
+#else
+      _mkdir (parent.c_str ());
+#endif
+    }
+    return true;
+  }
+
+}
+
+bool noise::utils::GetModuleGraphHash (const Module& sourceModule,
+  unsigned long long& hash)
+{
+  std::map<const Module*, unsigned long long> hashes;
+  return GetSubgraphHash (sourceModule, hashes, hash);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// NoiseMapTile class
+
+NoiseMapTile::NoiseMapTile ():
+  m_pMapping (NULL),
+  m_mappingSize (0),
+  m_pValues (NULL),
+  m_scale (0.0),
+  m_bias (0.0),
+  m_width (0),
+  m_height (0)
+{
+}
+
+NoiseMapTile::~NoiseMapTile ()
+{
+  Release ();
+}
+
+void NoiseMapTile::Release ()
+{
+  if (m_pMapping != NULL) {
+#if NOISE_TILECACHE_MMAP
+    munmap (m_pMapping, m_mappingSize);
+#else
+    delete[] (char*)m_pMapping;
+#endif
+  }
+  m_pMapping = NULL;
+  m_mappingSize = 0;
+  m_pValues = NULL;
+  m_scale = 0.0;
+  m_bias = 0.0;
+  m_width = 0;
+  m_height = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// NoiseMapTileCache class
+
+NoiseMapTileCache::NoiseMapTileCache (const std::string& directory):
+  m_directory (directory),
+  m_hitCount (0),
+  m_missCount (0),
+  m_staleCount (0)
+{
+}
+
+std::string NoiseMapTileCache::GetTilePath (const NoiseMapTileKey& key)
+  const
+{
+  // The graph hash is left out, so that a tile generated by an older graph
+  // is found, recognized as stale and replaced instead of lingering.
+  GraphHasher hasher;
+  hasher.Add (key.seed);
+  hasher.Add (&key.lowerXBound, sizeof (double));
+  hasher.Add (&key.upperXBound, sizeof (double));
+  hasher.Add (&key.lowerZBound, sizeof (double));
+  hasher.Add (&key.upperZBound, sizeof (double));
+  hasher.Add (key.width);
+  hasher.Add (key.height);
+  if (key.channel != 0) {
+    // Value tiles keep the paths they had before channels existed.
+    hasher.Add (key.channel);
+  }
+  char name[32];
+  snprintf (name, sizeof (name), "%016llx.tile", hasher.GetHash ());
+  return m_directory + "/" + name;
+}
+
+bool NoiseMapTileCache::Load (const NoiseMapTileKey& key, NoiseMapTile& tile)
+{
+  if (key.width <= 0 || key.height <= 0) {
+    m_missCount++;
+    return false;
+  }
+  std::string path = GetTilePath (key);
+  size_t expectedSize = sizeof (TileHeader)
+    + (size_t)key.width * (size_t)key.height * sizeof (noise::uint16);
+
+#if NOISE_TILECACHE_MMAP
+  int file = open (path.c_str (), O_RDONLY);
+  if (file < 0) {
+    m_missCount++;
+    return false;
+  }
+  struct stat fileStatus;
+  void* pMapping = MAP_FAILED;
+  if (fstat (file, &fileStatus) == 0
+    && (size_t)fileStatus.st_size == expectedSize) {
+    pMapping = mmap (NULL, expectedSize, PROT_READ, MAP_PRIVATE, file, 0);
+  }
+  close (file);
+  if (pMapping == MAP_FAILED) {
+    pMapping = NULL;
+  } else if (!IsHeaderMatch (*(const TileHeader*)pMapping, key)) {
+    munmap (pMapping, expectedSize);
+    pMapping = NULL;
+  }
+#else
+  FILE* pFile = fopen (path.c_str (), "rb");
+  if (pFile == NULL) {
+    m_missCount++;
+    return false;
+  }
+  char* pMapping = new char[expectedSize + 1];
+  if (fread (pMapping, 1, expectedSize + 1, pFile) != expectedSize
+    || !IsHeaderMatch (*(const TileHeader*)pMapping, key)) {
+    delete[] pMapping;
+    pMapping = NULL;
+  }
+  fclose (pFile);
+#endif
+
+  if (pMapping == NULL) {
+    // The file exists but belongs to another graph, format or size.
+    remove (path.c_str ());
+    m_staleCount++;
+    m_missCount++;
+    return false;
+  }
+
+  tile.Release ();
+  tile.m_pMapping = pMapping;
+  tile.m_mappingSize = expectedSize;
+  tile.m_pValues = (const noise::uint16*)((const char*)pMapping
+    + sizeof (TileHeader));
+  tile.m_scale = ((const TileHeader*)pMapping)->scale;
+  tile.m_bias = ((const TileHeader*)pMapping)->bias;
+  tile.m_width = key.width;
+  tile.m_height = key.height;
+  m_hitCount++;
+  return true;
+}
+
+bool NoiseMapTileCache::Store (const NoiseMapTileKey& key,
+  const QuantizedNoiseMap& noiseMap)
+{
+  if (noiseMap.GetWidth () != key.width
+    || noiseMap.GetHeight () != key.height) {
+    throw noise::ExceptionInvalidParam ();
+  }
+  if (!CreateDirectories (m_directory)) {
+    return false;
+  }
+
+  TileHeader header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, TILE_MAGIC, sizeof (TILE_MAGIC));
+  header.version = TILE_FILE_VERSION;
+  header.graphHash = key.graphHash;
+  header.seed = key.seed;
+  header.width = key.width;
+  header.height = key.height;
+  header.channel = key.channel;
+  header.scale = noiseMap.GetScale ();
+  header.bias = noiseMap.GetBias ();
+  header.lowerXBound = key.lowerXBound;
+  header.upperXBound = key.upperXBound;
+  header.lowerZBound = key.lowerZBound;
+  header.upperZBound = key.upperZBound;
+
+  // Write a temporary file first and rename it over the tile file.
+  std::string path = GetTilePath (key);
+  char suffix[32];
+  snprintf (suffix, sizeof (suffix), ".%u.tmp",
+    g_tempFileCounter.fetch_add (1));
+  std::string tempPath = path + suffix;
+  FILE* pFile = fopen (tempPath.c_str (), "wb");
+  if (pFile == NULL) {
+    return false;
+  }
+  bool isWritten = fwrite (&header, sizeof (header), 1, pFile) == 1;
+  for (int y = 0; y < key.height && isWritten; y++) {
+    isWritten = fwrite (noiseMap.GetConstSlabPtr (y),
+      sizeof (noise::uint16), key.width, pFile) == (size_t)key.width;
+  }
+  isWritten = (fclose (pFile) == 0) && isWritten;
+
+#if !NOISE_TILECACHE_MMAP
+  remove (path.c_str ());
+#endif
+  if (!isWritten || rename (tempPath.c_str (), path.c_str ()) != 0) {
+    remove (tempPath.c_str ());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,204 @@
+#include <terrain/BakedWorld.h>
+#include <general/Config.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>   // For logging
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BAKED_WORLD_MMAP 1
+#else
+#define BAKED_WORLD_MMAP 0
+#endif
+
+namespace {
+  // File header; the index follows it, then the vertex buffers
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    int32_t worldSize;
+    int32_t chunkSize;
+    uint64_t dataSize;    // Bytes of vertex data after the index
+  };
+  static_assert(sizeof(Header) == 32, "the baked world header must not depend on padding");
+
+  const char MAGIC[4] = {'B', 'W', 'L', 'D'};
+
+  // Each chunk's buffer starts on a 16-byte boundary of the file
+  const uint64_t DATA_ALIGNMENT = 16;
+
+  // Makes temporary file names unique when several bakes run at once
+  std::atomic<unsigned int> tempFileCounter(0);
+
+  uint64_t alignUp(uint64_t value) {
+    return (value + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1);
+  }
+}
+
+BakedWorld::BakedWorld() : mapping(nullptr), mappingSize(0), index(nullptr), worldSize(0) {}
+
+BakedWorld::~BakedWorld() {
+  close();
+}
+
+bool BakedWorld::bake(const std::string& filename, int worldSize, uint64_t sourceHash,
+                      const std::vector<std::vector<float>>& meshes) {
+  const size_t chunkCount = (size_t)worldSize * worldSize;
+  if (worldSize <= 0 || meshes.size() != chunkCount) {
+    return false;
+  }
+
+  // Index entries are (offset from the start of the file, float count) pairs
+  std::vector<uint64_t> entries(chunkCount * 2);
+  uint64_t offset = alignUp(sizeof(Header) + entries.size() * sizeof(uint64_t));
+  const uint64_t dataStart = offset;
+  for (size_t c = 0; c < chunkCount; c++) {
+    entries[c * 2] = offset;
+    entries[c * 2 + 1] = meshes[c].size();
+    offset = alignUp(offset + meshes[c].size() * sizeof(float));
+  }
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = FILE_VERSION;
+  header.sourceHash = sourceHash;
+  header.worldSize = worldSize;
+  header.chunkSize = Config::World::CHUNK_SIZE;
+  header.dataSize = offset - dataStart;
+
+  std::error_code error;
+  std::filesystem::path path(filename);
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path(), error);
+  }
+
+  std::string tempName = filename + "." + std::to_string(tempFileCounter++) + ".tmp";
+  {
+    std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      std::cout << "[BAKE] Could not create " << tempName << std::endl;
+      return false;
+    }
+    const char padding[DATA_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(uint64_t));
+    uint64_t written = sizeof(header) + entries.size() * sizeof(uint64_t);
+    file.write(padding, dataStart - written);
+    for (size_t c = 0; c < chunkCount; c++) {
+      uint64_t bytes = meshes[c].size() * sizeof(float);
+      file.write(reinterpret_cast<const char*>(meshes[c].data()), bytes);
+      file.write(padding, alignUp(bytes) - bytes);
+    }
+    if (!file.flush()) {
+      file.close();
+      std::remove(tempName.c_str());
+      std::cout << "[BAKE] Could not write " << tempName << std::endl;
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tempName, filename, error);
+  if (error) {
+    std::remove(tempName.c_str());
+    std::cout << "[BAKE] Could not replace " << filename << ": " << error.message() << std::endl;
+    return false;
+  }
+
+  std::cout << "[BAKE] Wrote " << chunkCount << " chunk meshes (" << offset / 1024 << " KB) to " << filename
+            << std::endl;
+  return true;
+}
+
+bool BakedWorld::open(const std::string& filename, int worldSize, uint64_t sourceHash) {
+  close();
+
+#if BAKED_WORLD_MMAP
+  int file = ::open(filename.c_str(), O_RDONLY);
+  if (file < 0) {
+    return false;
+  }
+  struct stat status;
+  if (fstat(file, &status) != 0 || (size_t)status.st_size < sizeof(Header)) {
+    ::close(file);
+    return false;
+  }
+  size_t size = (size_t)status.st_size;
+  void* pages = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+  ::close(file);
+  if (pages == MAP_FAILED) {
+    return false;
+  }
+  mapping = pages;
+  mappingSize = size;
+#else
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return false;
+  }
+  buffer.resize((size_t)file.tellg());
+  file.seekg(0);
+  if (buffer.size() < sizeof(Header) || !file.read(buffer.data(), buffer.size())) {
+    buffer.clear();
+    return false;
+  }
+  mapping = buffer.data();
+  mappingSize = buffer.size();
+#endif
+
+  const Header* header = static_cast<const Header*>(mapping);
+  const size_t chunkCount = (size_t)worldSize * worldSize;
+  const uint64_t dataStart = alignUp(sizeof(Header) + chunkCount * 2 * sizeof(uint64_t));
+  bool valid = std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->version == FILE_VERSION &&
+               header->sourceHash == sourceHash && header->worldSize == worldSize &&
+               header->chunkSize == Config::World::CHUNK_SIZE && dataStart + header->dataSize == mappingSize;
+  const uint64_t* entries = reinterpret_cast<const uint64_t*>(static_cast<const char*>(mapping) + sizeof(Header));
+
+  // Every buffer must lie inside the file, a truncated or foreign file is ignored
+  for (size_t c = 0; valid && c < chunkCount; c++) {
+    uint64_t start = entries[c * 2];
+    uint64_t floats = entries[c * 2 + 1];
+    valid = start >= dataStart && start % DATA_ALIGNMENT == 0 && floats <= (mappingSize - start) / sizeof(float);
+  }
+  if (!valid) {
+    std::cout << "[BAKE] " << filename << " does not match the current world, ignoring it" << std::endl;
+    close();
+    return false;
+  }
+
+#if BAKED_WORLD_MMAP
+  // Uploads read the buffers front to back exactly once
+  madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+#endif
+  index = entries;
+  this->worldSize = worldSize;
+  return true;
+}
+
+void BakedWorld::close() {
+#if BAKED_WORLD_MMAP
+  if (mapping != nullptr) {
+    munmap(mapping, mappingSize);
+  }
+#else
+  buffer.clear();
+  buffer.shrink_to_fit();
+#endif
+  mapping = nullptr;
+  mappingSize = 0;
+  index = nullptr;
+  worldSize = 0;
+}
+
+const float* BakedWorld::getMesh(int i, int j, size_t& floatCount) const {
+  size_t c = (size_t)i * worldSize + j;
+  floatCount = (size_t)index[c * 2 + 1];
+  return reinterpret_cast<const float*>(static_cast<const char*>(mapping) + index[c * 2]);
+}
@@ -1,8 +1,5 @@
 #include <terrain/BlockRegistry.h>
 
-// Initialize singleton instance
-BlockRegistry* BlockRegistry::instance = nullptr;
-
 BlockRegistry::BlockRegistry() {
     // Initialize color map (RGB values for rendering)
     colorMap[BlockTexture::DEFAULT]        = glm::vec3(0.04f,   0.44f,   0.15f);
@@ -24,10 +21,10 @@ BlockRegistry::BlockRegistry() {
 }
 
 BlockRegistry& BlockRegistry::getInstance() {
-    if (instance == nullptr) {
-        instance = new BlockRegistry();
-    }
-    return *instance;
+    // Function-local static: initialization is thread-safe, and chunks are
+    // meshed on job system workers
+    static BlockRegistry instance;
+    return instance;
 }
 
 glm::vec3 BlockRegistry::getColor(BlockTexture texture) const {
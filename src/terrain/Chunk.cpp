@@ -3,22 +3,41 @@
 #include <general/GeometryUtils.h>
 #include <general/Config.h>
 #include <algorithm>  // For std::max
+#include <cmath>
 #include <iostream>   // For logging
 
-Chunk::Chunk() {
-  block3D = new Block **[CHUNK_SIZE];
-
-  for (int i = 0; i < CHUNK_SIZE; i++) {
-    block3D[i] = new Block *[CHUNK_SIZE];
-    for (int j = 0; j < CHUNK_SIZE; j++) {
-      block3D[i][j] = new Block[CHUNK_SIZE];
-    }
+namespace {
+
+// Bits per component of a packed normal
+const int OCTAHEDRAL_BITS = 12;
+
+// Packs a unit normal into one integer: the normal is projected onto the
+// octahedron |x| + |y| + |z| = 1, the lower half folded over the upper half
+// (y is up), and x and z quantized to OCTAHEDRAL_BITS each. Decoded in
+// SmoothShader.GLSL
+int packOctahedral(glm::vec3 normal) {
+  normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  glm::vec2 p(normal.x, normal.z);
+  if (normal.y < 0.0f) {
+    p = glm::vec2((1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                  (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
   }
+  const float maxValue = (float)((1 << OCTAHEDRAL_BITS) - 1);
+  int u = (int)std::round((p.x * 0.5f + 0.5f) * maxValue);
+  int v = (int)std::round((p.y * 0.5f + 0.5f) * maxValue);
+  return u | (v << OCTAHEDRAL_BITS);
+}
 
-  setupHeightMap();
+}
+
+Chunk::Chunk() : block3D(nullptr), voxelsPending(false) {
+  // Blocks are allocated on first use, see materializeBlocks()
 }
 
 Chunk::~Chunk() {
+  if (block3D == nullptr) {
+    return;
+  }
   for (int i = 0; i < CHUNK_SIZE; ++i) {
     for (int j = 0; j < CHUNK_SIZE; ++j) {
       delete[] block3D[i][j];
@@ -32,28 +51,36 @@ void Chunk::update(float dt) {
   // Todo
 }
 
-void Chunk::setupHeightMap() {
-  // 1. Setup Perlin Noise module
-  myModule.SetFrequency(0.01f);
-  heightMapBuilder.SetSourceModule(myModule);
-  heightMapBuilder.SetDestNoiseMap(heightMap);
-  heightMapBuilder.SetDestSize(CHUNK_SIZE, CHUNK_SIZE);
-
-  // 2. Setup Image renderer
-  renderer.SetSourceNoiseMap(heightMap);
-  renderer.SetDestImage(image);
-  renderer.ClearGradient();
-  renderer.AddGradientPoint(-1.0000, utils::Color(0,   0,   128, 255)); // depth
-  renderer.AddGradientPoint(-0.2500, utils::Color(0,   0,   255, 255)); // shallow
-  renderer.AddGradientPoint( 0.0000, utils::Color(0,   128, 255, 255)); // shore
-  renderer.AddGradientPoint( 0.0625, utils::Color(240, 240, 64,  255)); // sand
-  renderer.AddGradientPoint( 0.1250, utils::Color(32,  160, 0,   255)); // grass
-  renderer.AddGradientPoint( 0.3750, utils::Color(224, 224, 0,   255)); // dirt
-  renderer.AddGradientPoint( 0.7500, utils::Color(128, 128, 128, 255)); // rock
-  renderer.AddGradientPoint( 1.0000, utils::Color(255, 255, 255, 255)); // snow
-  
-  writer.SetSourceImage(image);
-  writer.SetDestFilename("terrain.bmp");
+Block*** Chunk::getBlocks() {
+  materializeBlocks();
+  return block3D;
+}
+
+void Chunk::materializeBlocks() {
+  if (block3D == nullptr) {
+    block3D = new Block **[CHUNK_SIZE];
+    for (int i = 0; i < CHUNK_SIZE; i++) {
+      block3D[i] = new Block *[CHUNK_SIZE];
+      for (int j = 0; j < CHUNK_SIZE; j++) {
+        block3D[i][j] = new Block[CHUNK_SIZE];
+      }
+    }
+  }
+  if (!voxelsPending) {
+    return;
+  }
+  voxelsPending = false;
+
+  // Fill every column of a smooth landscape up to its surface height
+  for (int x = 0; x < CHUNK_SIZE; x++) {
+    for (int z = 0; z < CHUNK_SIZE; z++) {
+      int height = (int)getSurfaceHeight(x, z);
+      for (int y = 0; y < height; y++) {
+        block3D[x][y][z].setActive(true);
+        block3D[x][y][z].setTexture(getTextureFromHeight((int)y));
+      }
+    }
+  }
 }
 
 BlockTexture Chunk::getTextureFromHeight(int height) {
@@ -74,6 +101,7 @@ BlockTexture Chunk::getTextureFromHeight(int height) {
 }
 
 void Chunk::createSphere() {
+  materializeBlocks();
   for (int z = 0; z < CHUNK_SIZE; ++z) {
     for (int y = 0; y < CHUNK_SIZE; ++y) {
       for (int x = 0; x < CHUNK_SIZE; ++x) {
@@ -87,6 +115,7 @@ void Chunk::createSphere() {
 }
 
 void Chunk::createCube() {
+  materializeBlocks();
   for (int z = 0; z < CHUNK_SIZE; ++z) {
     for (int y = 0; y < CHUNK_SIZE; ++y) {
       for (int x = 0; x < CHUNK_SIZE; ++x) {
@@ -125,22 +154,20 @@ void Chunk::createCube(std::vector<float> &vertices, Block block, glm::vec3 coor
   }
 }
 
-void Chunk::createLandscape(double dx, double dy) {
-  std::cout << "[TERRAIN] Creating landscape at offset (" << dx << ", " << dy << ")" << std::endl;
+void Chunk::createLandscape(const HeightfieldView& view) {
+  std::cout << "[TERRAIN] Creating landscape from shared height field" << std::endl;
 
-  // 1. Setup height map
-  heightMapBuilder.SetBounds(dx, dx + CHUNK_SIZE - 1, dy, dy + CHUNK_SIZE - 1);
-  heightMapBuilder.Build();
-  renderer.Render();
-
-  std::cout << "[TERRAIN] Height map built, generating terrain..." << std::endl;
+  // 1. Height map samples come from the shared Heightfield
+  heightfield = view;
+  voxelsPending = false;
+  materializeBlocks();
 
   // 2. Loop over chunk horizontal positions
   int blockCount = 0;
   for (int x = 0; x < CHUNK_SIZE; x++) {
     for (int z = 0; z < CHUNK_SIZE; z++) {
       // 3. Get height
-      float height = std::min((float)CHUNK_SIZE, ((heightMap.GetValue(x, CHUNK_SIZE - 1 - z) + 1.0f) * (CHUNK_SIZE / 2.0f) * 1.0f));
+      float height = std::min((float)CHUNK_SIZE, ((heightfield.getValue(x, CHUNK_SIZE - 1 - z) + 1.0f) * (CHUNK_SIZE / 2.0f) * 1.0f));
       height = std::max(1.0f,height);
       for (int y = 0; y < height; y++) {
         block3D[x][y][z].setActive(true);
@@ -153,42 +180,53 @@ void Chunk::createLandscape(double dx, double dy) {
   std::cout << "[TERRAIN] Created " << blockCount << " blocks in landscape" << std::endl;
 }
 
-void Chunk::createSmoothLandscape(double dx, double dy) {
-  std::cout << "[SMOOTH TERRAIN] Creating smooth landscape at offset (" << dx << ", " << dy << ")" << std::endl;
-
-  // 1. Setup and build height map with one extra sample for seamless edges
-  // This ensures adjacent chunks share edge heights
-  heightMapBuilder.SetBounds(dx, dx + CHUNK_SIZE, dy, dy + CHUNK_SIZE);
-  heightMapBuilder.SetDestSize(CHUNK_SIZE + 1, CHUNK_SIZE + 1);
-  heightMapBuilder.Build();
-  renderer.Render();
-
-  // 2. Store normalized height values (including edges at x=32, z=32)
-  for (int x = 0; x <= CHUNK_SIZE; x++) {
-    for (int z = 0; z <= CHUNK_SIZE; z++) {
-      float rawHeight = heightMap.GetValue(x, CHUNK_SIZE - z);
-      // Normalize to 0-CHUNK_SIZE range
-      heightMapData[x][z] = std::min((float)CHUNK_SIZE, ((rawHeight + 1.0f) * (CHUNK_SIZE / 2.0f)));
-      heightMapData[x][z] = std::max(1.0f, heightMapData[x][z]);
-    }
-  }
+void Chunk::createSmoothLandscape(const HeightfieldView& view) {
+  std::cout << "[SMOOTH TERRAIN] Creating smooth landscape from shared height field" << std::endl;
 
-  // 3. Still create block data for non-terrain features (like waterfall)
-  // But we'll render the smooth surface instead of cubes
-  for (int x = 0; x < CHUNK_SIZE; x++) {
-    for (int z = 0; z < CHUNK_SIZE; z++) {
-      int height = (int)heightMapData[x][z];
-      for (int y = 0; y < height; y++) {
-        block3D[x][y][z].setActive(true);
-        block3D[x][y][z].setTexture(getTextureFromHeight((int)y));
-      }
-    }
+  // 1. Keep a view of the shared samples, including the edges at x=32, z=32
+  // that the next chunks start with. Nothing is copied
+  heightfield = view;
+
+  // 2. Block data for non-terrain features (like waterfall) is only created
+  // when something asks for it; the smooth surface is rendered from the view
+  voxelsPending = true;
+  if (block3D != nullptr) {
+    // Blocks that already exist must not miss the new landscape
+    materializeBlocks();
   }
 
   std::cout << "[SMOOTH TERRAIN] Height map stored for smooth rendering" << std::endl;
 }
 
+float Chunk::getSurfaceHeight(int x, int z) const {
+  // Normalize to 0-CHUNK_SIZE range
+  float rawHeight = heightfield.getValue(x, CHUNK_SIZE - z);
+  float height = std::min((float)CHUNK_SIZE, ((rawHeight + 1.0f) * (CHUNK_SIZE / 2.0f)));
+  return std::max(1.0f, height);
+}
+
+glm::vec3 Chunk::getSurfaceNormal(int x, int z) const {
+  // Where the height is clamped the surface is flat
+  int row = CHUNK_SIZE - z;
+  float height = (heightfield.getValue(x, row) + 1.0f) * (CHUNK_SIZE / 2.0f);
+  if (height <= 1.0f || height >= (float)CHUNK_SIZE) {
+    return glm::vec3(0.0f, 1.0f, 0.0f);
+  }
+
+  // Noise slopes per block, scaled like the heights; z runs against the rows
+  float slopeX, slopeRow;
+  heightfield.getSlope(x, row, slopeX, slopeRow);
+  float dx = slopeX * (CHUNK_SIZE / 2.0f);
+  float dz = -slopeRow * (CHUNK_SIZE / 2.0f);
+  return glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+}
+
 void Chunk::clear() {
+  // A smooth landscape that was never voxelized is simply dropped
+  voxelsPending = false;
+  if (block3D == nullptr) {
+    return;
+  }
   for (int z = 0; z < CHUNK_SIZE; ++z) {
     for (int y = 0; y < CHUNK_SIZE; ++y) {
       for (int x = 0; x < CHUNK_SIZE; ++x) {
@@ -216,6 +254,7 @@ bool Chunk::isHidden(int x, int y, int z) const {
 std::vector<float> Chunk::render() {
   // 1. Initialize VAO
   std::vector<float> vertices;
+  materializeBlocks();
 
   // 2. Get the vertices
   for (int x = 0; x < CHUNK_SIZE; ++x) {
@@ -237,72 +276,52 @@ std::vector<float> Chunk::render() {
 
 std::vector<float> Chunk::renderSmooth() {
   std::cout << "[SMOOTH RENDER] Generating smooth terrain mesh..." << std::endl;
+
+  // Each corner is shared by up to six triangles, so its height and normal
+  // are looked up once
+  const int corners = CHUNK_SIZE + 1;
+  std::vector<float> heights(corners * corners);
+  std::vector<int> normals(corners * corners);
+  for (int z = 0; z < corners; z++) {
+    for (int x = 0; x < corners; x++) {
+      heights[z * corners + x] = getSurfaceHeight(x, z);
+      normals[z * corners + x] = packOctahedral(getSurfaceNormal(x, z));
+    }
+  }
+
+  // Two floats per vertex, both exact integers below 2^24:
+  // x | height in SMOOTH_HEIGHT_STEPS << 6 | z << 15 | colorID << 21, then the normal
   std::vector<float> vertices;
+  vertices.reserve(CHUNK_SIZE * CHUNK_SIZE * 6 * 2);
+  auto addVertex = [&](int x, int z, int colorID) {
+    int corner = z * corners + x;
+    int y = (int)round(heights[corner] * SMOOTH_HEIGHT_STEPS);
+    vertices.push_back(x | (y << 6) | (z << 15) | (colorID << 21));
+    vertices.push_back(normals[corner]);
+  };
 
   // Create a smooth triangulated surface based on height map
   // Render all quads including edges (x=0 to x=31, using heights up to x=32)
   for (int x = 0; x < CHUNK_SIZE; x++) {
     for (int z = 0; z < CHUNK_SIZE; z++) {
-      // Get heights of 4 corners of this quad
-      float h00 = heightMapData[x][z];       // bottom-left
-      float h10 = heightMapData[x+1][z];     // bottom-right
-      float h01 = heightMapData[x][z+1];     // top-left
-      float h11 = heightMapData[x+1][z+1];   // top-right
-
-      // Calculate smooth normal using cross product of edges
-      glm::vec3 v1(1.0f, h10 - h00, 0.0f);  // Edge to right
-      glm::vec3 v2(0.0f, h01 - h00, 1.0f);  // Edge forward
-      glm::vec3 normal = glm::normalize(glm::cross(v2, v1));
-
-      // Convert normal to encoded format (0, 1, 2 for -1, 0, 1)
-      int normX = (int)round(normal.x) + 1;
-      int normY = (int)round(normal.y) + 1;
-      int normZ = (int)round(normal.z) + 1;
-
-      // Get color based on average height using BlockRegistry
-      float avgHeight = (h00 + h10 + h01 + h11) / 4.0f;
+      // Get color based on average height of the 4 corners using BlockRegistry
+      float avgHeight = (heights[z * corners + x] + heights[z * corners + x + 1] +
+                         heights[(z + 1) * corners + x] + heights[(z + 1) * corners + x + 1]) / 4.0f;
       BlockTexture texture = getTextureFromHeight((int)avgHeight);
       int colorID = BlockRegistry::getInstance().getColorID(texture);
 
-      // Create 2 triangles for this quad
       // Triangle 1: h00, h10, h01
-      {
-        // Vertex 1: (x, h00, z) - use round() for better precision
-        int pos1 = x | ((int)round(h00) << 6) | (z << 12);
-        int encoded1 = pos1 | (normX | normY << 2 | normZ << 4) << 18 | colorID << 24;
-        vertices.push_back(encoded1);
-
-        // Vertex 2: (x+1, h10, z)
-        int pos2 = (x+1) | ((int)round(h10) << 6) | (z << 12);
-        int encoded2 = pos2 | (normX | normY << 2 | normZ << 4) << 18 | colorID << 24;
-        vertices.push_back(encoded2);
-
-        // Vertex 3: (x, h01, z+1)
-        int pos3 = x | ((int)round(h01) << 6) | ((z+1) << 12);
-        int encoded3 = pos3 | (normX | normY << 2 | normZ << 4) << 18 | colorID << 24;
-        vertices.push_back(encoded3);
-      }
+      addVertex(x, z, colorID);
+      addVertex(x + 1, z, colorID);
+      addVertex(x, z + 1, colorID);
 
       // Triangle 2: h10, h11, h01
-      {
-        // Vertex 1: (x+1, h10, z)
-        int pos1 = (x+1) | ((int)round(h10) << 6) | (z << 12);
-        int encoded1 = pos1 | (normX | normY << 2 | normZ << 4) << 18 | colorID << 24;
-        vertices.push_back(encoded1);
-
-        // Vertex 2: (x+1, h11, z+1)
-        int pos2 = (x+1) | ((int)round(h11) << 6) | ((z+1) << 12);
-        int encoded2 = pos2 | (normX | normY << 2 | normZ << 4) << 18 | colorID << 24;
-        vertices.push_back(encoded2);
-
-        // Vertex 3: (x, h01, z+1)
-        int pos3 = x | ((int)round(h01) << 6) | ((z+1) << 12);
-        int encoded3 = pos3 | (normX | normY << 2 | normZ << 4) << 18 | colorID << 24;
-        vertices.push_back(encoded3);
-      }
+      addVertex(x + 1, z, colorID);
+      addVertex(x + 1, z + 1, colorID);
+      addVertex(x, z + 1, colorID);
     }
   }
 
-  std::cout << "[SMOOTH RENDER] Generated " << vertices.size() << " vertices for smooth terrain" << std::endl;
+  std::cout << "[SMOOTH RENDER] Generated " << vertices.size() / 2 << " vertices for smooth terrain" << std::endl;
   return vertices;
 }
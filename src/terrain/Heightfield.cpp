@@ -0,0 +1,246 @@
+#include <terrain/Heightfield.h>
+#include <general/Config.h>
+#include <algorithm>
+#include <iostream>   // For logging
+
+Heightfield::Heightfield()
+    : tileCache(nullptr), samples(nullptr), xSlopes(nullptr), zSlopes(nullptr), stride(0), scale(0.0f), bias(0.0f),
+      slopeScale(0.0f), slopeBias(0.0f), withSlopes(false), firstChunkX(0), firstChunkZ(0), chunkCountX(0),
+      chunkCountZ(0) {
+  perlin.SetFrequency(Config::Terrain::NOISE_FREQUENCY);
+  builder.SetSourceModule(perlin);
+  // Heights are clamped to 1..CHUNK_SIZE, which is noise values up to 1
+  heightMap.SetRange(-1.0f, 1.0f);
+  xSlopeMap.SetRange(-Config::Terrain::MAX_NOISE_SLOPE, Config::Terrain::MAX_NOISE_SLOPE);
+  zSlopeMap.SetRange(-Config::Terrain::MAX_NOISE_SLOPE, Config::Terrain::MAX_NOISE_SLOPE);
+}
+
+void Heightfield::setTileCache(utils::NoiseMapTileCache* cache) {
+  tileCache = cache;
+}
+
+void Heightfield::setSlopeMaps(bool enable) {
+  withSlopes = enable;
+}
+
+void Heightfield::build(int firstChunkX, int firstChunkZ, int countX, int countZ) {
+  const int chunkSize = Config::World::CHUNK_SIZE;
+  this->firstChunkX = firstChunkX;
+  this->firstChunkZ = firstChunkZ;
+  chunkCountX = countX;
+  chunkCountZ = countZ;
+
+  // One sample per block plus the far edge: the bounds are one sample wider
+  // than the region so that the builder steps exactly one unit per sample
+  int width = countX * chunkSize + 1;
+  int height = countZ * chunkSize + 1;
+  double lowerX = (double)firstChunkX * chunkSize;
+  double lowerZ = (double)firstChunkZ * chunkSize;
+  tile.Release();
+  xSlopeTile.Release();
+  zSlopeTile.Release();
+
+  // The graph hash makes a tile generated with other noise parameters stale.
+  // The slopes are two more channels of the same region
+  utils::NoiseMapTileKey key;
+  bool isCacheable = tileCache != nullptr && utils::GetModuleGraphHash(perlin, key.graphHash);
+  utils::NoiseMapTileKey xSlopeKey;
+  utils::NoiseMapTileKey zSlopeKey;
+  if (isCacheable) {
+    key.seed = perlin.GetSeed();
+    key.lowerXBound = lowerX;
+    key.upperXBound = lowerX + width;
+    key.lowerZBound = lowerZ;
+    key.upperZBound = lowerZ + height;
+    key.width = width;
+    key.height = height;
+    key.channel = 0;
+    xSlopeKey = key;
+    xSlopeKey.channel = 1;
+    zSlopeKey = key;
+    zSlopeKey.channel = 2;
+    if (tileCache->Load(key, tile) &&
+        (!withSlopes || (tileCache->Load(xSlopeKey, xSlopeTile) && tileCache->Load(zSlopeKey, zSlopeTile)))) {
+      samples = tile.GetConstSlabPtr(0);
+      xSlopes = withSlopes ? xSlopeTile.GetConstSlabPtr(0) : nullptr;
+      zSlopes = withSlopes ? zSlopeTile.GetConstSlabPtr(0) : nullptr;
+      stride = tile.GetStride();
+      scale = tile.GetScale();
+      bias = tile.GetBias();
+      slopeScale = xSlopeTile.GetScale();
+      slopeBias = xSlopeTile.GetBias();
+      std::cout << "[HEIGHTFIELD] Loaded " << width << "x" << height << " samples for " << countX << "x" << countZ
+                << " chunks from the tile cache" << std::endl;
+      return;
+    }
+    tile.Release();
+    xSlopeTile.Release();
+    zSlopeTile.Release();
+  }
+
+  // Only one strip of rows is held as floats; each strip is quantized into
+  // the height and slope maps as soon as it is built. The slopes come out of
+  // the same noise evaluation as the heights
+  utils::NoiseMap strip;
+  utils::NoiseMap xSlopeStrip;
+  utils::NoiseMap zSlopeStrip;
+  builder.SetDestNoiseMap(strip);
+  if (withSlopes) {
+    builder.SetDestGradientMaps(xSlopeStrip, zSlopeStrip);
+  }
+  builder.SetBounds(lowerX, lowerX + width, lowerZ, lowerZ + height);
+  builder.SetDestSize(width, height);
+  heightMap.SetSize(width, height);
+  xSlopeMap.SetSize(withSlopes ? width : 0, withSlopes ? height : 0);
+  zSlopeMap.SetSize(withSlopes ? width : 0, withSlopes ? height : 0);
+  for (int firstRow = 0; firstRow < height; firstRow += Config::Terrain::HEIGHTFIELD_STRIP_ROWS) {
+    int lastRow = std::min(height, firstRow + Config::Terrain::HEIGHTFIELD_STRIP_ROWS);
+    builder.SetDestRowRange(firstRow, lastRow);
+    builder.Build();
+    heightMap.QuantizeRows(strip, 0, firstRow, lastRow - firstRow);
+    if (withSlopes) {
+      xSlopeMap.QuantizeRows(xSlopeStrip, 0, firstRow, lastRow - firstRow);
+      zSlopeMap.QuantizeRows(zSlopeStrip, 0, firstRow, lastRow - firstRow);
+    }
+  }
+  builder.ClearDestRowRange();
+  builder.ClearDestGradientMaps();
+  samples = heightMap.GetConstSlabPtr(0);
+  xSlopes = xSlopeMap.GetConstSlabPtr(0);
+  zSlopes = zSlopeMap.GetConstSlabPtr(0);
+  stride = heightMap.GetStride();
+  scale = heightMap.GetScale();
+  bias = heightMap.GetBias();
+  slopeScale = xSlopeMap.GetScale();
+  slopeBias = xSlopeMap.GetBias();
+
+  bool isStored = !isCacheable || (tileCache->Store(key, heightMap) &&
+                                   (!withSlopes || (tileCache->Store(xSlopeKey, xSlopeMap) &&
+                                                    tileCache->Store(zSlopeKey, zSlopeMap))));
+  if (!isStored) {
+    std::cout << "[HEIGHTFIELD] Could not write the tile cache in " << tileCache->GetDirectory() << std::endl;
+  }
+
+  std::cout << "[HEIGHTFIELD] Built " << width << "x" << height << " samples for " << countX << "x" << countZ
+            << " chunks" << std::endl;
+}
+
+bool Heightfield::renderNormalMap(int detail, utils::NormalMapFormat format, std::vector<uint8_t>& pixels, int& width,
+                                  int& height) {
+  if (chunkCountX <= 0 || chunkCountZ <= 0 || detail <= 0) {
+    return false;
+  }
+
+  // Same region as build(), `detail` pixels per block plus the far edge
+  const int chunkSize = Config::World::CHUNK_SIZE;
+  width = chunkCountX * chunkSize * detail + 1;
+  height = chunkCountZ * chunkSize * detail + 1;
+  double lowerX = (double)firstChunkX * chunkSize;
+  double lowerZ = (double)firstChunkZ * chunkSize;
+  double blocksX = (double)width / detail;
+  double blocksZ = (double)height / detail;
+
+  // Only a strip is held as floats, as in build()
+  utils::QuantizedNoiseMap detailMap;
+  detailMap.SetRange(-1.0f, 1.0f);
+  detailMap.SetSize(width, height);
+  utils::NoiseMap strip;
+  builder.SetDestNoiseMap(strip);
+  builder.SetBounds(lowerX, lowerX + blocksX, lowerZ, lowerZ + blocksZ);
+  builder.SetDestSize(width, height);
+  for (int firstRow = 0; firstRow < height; firstRow += Config::Terrain::HEIGHTFIELD_STRIP_ROWS) {
+    int lastRow = std::min(height, firstRow + Config::Terrain::HEIGHTFIELD_STRIP_ROWS);
+    builder.SetDestRowRange(firstRow, lastRow);
+    builder.Build();
+    detailMap.QuantizeRows(strip, 0, firstRow, lastRow - firstRow);
+  }
+  builder.ClearDestRowRange();
+
+  // A noise value of 1 is CHUNK_SIZE / 2 blocks high, and neighbouring
+  // pixels lie 1 / detail blocks apart
+  utils::RendererNormalMap renderer;
+  renderer.SetSourceNoiseMap(detailMap);
+  renderer.SetBumpHeight(chunkSize / 2.0 * detail);
+  pixels.resize(renderer.GetDestBufferSize(format));
+  renderer.SetDestBuffer(pixels.data(), format);
+  renderer.Render();
+
+  std::cout << "[HEIGHTFIELD] Rendered a " << width << "x" << height << " normal map" << std::endl;
+  return true;
+}
+
+HeightfieldView Heightfield::getChunkView(int chunkX, int chunkZ) const {
+  int x = chunkX - firstChunkX;
+  int z = chunkZ - firstChunkZ;
+  if (x < 0 || x >= chunkCountX || z < 0 || z >= chunkCountZ) {
+    return HeightfieldView();
+  }
+
+  const int chunkSize = Config::World::CHUNK_SIZE;
+  size_t offset = (size_t)(z * chunkSize) * stride + x * chunkSize;
+  return HeightfieldView(samples + offset, xSlopes ? xSlopes + offset : nullptr, zSlopes ? zSlopes + offset : nullptr,
+                         stride, scale, bias, slopeScale, slopeBias);
+}
+
+bool Heightfield::copyChunkTile(int chunkX, int chunkZ, uint16_t* tile) const {
+  int x = chunkX - firstChunkX;
+  int z = chunkZ - firstChunkZ;
+  if (x < 0 || x >= chunkCountX || z < 0 || z >= chunkCountZ) {
+    return false;
+  }
+
+  const int chunkSize = Config::World::CHUNK_SIZE;
+  const int tileSize = chunkSize + 3;
+  int lastColumn = chunkCountX * chunkSize;
+  int lastRow = chunkCountZ * chunkSize;
+  for (int row = 0; row < tileSize; row++) {
+    int sourceRow = std::min(lastRow, std::max(0, z * chunkSize + row - 1));
+    const uint16_t* source = samples + sourceRow * stride;
+    for (int column = 0; column < tileSize; column++) {
+      int sourceColumn = std::min(lastColumn, std::max(0, x * chunkSize + column - 1));
+      tile[row * tileSize + column] = source[sourceColumn];
+    }
+  }
+  return true;
+}
+
+unsigned long long Heightfield::getSourceHash() const {
+  unsigned long long hash = 0;
+  utils::GetModuleGraphHash(perlin, hash);
+  return hash;
+}
+
+void Heightfield::writeDebugImage(const std::string& filename) const {
+  // Only allocated on request, the game itself never needs the image
+  utils::Image image;
+  utils::RendererImage renderer;
+
+  // A cached tile is only mapped, so copy it into a noise map for the renderer
+  utils::QuantizedNoiseMap tileMap;
+  if (tile.IsLoaded()) {
+    tileMap.SetSize(tile.GetWidth(), tile.GetHeight());
+    tileMap.SetScaleBias(tile.GetScale(), tile.GetBias());
+    for (int y = 0; y < tile.GetHeight(); y++) {
+      std::copy(tile.GetConstSlabPtr(y), tile.GetConstSlabPtr(y) + tile.GetWidth(), tileMap.GetSlabPtr(y));
+    }
+  }
+  renderer.SetSourceNoiseMap(tile.IsLoaded() ? tileMap : heightMap);
+  renderer.SetDestImage(image);
+  renderer.ClearGradient();
+  renderer.AddGradientPoint(-1.0000, utils::Color(0,   0,   128, 255)); // depth
+  renderer.AddGradientPoint(-0.2500, utils::Color(0,   0,   255, 255)); // shallow
+  renderer.AddGradientPoint( 0.0000, utils::Color(0,   128, 255, 255)); // shore
+  renderer.AddGradientPoint( 0.0625, utils::Color(240, 240, 64,  255)); // sand
+  renderer.AddGradientPoint( 0.1250, utils::Color(32,  160, 0,   255)); // grass
+  renderer.AddGradientPoint( 0.3750, utils::Color(224, 224, 0,   255)); // dirt
+  renderer.AddGradientPoint( 0.7500, utils::Color(128, 128, 128, 255)); // rock
+  renderer.AddGradientPoint( 1.0000, utils::Color(255, 255, 255, 255)); // snow
+  renderer.Render();
+
+  utils::WriterBMP writer;
+  writer.SetSourceImage(image);
+  writer.SetDestFilename(filename);
+  writer.WriteDestFile();
+
+  std::cout << "[HEIGHTFIELD] Wrote height map image " << filename << std::endl;
+}
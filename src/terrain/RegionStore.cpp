@@ -0,0 +1,399 @@
+#include <terrain/RegionStore.h>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>   // For logging
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define REGION_STORE_MMAP 1
+#else
+#define REGION_STORE_MMAP 0
+#endif
+
+namespace {
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t regionSize;
+    uint32_t reserved;
+  };
+  static_assert(sizeof(Header) == 16, "the region header must not depend on padding");
+
+  // Offset table entry; an offset of 0 marks a chunk that was never saved
+  struct TableEntry {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t reserved;
+  };
+  static_assert(sizeof(TableEntry) == 16, "the region table must not depend on padding");
+
+  const char MAGIC[4] = {'R', 'G', 'N', 'F'};
+  const int CHUNK_SIZE = Chunk::CHUNK_SIZE;
+  const int BLOCKS_PER_CHUNK = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+  const int SLOTS_PER_REGION = RegionStore::REGION_SIZE * RegionStore::REGION_SIZE;
+  const size_t TABLE_OFFSET = sizeof(Header);
+  const size_t RECORDS_OFFSET = TABLE_OFFSET + SLOTS_PER_REGION * sizeof(TableEntry);
+  const int MAX_RUN = 0xffff;
+  const uint8_t ACTIVE_BIT = 0x80;
+
+  // Region coordinate of a chunk, rounding towards negative infinity
+  int regionOf(int chunk) {
+    return chunk >= 0 ? chunk / RegionStore::REGION_SIZE
+                      : -((-chunk - 1) / RegionStore::REGION_SIZE) - 1;
+  }
+
+  int slotOf(int chunkX, int chunkZ) {
+    int x = chunkX - regionOf(chunkX) * RegionStore::REGION_SIZE;
+    int z = chunkZ - regionOf(chunkZ) * RegionStore::REGION_SIZE;
+    return x * RegionStore::REGION_SIZE + z;
+  }
+
+  // Blocks are visited layer by layer from y = 0, then x, then z
+  Block& blockAt(Block*** blocks, int index) {
+    int y = index / (CHUNK_SIZE * CHUNK_SIZE);
+    int x = (index / CHUNK_SIZE) % CHUNK_SIZE;
+    int z = index % CHUNK_SIZE;
+    return blocks[x][y][z];
+  }
+
+  std::vector<uint8_t> encodeBlocks(Block*** blocks) {
+    std::vector<uint8_t> record;
+    int index = 0;
+    while (index < BLOCKS_PER_CHUNK) {
+      Block& first = blockAt(blocks, index);
+      uint8_t value = (uint8_t)first.getTexture() | (first.isActive() ? ACTIVE_BIT : 0);
+      int run = 1;
+      while (index + run < BLOCKS_PER_CHUNK && run < MAX_RUN) {
+        Block& next = blockAt(blocks, index + run);
+        if (((uint8_t)next.getTexture() | (next.isActive() ? ACTIVE_BIT : 0)) != value) {
+          break;
+        }
+        run++;
+      }
+      // Run: value, then the length as two little-endian bytes
+      record.push_back(value);
+      record.push_back((uint8_t)(run & 0xff));
+      record.push_back((uint8_t)(run >> 8));
+      index += run;
+    }
+    return record;
+  }
+
+  bool decodeBlocks(const uint8_t* record, size_t size, Chunk& chunk) {
+    // Check the whole record before the chunk is touched
+    if (size % 3 != 0) {
+      return false;
+    }
+    int total = 0;
+    for (size_t i = 0; i < size; i += 3) {
+      int run = record[i + 1] | (record[i + 2] << 8);
+      if ((record[i] & ~ACTIVE_BIT) >= BlockTexture::TOTAL || run == 0) {
+        return false;
+      }
+      total += run;
+    }
+    if (total != BLOCKS_PER_CHUNK) {
+      return false;
+    }
+
+    chunk.clear();
+    Block*** blocks = chunk.getBlocks();
+    int index = 0;
+    for (size_t i = 0; i < size; i += 3) {
+      bool active = (record[i] & ACTIVE_BIT) != 0;
+      BlockTexture texture = (BlockTexture)(record[i] & ~ACTIVE_BIT);
+      int run = record[i + 1] | (record[i + 2] << 8);
+      for (int r = 0; r < run; r++, index++) {
+        Block& block = blockAt(blocks, index);
+        block.setActive(active);
+        block.setTexture(texture);
+      }
+    }
+    return true;
+  }
+
+  bool isHeaderValid(const Header& header) {
+    return std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == RegionStore::FILE_VERSION &&
+           header.regionSize == (uint32_t)RegionStore::REGION_SIZE;
+  }
+
+  Header makeHeader() {
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = RegionStore::FILE_VERSION;
+    header.regionSize = RegionStore::REGION_SIZE;
+    return header;
+  }
+}
+
+RegionStore::RegionStore(const std::string& directory) : directory(directory) {}
+
+RegionStore::~RegionStore() {
+  JobSystem::getInstance().wait(flushJobs);
+  flushPending();
+  for (auto& pair : regions) {
+    unmapRegion(*pair.second);
+  }
+}
+
+RegionStore::Region& RegionStore::getRegion(int regionX, int regionZ) {
+  std::lock_guard<std::mutex> lock(regionsMutex);
+  std::unique_ptr<Region>& region = regions[std::make_pair(regionX, regionZ)];
+  if (!region) {
+    region = std::make_unique<Region>();
+    region->path = directory + "/r." + std::to_string(regionX) + "." + std::to_string(regionZ) + ".region";
+  }
+  return *region;
+}
+
+void RegionStore::unmapRegion(Region& region) {
+#if REGION_STORE_MMAP
+  if (region.mapping != nullptr) {
+    munmap(region.mapping, region.mappingSize);
+  }
+#else
+  region.buffer.clear();
+  region.buffer.shrink_to_fit();
+#endif
+  region.mapping = nullptr;
+  region.mappingSize = 0;
+}
+
+bool RegionStore::mapRegion(Region& region) {
+  if (region.mapping != nullptr) {
+    return true;
+  }
+
+#if REGION_STORE_MMAP
+  int file = open(region.path.c_str(), O_RDONLY);
+  if (file < 0) {
+    return false;
+  }
+  struct stat status;
+  void* pages = MAP_FAILED;
+  if (fstat(file, &status) == 0 && (size_t)status.st_size >= RECORDS_OFFSET) {
+    pages = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+  }
+  close(file);
+  if (pages == MAP_FAILED) {
+    return false;
+  }
+  region.mapping = pages;
+  region.mappingSize = (size_t)status.st_size;
+#else
+  std::ifstream file(region.path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return false;
+  }
+  region.buffer.resize((size_t)file.tellg());
+  file.seekg(0);
+  if (region.buffer.size() < RECORDS_OFFSET || !file.read(region.buffer.data(), region.buffer.size())) {
+    region.buffer.clear();
+    return false;
+  }
+  region.mapping = region.buffer.data();
+  region.mappingSize = region.buffer.size();
+#endif
+
+  if (!isHeaderValid(*static_cast<const Header*>(region.mapping))) {
+    std::cout << "[REGION] " << region.path << " is not a region file of this version, ignoring it" << std::endl;
+    unmapRegion(region);
+    return false;
+  }
+  return true;
+}
+
+bool RegionStore::loadChunk(int chunkX, int chunkZ, Chunk& chunk) {
+  std::pair<int, int> regionKey(regionOf(chunkX), regionOf(chunkZ));
+  int slot = slotOf(chunkX, chunkZ);
+
+  // Snapshots that have not reached the disk yet are newer than the file
+  std::vector<uint8_t> unwritten;
+  bool isUnwritten = false;
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    for (RecordBatch* batch : {&pending, &writing}) {
+      auto region = batch->find(regionKey);
+      if (region != batch->end()) {
+        auto record = region->second.find(slot);
+        if (record != region->second.end()) {
+          unwritten = record->second;
+          isUnwritten = true;
+          break;
+        }
+      }
+    }
+  }
+  if (isUnwritten) {
+    return decodeBlocks(unwritten.data(), unwritten.size(), chunk);
+  }
+
+  Region& region = getRegion(regionKey.first, regionKey.second);
+  std::lock_guard<std::mutex> lock(region.mutex);
+  if (!mapRegion(region)) {
+    return false;
+  }
+  const char* bytes = static_cast<const char*>(region.mapping);
+  const TableEntry& entry = reinterpret_cast<const TableEntry*>(bytes + TABLE_OFFSET)[slot];
+  if (entry.offset < RECORDS_OFFSET || entry.offset > region.mappingSize ||
+      entry.size > region.mappingSize - entry.offset) {
+    return false;
+  }
+  return decodeBlocks(reinterpret_cast<const uint8_t*>(bytes + entry.offset), entry.size, chunk);
+}
+
+void RegionStore::loadChunkAsync(int chunkX, int chunkZ, Chunk* chunk, bool* loaded, JobCounter& counter) {
+  JobSystem::getInstance().run(counter, [this, chunkX, chunkZ, chunk, loaded] {
+    *loaded = loadChunk(chunkX, chunkZ, *chunk);
+  });
+}
+
+void RegionStore::markDirty(int chunkX, int chunkZ, Chunk& chunk) {
+  std::vector<uint8_t> record = encodeBlocks(chunk.getBlocks());
+  std::lock_guard<std::mutex> lock(pendingMutex);
+  pending[std::make_pair(regionOf(chunkX), regionOf(chunkZ))][slotOf(chunkX, chunkZ)] = std::move(record);
+}
+
+void RegionStore::flushAsync() {
+  JobSystem::getInstance().run(flushJobs, [this] { flushPending(); });
+}
+
+void RegionStore::flush() {
+  flushAsync();
+  JobSystem::getInstance().wait(flushJobs);
+}
+
+void RegionStore::flushPending() {
+  // Flushes take their batch while holding flushMutex, so a later snapshot
+  // of a chunk is never overwritten by an earlier one
+  std::lock_guard<std::mutex> flushLock(flushMutex);
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    writing.swap(pending);
+  }
+  if (writing.empty()) {
+    return;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  for (auto& batch : writing) {
+    Region& region = getRegion(batch.first.first, batch.first.second);
+    std::lock_guard<std::mutex> lock(region.mutex);
+    if (!writeRecords(region, batch.second)) {
+      std::cout << "[REGION] Could not save " << batch.second.size() << " chunks to " << region.path << std::endl;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(pendingMutex);
+  writing.clear();
+}
+
+bool RegionStore::writeRecords(Region& region, const std::map<int, std::vector<uint8_t>>& records) {
+  // The mapping would not cover the appended records
+  unmapRegion(region);
+
+  std::vector<TableEntry> table(SLOTS_PER_REGION);
+  std::fstream file(region.path, std::ios::in | std::ios::out | std::ios::binary);
+  Header header;
+  if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !isHeaderValid(header) ||
+      !file.read(reinterpret_cast<char*>(table.data()), table.size() * sizeof(TableEntry))) {
+    // Missing or foreign file: start an empty region
+    file.close();
+    header = makeHeader();
+    std::fill(table.begin(), table.end(), TableEntry{0, 0, 0});
+    std::ofstream created(region.path, std::ios::binary | std::ios::trunc);
+    created.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    created.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(TableEntry));
+    if (!created.flush()) {
+      return false;
+    }
+    created.close();
+    file.open(region.path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file) {
+      return false;
+    }
+  }
+
+  // One append for every record of the batch, then one table update
+  file.seekp(0, std::ios::end);
+  uint64_t offset = (uint64_t)file.tellp();
+  std::vector<char> appended;
+  for (const auto& record : records) {
+    table[record.first].offset = offset + appended.size();
+    table[record.first].size = (uint32_t)record.second.size();
+    appended.insert(appended.end(), record.second.begin(), record.second.end());
+  }
+  file.write(appended.data(), appended.size());
+  file.seekp(TABLE_OFFSET);
+  file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(TableEntry));
+  if (!file.flush()) {
+    return false;
+  }
+  file.close();
+
+  // Replaced records are garbage; rewrite the region once they dominate it
+  uint64_t live = 0;
+  for (const TableEntry& entry : table) {
+    live += entry.size;
+  }
+  uint64_t garbage = offset + appended.size() - RECORDS_OFFSET - live;
+  if (garbage > live) {
+    compactRegion(region);
+  }
+  return true;
+}
+
+void RegionStore::compactRegion(Region& region) {
+  if (!mapRegion(region)) {
+    return;
+  }
+  const char* bytes = static_cast<const char*>(region.mapping);
+  std::vector<TableEntry> table(reinterpret_cast<const TableEntry*>(bytes + TABLE_OFFSET),
+                                reinterpret_cast<const TableEntry*>(bytes + TABLE_OFFSET) + SLOTS_PER_REGION);
+  for (TableEntry& entry : table) {
+    if (entry.offset < RECORDS_OFFSET || entry.offset > region.mappingSize ||
+        entry.size > region.mappingSize - entry.offset) {
+      entry = TableEntry{0, 0, 0};
+    }
+  }
+
+  // Live records are copied in slot order behind a fresh table
+  std::string tempPath = region.path + ".tmp";
+  std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+  Header header = makeHeader();
+  std::vector<TableEntry> compacted(SLOTS_PER_REGION, TableEntry{0, 0, 0});
+  uint64_t offset = RECORDS_OFFSET;
+  for (int slot = 0; slot < SLOTS_PER_REGION; slot++) {
+    if (table[slot].offset != 0) {
+      compacted[slot].offset = offset;
+      compacted[slot].size = table[slot].size;
+      offset += table[slot].size;
+    }
+  }
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(compacted.data()), compacted.size() * sizeof(TableEntry));
+  for (int slot = 0; slot < SLOTS_PER_REGION; slot++) {
+    if (table[slot].offset != 0) {
+      file.write(bytes + table[slot].offset, table[slot].size);
+    }
+  }
+  bool written = (bool)file.flush();
+  file.close();
+  unmapRegion(region);
+
+  std::error_code error;
+  if (written) {
+    std::filesystem::rename(tempPath, region.path, error);
+  }
+  if (!written || error) {
+    std::remove(tempPath.c_str());
+    std::cout << "[REGION] Could not compact " << region.path << std::endl;
+  }
+}
@@ -48,6 +48,10 @@ void Waterfall::create(double dx, double dy) {
     std::cout << "[WATERFALL] ========================================" << std::endl;
 }
 
+Chunk& Waterfall::getTerrain() {
+    return terrainChunk;
+}
+
 void Waterfall::createMountain() {
     Block*** blocks = terrainChunk.getBlocks();
 